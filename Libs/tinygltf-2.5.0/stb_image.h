@@ -869,7 +869,10 @@ static void    *stbi__pnm_load(stbi__context *s, int *x, int *y, int *comp, int
 static int      stbi__pnm_info(stbi__context *s, int *x, int *y, int *comp);
 #endif
 
-// this is not threadsafe
+// this is not threadsafe unless STBI_THREAD_LOCAL is defined (backported from stb_image 2.26)
+#ifdef STBI_THREAD_LOCAL
+STBI_THREAD_LOCAL
+#endif
 static const char *stbi__g_failure_reason;
 
 STBIDEF const char *stbi_failure_reason(void)
@@ -4029,8 +4029,22 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
 
+  // EXT_meshopt_compression fallback buffer without uri has no data; it is
+  // filled by decompressing the buffer views which refer to it
+  bool is_meshopt_fallback = false;
+  if (buffer->uri.empty()) {
+    json_const_iterator extensions_it, meshopt_it;
+    if (FindMember(o, "extensions", extensions_it) &&
+        IsObject(GetValue(extensions_it)) &&
+        FindMember(GetValue(extensions_it), "EXT_meshopt_compression",
+                   meshopt_it)) {
+      ParseBooleanProperty(&is_meshopt_fallback, nullptr, GetValue(meshopt_it),
+                           "fallback", false);
+    }
+  }
+
   // having an empty uri for a non embedded image should not be valid
-  if (!is_binary && buffer->uri.empty()) {
+  if (!is_binary && buffer->uri.empty() && !is_meshopt_fallback) {
     if (err) {
       (*err) += "'uri' is missing from non binary glTF file buffer.\n";
     }
@@ -4046,7 +4060,9 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
     }
   }
 
-  if (is_binary) {
+  if (is_meshopt_fallback) {
+    // No data
+  } else if (is_binary) {
     // Still binary glTF accepts external dataURI.
     if (!buffer->uri.empty()) {
       // First try embedded data URI.
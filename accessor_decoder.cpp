@@ -0,0 +1,365 @@
+#include "accessor_decoder.hpp"
+
+#include "gltf_utils.hpp"
+#include "log.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define ACCESSOR_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+using AccessorDecoder::AccessorView;
+
+
+size_t AccessorView::GetElementSize() const
+{
+    return (size_t)tinygltf::GetComponentSizeInBytes(componentType) * componentCount;
+}
+
+
+bool AccessorDecoder::GetAccessorView(AccessorView &view,
+                                      const tinygltf::Model &model,
+                                      const tinygltf::Accessor &accessor,
+                                      const wchar_t *logPrefix,
+                                      const wchar_t *logDataName)
+{
+    Log::Debug(L"%s%s accesor \"%s\": view %d, offset %d, type %s<%s>%s, count %d",
+               logPrefix,
+               logDataName,
+               Utils::StringToWstring(accessor.name).c_str(),
+               accessor.bufferView,
+               accessor.byteOffset,
+               GltfUtils::TypeToWstring(accessor.type).c_str(),
+               GltfUtils::ComponentTypeToWstring(accessor.componentType).c_str(),
+               accessor.normalized ? L" normalized" : L"",
+               accessor.count);
+
+    if (accessor.sparse.isSparse)
+    {
+        Log::Error(L"%sSparse %s accessors are not supported!", logPrefix, logDataName);
+        return false;
+    }
+
+    const auto componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    const auto componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+    if ((componentSize <= 0) || (componentCount <= 0))
+    {
+        Log::Error(L"%sInvalid %s accessor type!", logPrefix, logDataName);
+        return false;
+    }
+
+    // Buffer view
+
+    const auto bufferViewIdx = accessor.bufferView;
+    if ((bufferViewIdx < 0) || (bufferViewIdx >= model.bufferViews.size()))
+    {
+        Log::Error(L"%sInvalid %s view buffer index (%d/%d)!",
+                   logPrefix, logDataName, bufferViewIdx, model.bufferViews.size());
+        return false;
+    }
+
+    const auto &bufferView = model.bufferViews[bufferViewIdx];
+
+    // Buffer
+
+    const auto bufferIdx = bufferView.buffer;
+    if ((bufferIdx < 0) || (bufferIdx >= model.buffers.size()))
+    {
+        Log::Error(L"%sInvalid %s buffer index (%d/%d)!",
+                   logPrefix, logDataName, bufferIdx, model.buffers.size());
+        return false;
+    }
+
+    const auto &buffer = model.buffers[bufferIdx];
+
+    // Data
+
+    view.componentType  = accessor.componentType;
+    view.componentCount = (uint32_t)componentCount;
+    view.normalized     = accessor.normalized;
+    view.count          = accessor.count;
+
+    const auto elementSize = view.GetElementSize();
+    view.stride = (bufferView.byteStride == 0) ? elementSize : bufferView.byteStride;
+    if (view.stride < elementSize)
+    {
+        Log::Error(L"%s%s buffer view stride %d is smaller than the element size %d!",
+                   logPrefix, logDataName, view.stride, elementSize);
+        return false;
+    }
+
+    const size_t dataSize = (view.count > 0) ? (view.count - 1) * view.stride + elementSize : 0;
+    if ((bufferView.byteOffset + bufferView.byteLength > buffer.data.size()) ||
+        (accessor.byteOffset + dataSize > bufferView.byteLength))
+    {
+        Log::Error(L"%sAccessing data chunk outside %s buffer %d!",
+                   logPrefix, logDataName, bufferIdx);
+        return false;
+    }
+
+    view.data = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+
+    return true;
+}
+
+
+template <typename T, bool Normalized>
+static inline float ConvertComponent(T value)
+{
+    if (!Normalized)
+        return (float)value;
+
+    // As defined by glTF (and KHR_mesh_quantization) for normalized integers
+    const float scale = 1.f / (float)std::numeric_limits<T>::max();
+    const float result = (float)value * scale;
+    return std::is_signed<T>::value ? std::max(result, -1.f) : result;
+}
+
+
+// Generic path: elements with any source and output stride
+template <typename T, bool Normalized, uint32_t ComponentCount>
+static void DecodeElements(float *output,
+                           size_t outputStride,
+                           const uint8_t *src,
+                           size_t srcStride,
+                           size_t count)
+{
+    auto dst = reinterpret_cast<uint8_t*>(output);
+    for (size_t i = 0; i < count; i++, src += srcStride, dst += outputStride)
+    {
+        T values[ComponentCount];
+        memcpy(values, src, sizeof(values));
+
+        auto out = reinterpret_cast<float*>(dst);
+        for (uint32_t k = 0; k < ComponentCount; k++)
+            out[k] = ConvertComponent<T, Normalized>(values[k]);
+    }
+}
+
+
+#ifdef ACCESSOR_DECODER_SSE2
+
+// Converts 4 32-bit integers to floats, normalizing them if needed
+static inline __m128 ConvertVector(__m128i values, __m128 scale, bool clampToMinusOne)
+{
+    const __m128 result = _mm_mul_ps(_mm_cvtepi32_ps(values), scale);
+    return clampToMinusOne ? _mm_max_ps(result, _mm_set1_ps(-1.f)) : result;
+}
+
+
+// Widens the lower or upper 4 of 8 16-bit integers to 32 bits
+static inline __m128i Widen16Lo(__m128i values, bool isSigned)
+{
+    return isSigned ?
+        _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16) :
+        _mm_unpacklo_epi16(values, _mm_setzero_si128());
+}
+
+static inline __m128i Widen16Hi(__m128i values, bool isSigned)
+{
+    return isSigned ?
+        _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16) :
+        _mm_unpackhi_epi16(values, _mm_setzero_si128());
+}
+
+
+// Widens the lower or upper 8 of 16 8-bit integers to 16 bits
+static inline __m128i Widen8Lo(__m128i values, bool isSigned)
+{
+    return isSigned ?
+        _mm_srai_epi16(_mm_unpacklo_epi8(values, values), 8) :
+        _mm_unpacklo_epi8(values, _mm_setzero_si128());
+}
+
+static inline __m128i Widen8Hi(__m128i values, bool isSigned)
+{
+    return isSigned ?
+        _mm_srai_epi16(_mm_unpackhi_epi8(values, values), 8) :
+        _mm_unpackhi_epi8(values, _mm_setzero_si128());
+}
+
+
+// Converts the leading part of a stream of 8-bit or 16-bit integers; returns the number of converted ones
+template <typename T, bool Normalized>
+static size_t DecodeStreamSse2(float *output, const uint8_t *src, size_t count)
+{
+    const bool isSigned = std::is_signed<T>::value;
+    const __m128 scale = _mm_set1_ps(Normalized ? 1.f / (float)std::numeric_limits<T>::max() : 1.f);
+    const bool clampToMinusOne = Normalized && isSigned;
+
+    size_t i = 0;
+    if (sizeof(T) == 2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            _mm_storeu_ps(output + i,     ConvertVector(Widen16Lo(values, isSigned), scale, clampToMinusOne));
+            _mm_storeu_ps(output + i + 4, ConvertVector(Widen16Hi(values, isSigned), scale, clampToMinusOne));
+        }
+    }
+    else if (sizeof(T) == 1)
+    {
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i lo = Widen8Lo(values, isSigned);
+            const __m128i hi = Widen8Hi(values, isSigned);
+            _mm_storeu_ps(output + i,      ConvertVector(Widen16Lo(lo, isSigned), scale, clampToMinusOne));
+            _mm_storeu_ps(output + i + 4,  ConvertVector(Widen16Hi(lo, isSigned), scale, clampToMinusOne));
+            _mm_storeu_ps(output + i + 8,  ConvertVector(Widen16Lo(hi, isSigned), scale, clampToMinusOne));
+            _mm_storeu_ps(output + i + 12, ConvertVector(Widen16Hi(hi, isSigned), scale, clampToMinusOne));
+        }
+    }
+
+    return i;
+}
+
+#endif // ACCESSOR_DECODER_SSE2
+
+
+// Fast path: tightly packed components converted into tightly packed floats
+template <typename T, bool Normalized>
+static void DecodeStream(float *output, const uint8_t *src, size_t count)
+{
+    if (std::is_same<T, float>::value)
+    {
+        memcpy(output, src, count * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+#ifdef ACCESSOR_DECODER_SSE2
+    if (std::is_integral<T>::value && (sizeof(T) <= 2))
+        i = DecodeStreamSse2<T, Normalized>(output, src, count);
+#endif
+    for (; i < count; i++)
+    {
+        T value;
+        memcpy(&value, src + i * sizeof(T), sizeof(T));
+        output[i] = ConvertComponent<T, Normalized>(value);
+    }
+}
+
+
+template <typename T, bool Normalized>
+static void DecodeFloatsTyped(float *output,
+                              size_t outputStride,
+                              uint32_t outputComponents,
+                              const AccessorView &view)
+{
+    const uint32_t componentCount = std::min(view.componentCount, outputComponents);
+
+    if (view.IsContiguous() &&
+        (componentCount == view.componentCount) &&
+        (outputStride == componentCount * sizeof(float)))
+    {
+        DecodeStream<T, Normalized>(output, view.data, view.count * componentCount);
+        return;
+    }
+
+    switch (componentCount)
+    {
+    case 1: DecodeElements<T, Normalized, 1>(output, outputStride, view.data, view.stride, view.count); break;
+    case 2: DecodeElements<T, Normalized, 2>(output, outputStride, view.data, view.stride, view.count); break;
+    case 3: DecodeElements<T, Normalized, 3>(output, outputStride, view.data, view.stride, view.count); break;
+    case 4: DecodeElements<T, Normalized, 4>(output, outputStride, view.data, view.stride, view.count); break;
+    }
+}
+
+
+template <typename T>
+static void DecodeFloatsTyped(float *output,
+                              size_t outputStride,
+                              uint32_t outputComponents,
+                              const AccessorView &view)
+{
+    if (view.normalized && std::is_integral<T>::value)
+        DecodeFloatsTyped<T, true>(output, outputStride, outputComponents, view);
+    else
+        DecodeFloatsTyped<T, false>(output, outputStride, outputComponents, view);
+}
+
+
+void AccessorDecoder::DecodeFloats(float *output,
+                                   size_t outputStride,
+                                   uint32_t outputComponents,
+                                   const AccessorView &view)
+{
+    switch (view.componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:              DecodeFloatsTyped<int8_t>  (output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:     DecodeFloatsTyped<uint8_t> (output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:             DecodeFloatsTyped<int16_t> (output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:    DecodeFloatsTyped<uint16_t>(output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_INT:               DecodeFloatsTyped<int32_t> (output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:      DecodeFloatsTyped<uint32_t>(output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:             DecodeFloatsTyped<float>   (output, outputStride, outputComponents, view); break;
+    case TINYGLTF_COMPONENT_TYPE_DOUBLE:            DecodeFloatsTyped<double>  (output, outputStride, outputComponents, view); break;
+    }
+}
+
+
+template <typename T>
+static void DecodeIndicesTyped(uint32_t *output, const AccessorView &view)
+{
+    size_t i = 0;
+
+    if (view.IsContiguous())
+    {
+        if (sizeof(T) == 4)
+        {
+            memcpy(output, view.data, view.count * sizeof(uint32_t));
+            return;
+        }
+
+#ifdef ACCESSOR_DECODER_SSE2
+        const auto src = view.data;
+        if (sizeof(T) == 2)
+        {
+            for (; i + 8 <= view.count; i += 8)
+            {
+                const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),     Widen16Lo(values, false));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 4), Widen16Hi(values, false));
+            }
+        }
+        else if (sizeof(T) == 1)
+        {
+            for (; i + 16 <= view.count; i += 16)
+            {
+                const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                const __m128i lo = Widen8Lo(values, false);
+                const __m128i hi = Widen8Hi(values, false);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),      Widen16Lo(lo, false));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 4),  Widen16Hi(lo, false));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8),  Widen16Lo(hi, false));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 12), Widen16Hi(hi, false));
+            }
+        }
+#endif
+    }
+
+    for (auto src = view.data + i * view.stride; i < view.count; i++, src += view.stride)
+    {
+        T value;
+        memcpy(&value, src, sizeof(T));
+        output[i] = value;
+    }
+}
+
+
+void AccessorDecoder::DecodeIndices(uint32_t *output, const AccessorView &view)
+{
+    switch (tinygltf::GetComponentSizeInBytes(view.componentType))
+    {
+    case 1: DecodeIndicesTyped<uint8_t> (output, view); break;
+    case 2: DecodeIndicesTyped<uint16_t>(output, view); break;
+    case 4: DecodeIndicesTyped<uint32_t>(output, view); break;
+    }
+}
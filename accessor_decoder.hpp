@@ -0,0 +1,47 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Bulk decoding of glTF accessors. Each combination of component type, component count and
+// normalization has its own kernel, so no per-element dispatch is done. Tightly packed data
+// decoded into a tightly packed output is converted as one flat stream (memcpy or SSE2 widening).
+// Normalized integers are converted as defined by the glTF specification, which also covers
+// the attributes allowed by KHR_mesh_quantization.
+// ------------------------------------------------------------------------------------------------
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AccessorDecoder
+{
+    // Accessor data checked to lie within its buffer view
+    struct AccessorView
+    {
+        const uint8_t  *data = nullptr;
+        size_t          count = 0;
+        size_t          stride = 0;         // Bytes between elements
+        int             componentType = 0;  // TINYGLTF_COMPONENT_TYPE_*
+        uint32_t        componentCount = 0;
+        bool            normalized = false;
+
+        size_t  GetElementSize() const;
+        bool    IsContiguous() const { return stride == GetElementSize(); }
+    };
+
+    bool GetAccessorView(AccessorView &view,
+                         const tinygltf::Model &model,
+                         const tinygltf::Accessor &accessor,
+                         const wchar_t *logPrefix,
+                         const wchar_t *logDataName);
+
+    // Converts each element into outputComponents floats (1-4) placed outputStride bytes apart.
+    // If the accessor has fewer components, the remaining output components are left untouched.
+    void DecodeFloats(float *output,
+                      size_t outputStride,
+                      uint32_t outputComponents,
+                      const AccessorView &view);
+
+    // Widens scalar indices to 32 bits; signed types are read as unsigned ones of the same size
+    void DecodeIndices(uint32_t *output, const AccessorView &view);
+}
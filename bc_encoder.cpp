@@ -0,0 +1,629 @@
+#include "bc_encoder.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using BcEncoder::Format;
+using BcEncoder::Quality;
+
+// Texels of one block; only the leading channels are used by some of the encoders
+typedef float BlockTexels[16][4];
+
+
+// Writes bit fields from the least significant bit of the first byte on
+class BlockBitWriter
+{
+public:
+
+    void Write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t bit = 0; bit < bitCount; bit++, mOffset++)
+            if ((value >> bit) & 1)
+                mBits[mOffset / 64] |= 1ull << (mOffset % 64);
+    }
+
+    void Store(uint8_t *dst, uint32_t byteCount) const
+    {
+        for (uint32_t i = 0; i < byteCount; i++)
+            dst[i] = (uint8_t)(mBits[i / 8] >> ((i % 8) * 8));
+    }
+
+private:
+
+    uint64_t mBits[2] = {};
+    uint32_t mOffset = 0;
+};
+
+
+static float Clamp255(float value)
+{
+    return std::min(std::max(value, 0.f), 255.f);
+}
+
+
+static float SquaredDistance(const float *a, const float *b, int channelCount)
+{
+    float distance = 0.f;
+    for (int c = 0; c < channelCount; c++)
+        distance += (a[c] - b[c]) * (a[c] - b[c]);
+    return distance;
+}
+
+
+static void LoadBlock(BlockTexels &block,
+                      const uint8_t *texels,
+                      uint32_t width,
+                      uint32_t height,
+                      uint32_t blockX,
+                      uint32_t blockY)
+{
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        const uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            const uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+            const uint8_t *texel = texels + ((size_t)srcY * width + srcX) * 4;
+            for (int c = 0; c < 4; c++)
+                block[y * 4 + x][c] = texel[c];
+        }
+    }
+}
+
+
+// Endpoints of the segment covering all texels projected onto their principal axis
+static void ComputePrincipalEndpoints(const BlockTexels &texels,
+                                      int channelCount,
+                                      float (&e0)[4],
+                                      float (&e1)[4])
+{
+    float mean[4] = {}, minimum[4], maximum[4];
+    for (int c = 0; c < channelCount; c++)
+    {
+        minimum[c] = maximum[c] = texels[0][c];
+        for (int i = 0; i < 16; i++)
+        {
+            mean[c] += texels[i][c];
+            minimum[c] = std::min(minimum[c], texels[i][c]);
+            maximum[c] = std::max(maximum[c], texels[i][c]);
+        }
+        mean[c] /= 16.f;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int c0 = 0; c0 < channelCount; c0++)
+            for (int c1 = 0; c1 < channelCount; c1++)
+                covariance[c0][c1] += (texels[i][c0] - mean[c0]) * (texels[i][c1] - mean[c1]);
+
+    // Power iteration starting from the bounding box diagonal
+    float axis[4] = {};
+    float axisLength = 0.f;
+    for (int c = 0; c < channelCount; c++)
+    {
+        axis[c] = maximum[c] - minimum[c];
+        axisLength += axis[c] * axis[c];
+    }
+    if (axisLength == 0.f)
+    {
+        // Uniform block
+        for (int c = 0; c < 4; c++)
+            e0[c] = e1[c] = mean[c];
+        return;
+    }
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float product[4] = {};
+        float length = 0.f;
+        for (int c0 = 0; c0 < channelCount; c0++)
+        {
+            for (int c1 = 0; c1 < channelCount; c1++)
+                product[c0] += covariance[c0][c1] * axis[c1];
+            length += product[c0] * product[c0];
+        }
+        if (length < 1e-12f)
+            break; // Keep the last usable axis
+        length = std::sqrt(length);
+        for (int c = 0; c < channelCount; c++)
+            axis[c] = product[c] / length;
+    }
+
+    float tMin = 0.f, tMax = 0.f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.f;
+        for (int c = 0; c < channelCount; c++)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    // Normalization of a non-unit starting axis (single channel or no iteration done)
+    float axisSq = 0.f;
+    for (int c = 0; c < channelCount; c++)
+        axisSq += axis[c] * axis[c];
+    for (int c = 0; c < 4; c++)
+    {
+        e0[c] = (c < channelCount) ? Clamp255(mean[c] + tMin * axis[c] / axisSq) : 0.f;
+        e1[c] = (c < channelCount) ? Clamp255(mean[c] + tMax * axis[c] / axisSq) : 0.f;
+    }
+}
+
+
+// Endpoints which minimize the squared error of texels interpolated with the given weights
+static bool FitEndpoints(const BlockTexels &texels,
+                         int channelCount,
+                         const float (&weights)[16],
+                         float (&e0)[4],
+                         float (&e1)[4])
+{
+    float a00 = 0.f, a01 = 0.f, a11 = 0.f;
+    float b0[4] = {}, b1[4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        const float w1 = weights[i];
+        const float w0 = 1.f - w1;
+        a00 += w0 * w0;
+        a01 += w0 * w1;
+        a11 += w1 * w1;
+        for (int c = 0; c < channelCount; c++)
+        {
+            b0[c] += w0 * texels[i][c];
+            b1[c] += w1 * texels[i][c];
+        }
+    }
+
+    const float det = a00 * a11 - a01 * a01;
+    if (std::fabs(det) < 1e-6f)
+        return false;
+
+    for (int c = 0; c < channelCount; c++)
+    {
+        e0[c] = Clamp255((a11 * b0[c] - a01 * b1[c]) / det);
+        e1[c] = Clamp255((a00 * b1[c] - a01 * b0[c]) / det);
+    }
+
+    return true;
+}
+
+
+// --- BC1 ----------------------------------------------------------------------------------------
+
+struct Bc1Block
+{
+    uint16_t    color0;
+    uint16_t    color1;
+    uint8_t     indices[16];
+    float       weights[16];
+    float       error;
+};
+
+
+static uint16_t PackRgb565(const float (&color)[4])
+{
+    const uint32_t r = (uint32_t)std::lround(color[0] * 31.f / 255.f);
+    const uint32_t g = (uint32_t)std::lround(color[1] * 63.f / 255.f);
+    const uint32_t b = (uint32_t)std::lround(color[2] * 31.f / 255.f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+
+static void UnpackRgb565(uint16_t packed, float *color)
+{
+    const uint32_t r = (packed >> 11) & 31;
+    const uint32_t g = (packed >> 5) & 63;
+    const uint32_t b = packed & 31;
+    color[0] = (float)((r << 3) | (r >> 2));
+    color[1] = (float)((g << 2) | (g >> 4));
+    color[2] = (float)((b << 3) | (b >> 2));
+}
+
+
+static void EvaluateBc1(Bc1Block &block, const BlockTexels &texels)
+{
+    // Four-color mode requires color0 > color1
+    if (block.color0 < block.color1)
+        std::swap(block.color0, block.color1);
+
+    static const float kWeights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+    float palette[4][3];
+    UnpackRgb565(block.color0, palette[0]);
+    UnpackRgb565(block.color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+        palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+    }
+
+    // Equal colors switch the block to three-color mode, where only index 0 is safe
+    const int paletteSize = (block.color0 == block.color1) ? 1 : 4;
+
+    block.error = 0.f;
+    for (int i = 0; i < 16; i++)
+    {
+        int bestIdx = 0;
+        float bestDistance = SquaredDistance(texels[i], palette[0], 3);
+        for (int idx = 1; idx < paletteSize; idx++)
+        {
+            const float distance = SquaredDistance(texels[i], palette[idx], 3);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIdx = idx;
+            }
+        }
+        block.indices[i] = (uint8_t)bestIdx;
+        block.weights[i] = kWeights[bestIdx];
+        block.error += bestDistance;
+    }
+}
+
+
+static void EncodeBc1(uint8_t *dst, const BlockTexels &texels, Quality quality)
+{
+    float e0[4], e1[4];
+    ComputePrincipalEndpoints(texels, 3, e0, e1);
+
+    Bc1Block best;
+    best.color0 = PackRgb565(e0);
+    best.color1 = PackRgb565(e1);
+    EvaluateBc1(best, texels);
+
+    if (quality == Quality::kHigh)
+    {
+        for (int iteration = 0; (iteration < 2) && (best.error > 0.f); iteration++)
+        {
+            if (!FitEndpoints(texels, 3, best.weights, e0, e1))
+                break;
+
+            Bc1Block candidate;
+            candidate.color0 = PackRgb565(e0);
+            candidate.color1 = PackRgb565(e1);
+            EvaluateBc1(candidate, texels);
+            if (candidate.error >= best.error)
+                break;
+            best = candidate;
+        }
+    }
+
+    BlockBitWriter writer;
+    writer.Write(best.color0, 16);
+    writer.Write(best.color1, 16);
+    for (int i = 0; i < 16; i++)
+        writer.Write(best.indices[i], 2);
+    writer.Store(dst, 8);
+}
+
+
+// --- BC4 ----------------------------------------------------------------------------------------
+
+struct Bc4Block
+{
+    uint8_t     value0;
+    uint8_t     value1;
+    uint8_t     indices[16];
+    float       weights[16];
+    float       error;
+};
+
+
+static void EvaluateBc4(Bc4Block &block, const BlockTexels &texels)
+{
+    // Eight-value mode requires value0 > value1
+    if (block.value0 < block.value1)
+        std::swap(block.value0, block.value1);
+
+    float palette[8];
+    float weights[8];
+    palette[0] = block.value0;
+    palette[1] = block.value1;
+    weights[0] = 0.f;
+    weights[1] = 1.f;
+    for (int idx = 2; idx < 8; idx++)
+    {
+        weights[idx] = (idx - 1) / 7.f;
+        palette[idx] = (1.f - weights[idx]) * palette[0] + weights[idx] * palette[1];
+    }
+
+    // Equal values switch the block to six-value mode, where only index 0 is safe
+    const int paletteSize = (block.value0 == block.value1) ? 1 : 8;
+
+    block.error = 0.f;
+    for (int i = 0; i < 16; i++)
+    {
+        int bestIdx = 0;
+        float bestDistance = (texels[i][0] - palette[0]) * (texels[i][0] - palette[0]);
+        for (int idx = 1; idx < paletteSize; idx++)
+        {
+            const float distance = (texels[i][0] - palette[idx]) * (texels[i][0] - palette[idx]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIdx = idx;
+            }
+        }
+        block.indices[i] = (uint8_t)bestIdx;
+        block.weights[i] = weights[bestIdx];
+        block.error += bestDistance;
+    }
+}
+
+
+static void EncodeBc4(uint8_t *dst, const BlockTexels &block, int channel, Quality quality)
+{
+    BlockTexels texels;
+    for (int i = 0; i < 16; i++)
+        texels[i][0] = block[i][channel];
+
+    float e0[4], e1[4];
+    ComputePrincipalEndpoints(texels, 1, e0, e1);
+
+    Bc4Block best;
+    best.value0 = (uint8_t)std::lround(e0[0]);
+    best.value1 = (uint8_t)std::lround(e1[0]);
+    EvaluateBc4(best, texels);
+
+    if (quality == Quality::kHigh)
+    {
+        for (int iteration = 0; (iteration < 2) && (best.error > 0.f); iteration++)
+        {
+            if (!FitEndpoints(texels, 1, best.weights, e0, e1))
+                break;
+
+            Bc4Block candidate;
+            candidate.value0 = (uint8_t)std::lround(e0[0]);
+            candidate.value1 = (uint8_t)std::lround(e1[0]);
+            EvaluateBc4(candidate, texels);
+            if (candidate.error >= best.error)
+                break;
+            best = candidate;
+        }
+    }
+
+    BlockBitWriter writer;
+    writer.Write(best.value0, 8);
+    writer.Write(best.value1, 8);
+    for (int i = 0; i < 16; i++)
+        writer.Write(best.indices[i], 3);
+    writer.Store(dst, 8);
+}
+
+
+// --- BC7 (mode 6: single subset, RGBA 7.7.7.7 endpoints with unique p-bits, 4-bit indices) -------
+
+struct Bc7Block
+{
+    uint8_t     endpoints[2][4]; // 7-bit
+    uint8_t     pBits[2];
+    uint8_t     indices[16];
+    float       weights[16];
+    float       error;
+};
+
+
+static void QuantizeBc7Endpoint(const float (&value)[4], uint8_t (&endpoint)[4], uint8_t &pBit)
+{
+    float bestError = -1.f;
+    for (uint8_t p = 0; p < 2; p++)
+    {
+        uint8_t quantized[4];
+        float error = 0.f;
+        for (int c = 0; c < 4; c++)
+        {
+            const long q = std::lround((value[c] - p) / 2.f);
+            quantized[c] = (uint8_t)std::min(std::max(q, 0l), 127l);
+            const float restored = (float)(quantized[c] * 2 + p);
+            error += (restored - value[c]) * (restored - value[c]);
+        }
+        if ((bestError < 0.f) || (error < bestError))
+        {
+            bestError = error;
+            pBit = p;
+            memcpy(endpoint, quantized, sizeof(quantized));
+        }
+    }
+}
+
+
+static void EvaluateBc7(Bc7Block &block, const BlockTexels &texels)
+{
+    static const uint32_t kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    uint32_t ep[2][4];
+    for (int e = 0; e < 2; e++)
+        for (int c = 0; c < 4; c++)
+            ep[e][c] = block.endpoints[e][c] * 2u + block.pBits[e];
+
+    float palette[16][4];
+    for (int idx = 0; idx < 16; idx++)
+        for (int c = 0; c < 4; c++)
+            palette[idx][c] = (float)(((64 - kWeights[idx]) * ep[0][c] + kWeights[idx] * ep[1][c] + 32) >> 6);
+
+    block.error = 0.f;
+    for (int i = 0; i < 16; i++)
+    {
+        int bestIdx = 0;
+        float bestDistance = SquaredDistance(texels[i], palette[0], 4);
+        for (int idx = 1; idx < 16; idx++)
+        {
+            const float distance = SquaredDistance(texels[i], palette[idx], 4);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIdx = idx;
+            }
+        }
+        block.indices[i] = (uint8_t)bestIdx;
+        block.weights[i] = kWeights[bestIdx] / 64.f;
+        block.error += bestDistance;
+    }
+
+    // The most significant bit of the first (anchor) index is implicit zero
+    if (block.indices[0] >= 8)
+    {
+        for (int c = 0; c < 4; c++)
+            std::swap(block.endpoints[0][c], block.endpoints[1][c]);
+        std::swap(block.pBits[0], block.pBits[1]);
+        for (int i = 0; i < 16; i++)
+        {
+            block.indices[i] = (uint8_t)(15 - block.indices[i]);
+            block.weights[i] = 1.f - block.weights[i];
+        }
+    }
+}
+
+
+static void EncodeBc7(uint8_t *dst, const BlockTexels &texels, Quality quality)
+{
+    float e0[4], e1[4];
+    ComputePrincipalEndpoints(texels, 4, e0, e1);
+
+    Bc7Block best;
+    QuantizeBc7Endpoint(e0, best.endpoints[0], best.pBits[0]);
+    QuantizeBc7Endpoint(e1, best.endpoints[1], best.pBits[1]);
+    EvaluateBc7(best, texels);
+
+    if (quality == Quality::kHigh)
+    {
+        for (int iteration = 0; (iteration < 2) && (best.error > 0.f); iteration++)
+        {
+            if (!FitEndpoints(texels, 4, best.weights, e0, e1))
+                break;
+
+            Bc7Block candidate;
+            QuantizeBc7Endpoint(e0, candidate.endpoints[0], candidate.pBits[0]);
+            QuantizeBc7Endpoint(e1, candidate.endpoints[1], candidate.pBits[1]);
+            EvaluateBc7(candidate, texels);
+            if (candidate.error >= best.error)
+                break;
+            best = candidate;
+        }
+    }
+
+    BlockBitWriter writer;
+    writer.Write(1u << 6, 7); // Mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        writer.Write(best.endpoints[0][c], 7);
+        writer.Write(best.endpoints[1][c], 7);
+    }
+    writer.Write(best.pBits[0], 1);
+    writer.Write(best.pBits[1], 1);
+    writer.Write(best.indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        writer.Write(best.indices[i], 4);
+    writer.Store(dst, 16);
+}
+
+
+// ------------------------------------------------------------------------------------------------
+
+static void EncodeBlock(uint8_t *dst, Format format, Quality quality, const BlockTexels &texels)
+{
+    switch (format)
+    {
+    case Format::kBC1:
+        EncodeBc1(dst, texels, quality);
+        break;
+    case Format::kBC3:
+        EncodeBc4(dst, texels, 3, quality);
+        EncodeBc1(dst + 8, texels, quality);
+        break;
+    case Format::kBC4:
+        EncodeBc4(dst, texels, 0, quality);
+        break;
+    case Format::kBC5:
+        EncodeBc4(dst, texels, 0, quality);
+        EncodeBc4(dst + 8, texels, 1, quality);
+        break;
+    case Format::kBC7:
+        EncodeBc7(dst, texels, quality);
+        break;
+    default:
+        break;
+    }
+}
+
+
+uint32_t BcEncoder::GetBlockSize(Format format)
+{
+    switch (format)
+    {
+    case Format::kNone: return 4;
+    case Format::kBC1:
+    case Format::kBC4:  return 8;
+    case Format::kBC3:
+    case Format::kBC5:
+    case Format::kBC7:  return 16;
+    default:            return 0;
+    }
+}
+
+
+uint32_t BcEncoder::GetRowPitch(Format format, uint32_t width)
+{
+    if (format == Format::kNone)
+        return width * GetBlockSize(format);
+    else
+        return ((width + 3) / 4) * GetBlockSize(format);
+}
+
+
+size_t BcEncoder::GetImageSize(Format format, uint32_t width, uint32_t height)
+{
+    const size_t rowCount = (format == Format::kNone) ? height : (height + 3) / 4;
+    return rowCount * GetRowPitch(format, width);
+}
+
+
+void BcEncoder::EncodeImage(uint8_t *blocks,
+                            Format format,
+                            Quality quality,
+                            uint32_t width,
+                            uint32_t height,
+                            const uint8_t *texels,
+                            ThreadPool *pool)
+{
+    if ((width == 0) || (height == 0))
+        return;
+
+    if (format == Format::kNone)
+    {
+        memcpy(blocks, texels, GetImageSize(format, width, height));
+        return;
+    }
+
+    const uint32_t blockCountX = (width + 3) / 4;
+    const uint32_t blockCountY = (height + 3) / 4;
+    const uint32_t blockSize   = GetBlockSize(format);
+    const uint32_t rowPitch    = GetRowPitch(format, width);
+
+    auto encodeRow = [&](size_t blockY)
+    {
+        uint8_t *dst = blocks + blockY * rowPitch;
+        for (uint32_t blockX = 0; blockX < blockCountX; blockX++, dst += blockSize)
+        {
+            BlockTexels block;
+            LoadBlock(block, texels, width, height, blockX, (uint32_t)blockY);
+            EncodeBlock(dst, format, quality, block);
+        }
+    };
+
+    if (pool && (pool->GetThreadCount() > 1) && (blockCountY > 1))
+        pool->ParallelFor(blockCountY, encodeRow);
+    else
+        for (uint32_t blockY = 0; blockY < blockCountY; blockY++)
+            encodeRow(blockY);
+}
+
+
+bool BcEncoder::IsOpaque(const uint8_t *texels, size_t texelCount)
+{
+    for (size_t i = 0; i < texelCount; i++)
+        if (texels[i * 4 + 3] != 255)
+            return false;
+    return true;
+}
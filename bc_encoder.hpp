@@ -0,0 +1,49 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// CPU encoder of block-compressed texture formats (BC1, BC3, BC4, BC5 and BC7). Images are RGBA8
+// and are encoded in blocks of 4x4 texels; blocks reaching over the image edges are padded by
+// repeating the edge texels. sRGB images are encoded in sRGB space as they are.
+// ------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace BcEncoder
+{
+    enum class Format
+    {
+        kNone,  // Uncompressed RGBA8
+        kBC1,   // RGB, opaque
+        kBC3,   // RGBA: BC1 color and BC4 alpha
+        kBC4,   // R
+        kBC5,   // RG: two BC4 blocks
+        kBC7,   // RGBA, mode 6 blocks only
+    };
+
+    enum class Quality
+    {
+        kFast,  // Endpoints on the principal axis extents
+        kHigh,  // Endpoints refined by least squares fitting
+    };
+
+    // Number of bytes in one 4x4 block (or in one texel for Format::kNone)
+    uint32_t GetBlockSize(Format format);
+
+    uint32_t GetRowPitch(Format format, uint32_t width);
+    size_t   GetImageSize(Format format, uint32_t width, uint32_t height);
+
+    // Encodes the whole image into GetImageSize() bytes. If a pool is given, rows of blocks are
+    // encoded on its workers (must not be called from a worker of the same pool).
+    void EncodeImage(uint8_t *blocks,
+                     Format format,
+                     Quality quality,
+                     uint32_t width,
+                     uint32_t height,
+                     const uint8_t *texels,
+                     ThreadPool *pool = nullptr);
+
+    bool IsOpaque(const uint8_t *texels, size_t texelCount);
+}
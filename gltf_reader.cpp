@@ -0,0 +1,1392 @@
+#include "gltf_reader.hpp"
+
+#include "gltf_utils.hpp"
+#include "load_profiler.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// Not null-terminated part of the parsed data
+struct StringView
+{
+    const char  *data = nullptr;
+    size_t      size = 0;
+
+    bool operator ==(const char *other) const
+    {
+        return (strlen(other) == size) && (memcmp(data, other, size) == 0);
+    }
+
+    std::string ToString() const { return std::string(data, size); }
+};
+
+
+// Pull parser of JSON text. Objects and arrays are read via callbacks which have to read or skip
+// each member/element value. Strings are returned as views into the data unless they need
+// unescaping.
+class JsonReader
+{
+public:
+
+    JsonReader(const char *data, size_t size) :
+        mBegin(data),
+        mPos(data),
+        mEnd(data + size)
+    {}
+
+    const std::string&  GetError()  const { return mError; }
+    size_t              GetOffset() const { return (size_t)(mPos - mBegin); }
+
+    bool Fail(const char *message)
+    {
+        if (mError.empty())
+            mError = message;
+        return false;
+    }
+
+    template <typename F>
+    bool ReadObject(F readMember)
+    {
+        if (!Expect('{'))
+            return false;
+        SkipWhitespace();
+        if ((mPos < mEnd) && (*mPos == '}'))
+        {
+            mPos++;
+            return true;
+        }
+
+        for (;;)
+        {
+            StringView key;
+            bool hasEscapes;
+            if (!ReadRawString(key, hasEscapes) || !Expect(':'))
+                return false;
+            if (!readMember(key))
+                return false;
+            if (!ReadSeparator('}'))
+                return false;
+            if (mPos[-1] == '}')
+                return true;
+        }
+    }
+
+    template <typename F>
+    bool ReadArray(F readElement)
+    {
+        if (!Expect('['))
+            return false;
+        SkipWhitespace();
+        if ((mPos < mEnd) && (*mPos == ']'))
+        {
+            mPos++;
+            return true;
+        }
+
+        for (;;)
+        {
+            if (!readElement())
+                return false;
+            if (!ReadSeparator(']'))
+                return false;
+            if (mPos[-1] == ']')
+                return true;
+        }
+    }
+
+    // Content between the quotes, escape sequences are left as they are
+    bool ReadRawString(StringView &value, bool &hasEscapes)
+    {
+        if (!Expect('"'))
+            return false;
+
+        const char *begin = mPos;
+        const char *pos = begin;
+        for (;;)
+        {
+            const char *quote = static_cast<const char*>(memchr(pos, '"', (size_t)(mEnd - pos)));
+            if (!quote)
+                return Fail("Unterminated string");
+
+            // An escaped quote has an odd number of backslashes in front of it
+            size_t backslashCount = 0;
+            while ((quote - backslashCount > begin) && (quote[-1 - (ptrdiff_t)backslashCount] == '\\'))
+                backslashCount++;
+            if (backslashCount % 2 == 0)
+            {
+                value.data = begin;
+                value.size = (size_t)(quote - begin);
+                hasEscapes = memchr(begin, '\\', value.size) != nullptr;
+                mPos = quote + 1;
+                return true;
+            }
+            pos = quote + 1;
+        }
+    }
+
+    bool ReadString(std::string &value)
+    {
+        StringView rawValue;
+        bool hasEscapes;
+        if (!ReadRawString(rawValue, hasEscapes))
+            return false;
+        if (!hasEscapes)
+        {
+            value.assign(rawValue.data, rawValue.size);
+            return true;
+        }
+        return Unescape(value, rawValue);
+    }
+
+    bool Unescape(std::string &value, const StringView &rawValue)
+    {
+        value.clear();
+        value.reserve(rawValue.size);
+        const char *pos = rawValue.data;
+        const char *end = rawValue.data + rawValue.size;
+        while (pos < end)
+        {
+            if (*pos != '\\')
+            {
+                value.push_back(*pos++);
+                continue;
+            }
+            if (++pos >= end)
+                return Fail("Invalid escape sequence");
+            switch (*pos++)
+            {
+            case '"':   value.push_back('"'); break;
+            case '\\':  value.push_back('\\'); break;
+            case '/':   value.push_back('/'); break;
+            case 'b':   value.push_back('\b'); break;
+            case 'f':   value.push_back('\f'); break;
+            case 'n':   value.push_back('\n'); break;
+            case 'r':   value.push_back('\r'); break;
+            case 't':   value.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t codePoint;
+                if (!ReadHex4(codePoint, pos, end))
+                    return false;
+                if ((codePoint >= 0xd800) && (codePoint < 0xdc00))
+                {
+                    // Surrogate pair
+                    uint32_t lowSurrogate;
+                    if ((end - pos < 2) || (pos[0] != '\\') || (pos[1] != 'u'))
+                        return Fail("Invalid surrogate pair");
+                    pos += 2;
+                    if (!ReadHex4(lowSurrogate, pos, end) || (lowSurrogate < 0xdc00) || (lowSurrogate > 0xdfff))
+                        return Fail("Invalid surrogate pair");
+                    codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+                }
+                AppendUtf8(value, codePoint);
+                break;
+            }
+            default:
+                return Fail("Invalid escape sequence");
+            }
+        }
+        return true;
+    }
+
+    bool ReadNumber(double &value, bool *isInteger = nullptr)
+    {
+        SkipWhitespace();
+
+        // strtod needs a terminated string
+        char token[64];
+        size_t length = 0;
+        bool hasFraction = false;
+        while ((mPos < mEnd) && (length < sizeof(token) - 1) &&
+               (((*mPos >= '0') && (*mPos <= '9')) ||
+                (*mPos == '-') || (*mPos == '+') || (*mPos == '.') || (*mPos == 'e') || (*mPos == 'E')))
+        {
+            hasFraction |= (*mPos == '.') || (*mPos == 'e') || (*mPos == 'E');
+            token[length++] = *mPos++;
+        }
+        token[length] = '\0';
+
+        char *tokenEnd;
+        value = strtod(token, &tokenEnd);
+        if ((length == 0) || (tokenEnd != token + length))
+            return Fail("Invalid number");
+        if (isInteger)
+            *isInteger = !hasFraction;
+        return true;
+    }
+
+    bool ReadInt(int &value)
+    {
+        double number;
+        if (!ReadNumber(number))
+            return false;
+        if ((number < (double)std::numeric_limits<int>::min()) ||
+            (number > (double)std::numeric_limits<int>::max()) ||
+            (number != std::floor(number)))
+            return Fail("Invalid integer");
+        value = (int)number;
+        return true;
+    }
+
+    bool ReadSize(size_t &value)
+    {
+        double number;
+        if (!ReadNumber(number))
+            return false;
+        if ((number < 0.) || (number != std::floor(number)))
+            return Fail("Invalid size");
+        value = (size_t)number;
+        return true;
+    }
+
+    bool ReadBool(bool &value)
+    {
+        SkipWhitespace();
+        if (ReadLiteral("true"))
+            value = true;
+        else if (ReadLiteral("false"))
+            value = false;
+        else
+            return Fail("Invalid boolean");
+        return true;
+    }
+
+    bool ReadValue(tinygltf::Value &value)
+    {
+        SkipWhitespace();
+        if (mPos >= mEnd)
+            return Fail("Unexpected end of data");
+
+        switch (*mPos)
+        {
+        // Null members and elements are dropped, as with tinygltf
+        case '{':
+        {
+            tinygltf::Value::Object object;
+            if (!ReadObject([&](const StringView &key)
+                {
+                    tinygltf::Value member;
+                    if (!ReadValue(member))
+                        return false;
+                    if (member.Type() != tinygltf::NULL_TYPE)
+                        object[key.ToString()] = std::move(member);
+                    return true;
+                }))
+                return false;
+            value = tinygltf::Value(std::move(object));
+            return true;
+        }
+        case '[':
+        {
+            tinygltf::Value::Array array;
+            if (!ReadArray([&]()
+                {
+                    array.emplace_back();
+                    if (!ReadValue(array.back()))
+                        return false;
+                    if (array.back().Type() == tinygltf::NULL_TYPE)
+                        array.pop_back();
+                    return true;
+                }))
+                return false;
+            value = tinygltf::Value(std::move(array));
+            return true;
+        }
+        case '"':
+        {
+            std::string string;
+            if (!ReadString(string))
+                return false;
+            value = tinygltf::Value(std::move(string));
+            return true;
+        }
+        case 't':
+        case 'f':
+        {
+            bool boolean;
+            if (!ReadBool(boolean))
+                return false;
+            value = tinygltf::Value(boolean);
+            return true;
+        }
+        case 'n':
+            if (!ReadLiteral("null"))
+                return Fail("Invalid value");
+            value = tinygltf::Value();
+            return true;
+        default:
+        {
+            double number;
+            bool isInteger;
+            if (!ReadNumber(number, &isInteger))
+                return false;
+            if (isInteger &&
+                (number >= (double)std::numeric_limits<int>::min()) &&
+                (number <= (double)std::numeric_limits<int>::max()))
+                value = tinygltf::Value((int)number);
+            else
+                value = tinygltf::Value(number);
+            return true;
+        }
+        }
+    }
+
+    bool SkipValue()
+    {
+        SkipWhitespace();
+        if (mPos >= mEnd)
+            return Fail("Unexpected end of data");
+
+        switch (*mPos)
+        {
+        case '{':
+            return ReadObject([this](const StringView &) { return SkipValue(); });
+        case '[':
+            return ReadArray([this]() { return SkipValue(); });
+        case '"':
+        {
+            StringView string;
+            bool hasEscapes;
+            return ReadRawString(string, hasEscapes);
+        }
+        case 't':
+        case 'f':
+        {
+            bool boolean;
+            return ReadBool(boolean);
+        }
+        case 'n':
+            return ReadLiteral("null") || Fail("Invalid value");
+        default:
+        {
+            double number;
+            return ReadNumber(number);
+        }
+        }
+    }
+
+    bool IsAtEnd()
+    {
+        SkipWhitespace();
+        return mPos >= mEnd;
+    }
+
+private:
+
+    void SkipWhitespace()
+    {
+        while ((mPos < mEnd) && ((*mPos == ' ') || (*mPos == '\n') || (*mPos == '\r') || (*mPos == '\t')))
+            mPos++;
+    }
+
+    bool Expect(char c)
+    {
+        SkipWhitespace();
+        if ((mPos >= mEnd) || (*mPos != c))
+        {
+            char message[] = "Expected 'x'";
+            message[10] = c;
+            return Fail(message);
+        }
+        mPos++;
+        return true;
+    }
+
+    // Consumes ',' or the closing character
+    bool ReadSeparator(char closing)
+    {
+        SkipWhitespace();
+        if ((mPos < mEnd) && ((*mPos == ',') || (*mPos == closing)))
+        {
+            mPos++;
+            return true;
+        }
+        return Fail((closing == '}') ? "Expected ',' or '}'" : "Expected ',' or ']'");
+    }
+
+    bool ReadLiteral(const char *literal)
+    {
+        const size_t length = strlen(literal);
+        if (((size_t)(mEnd - mPos) < length) || (strncmp(mPos, literal, length) != 0))
+            return false;
+        mPos += length;
+        return true;
+    }
+
+    bool ReadHex4(uint32_t &value, const char *&pos, const char *end)
+    {
+        if (end - pos < 4)
+            return Fail("Invalid escape sequence");
+        value = 0;
+        for (int i = 0; i < 4; i++, pos++)
+        {
+            const char c = *pos;
+            uint32_t digit;
+            if ((c >= '0') && (c <= '9'))
+                digit = (uint32_t)(c - '0');
+            else if ((c >= 'a') && (c <= 'f'))
+                digit = (uint32_t)(c - 'a' + 10);
+            else if ((c >= 'A') && (c <= 'F'))
+                digit = (uint32_t)(c - 'A' + 10);
+            else
+                return Fail("Invalid escape sequence");
+            value = (value << 4) | digit;
+        }
+        return true;
+    }
+
+    static void AppendUtf8(std::string &string, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+            string.push_back((char)codePoint);
+        else if (codePoint < 0x800)
+        {
+            string.push_back((char)(0xc0 | (codePoint >> 6)));
+            string.push_back((char)(0x80 | (codePoint & 0x3f)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            string.push_back((char)(0xe0 | (codePoint >> 12)));
+            string.push_back((char)(0x80 | ((codePoint >> 6) & 0x3f)));
+            string.push_back((char)(0x80 | (codePoint & 0x3f)));
+        }
+        else
+        {
+            string.push_back((char)(0xf0 | (codePoint >> 18)));
+            string.push_back((char)(0x80 | ((codePoint >> 12) & 0x3f)));
+            string.push_back((char)(0x80 | ((codePoint >> 6) & 0x3f)));
+            string.push_back((char)(0x80 | (codePoint & 0x3f)));
+        }
+    }
+
+    const char      *mBegin;
+    const char      *mPos;
+    const char      *mEnd;
+    std::string     mError;
+};
+
+
+struct Base64Table
+{
+    uint8_t values[256];
+
+    Base64Table()
+    {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        memset(values, 0xff, sizeof(values));
+        for (uint8_t i = 0; i < 64; i++)
+            values[(uint8_t)alphabet[i]] = i;
+    }
+};
+
+
+static bool DecodeBase64(std::vector<unsigned char> &output, const char *data, size_t size)
+{
+    static const Base64Table table;
+
+    while ((size > 0) && (data[size - 1] == '='))
+        size--;
+    if (size % 4 == 1)
+        return false;
+
+    output.resize(size / 4 * 3 + ((size % 4 != 0) ? size % 4 - 1 : 0));
+    unsigned char *out = output.data();
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        const uint32_t a = table.values[(uint8_t)data[i + 0]];
+        const uint32_t b = table.values[(uint8_t)data[i + 1]];
+        const uint32_t c = table.values[(uint8_t)data[i + 2]];
+        const uint32_t d = table.values[(uint8_t)data[i + 3]];
+        if ((a | b | c | d) & 0x80)
+            return false;
+
+        const uint32_t bits = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = (unsigned char)(bits >> 16);
+        *out++ = (unsigned char)(bits >> 8);
+        *out++ = (unsigned char)bits;
+    }
+
+    // Last 2 or 3 characters
+    if (i < size)
+    {
+        uint32_t bits = 0;
+        const size_t remaining = size - i;
+        for (size_t k = 0; k < remaining; k++)
+        {
+            const uint32_t value = table.values[(uint8_t)data[i + k]];
+            if (value & 0x80)
+                return false;
+            bits |= value << (18 - 6 * k);
+        }
+        *out++ = (unsigned char)(bits >> 16);
+        if (remaining == 3)
+            *out++ = (unsigned char)(bits >> 8);
+    }
+
+    return true;
+}
+
+
+// Decodes a base64 data URI string value into data; the uri keeps just the part before the payload
+static bool ReadDataUri(JsonReader &reader,
+                        std::string &uri,
+                        std::vector<unsigned char> &data,
+                        bool &isDataUri)
+{
+    StringView rawUri;
+    bool hasEscapes;
+    if (!reader.ReadRawString(rawUri, hasEscapes))
+        return false;
+
+    // Base64 payload may have escaped slashes
+    std::string unescapedUri;
+    if (hasEscapes)
+    {
+        if (!reader.Unescape(unescapedUri, rawUri))
+            return false;
+        rawUri.data = unescapedUri.data();
+        rawUri.size = unescapedUri.size();
+    }
+
+    isDataUri = (rawUri.size >= 5) && (strncmp(rawUri.data, "data:", 5) == 0);
+    if (!isDataUri)
+    {
+        uri = rawUri.ToString();
+        return true;
+    }
+
+    static const char base64Marker[] = ";base64,";
+    const size_t markerLength = sizeof(base64Marker) - 1;
+    size_t payloadOffset = 0;
+    for (size_t i = 0; i + markerLength <= rawUri.size; i++)
+        if (strncmp(rawUri.data + i, base64Marker, markerLength) == 0)
+        {
+            payloadOffset = i + markerLength;
+            break;
+        }
+    if (payloadOffset == 0)
+        return reader.Fail("Data URI is not base64 encoded");
+
+    uri.assign(rawUri.data, payloadOffset);
+    if (!DecodeBase64(data, rawUri.data + payloadOffset, rawUri.size - payloadOffset))
+        return reader.Fail("Invalid base64 data");
+
+    return true;
+}
+
+
+static bool ReadIntArray(JsonReader &reader, std::vector<int> &values)
+{
+    values.clear();
+    return reader.ReadArray([&]() { values.push_back(0); return reader.ReadInt(values.back()); });
+}
+
+
+static bool ReadDoubleArray(JsonReader &reader, std::vector<double> &values)
+{
+    values.clear();
+    return reader.ReadArray([&]() { values.push_back(0.); return reader.ReadNumber(values.back()); });
+}
+
+
+static bool ReadStringArray(JsonReader &reader, std::vector<std::string> &values)
+{
+    values.clear();
+    return reader.ReadArray([&]() { values.emplace_back(); return reader.ReadString(values.back()); });
+}
+
+
+static bool ReadAttributeMap(JsonReader &reader, std::map<std::string, int> &attributes)
+{
+    return reader.ReadObject([&](const StringView &key) { return reader.ReadInt(attributes[key.ToString()]); });
+}
+
+
+static bool ReadExtensions(JsonReader &reader, tinygltf::ExtensionMap &extensions)
+{
+    return reader.ReadObject([&](const StringView &key) { return reader.ReadValue(extensions[key.ToString()]); });
+}
+
+
+template <typename T, typename F>
+static bool ReadObjectArray(JsonReader &reader, std::vector<T> &objects, F readObject)
+{
+    objects.clear();
+    return reader.ReadArray([&]()
+    {
+        objects.emplace_back();
+        return readObject(reader, objects.back());
+    });
+}
+
+
+static bool ReadAsset(JsonReader &reader, tinygltf::Asset &asset)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "version")
+            return reader.ReadString(asset.version);
+        if (key == "generator")
+            return reader.ReadString(asset.generator);
+        if (key == "minVersion")
+            return reader.ReadString(asset.minVersion);
+        if (key == "copyright")
+            return reader.ReadString(asset.copyright);
+        if (key == "extensions")
+            return ReadExtensions(reader, asset.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadScene(JsonReader &reader, tinygltf::Scene &scene)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(scene.name);
+        if (key == "nodes")
+            return ReadIntArray(reader, scene.nodes);
+        if (key == "extensions")
+            return ReadExtensions(reader, scene.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadNode(JsonReader &reader, tinygltf::Node &node)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(node.name);
+        if (key == "camera")
+            return reader.ReadInt(node.camera);
+        if (key == "skin")
+            return reader.ReadInt(node.skin);
+        if (key == "mesh")
+            return reader.ReadInt(node.mesh);
+        if (key == "children")
+            return ReadIntArray(reader, node.children);
+        if (key == "rotation")
+            return ReadDoubleArray(reader, node.rotation);
+        if (key == "scale")
+            return ReadDoubleArray(reader, node.scale);
+        if (key == "translation")
+            return ReadDoubleArray(reader, node.translation);
+        if (key == "matrix")
+            return ReadDoubleArray(reader, node.matrix);
+        if (key == "weights")
+            return ReadDoubleArray(reader, node.weights);
+        if (key == "extensions")
+            return ReadExtensions(reader, node.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadPrimitive(JsonReader &reader, tinygltf::Primitive &primitive)
+{
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "attributes")
+            return ReadAttributeMap(reader, primitive.attributes);
+        if (key == "indices")
+            return reader.ReadInt(primitive.indices);
+        if (key == "material")
+            return reader.ReadInt(primitive.material);
+        if (key == "mode")
+            return reader.ReadInt(primitive.mode);
+        if (key == "targets")
+            return reader.ReadArray([&]()
+            {
+                primitive.targets.emplace_back();
+                return ReadAttributeMap(reader, primitive.targets.back());
+            });
+        if (key == "extensions")
+            return ReadExtensions(reader, primitive.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadMesh(JsonReader &reader, tinygltf::Mesh &mesh)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(mesh.name);
+        if (key == "primitives")
+            return ReadObjectArray(reader, mesh.primitives, ReadPrimitive);
+        if (key == "weights")
+            return ReadDoubleArray(reader, mesh.weights);
+        if (key == "extensions")
+            return ReadExtensions(reader, mesh.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadAccessorType(JsonReader &reader, int &type)
+{
+    std::string name;
+    if (!reader.ReadString(name))
+        return false;
+
+    if (name == "SCALAR")
+        type = TINYGLTF_TYPE_SCALAR;
+    else if (name == "VEC2")
+        type = TINYGLTF_TYPE_VEC2;
+    else if (name == "VEC3")
+        type = TINYGLTF_TYPE_VEC3;
+    else if (name == "VEC4")
+        type = TINYGLTF_TYPE_VEC4;
+    else if (name == "MAT2")
+        type = TINYGLTF_TYPE_MAT2;
+    else if (name == "MAT3")
+        type = TINYGLTF_TYPE_MAT3;
+    else if (name == "MAT4")
+        type = TINYGLTF_TYPE_MAT4;
+    else
+        return reader.Fail("Invalid accessor type");
+    return true;
+}
+
+
+static bool ReadSparseAccessor(JsonReader &reader, tinygltf::Accessor &accessor)
+{
+    auto &sparse = accessor.sparse;
+    sparse.isSparse = true;
+    sparse.indices.byteOffset = 0;
+    sparse.values.byteOffset = 0;
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "count")
+            return reader.ReadInt(sparse.count);
+        if (key == "indices")
+            return reader.ReadObject([&](const StringView &indicesKey)
+            {
+                if (indicesKey == "bufferView")
+                    return reader.ReadInt(sparse.indices.bufferView);
+                if (indicesKey == "byteOffset")
+                    return reader.ReadInt(sparse.indices.byteOffset);
+                if (indicesKey == "componentType")
+                    return reader.ReadInt(sparse.indices.componentType);
+                return reader.SkipValue();
+            });
+        if (key == "values")
+            return reader.ReadObject([&](const StringView &valuesKey)
+            {
+                if (valuesKey == "bufferView")
+                    return reader.ReadInt(sparse.values.bufferView);
+                if (valuesKey == "byteOffset")
+                    return reader.ReadInt(sparse.values.byteOffset);
+                return reader.SkipValue();
+            });
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadAccessor(JsonReader &reader, tinygltf::Accessor &accessor)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(accessor.name);
+        if (key == "bufferView")
+            return reader.ReadInt(accessor.bufferView);
+        if (key == "byteOffset")
+            return reader.ReadSize(accessor.byteOffset);
+        if (key == "normalized")
+            return reader.ReadBool(accessor.normalized);
+        if (key == "componentType")
+            return reader.ReadInt(accessor.componentType);
+        if (key == "count")
+            return reader.ReadSize(accessor.count);
+        if (key == "type")
+            return ReadAccessorType(reader, accessor.type);
+        if (key == "min")
+            return ReadDoubleArray(reader, accessor.minValues);
+        if (key == "max")
+            return ReadDoubleArray(reader, accessor.maxValues);
+        if (key == "sparse")
+            return ReadSparseAccessor(reader, accessor);
+        if (key == "extensions")
+            return ReadExtensions(reader, accessor.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadBufferView(JsonReader &reader, tinygltf::BufferView &bufferView)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(bufferView.name);
+        if (key == "buffer")
+            return reader.ReadInt(bufferView.buffer);
+        if (key == "byteOffset")
+            return reader.ReadSize(bufferView.byteOffset);
+        if (key == "byteLength")
+            return reader.ReadSize(bufferView.byteLength);
+        if (key == "byteStride")
+            return reader.ReadSize(bufferView.byteStride);
+        if (key == "target")
+            return reader.ReadInt(bufferView.target);
+        if (key == "extensions")
+            return ReadExtensions(reader, bufferView.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+// Buffer data which is not in the JSON itself, loaded once the JSON is read
+struct PendingBuffer
+{
+    size_t  byteLength = 0;
+    bool    isDataUri = false;
+};
+
+
+static bool ReadBuffer(JsonReader &reader, tinygltf::Buffer &buffer, PendingBuffer &pending)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(buffer.name);
+        if (key == "uri")
+            return ReadDataUri(reader, buffer.uri, buffer.data, pending.isDataUri);
+        if (key == "byteLength")
+            return reader.ReadSize(pending.byteLength);
+        if (key == "extensions")
+            return ReadExtensions(reader, buffer.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadTextureInfo(JsonReader &reader, tinygltf::TextureInfo &info)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "index")
+            return reader.ReadInt(info.index);
+        if (key == "texCoord")
+            return reader.ReadInt(info.texCoord);
+        if (key == "extensions")
+            return ReadExtensions(reader, info.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadNormalTextureInfo(JsonReader &reader, tinygltf::NormalTextureInfo &info)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "index")
+            return reader.ReadInt(info.index);
+        if (key == "texCoord")
+            return reader.ReadInt(info.texCoord);
+        if (key == "scale")
+            return reader.ReadNumber(info.scale);
+        if (key == "extensions")
+            return ReadExtensions(reader, info.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadOcclusionTextureInfo(JsonReader &reader, tinygltf::OcclusionTextureInfo &info)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "index")
+            return reader.ReadInt(info.index);
+        if (key == "texCoord")
+            return reader.ReadInt(info.texCoord);
+        if (key == "strength")
+            return reader.ReadNumber(info.strength);
+        if (key == "extensions")
+            return ReadExtensions(reader, info.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadPbrMetallicRoughness(JsonReader &reader, tinygltf::PbrMetallicRoughness &pbr)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "baseColorFactor")
+            return ReadDoubleArray(reader, pbr.baseColorFactor);
+        if (key == "baseColorTexture")
+            return ReadTextureInfo(reader, pbr.baseColorTexture);
+        if (key == "metallicFactor")
+            return reader.ReadNumber(pbr.metallicFactor);
+        if (key == "roughnessFactor")
+            return reader.ReadNumber(pbr.roughnessFactor);
+        if (key == "metallicRoughnessTexture")
+            return ReadTextureInfo(reader, pbr.metallicRoughnessTexture);
+        if (key == "extensions")
+            return ReadExtensions(reader, pbr.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadMaterial(JsonReader &reader, tinygltf::Material &material)
+{
+    material.emissiveFactor = { 0., 0., 0. };
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(material.name);
+        if (key == "pbrMetallicRoughness")
+            return ReadPbrMetallicRoughness(reader, material.pbrMetallicRoughness);
+        if (key == "normalTexture")
+            return ReadNormalTextureInfo(reader, material.normalTexture);
+        if (key == "occlusionTexture")
+            return ReadOcclusionTextureInfo(reader, material.occlusionTexture);
+        if (key == "emissiveTexture")
+            return ReadTextureInfo(reader, material.emissiveTexture);
+        if (key == "emissiveFactor")
+            return ReadDoubleArray(reader, material.emissiveFactor);
+        if (key == "alphaMode")
+            return reader.ReadString(material.alphaMode);
+        if (key == "alphaCutoff")
+            return reader.ReadNumber(material.alphaCutoff);
+        if (key == "doubleSided")
+            return reader.ReadBool(material.doubleSided);
+        if (key == "extensions")
+            return ReadExtensions(reader, material.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadTexture(JsonReader &reader, tinygltf::Texture &texture)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(texture.name);
+        if (key == "sampler")
+            return reader.ReadInt(texture.sampler);
+        if (key == "source")
+            return reader.ReadInt(texture.source);
+        if (key == "extensions")
+            return ReadExtensions(reader, texture.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadImage(JsonReader &reader, tinygltf::Image &image)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(image.name);
+        if (key == "uri")
+        {
+            bool isDataUri;
+            if (!ReadDataUri(reader, image.uri, image.image, isDataUri))
+                return false;
+            if (isDataUri)
+            {
+                // As with tinygltf, the MIME type comes from the data URI and the URI itself is dropped
+                const auto semicolon = image.uri.find(';');
+                if (image.uri.compare(5, 6, "image/") == 0)
+                    image.mimeType = image.uri.substr(5, semicolon - 5);
+                image.uri.clear();
+            }
+            return true;
+        }
+        if (key == "mimeType")
+            return reader.ReadString(image.mimeType);
+        if (key == "bufferView")
+            return reader.ReadInt(image.bufferView);
+        if (key == "extensions")
+            return ReadExtensions(reader, image.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadSampler(JsonReader &reader, tinygltf::Sampler &sampler)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(sampler.name);
+        if (key == "minFilter")
+            return reader.ReadInt(sampler.minFilter);
+        if (key == "magFilter")
+            return reader.ReadInt(sampler.magFilter);
+        if (key == "wrapS")
+            return reader.ReadInt(sampler.wrapS);
+        if (key == "wrapT")
+            return reader.ReadInt(sampler.wrapT);
+        if (key == "extensions")
+            return ReadExtensions(reader, sampler.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadCamera(JsonReader &reader, tinygltf::Camera &camera)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "name")
+            return reader.ReadString(camera.name);
+        if (key == "type")
+            return reader.ReadString(camera.type);
+        if (key == "perspective")
+            return reader.ReadObject([&](const StringView &perspectiveKey)
+            {
+                auto &perspective = camera.perspective;
+                if (perspectiveKey == "aspectRatio")
+                    return reader.ReadNumber(perspective.aspectRatio);
+                if (perspectiveKey == "yfov")
+                    return reader.ReadNumber(perspective.yfov);
+                if (perspectiveKey == "zfar")
+                    return reader.ReadNumber(perspective.zfar);
+                if (perspectiveKey == "znear")
+                    return reader.ReadNumber(perspective.znear);
+                return reader.SkipValue();
+            });
+        if (key == "orthographic")
+            return reader.ReadObject([&](const StringView &orthographicKey)
+            {
+                auto &orthographic = camera.orthographic;
+                if (orthographicKey == "xmag")
+                    return reader.ReadNumber(orthographic.xmag);
+                if (orthographicKey == "ymag")
+                    return reader.ReadNumber(orthographic.ymag);
+                if (orthographicKey == "zfar")
+                    return reader.ReadNumber(orthographic.zfar);
+                if (orthographicKey == "znear")
+                    return reader.ReadNumber(orthographic.znear);
+                return reader.SkipValue();
+            });
+        if (key == "extensions")
+            return ReadExtensions(reader, camera.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+static bool ReadModel(JsonReader &reader, tinygltf::Model &model, std::vector<PendingBuffer> &pendingBuffers)
+{
+    return reader.ReadObject([&](const StringView &key)
+    {
+        if (key == "asset")
+            return ReadAsset(reader, model.asset);
+        if (key == "extensionsUsed")
+            return ReadStringArray(reader, model.extensionsUsed);
+        if (key == "extensionsRequired")
+            return ReadStringArray(reader, model.extensionsRequired);
+        if (key == "scene")
+            return reader.ReadInt(model.defaultScene);
+        if (key == "scenes")
+            return ReadObjectArray(reader, model.scenes, ReadScene);
+        if (key == "nodes")
+            return ReadObjectArray(reader, model.nodes, ReadNode);
+        if (key == "meshes")
+            return ReadObjectArray(reader, model.meshes, ReadMesh);
+        if (key == "accessors")
+            return ReadObjectArray(reader, model.accessors, ReadAccessor);
+        if (key == "bufferViews")
+            return ReadObjectArray(reader, model.bufferViews, ReadBufferView);
+        if (key == "buffers")
+        {
+            pendingBuffers.clear();
+            return ReadObjectArray(reader, model.buffers, [&](JsonReader &, tinygltf::Buffer &buffer)
+            {
+                pendingBuffers.emplace_back();
+                return ReadBuffer(reader, buffer, pendingBuffers.back());
+            });
+        }
+        if (key == "materials")
+            return ReadObjectArray(reader, model.materials, ReadMaterial);
+        if (key == "textures")
+            return ReadObjectArray(reader, model.textures, ReadTexture);
+        if (key == "images")
+            return ReadObjectArray(reader, model.images, ReadImage);
+        if (key == "samplers")
+            return ReadObjectArray(reader, model.samplers, ReadSampler);
+        if (key == "cameras")
+            return ReadObjectArray(reader, model.cameras, ReadCamera);
+        if (key == "extensions")
+            return ReadExtensions(reader, model.extensions);
+        return reader.SkipValue();
+    });
+}
+
+
+// Buffer view targets are implied by their use in primitives, as with tinygltf
+static void SetBufferViewTargets(tinygltf::Model &model)
+{
+    auto setTarget = [&model](int accessorIdx, int target)
+    {
+        if ((accessorIdx < 0) || ((size_t)accessorIdx >= model.accessors.size()))
+            return;
+        const int bufferViewIdx = model.accessors[accessorIdx].bufferView;
+        if ((bufferViewIdx >= 0) && ((size_t)bufferViewIdx < model.bufferViews.size()))
+            model.bufferViews[bufferViewIdx].target = target;
+    };
+
+    for (const auto &mesh : model.meshes)
+        for (const auto &primitive : mesh.primitives)
+        {
+            setTarget(primitive.indices, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+            for (const auto &attribute : primitive.attributes)
+                setTarget(attribute.second, TINYGLTF_TARGET_ARRAY_BUFFER);
+            for (const auto &target : primitive.targets)
+                for (const auto &attribute : target)
+                    setTarget(attribute.second, TINYGLTF_TARGET_ARRAY_BUFFER);
+        }
+}
+
+
+// Relative URIs may be percent-encoded
+static std::wstring GetUriFilePath(const std::wstring &baseDir, const std::string &uri)
+{
+    std::string decodedUri;
+    decodedUri.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if ((uri[i] == '%') && (i + 2 < uri.size()) && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+        {
+            decodedUri.push_back((char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else
+            decodedUri.push_back(uri[i]);
+    }
+
+    return baseDir + Utils::StringToWstring(decodedUri);
+}
+
+
+// Reads the file straight into data: the whole file, or its first size bytes if size is not zero
+static bool LoadExternalFile(std::vector<unsigned char> &data, const std::wstring &path, size_t size)
+{
+    LoadProfiler::ScopedTimer timer("file read", Utils::WstringToString(path));
+
+    FILE *file = nullptr;
+#ifdef _MSC_VER
+    _wfopen_s(&file, path.c_str(), L"rb");
+#else
+    file = fopen(Utils::WstringToString(path).c_str(), "rb");
+#endif
+    if (!file)
+        return false;
+
+    bool read = false;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        const long fileSize = ftell(file);
+        if ((fileSize >= 0) && ((size_t)fileSize >= size) && (fseek(file, 0, SEEK_SET) == 0))
+        {
+            data.resize((size != 0) ? size : (size_t)fileSize);
+            read = (fread(data.data(), 1, data.size(), file) == data.size());
+        }
+    }
+    fclose(file);
+    timer.SetBytes(data.size());
+
+    return read;
+}
+
+
+static bool LoadBuffers(tinygltf::Model &model,
+                        const std::vector<PendingBuffer> &pendingBuffers,
+                        const std::wstring &baseDir,
+                        const uint8_t *binaryChunk,
+                        size_t binaryChunkSize,
+                        const std::wstring &filePath)
+{
+    for (size_t i = 0; i < model.buffers.size(); i++)
+    {
+        auto &buffer = model.buffers[i];
+        const auto &pending = pendingBuffers[i];
+
+        if (pending.byteLength == 0)
+        {
+            Log::Error(L"GltfReader: Buffer %d has no byteLength in \"%s\"", (int)i, filePath.c_str());
+            return false;
+        }
+
+        if (pending.isDataUri)
+        {
+            if (buffer.data.size() < pending.byteLength)
+            {
+                Log::Error(L"GltfReader: Data URI of buffer %d is shorter than its length in \"%s\"",
+                           (int)i, filePath.c_str());
+                return false;
+            }
+            buffer.data.resize(pending.byteLength);
+        }
+        else if (!buffer.uri.empty())
+        {
+            if (!LoadExternalFile(buffer.data, GetUriFilePath(baseDir, buffer.uri), pending.byteLength))
+            {
+                Log::Error(L"GltfReader: Failed to load buffer \"%s\" of \"%s\"",
+                           Utils::StringToWstring(buffer.uri).c_str(), filePath.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            // EXT_meshopt_compression fallback buffer is filled by decompression
+            const auto meshopt = buffer.extensions.find("EXT_meshopt_compression");
+            if ((meshopt != buffer.extensions.end()) && meshopt->second.IsObject() &&
+                meshopt->second.Get("fallback").IsBool() && meshopt->second.Get("fallback").Get<bool>())
+                continue;
+
+            if (!binaryChunk || (pending.byteLength > binaryChunkSize))
+            {
+                Log::Error(L"GltfReader: Buffer %d has no data in \"%s\"", (int)i, filePath.c_str());
+                return false;
+            }
+            buffer.data.assign(binaryChunk, binaryChunk + pending.byteLength);
+        }
+    }
+
+    return true;
+}
+
+
+static bool LoadImages(tinygltf::Model &model, const std::wstring &baseDir, bool deferImageDecoding)
+{
+    for (auto &image : model.images)
+    {
+        if (image.image.empty())
+        {
+            if (image.bufferView >= 0)
+            {
+                if (image.bufferView >= model.bufferViews.size())
+                    continue;
+                const auto &bufferView = model.bufferViews[image.bufferView];
+                if ((bufferView.buffer < 0) || (bufferView.buffer >= model.buffers.size()))
+                    continue;
+                const auto &buffer = model.buffers[bufferView.buffer];
+                if (bufferView.byteOffset + bufferView.byteLength > buffer.data.size())
+                    continue;
+                const auto data = buffer.data.data() + bufferView.byteOffset;
+                image.image.assign(data, data + bufferView.byteLength);
+            }
+            else if (!image.uri.empty() && !tinygltf::IsDataURI(image.uri))
+            {
+                // Missing images are reported by their users, as with tinygltf
+                if (!LoadExternalFile(image.image, GetUriFilePath(baseDir, image.uri), 0))
+                    Log::Debug(L"GltfReader: Failed to load image \"%s\"",
+                               Utils::StringToWstring(image.uri).c_str());
+            }
+        }
+
+        if (image.image.empty())
+            continue;
+
+        image.as_is = true;
+        if (!deferImageDecoding && !GltfUtils::DecodeImage(image))
+            return false;
+    }
+
+    return true;
+}
+
+
+bool GltfReader::LoadModel(tinygltf::Model &model,
+                           const std::wstring &filePath,
+                           bool deferImageDecoding)
+{
+    // Pages of the mapped file are mostly read in during parsing
+    MappedFile file;
+    {
+        LoadProfiler::ScopedTimer timer("file read");
+        if (!file.Open(filePath))
+        {
+            Log::Error(L"GltfReader: Failed to open \"%s\"", filePath.c_str());
+            return false;
+        }
+        timer.SetBytes(file.GetSize());
+    }
+
+    const auto lastSeparator = filePath.find_last_of(L"/\\");
+    const std::wstring baseDir = (lastSeparator != std::wstring::npos) ? filePath.substr(0, lastSeparator + 1) : L"";
+
+    const uint8_t *json = file.GetData();
+    size_t jsonSize = file.GetSize();
+    const uint8_t *binaryChunk = nullptr;
+    size_t binaryChunkSize = 0;
+
+    // Binary glTF: 12-byte header, JSON chunk and optional binary chunk
+    if (Utils::GetFilePathExt(filePath) == L"glb")
+    {
+        const auto data = file.GetData();
+        const auto size = file.GetSize();
+        uint32_t header[5];
+        if (size < sizeof(header))
+        {
+            Log::Error(L"GltfReader: Invalid binary glTF \"%s\"", filePath.c_str());
+            return false;
+        }
+        memcpy(header, data, sizeof(header));
+        const uint32_t jsonChunkSize = header[3];
+        if ((memcmp(data, "glTF", 4) != 0) || (header[1] != 2) ||
+            (memcmp(data + 16, "JSON", 4) != 0) || (jsonChunkSize > size - sizeof(header)))
+        {
+            Log::Error(L"GltfReader: Invalid binary glTF \"%s\"", filePath.c_str());
+            return false;
+        }
+        json = data + sizeof(header);
+        jsonSize = jsonChunkSize;
+
+        const size_t binaryHeaderOffset = sizeof(header) + ((jsonChunkSize + 3) & ~3u);
+        if (binaryHeaderOffset + 8 <= size)
+        {
+            uint32_t binaryHeader[2];
+            memcpy(binaryHeader, data + binaryHeaderOffset, sizeof(binaryHeader));
+            if ((memcmp(data + binaryHeaderOffset + 4, "BIN\0", 4) == 0) &&
+                (binaryHeader[0] <= size - binaryHeaderOffset - 8))
+            {
+                binaryChunk = data + binaryHeaderOffset + 8;
+                binaryChunkSize = binaryHeader[0];
+            }
+        }
+    }
+
+    model = tinygltf::Model();
+    std::vector<PendingBuffer> pendingBuffers;
+    JsonReader reader(reinterpret_cast<const char*>(json), jsonSize);
+    if (!ReadModel(reader, model, pendingBuffers) || !reader.IsAtEnd())
+    {
+        Log::Error(L"GltfReader: %s at offset %llu in \"%s\"",
+                   Utils::StringToWstring(reader.GetError().empty() ? "Unexpected data" : reader.GetError()).c_str(),
+                   (unsigned long long)reader.GetOffset(),
+                   filePath.c_str());
+        return false;
+    }
+
+    SetBufferViewTargets(model);
+
+    if (!LoadBuffers(model, pendingBuffers, baseDir, binaryChunk, binaryChunkSize, filePath))
+        return false;
+
+    return LoadImages(model, baseDir, deferImageDecoding);
+}
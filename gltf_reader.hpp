@@ -0,0 +1,21 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Streaming glTF front end. The JSON is read in a single pass over the mapped file straight into
+// tinygltf::Model, without building a JSON document first. Base64 data URIs are decoded right into
+// their buffers (which then keep just the "data:...;base64," prefix as their uri) and images, and
+// the GLB binary chunk is copied just once. Only the parts of glTF used by the renderer are read:
+// animations, skins, extras and the legacy material parameter maps of tinygltf are skipped.
+// ------------------------------------------------------------------------------------------------
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
+
+#include <string>
+
+namespace GltfReader
+{
+    // Same contract as GltfUtils::LoadModel(); images decoded right away are 8-bit RGBA
+    bool LoadModel(tinygltf::Model &model,
+                   const std::wstring &filePath,
+                   bool deferImageDecoding);
+}
@@ -1,70 +1,389 @@
 #include "gltf_utils.hpp"
+#include "gltf_reader.hpp"
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifdef _MSC_VER
 #define STBI_MSC_SECURE_CRT
+#endif
+#define STBI_THREAD_LOCAL thread_local  // Images are decoded on loader worker threads
 #include "Libs/tinygltf-2.5.0/tiny_gltf.h"
 
+#include "load_profiler.hpp"
 #include "log.hpp"
+#include "meshopt_decoder.hpp"
 #include "utils.hpp"
 
-bool GltfUtils::LoadModel(tinygltf::Model &model, const std::wstring &filePath)
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <sstream>
+
+// Image loader for deferred decoding: just keeps the encoded image data
+static bool StoreEncodedImageData(tinygltf::Image *image,
+                                  const int /*imageIdx*/,
+                                  std::string * /*err*/,
+                                  std::string * /*warn*/,
+                                  int /*reqWidth*/,
+                                  int /*reqHeight*/,
+                                  const unsigned char *bytes,
+                                  int size,
+                                  void * /*userData*/)
+{
+    image->image.assign(bytes, bytes + size);
+    image->as_is = true;
+    return true;
+}
+
+
+// File reader and image loader of tinygltf, just timed by the load profiler
+static bool ReadWholeFileTimed(std::vector<unsigned char> *out,
+                               std::string *err,
+                               const std::string &filePath,
+                               void *userData)
+{
+    LoadProfiler::ScopedTimer timer("file read", filePath);
+    const bool success = tinygltf::ReadWholeFile(out, err, filePath, userData);
+    timer.SetBytes(out->size());
+    return success;
+}
+
+
+static bool LoadImageDataTimed(tinygltf::Image *image,
+                               const int imageIdx,
+                               std::string *err,
+                               std::string *warn,
+                               int reqWidth,
+                               int reqHeight,
+                               const unsigned char *bytes,
+                               int size,
+                               void *userData)
+{
+    LoadProfiler::ScopedTimer timer("image decode", image->name.empty() ? image->uri : image->name, size);
+    return tinygltf::LoadImageData(image, imageIdx, err, warn, reqWidth, reqHeight, bytes, size, userData);
+}
+
+
+// Reads a non-negative number; a missing optional property keeps the value
+static bool GetSizeProperty(size_t &value, const tinygltf::Value &object, const char *name, bool required)
+{
+    const auto &property = object.Get(name);
+    if (!property.IsNumber())
+        return !required && (property.Type() == tinygltf::NULL_TYPE);
+
+    const double number = property.GetNumberAsDouble();
+    if (number < 0.)
+        return false;
+
+    value = (size_t)number;
+    return true;
+}
+
+
+static bool GetMeshoptMode(MeshoptMode &mode, const tinygltf::Value &object)
+{
+    const auto &property = object.Get("mode");
+    if (!property.IsString())
+        return false;
+
+    const auto &name = property.Get<std::string>();
+    if (name == "ATTRIBUTES")
+        mode = MeshoptMode::kAttributes;
+    else if (name == "TRIANGLES")
+        mode = MeshoptMode::kTriangles;
+    else if (name == "INDICES")
+        mode = MeshoptMode::kIndices;
+    else
+        return false;
+    return true;
+}
+
+
+static bool GetMeshoptFilter(MeshoptFilter &filter, const tinygltf::Value &object)
+{
+    const auto &property = object.Get("filter");
+    if (property.Type() == tinygltf::NULL_TYPE)
+    {
+        filter = MeshoptFilter::kNone;
+        return true;
+    }
+    if (!property.IsString())
+        return false;
+
+    const auto &name = property.Get<std::string>();
+    if (name == "NONE")
+        filter = MeshoptFilter::kNone;
+    else if (name == "OCTAHEDRAL")
+        filter = MeshoptFilter::kOctahedral;
+    else if (name == "QUATERNION")
+        filter = MeshoptFilter::kQuaternion;
+    else if (name == "EXPONENTIAL")
+        filter = MeshoptFilter::kExponential;
+    else
+        return false;
+    return true;
+}
+
+
+// Buffer views compressed by EXT_meshopt_compression are decoded right into their buffer, so that
+// accessors read them just like uncompressed data. Buffers which contain the uncompressed data
+// already (fallback for loaders without the extension) are used as they are.
+static bool DecodeMeshoptBufferViews(tinygltf::Model &model, const std::wstring &filePath)
+{
+    struct CompressedView
+    {
+        size_t          viewIdx;
+        const uint8_t   *data;
+        size_t          dataSize;
+        size_t          count;
+        size_t          stride;
+        MeshoptMode     mode;
+        MeshoptFilter   filter;
+    };
+    std::vector<CompressedView> compressedViews;
+
+    // Buffers without data are filled by the decoded views
+    std::vector<size_t> decodedBufferSizes(model.buffers.size(), 0);
+    std::vector<bool> isBufferDecoded(model.buffers.size());
+    for (size_t i = 0; i < model.buffers.size(); i++)
+        isBufferDecoded[i] = model.buffers[i].data.empty();
+
+    for (size_t viewIdx = 0; viewIdx < model.bufferViews.size(); viewIdx++)
+    {
+        const auto &view = model.bufferViews[viewIdx];
+        const auto extension = view.extensions.find("EXT_meshopt_compression");
+        if (extension == view.extensions.end())
+            continue;
+
+        if ((view.buffer < 0) || (view.buffer >= model.buffers.size()))
+            continue; // Reported by accessors using the view
+        if (!isBufferDecoded[view.buffer])
+            continue;
+
+        const auto &parameters = extension->second;
+        CompressedView compressedView;
+        compressedView.viewIdx = viewIdx;
+        size_t bufferIdx = 0, byteOffset = 0, byteLength = 0;
+        if (!parameters.IsObject() ||
+            !GetSizeProperty(bufferIdx, parameters, "buffer", true) ||
+            !GetSizeProperty(byteOffset, parameters, "byteOffset", false) ||
+            !GetSizeProperty(byteLength, parameters, "byteLength", true) ||
+            !GetSizeProperty(compressedView.stride, parameters, "byteStride", true) ||
+            !GetSizeProperty(compressedView.count, parameters, "count", true) ||
+            !GetMeshoptMode(compressedView.mode, parameters) ||
+            !GetMeshoptFilter(compressedView.filter, parameters))
+        {
+            Log::Error(L"Gltf::LoadModel: Invalid EXT_meshopt_compression parameters of buffer view %d in \"%s\"",
+                       (int)viewIdx, filePath.c_str());
+            return false;
+        }
+
+        if ((bufferIdx >= model.buffers.size()) ||
+            (byteOffset > model.buffers[bufferIdx].data.size()) ||
+            (byteLength > model.buffers[bufferIdx].data.size() - byteOffset) ||
+            (compressedView.count * compressedView.stride > view.byteLength))
+        {
+            Log::Error(L"Gltf::LoadModel: EXT_meshopt_compression data of buffer view %d out of range in \"%s\"",
+                       (int)viewIdx, filePath.c_str());
+            return false;
+        }
+
+        compressedView.data = model.buffers[bufferIdx].data.data() + byteOffset;
+        compressedView.dataSize = byteLength;
+        compressedViews.push_back(compressedView);
+
+        auto &bufferSize = decodedBufferSizes[view.buffer];
+        bufferSize = std::max(bufferSize, view.byteOffset + view.byteLength);
+    }
+
+    if (compressedViews.empty())
+        return true;
+
+    LoadProfiler::ScopedTimer timer("meshopt decode");
+
+    for (size_t i = 0; i < model.buffers.size(); i++)
+        if (isBufferDecoded[i])
+            model.buffers[i].data.resize(decodedBufferSizes[i]);
+
+    size_t compressedSize = 0, decodedSize = 0;
+    for (const auto &compressedView : compressedViews)
+    {
+        const auto &view = model.bufferViews[compressedView.viewIdx];
+        auto output = model.buffers[view.buffer].data.data() + view.byteOffset;
+        if (!MeshoptDecoder::DecodeBufferView(output,
+                                              compressedView.count,
+                                              compressedView.stride,
+                                              compressedView.mode,
+                                              compressedView.filter,
+                                              compressedView.data,
+                                              compressedView.dataSize))
+        {
+            Log::Error(L"Gltf::LoadModel: Failed to decode EXT_meshopt_compression buffer view %d in \"%s\"",
+                       (int)compressedView.viewIdx, filePath.c_str());
+            return false;
+        }
+
+        compressedSize += compressedView.dataSize;
+        decodedSize += compressedView.count * compressedView.stride;
+    }
+    timer.SetBytes(decodedSize);
+
+    Log::Debug(L"Gltf::LoadModel: Decoded %d meshopt compressed buffer view(s), %d KB -> %d KB",
+               (int)compressedViews.size(), (int)(compressedSize >> 10), (int)(decodedSize >> 10));
+
+    return true;
+}
+
+
+bool GltfUtils::LoadModel(tinygltf::Model &model,
+                          const std::wstring &filePath,
+                          bool deferImageDecoding,
+                          GltfFrontEnd frontEnd)
 {
     using namespace std;
 
+    const auto startTime = chrono::steady_clock::now();
+
     // Convert to plain string for tinygltf
     string filePathA = Utils::WstringToString(filePath);
 
-    tinygltf::TinyGLTF tinyGltf;
-    string errA, warnA;
-    wstring ext = Utils::GetFilePathExt(filePath);
+    // File reading and image decoding nested in the parsing are profiled separately
+    LoadProfiler::ScopedTimer parseTimer("json parse", filePathA);
 
-    bool ret = false;
-    if (ext.compare(L"glb") == 0)
+    if (frontEnd == GltfFrontEnd::kStreaming)
     {
-        Log::Debug(L"Gltf::LoadModel: Reading binary glTF from \"%s\"", filePath.c_str());
-        ret = tinyGltf.LoadBinaryFromFile(&model, &errA, &warnA, filePathA);
+        Log::Debug(L"Gltf::LoadModel: Streaming glTF from \"%s\"", filePath.c_str());
+        if (!GltfReader::LoadModel(model, filePath, deferImageDecoding))
+        {
+            Log::Error(L"Gltf::LoadModel: Failed to parse glTF file \"%s\"", filePath.c_str());
+            return false;
+        }
     }
     else
     {
-        Log::Debug(L"Gltf::LoadModel: Reading ASCII glTF from \"%s\"", filePath.c_str());
-        ret = tinyGltf.LoadASCIIFromFile(&model, &errA, &warnA, filePathA);
+        tinygltf::TinyGLTF tinyGltf;
+        tinygltf::FsCallbacks fsCallbacks = { tinygltf::FileExists,
+                                              tinygltf::ExpandFilePath,
+                                              ReadWholeFileTimed,
+                                              tinygltf::WriteWholeFile,
+                                              nullptr };
+        tinyGltf.SetFsCallbacks(fsCallbacks);
+        if (deferImageDecoding)
+            tinyGltf.SetImageLoader(StoreEncodedImageData, nullptr);
+        else
+            tinyGltf.SetImageLoader(LoadImageDataTimed, nullptr);
+        string errA, warnA;
+        wstring ext = Utils::GetFilePathExt(filePath);
+
+        bool ret = false;
+        if (ext.compare(L"glb") == 0)
+        {
+            Log::Debug(L"Gltf::LoadModel: Reading binary glTF from \"%s\"", filePath.c_str());
+            ret = tinyGltf.LoadBinaryFromFile(&model, &errA, &warnA, filePathA);
+        }
+        else
+        {
+            Log::Debug(L"Gltf::LoadModel: Reading ASCII glTF from \"%s\"", filePath.c_str());
+            ret = tinyGltf.LoadASCIIFromFile(&model, &errA, &warnA, filePathA);
+        }
+
+        if (!errA.empty())
+            Log::Debug(L"Gltf::LoadModel: Error: %s", Utils::StringToWstring(errA).c_str());
+
+        if (!warnA.empty())
+            Log::Debug(L"Gltf::LoadModel: Warning: %s", Utils::StringToWstring(warnA).c_str());
+
+        if (!ret)
+        {
+            Log::Error(L"Gltf::LoadModel: Failed to parse glTF file \"%s\"", filePath.c_str());
+            return false;
+        }
     }
 
-    if (!errA.empty())
-        Log::Debug(L"Gltf::LoadModel: Error: %s", Utils::StringToWstring(errA).c_str());
+    Log::Info(L"Gltf::LoadModel: Parsed by %s in %.2f ms, peak memory usage %.1f MB",
+              (frontEnd == GltfFrontEnd::kStreaming) ? L"streaming reader" : L"tinygltf",
+              chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count(),
+              Utils::GetPeakMemoryUsage() / (1024. * 1024.));
 
-    if (!warnA.empty())
-        Log::Debug(L"Gltf::LoadModel: Warning: %s", Utils::StringToWstring(warnA).c_str());
+    // Extensions which change the meaning of the data must be understood
+    static const char *supportedRequiredExtensions[] =
+    {
+        "KHR_mesh_quantization",    // Integer vertex attributes handled by AccessorDecoder
+        "EXT_meshopt_compression",  // Buffer views decoded by MeshoptDecoder
+    };
+    for (const auto &extension : model.extensionsRequired)
+    {
+        if (find_if(begin(supportedRequiredExtensions), end(supportedRequiredExtensions),
+                    [&extension](const char *supported) { return extension == supported; })
+            == end(supportedRequiredExtensions))
+        {
+            Log::Error(L"Gltf::LoadModel: Required extension %s is not supported",
+                       Utils::StringToWstring(extension).c_str());
+            return false;
+        }
+    }
 
-    if (ret)
-        Log::Debug(L"Gltf::LoadModel: Succesfully loaded model");
-    else
-        Log::Error(L"Gltf::LoadModel: Failed to parse glTF file \"%s\"", filePath.c_str());
+    if (!DecodeMeshoptBufferViews(model, filePath))
+        return false;
+
+    Log::Debug(L"Gltf::LoadModel: Succesfully loaded model");
+
+    return true;
+}
+
+
+bool GltfUtils::DecodeImage(tinygltf::Image &image)
+{
+    if (!image.as_is)
+        return true; // Already decoded
+
+    LoadProfiler::ScopedTimer timer("image decode", image.name.empty() ? image.uri : image.name, image.image.size());
+
+    int width, height, components;
+    auto data = stbi_load_from_memory(image.image.data(), (int)image.image.size(),
+                                      &width, &height, &components, 4);
+    if (!data)
+    {
+        Log::Error(L"Gltf::DecodeImage: Failed to decode image \"%s\"/\"%s\": %s",
+                   Utils::StringToWstring(image.name).c_str(),
+                   Utils::StringToWstring(image.uri).c_str(),
+                   Utils::StringToWstring(stbi_failure_reason()).c_str());
+        return false;
+    }
+
+    image.width         = width;
+    image.height        = height;
+    image.component     = 4;
+    image.bits          = 8;
+    image.pixel_type    = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.image.assign(data, data + (size_t)width * height * 4);
+    image.as_is         = false;
+
+    stbi_image_free(data);
 
-    return ret;
+    return true;
 }
 
 
-D3D11_PRIMITIVE_TOPOLOGY GltfUtils::ModeToTopology(int mode)
+PrimitiveTopology GltfUtils::ModeToTopology(int mode)
 {
     switch (mode)
     {
     case TINYGLTF_MODE_POINTS:
-        return D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+        return PrimitiveTopology::kPointList;
     case TINYGLTF_MODE_LINE:
-        return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+        return PrimitiveTopology::kLineList;
     case TINYGLTF_MODE_LINE_STRIP:
-        return D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
+        return PrimitiveTopology::kLineStrip;
     case TINYGLTF_MODE_TRIANGLES:
-        return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        return PrimitiveTopology::kTriangleList;
     case TINYGLTF_MODE_TRIANGLE_STRIP:
-        return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+        return PrimitiveTopology::kTriangleStrip;
     //case TINYGLTF_MODE_LINE_LOOP:
     //case TINYGLTF_MODE_TRIANGLE_FAN:
     default:
-        return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        return PrimitiveTopology::kUndefined;
     }
 }
 
@@ -176,7 +495,7 @@ std::wstring GltfUtils::ComponentTypeToWstring(int ty)
 //}
 
 
-std::wstring GltfUtils::ColorToWstring(const XMFLOAT4 &color)
+std::wstring GltfUtils::ColorToWstring(const SceneMath::Float4 &color)
 {
     std::wstringstream ss;
     ss << L"[ ";
@@ -242,21 +561,21 @@ std::wstring GltfUtils::ParameterValueToWstring(const tinygltf::Parameter &param
 }
 
 
-bool GltfUtils::FloatArrayToColor(XMFLOAT4 &color, const std::vector<double> &vector)
+bool GltfUtils::FloatArrayToColor(SceneMath::Float4 &color, const std::vector<double> &vector)
 {
     switch (vector.size())
     {
     case 4:
-        color = XMFLOAT4((float)vector[0],
-                         (float)vector[1],
-                         (float)vector[2],
-                         (float)vector[3]);
+        color = SceneMath::Float4((float)vector[0],
+                                  (float)vector[1],
+                                  (float)vector[2],
+                                  (float)vector[3]);
         return true;
     case 3:
-        color = XMFLOAT4((float)vector[0],
-                         (float)vector[1],
-                         (float)vector[2],
-                         1.0);
+        color = SceneMath::Float4((float)vector[0],
+                                  (float)vector[1],
+                                  (float)vector[2],
+                                  1.0);
         return true;
     default:
         return false;
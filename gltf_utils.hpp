@@ -2,26 +2,34 @@
 
 #include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
 
-// We are using an older version of DirectX headers which causes 
-// "warning C4005: '...' : macro redefinition"
-#pragma warning(push)
-#pragma warning(disable: 4005)
-#include <d3d11.h>
-#include <d3dx11.h>
-#pragma warning(pop)
-
-#pragma warning(push)
-#pragma warning(disable: 4838)
-#include <xnamath.h>
-#pragma warning(pop)
+#include "scene_geometry.hpp"
+#include "scene_math.hpp"
 
+#include <map>
 #include <string>
+#include <vector>
+
+enum class GltfFrontEnd
+{
+    kTinyGltf,      // Complete tinygltf parser (JSON document first, then the model)
+    kStreaming,     // GltfReader: single pass straight into the model, renderer-relevant parts only
+};
+
 
 namespace GltfUtils
 {
-    bool LoadModel(tinygltf::Model &model, const std::wstring &filePath);
+    // With deferred image decoding, images keep their encoded (PNG, JPEG, ...) content and are
+    // marked as_is. Such images have to be decoded via DecodeImage() before use.
+    bool LoadModel(tinygltf::Model &model,
+                   const std::wstring &filePath,
+                   bool deferImageDecoding = false,
+                   GltfFrontEnd frontEnd = GltfFrontEnd::kTinyGltf);
+
+    // Decodes an image kept as_is into 8-bit RGBA pixels. Touches nothing but the image itself,
+    // so different images can be decoded concurrently.
+    bool DecodeImage(tinygltf::Image &image);
 
-    D3D11_PRIMITIVE_TOPOLOGY ModeToTopology(int mode);
+    PrimitiveTopology ModeToTopology(int mode);
 
     std::wstring ModeToWstring(int mode);
 
@@ -35,7 +43,7 @@ namespace GltfUtils
 
     //std::wstring TargetToWstring(int target);
 
-    std::wstring ColorToWstring(const XMFLOAT4 &color);
+    std::wstring ColorToWstring(const SceneMath::Float4 &color);
 
     std::wstring FloatArrayToWstring(const std::vector<double> &arr);
 
@@ -43,10 +51,10 @@ namespace GltfUtils
 
     std::wstring ParameterValueToWstring(const tinygltf::Parameter &param);
 
-    bool FloatArrayToColor(XMFLOAT4 &color, const std::vector<double> &vector);
+    bool FloatArrayToColor(SceneMath::Float4 &color, const std::vector<double> &vector);
 
     template <int component>
-    void FloatToColorComponent(XMFLOAT4 &color, double value)
+    void FloatToColorComponent(SceneMath::Float4 &color, double value)
     {
         static_assert(component < 4, "Incorrect color component index!");
 
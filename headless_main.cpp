@@ -0,0 +1,308 @@
+// Runs scenes without any window or graphics device using the null rendering context
+// and reports CPU-side costs of loading and rendering.
+//
+// Usage: headless_runner [first scene id] [last scene id] [frame count] [--option=value ...]
+//
+// Options:
+//   --threads=N              Parallel loading of geometry and images with N worker threads
+//                            (0 = one per hardware thread, negative = serial loading, the default).
+//   --scene-cache=0|1        Baked scene cache, created by the first run and used by the following ones.
+//   --texture-compression=N  0 = none, 1 = fast (BC1/BC3 colors), 2 = high quality (BC7 colors).
+//   --shared-texture-cache=0|1
+//                            All scenes use one rendering context and one texture cache, which stays
+//                            warm across scene switches.
+//   --mesh-optimization=N    0 = none, 1 = vertex cache, 2 = vertex cache and overdraw; the vertex cache
+//                            efficiency before and after is reported.
+//   --vertex-format=N        0 = full, 1 = compact, 2 = compact with quantized positions and texture
+//                            coordinates.
+//   --weld-epsilon=E         Positive value merges vertices of all glTF primitives whose positions are
+//                            within epsilon of each other.
+//   --upload-budget=KB       Positive budget (KB per frame) enables asynchronous loading; frames are run
+//                            until the scene is loaded and the number of these frames and the longest
+//                            of them are reported.
+//   --gltf-front-end=N       0 = tinygltf, 1 = streaming reader; parse time and peak memory usage are
+//                            reported.
+//   --load-profile=DIR       Load-phase profiler, which writes a JSON report for each scene
+//                            (scene_<id>.load_profile.json) covering everything from scene
+//                            initialization to the end of loading.
+//   --memory-budget=MB       A scene whose peak memory usage exceeds a positive budget counts as failed.
+//   --tangent-method=N       0 = mikktspace, 1 = fast approximation (see tangent_validator for its
+//                            deviation).
+//   --normal-method=N        Normals of primitives without them; 0 = flat, 1 = area-weighted,
+//                            2 = angle-weighted.
+//   --crease-angle=DEG       Smooth normals are split at edges sharper than this angle
+//                            (see normal_benchmark).
+//
+// Memory usage of each scene and the number of scene graph nodes whose world matrices are recomputed
+// per frame are always reported.
+
+#include "scene.hpp"
+#include "null_rendering_context.hpp"
+#include "load_profiler.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+
+static double MillisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool RunHeadlessScene(Scene::SceneId sceneId,
+                             int frameCount,
+                             const SceneLoadOptions &loadOptions,
+                             const std::wstring &profileDir,
+                             size_t memoryBudget,
+                             NullRenderingContext &ctx)
+{
+    Log::Info(L"");
+    Log::Info(L"-------------------------------");
+    Log::Info(L"RunHeadlessScene: scene %d", sceneId);
+    Log::Info(L"-------------------------------");
+    Log::Info(L"");
+
+    const std::wstring profilePath =
+        profileDir.empty() ? L"" : profileDir + L"/scene_" + std::to_wstring(sceneId) + L".load_profile.json";
+    if (!profilePath.empty())
+        LoadProfiler::BeginReport(L"scene " + std::to_wstring(sceneId));
+
+    ctx.ResetCounters();
+    Scene scene(sceneId, loadOptions);
+
+    const auto initStart = Clock::now();
+    if (!scene.Init(ctx))
+    {
+        Log::Error(L"RunHeadlessScene: failed to initialize scene %d!", sceneId);
+        if (!profilePath.empty())
+            LoadProfiler::EndReport(profilePath);
+        return false;
+    }
+    const auto initTime = MillisecondsSince(initStart);
+
+    int loadFrameCount = 0;
+    double maxLoadFrameTime = 0.;
+    while (scene.IsLoading())
+    {
+        const auto frameStart = Clock::now();
+        ctx.SetFrameAnimationTime(loadFrameCount / 60.f);
+        scene.AnimateFrame(ctx);
+        scene.RenderFrame(ctx);
+        maxLoadFrameTime = std::max(maxLoadFrameTime, MillisecondsSince(frameStart));
+        loadFrameCount++;
+    }
+    const auto loadTime = MillisecondsSince(initStart);
+    const auto loadCounters = ctx.GetCounters();
+    if (!profilePath.empty())
+        LoadProfiler::EndReport(profilePath);
+
+    ctx.ResetCounters();
+
+    const auto updatedNodeCount = scene.GetUpdatedNodeCount();
+    const auto framesStart = Clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        ctx.SetFrameAnimationTime(frame / 60.f);
+        scene.AnimateFrame(ctx);
+        scene.RenderFrame(ctx);
+    }
+    const auto framesTime = MillisecondsSince(framesStart);
+    const auto &frameCounters = ctx.GetCounters();
+    const auto frames = (double)(frameCount > 0 ? frameCount : 1);
+
+    Log::Info(L"Init: %.2f ms, "
+              L"buffers %llu (%llu KB), textures %llu (%llu KB), shaders %llu, samplers %llu",
+              initTime,
+              (unsigned long long)loadCounters.bufferCreations,
+              (unsigned long long)loadCounters.bufferBytes >> 10,
+              (unsigned long long)loadCounters.textureCreations,
+              (unsigned long long)loadCounters.textureBytes >> 10,
+              (unsigned long long)loadCounters.shaderCreations,
+              (unsigned long long)loadCounters.samplerCreations);
+    if (loadOptions.asyncLoading)
+        Log::Info(L"Async loading: %.2f ms in total, %d frame(s), longest frame %.2f ms",
+                  loadTime, loadFrameCount, maxLoadFrameTime);
+    if (loadOptions.textureCache)
+        Log::Info(L"Texture cache: %llu textures, %llu hits, %llu misses (so far)",
+                  (unsigned long long)loadOptions.textureCache->GetTextureCount(),
+                  (unsigned long long)loadOptions.textureCache->GetHitCount(),
+                  (unsigned long long)loadOptions.textureCache->GetMissCount());
+    Log::Info(L"Frames: %d, average frame CPU time %.4f ms, per frame: "
+              L"draw calls %.1f, indices %.1f, CB updates %.1f (%.1f B), state changes %.1f",
+              frameCount,
+              framesTime / frames,
+              frameCounters.drawCalls / frames,
+              frameCounters.drawnIndices / frames,
+              frameCounters.constantBufferUpdates / frames,
+              frameCounters.constantBufferBytes / frames,
+              frameCounters.stateChanges / frames);
+    Log::Info(L"Scene graph: %d node(s), per frame %.1f updated",
+              (int)scene.GetSceneGraph().GetNodeCount(),
+              (scene.GetUpdatedNodeCount() - updatedNodeCount) / frames);
+    scene.LogMemoryReport(5);
+
+    scene.Destroy();
+
+    const auto peakMemory = scene.GetMemoryTracker().GetPeakTotalSize();
+    if ((memoryBudget > 0) && (peakMemory > memoryBudget))
+    {
+        Log::Error(L"RunHeadlessScene: scene %d exceeded the memory budget (peak %llu KB, budget %llu KB)!",
+                   sceneId, (unsigned long long)peakMemory >> 10, (unsigned long long)memoryBudget >> 10);
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Log::sLoggingLevel = Log::eInfo;
+
+    int firstScene = Scene::eFirst;
+    int lastScene  = Scene::eLast;
+    int frameCount = 1000;
+    SceneLoadOptions loadOptions;
+    bool sharedTextureCache = false;
+    std::wstring profileDir;
+    size_t memoryBudget = 0;
+    int positionalCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            switch (positionalCount++)
+            {
+            case 0: firstScene = lastScene = std::atoi(arg.c_str()); break;
+            case 1: lastScene = std::atoi(arg.c_str()); break;
+            case 2: frameCount = std::atoi(arg.c_str()); break;
+            default:
+                Log::Error(L"Unexpected argument \"%s\" (options are given as --name=value)!",
+                           Utils::StringToWstring(arg).c_str());
+                return -1;
+            }
+            continue;
+        }
+
+        const auto separator = arg.find('=');
+        if (separator == std::string::npos)
+        {
+            Log::Error(L"Option \"%s\" has no value (expected --name=value)!", Utils::StringToWstring(arg).c_str());
+            return -1;
+        }
+        const std::string name = arg.substr(2, separator - 2);
+        const std::string value = arg.substr(separator + 1);
+
+        const int intValue = std::atoi(value.c_str());
+        if (name == "threads")
+        {
+            loadOptions.parallelGeometry = loadOptions.parallelImages = (intValue >= 0);
+            if (intValue >= 0)
+                loadOptions.workerThreadCount = (uint32_t)intValue;
+        }
+        else if (name == "scene-cache")
+            loadOptions.useSceneCache = (intValue != 0);
+        else if (name == "texture-compression")
+            loadOptions.textureCompression = (TextureCompression)intValue;
+        else if (name == "shared-texture-cache")
+            sharedTextureCache = (intValue != 0);
+        else if (name == "mesh-optimization")
+            loadOptions.meshOptimization = (MeshOptimization)intValue;
+        else if (name == "vertex-format")
+            loadOptions.vertexFormat = (VertexFormat)intValue;
+        else if (name == "weld-epsilon")
+            loadOptions.weldEpsilon = (float)std::atof(value.c_str());
+        else if (name == "upload-budget")
+        {
+            loadOptions.asyncLoading = (intValue > 0);
+            if (intValue > 0)
+                loadOptions.uploadBudget = (size_t)intValue << 10;
+        }
+        else if (name == "gltf-front-end")
+            loadOptions.gltfFrontEnd = (GltfFrontEnd)intValue;
+        else if (name == "load-profile")
+            profileDir = Utils::StringToWstring(value);
+        else if (name == "memory-budget")
+            memoryBudget = (size_t)std::max(intValue, 0) << 20;
+        else if (name == "tangent-method")
+            loadOptions.tangentMethod = (TangentMethod)intValue;
+        else if (name == "normal-method")
+            loadOptions.normalMethod = (NormalMethod)intValue;
+        else if (name == "crease-angle")
+            loadOptions.normalCreaseAngle = (float)std::atof(value.c_str());
+        else
+        {
+            Log::Error(L"Unknown option \"%s\"!", Utils::StringToWstring(arg).c_str());
+            return -1;
+        }
+    }
+
+    if ((firstScene < Scene::eFirst) || (lastScene > Scene::eLast) || (firstScene > lastScene))
+    {
+        Log::Error(L"Invalid scene range %d-%d (valid ids are %d-%d)!",
+                   firstScene, lastScene, Scene::eFirst, Scene::eLast);
+        return -1;
+    }
+    if ((loadOptions.textureCompression < TextureCompression::kNone) ||
+        (loadOptions.textureCompression > TextureCompression::kHigh))
+    {
+        Log::Error(L"Invalid texture compression %d (valid values are 0-2)!",
+                   (int)loadOptions.textureCompression);
+        return -1;
+    }
+    if ((loadOptions.meshOptimization < MeshOptimization::kNone) ||
+        (loadOptions.meshOptimization > MeshOptimization::kVertexCacheAndOverdraw))
+    {
+        Log::Error(L"Invalid mesh optimization %d (valid values are 0-2)!",
+                   (int)loadOptions.meshOptimization);
+        return -1;
+    }
+    if ((loadOptions.vertexFormat < VertexFormat::kFull) ||
+        (loadOptions.vertexFormat > VertexFormat::kQuantized))
+    {
+        Log::Error(L"Invalid vertex format %d (valid values are 0-2)!",
+                   (int)loadOptions.vertexFormat);
+        return -1;
+    }
+    if ((loadOptions.tangentMethod < TangentMethod::kMikkTSpace) ||
+        (loadOptions.tangentMethod > TangentMethod::kFast))
+    {
+        Log::Error(L"Invalid tangent method %d (valid values are 0-1)!",
+                   (int)loadOptions.tangentMethod);
+        return -1;
+    }
+    if ((loadOptions.normalMethod < NormalMethod::kFlat) ||
+        (loadOptions.normalMethod > NormalMethod::kAngleWeighted))
+    {
+        Log::Error(L"Invalid normal method %d (valid values are 0-2)!",
+                   (int)loadOptions.normalMethod);
+        return -1;
+    }
+
+    // The shared cache must be destroyed before the context its textures come from
+    NullRenderingContext sharedCtx;
+    TextureCache textureCache;
+    if (sharedTextureCache)
+        loadOptions.textureCache = &textureCache;
+
+    int failedCount = 0;
+    for (int sceneId = firstScene; sceneId <= lastScene; sceneId++)
+    {
+        NullRenderingContext sceneCtx;
+        auto &ctx = sharedTextureCache ? sharedCtx : sceneCtx;
+        if (!RunHeadlessScene((Scene::SceneId)sceneId, frameCount, loadOptions, profileDir, memoryBudget, ctx))
+            failedCount++;
+    }
+
+    return failedCount == 0 ? 0 : -1;
+}
@@ -0,0 +1,46 @@
+#include "irenderingcontext.hpp"
+
+#include <algorithm>
+
+
+uint32_t GetTextureFormatElementSize(TextureFormat format, uint32_t &elementDim)
+{
+    elementDim = 1;
+    switch (format)
+    {
+    case TextureFormat::kR8G8B8A8Unorm:
+    case TextureFormat::kR8G8B8A8UnormSrgb:     return 4;
+    case TextureFormat::kR32G32B32A32Float:     return 16;
+    default:                                    break;
+    }
+
+    elementDim = 4;
+    switch (format)
+    {
+    case TextureFormat::kBC1Unorm:
+    case TextureFormat::kBC1UnormSrgb:
+    case TextureFormat::kBC4Unorm:              return 8;
+    case TextureFormat::kBC3Unorm:
+    case TextureFormat::kBC3UnormSrgb:
+    case TextureFormat::kBC5Unorm:
+    case TextureFormat::kBC7Unorm:
+    case TextureFormat::kBC7UnormSrgb:          return 16;
+    default:                                    return 0;
+    }
+}
+
+
+uint32_t GetTextureByteSize(uint32_t width, uint32_t height, TextureFormat format, uint32_t mipCount)
+{
+    uint32_t elementDim;
+    const auto elementSize = GetTextureFormatElementSize(format, elementDim);
+
+    uint32_t byteSize = 0;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        const uint32_t mipWidth  = std::max(width >> mip, 1u);
+        const uint32_t mipHeight = std::max(height >> mip, 1u);
+        byteSize += (mipWidth + elementDim - 1) / elementDim * ((mipHeight + elementDim - 1) / elementDim) * elementSize;
+    }
+    return byteSize;
+}
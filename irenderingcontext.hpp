@@ -1,14 +1,107 @@
 #pragma once
 
-// We are using an older version of DirectX headers which causes 
-// "warning C4005: '...' : macro redefinition"
-#pragma warning(push)
-#pragma warning(disable: 4005)
-#include <d3d11.h>
-#include <d3dx11.h>
-#pragma warning(pop)
+#include "scene_geometry.hpp"
 
 #include <cstdint>
+#include <vector>
+
+// Device resources created through a rendering context.
+// They are reference counted (like the COM objects behind the DX11 implementation) so that
+// scene structures can share them via Utils::SafeAddRef() and Utils::ReleaseAndMakeNull().
+class IDeviceResource
+{
+public:
+
+    virtual ~IDeviceResource() {};
+
+    virtual void AddRef() = 0;
+    virtual void Release() = 0;
+};
+
+// Buffers and textures know how much device memory they take (textures including all mip levels)
+class IDeviceBuffer : public IDeviceResource
+{
+public:
+    virtual uint32_t GetByteSize() const = 0;
+};
+
+class IDeviceTexture : public IDeviceResource // Texture bindable to a shader
+{
+public:
+    virtual uint32_t GetByteSize() const = 0;
+};
+
+class IVertexShader : public IDeviceResource {};  // Vertex shader together with its input layout
+class IPixelShader : public IDeviceResource {};
+class ISamplerState : public IDeviceResource {};
+
+
+enum class DeviceBufferType
+{
+    kVertex,
+    kIndex, // See IndexFormat
+    kConstant,
+};
+
+
+enum class TextureFormat
+{
+    kR8G8B8A8Unorm,
+    kR8G8B8A8UnormSrgb,
+    kR32G32B32A32Float,
+
+    // Block-compressed formats; line pitch of their mip data is a row of 4x4 blocks
+    kBC1Unorm,
+    kBC1UnormSrgb,
+    kBC3Unorm,
+    kBC3UnormSrgb,
+    kBC4Unorm,
+    kBC5Unorm,
+    kBC7Unorm,
+    kBC7UnormSrgb,
+};
+
+
+// Size of a texel or of a 4x4 block (elementDim = 4) for block-compressed formats; zero if unknown
+uint32_t GetTextureFormatElementSize(TextureFormat format, uint32_t &elementDim);
+
+// Memory taken by the first mipCount levels of a texture
+uint32_t GetTextureByteSize(uint32_t width, uint32_t height, TextureFormat format, uint32_t mipCount);
+
+
+enum class IndexFormat
+{
+    kUint16, // 0xffff is the strip cut value
+    kUint32,
+};
+
+
+enum class VertexElementFormat
+{
+    kFloat2,
+    kFloat3,
+    kFloat4,
+    kHalf2,
+    kShort4Snorm,
+    kUShort2Unorm,
+    kUShort4Unorm,
+};
+
+
+// Initial data of a single texture mip level
+struct TextureMipData
+{
+    const void  *data;
+    uint32_t    lineMemPitch;
+};
+
+
+struct VertexElementDesc
+{
+    const char          *semanticName;
+    VertexElementFormat format; // Elements are tightly packed in the given order
+};
+
 
 // Used by a scene to access necessary renderer internals
 class IRenderingContext
@@ -17,32 +110,66 @@ public:
 
     virtual ~IRenderingContext() {};
 
-    virtual ID3D11Device*           GetDevice() const = 0;
+    // Resource creation
+
+    virtual bool                    CreateVertexShader(const wchar_t *fileName,
+                                                       const char *entryPoint,
+                                                       const char *shaderModel,
+                                                       const std::vector<VertexElementDesc> &layout,
+                                                       IVertexShader *&vertexShader) = 0;
+
+    virtual bool                    CreatePixelShader(const wchar_t *fileName,
+                                                      const char *entryPoint,
+                                                      const char *shaderModel,
+                                                      IPixelShader *&pixelShader) = 0;
+
+    // Constant buffers may be created without initial data
+    virtual bool                    CreateBuffer(DeviceBufferType type,
+                                                 const void *data,
+                                                 uint32_t byteWidth,
+                                                 IDeviceBuffer *&buffer) = 0;
+
+    // Mip levels start with the full-size one, each following level has half the size
+    // of the previous one (rounded down, at least 1)
+    virtual bool                    CreateTexture(uint32_t width,
+                                                  uint32_t height,
+                                                  TextureFormat format,
+                                                  const TextureMipData *mips,
+                                                  uint32_t mipCount,
+                                                  IDeviceTexture *&texture) = 0;
 
-    virtual ID3D11DeviceContext*    GetImmediateContext() const = 0;
+    virtual bool                    CreateTextureFromFile(const wchar_t *path,
+                                                          bool isSrgb,
+                                                          IDeviceTexture *&texture) = 0;
 
-    virtual bool                    CreateVertexShader(WCHAR* szFileName,
-                                                       LPCSTR szEntryPoint,
-                                                       LPCSTR szShaderModel,
-                                                       ID3DBlob *&pVsBlob,
-                                                       ID3D11VertexShader *&pVertexShader) const = 0;
+    // Anisotropic sampler with wrapping addressing mode
+    virtual bool                    CreateSamplerState(ISamplerState *&sampler) = 0;
 
-    virtual bool                    CreatePixelShader(WCHAR* szFileName,
-                                                      LPCSTR szEntryPoint,
-                                                      LPCSTR szShaderModel,
-                                                      ID3D11PixelShader *&pPixelShader) const = 0;
+    // Pipeline state & drawing
+
+    virtual void                    UpdateConstantBuffer(IDeviceBuffer *buffer, const void *data) = 0;
+
+    virtual void                    VSSetShader(IVertexShader *shader) = 0;
+    virtual void                    VSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) = 0;
+
+    virtual void                    PSSetShader(IPixelShader *shader) = 0;
+    virtual void                    PSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) = 0;
+    virtual void                    PSSetSampler(uint32_t slot, ISamplerState *sampler) = 0;
+    virtual void                    PSSetTexture(uint32_t slot, IDeviceTexture *texture) = 0;
+
+    virtual void                    DrawIndexed(IDeviceBuffer *vertexBuffer,
+                                                uint32_t vertexStride,
+                                                IDeviceBuffer *indexBuffer,
+                                                IndexFormat indexFormat,
+                                                uint32_t indexCount,
+                                                PrimitiveTopology topology) = 0;
+
+    // Misc
 
     virtual bool                    GetWindowSize(uint32_t &width,
                                                   uint32_t &height) const = 0;
 
-    virtual bool                    UsesMSAA() const = 0;
-    virtual uint32_t                GetMsaaCount() const = 0;
-    virtual uint32_t                GetMsaaQuality() const = 0;
-
     virtual float                   GetFrameAnimationTime() const = 0; // In seconds
 
-    virtual bool IsValid() const
-    {
-        return GetDevice() && GetImmediateContext();
-    };
+    virtual bool                    IsValid() const = 0;
 };
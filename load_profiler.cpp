@@ -0,0 +1,244 @@
+#include "load_profiler.hpp"
+
+#include "utils.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+struct LoadRecord
+{
+    const char      *phase;
+    std::string     asset;
+    size_t          threadIdx;
+    double          startTime;
+    double          totalTime;
+    double          selfTime;
+    uint64_t        bytes;
+};
+
+struct LoadPhaseStats
+{
+    const char      *phase;
+    size_t          count;
+    double          totalTime;
+    double          selfTime;
+    uint64_t        bytes;
+};
+
+static std::mutex sMutex;
+static std::atomic<uint64_t> sActiveReportId(0);
+static uint64_t sLastReportId = 0;
+static std::wstring sReportName;
+static Clock::time_point sReportStartTime;
+static std::vector<LoadRecord> sRecords;
+static std::vector<std::thread::id> sThreads;
+
+// Innermost running timer of the calling thread
+static thread_local LoadProfiler::ScopedTimer *tCurrentTimer = nullptr;
+
+
+void LoadProfiler::BeginReport(const std::wstring &name)
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    sReportName = name;
+    sReportStartTime = Clock::now();
+    sRecords.clear();
+    sThreads.clear();
+    sActiveReportId = ++sLastReportId;
+}
+
+
+bool LoadProfiler::IsActive()
+{
+    return sActiveReportId != 0;
+}
+
+
+static std::string EscapeJsonString(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (const char ch : str)
+    {
+        if ((ch == '"') || (ch == '\\'))
+        {
+            escaped.push_back('\\');
+            escaped.push_back(ch);
+        }
+        else if ((unsigned char)ch < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned)ch);
+            escaped += code;
+        }
+        else
+            escaped.push_back(ch);
+    }
+    return escaped;
+}
+
+
+bool LoadProfiler::EndReport(const std::wstring &filePath)
+{
+    std::wstring name;
+    double wallTime;
+    size_t threadCount;
+    std::vector<LoadRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+
+        if (sActiveReportId == 0)
+        {
+            Log::Error(L"LoadProfiler: No report to end");
+            return false;
+        }
+
+        sActiveReportId = 0;
+        name = sReportName;
+        wallTime = Milliseconds(Clock::now() - sReportStartTime).count();
+        threadCount = sThreads.size();
+        records.swap(sRecords);
+    }
+
+    std::stable_sort(records.begin(), records.end(),
+                     [](const LoadRecord &a, const LoadRecord &b) { return a.startTime < b.startTime; });
+
+    // Phases in the order of their first occurrence
+    std::vector<LoadPhaseStats> phases;
+    for (const auto &record : records)
+    {
+        auto phase = std::find_if(phases.begin(), phases.end(),
+                                  [&record](const LoadPhaseStats &stats)
+                                  { return strcmp(stats.phase, record.phase) == 0; });
+        if (phase == phases.end())
+        {
+            phases.push_back(LoadPhaseStats{ record.phase, 0, 0., 0., 0 });
+            phase = phases.end() - 1;
+        }
+        phase->count++;
+        phase->totalTime += record.totalTime;
+        phase->selfTime += record.selfTime;
+        phase->bytes += record.bytes;
+    }
+
+    FILE *file = nullptr;
+#ifdef _MSC_VER
+    _wfopen_s(&file, filePath.c_str(), L"wb");
+#else
+    file = fopen(Utils::WstringToString(filePath).c_str(), "wb");
+#endif
+    if (!file)
+    {
+        Log::Error(L"LoadProfiler: Failed to create report file \"%s\"", filePath.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"name\": \"%s\",\n", EscapeJsonString(Utils::WstringToString(name)).c_str());
+    fprintf(file, "  \"wallMs\": %.3f,\n", wallTime);
+    fprintf(file, "  \"threads\": %d,\n", (int)threadCount);
+    fprintf(file, "  \"phases\": [");
+    for (size_t i = 0; i < phases.size(); i++)
+    {
+        const auto &phase = phases[i];
+        fprintf(file,
+                "%s\n    { \"phase\": \"%s\", \"count\": %d, \"totalMs\": %.3f, \"selfMs\": %.3f, \"bytes\": %llu }",
+                (i > 0) ? "," : "",
+                EscapeJsonString(phase.phase).c_str(),
+                (int)phase.count,
+                phase.totalTime,
+                phase.selfTime,
+                (unsigned long long)phase.bytes);
+    }
+    fprintf(file, "\n  ],\n");
+    fprintf(file, "  \"records\": [");
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const auto &record = records[i];
+        fprintf(file,
+                "%s\n    { \"phase\": \"%s\", \"asset\": \"%s\", \"thread\": %d, "
+                "\"startMs\": %.3f, \"totalMs\": %.3f, \"selfMs\": %.3f, \"bytes\": %llu }",
+                (i > 0) ? "," : "",
+                EscapeJsonString(record.phase).c_str(),
+                EscapeJsonString(record.asset).c_str(),
+                (int)record.threadIdx,
+                record.startTime,
+                record.totalTime,
+                record.selfTime,
+                (unsigned long long)record.bytes);
+    }
+    fprintf(file, "\n  ]\n");
+    fprintf(file, "}\n");
+
+    const bool success = (ferror(file) == 0);
+    fclose(file);
+    if (!success)
+    {
+        Log::Error(L"LoadProfiler: Failed to write report file \"%s\"", filePath.c_str());
+        return false;
+    }
+
+    Log::Info(L"LoadProfiler: Report with %d record(s) written to \"%s\"", (int)records.size(), filePath.c_str());
+
+    return true;
+}
+
+
+LoadProfiler::ScopedTimer::ScopedTimer(const char *phase, const std::string &asset, uint64_t bytes) :
+    mPhase(phase),
+    mBytes(bytes),
+    mReportId(sActiveReportId),
+    mParent(nullptr),
+    mNestedTime(0.)
+{
+    if (mReportId == 0)
+        return;
+
+    mParent = tCurrentTimer;
+    tCurrentTimer = this;
+    mAsset = (asset.empty() && mParent) ? mParent->mAsset : asset;
+    mStartTime = Clock::now();
+}
+
+
+LoadProfiler::ScopedTimer::~ScopedTimer()
+{
+    if (mReportId == 0)
+        return;
+
+    const auto endTime = Clock::now();
+    const double totalTime = Milliseconds(endTime - mStartTime).count();
+
+    tCurrentTimer = mParent;
+    if (mParent)
+        mParent->mNestedTime += totalTime;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    // Timers started before the current report (or after the last one ended) are ignored
+    if (mReportId != sActiveReportId)
+        return;
+
+    const auto threadId = std::this_thread::get_id();
+    const size_t threadIdx = std::find(sThreads.begin(), sThreads.end(), threadId) - sThreads.begin();
+    if (threadIdx == sThreads.size())
+        sThreads.push_back(threadId);
+
+    sRecords.push_back(LoadRecord{ mPhase,
+                                   std::move(mAsset),
+                                   threadIdx,
+                                   Milliseconds(mStartTime - sReportStartTime).count(),
+                                   totalTime,
+                                   totalTime - mNestedTime,
+                                   mBytes });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Load-phase profiler. Scoped timers placed along the load pipeline record how long each phase
+// takes for each asset (and how many bytes it processes). Records are collected from any thread,
+// but only while a report is open; closing the report writes it out as JSON, so that load times
+// can be compared across builds. Just one report can be open at a time.
+// ------------------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace LoadProfiler
+{
+    // Starts a new report, discarding records of a report which was not ended
+    void BeginReport(const std::wstring &name);
+
+    // Writes the report to the given file and stops collecting records
+    bool EndReport(const std::wstring &filePath);
+
+    bool IsActive();
+
+
+    // Records the time between its construction and destruction. Time spent in timers nested on the
+    // same thread is reported as part of the total time, but not of the self time of the outer one.
+    // An empty asset name is taken over from the enclosing timer.
+    class ScopedTimer
+    {
+    public:
+
+        ScopedTimer(const char *phase, const std::string &asset = std::string(), uint64_t bytes = 0);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer& operator =(const ScopedTimer &) = delete;
+
+        void SetBytes(uint64_t bytes) { mBytes = bytes; }
+
+    private:
+
+        const char      *mPhase;
+        std::string     mAsset;
+        uint64_t        mBytes;
+        uint64_t        mReportId;      // Zero if no report was open when started
+        ScopedTimer     *mParent;
+        double          mNestedTime;    // ms spent in directly nested timers
+
+        std::chrono::steady_clock::time_point mStartTime;
+    };
+}
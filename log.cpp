@@ -1,5 +1,14 @@
 #include "log.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#endif
+
+#include <mutex>
+#include <vector>
+
 Log::ELoggingLevel Log::sLoggingLevel = Log::eDebug;
 
 
@@ -19,3 +28,59 @@ const wchar_t * Log::LogLevelToString(ELoggingLevel level)
         return L"Uknown";
     }
 }
+
+
+std::wstring Log::PortableFormat(const wchar_t *format)
+{
+    std::wstring result;
+    for (const wchar_t *ch = format; *ch; ++ch)
+    {
+        result.push_back(*ch);
+        if (*ch != L'%')
+            continue;
+
+        // Flags, width, precision and length modifiers
+        ++ch;
+        while (*ch && wcschr(L"-+ #0123456789.*hlLzjt", *ch))
+            result.push_back(*ch++);
+        if (!*ch)
+            break;
+
+        if (*ch == L's' && result.back() != L'l')
+            result.append(L"ls");
+        else if (*ch == L'S')
+            result.push_back(L's');
+        else
+            result.push_back(*ch);
+    }
+    return result;
+}
+
+
+wchar_t * Log::GetWriteBuffer(size_t index)
+{
+    static thread_local std::vector<wchar_t> buffers[2];
+
+    auto &buffer = buffers[index];
+    if (buffer.empty())
+        buffer.resize(kWriteBufferSize);
+
+    // Failed or truncated formatting must not leave a previous or unterminated message behind
+    buffer[0] = L'\0';
+    buffer[kWriteBufferSize - 1] = L'\0';
+    return buffer.data();
+}
+
+
+void Log::Output(const wchar_t *text)
+{
+    // Messages may come from loader worker threads
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
+
+#ifdef _WIN32
+    OutputDebugString(text);
+#else
+    fputws(text, stderr);
+#endif
+}
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <windows.h>
+#include <cstddef>
+#include <cwchar>
+#include <string>
 
 namespace Log
 {
@@ -20,19 +22,38 @@ namespace Log
     const wchar_t * LogLevelToString(ELoggingLevel level);
 
 
+    // Converts MSVC-style wide format string (%s = wide string, %S = narrow string)
+    // to the C99 one (%ls, %s) used by the other standard libraries
+    std::wstring PortableFormat(const wchar_t *format);
+
+
+    void Output(const wchar_t *text);
+
+
+    const size_t kWriteBufferSize = 100000; // Characters
+
+    // Empty heap buffer of kWriteBufferSize characters owned by the calling thread. Messages are
+    // written from loader worker threads as well, whose stacks are too small for buffers of this size.
+    wchar_t * GetWriteBuffer(size_t index);
+
+
     template <typename... Args>
     void Write(ELoggingLevel msgLevel, const wchar_t *msg, Args... args)
     {
         if (sLoggingLevel < msgLevel)
             return;
 
-        wchar_t tmpBuff1[100000] = {};
-        swprintf_s(tmpBuff1, msg, args...);
-
-        wchar_t tmpBuff2[100000] = {};
-        swprintf_s(tmpBuff2, L"[% 7s] %s\n", LogLevelToString(msgLevel), tmpBuff1);
-
-        OutputDebugString(tmpBuff2);
+        wchar_t *tmpBuff1 = GetWriteBuffer(0);
+        wchar_t *tmpBuff2 = GetWriteBuffer(1);
+#ifdef _MSC_VER
+        swprintf_s(tmpBuff1, kWriteBufferSize - 1, msg, args...);
+        swprintf_s(tmpBuff2, kWriteBufferSize - 1, L"[% 7s] %s\n", LogLevelToString(msgLevel), tmpBuff1);
+#else
+        swprintf(tmpBuff1, kWriteBufferSize - 1, PortableFormat(msg).c_str(), args...);
+        swprintf(tmpBuff2, kWriteBufferSize - 1, L"[% 7ls] %ls\n", LogLevelToString(msgLevel), tmpBuff1);
+#endif
+
+        Output(tmpBuff2);
     }
 
 
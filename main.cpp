@@ -17,9 +17,13 @@ int RunRenderer(HINSTANCE instance,
                 int cmdShow,
                 Scene::SceneId sceneId,
                 bool startWithAnimationActive,
-                double timeout = 0)
+                double timeout = 0,
+                size_t memoryBudget = 0)
 {
-    auto scene = std::make_shared<Scene>(sceneId);
+    // Geometry and textures of glTF scenes appear progressively while the window is already running
+    SceneLoadOptions loadOptions;
+    loadOptions.asyncLoading = true;
+    auto scene = std::make_shared<Scene>(sceneId, loadOptions);
 
     SimpleDX11Renderer renderer(scene, startWithAnimationActive);
 
@@ -29,7 +33,21 @@ int RunRenderer(HINSTANCE instance,
     if (timeout > 0.)
         renderer.SetTimeout(timeout); // For more deterministic measurements
 
-    return renderer.Run();
+    const int ret = renderer.Run();
+
+    scene->LogMemoryReport(5);
+    renderer.GetMemoryTracker().LogReport(L"Renderer: ", 5);
+
+    const auto peakMemory =
+        scene->GetMemoryTracker().GetPeakTotalSize() + renderer.GetMemoryTracker().GetPeakTotalSize();
+    if ((memoryBudget > 0) && (peakMemory > memoryBudget))
+    {
+        Log::Error(L"RunRenderer: scene %d exceeded the memory budget (peak %llu KB, budget %llu KB)!",
+                   sceneId, (unsigned long long)peakMemory >> 10, (unsigned long long)memoryBudget >> 10);
+        return -1;
+    }
+
+    return ret;
 }
 
 
@@ -56,7 +74,8 @@ int RunManyScenes(Scene::SceneId firstScene,
                   HINSTANCE instance,
                   int cmdShow,
                   bool startWithAnimationActive = true,
-                  double timeout = 0)
+                  double timeout = 0,
+                  size_t memoryBudget = 0)
 {
     for (int sceneId = firstScene; sceneId <= lastScene; sceneId++)
     {
@@ -66,7 +85,8 @@ int RunManyScenes(Scene::SceneId firstScene,
         Log::Info(L"-------------------------------");
         Log::Info(L"");
 
-        auto ret = RunRenderer(instance, cmdShow, (Scene::SceneId)sceneId, startWithAnimationActive, timeout);
+        auto ret = RunRenderer(instance, cmdShow, (Scene::SceneId)sceneId, startWithAnimationActive, timeout,
+                               memoryBudget);
         if (ret != 0)
             return ret;
     }
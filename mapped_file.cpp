@@ -0,0 +1,129 @@
+#include "mapped_file.hpp"
+
+#include "log.hpp"
+#include "utils.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::wstring &path)
+{
+    Close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    mFileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        Log::Error(L"MappedFile: Failed to get size of \"%s\"!", path.c_str());
+        Close();
+        return false;
+    }
+
+    mSize = (size_t)fileSize.QuadPart;
+    if (mSize > 0) // Empty files cannot be mapped
+    {
+        mMappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mMappingHandle)
+            mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!mData)
+        {
+            Log::Error(L"MappedFile: Failed to map \"%s\"!", path.c_str());
+            Close();
+            return false;
+        }
+    }
+
+    mIsOpen = true;
+
+    return true;
+}
+
+
+void MappedFile::Close()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMappingHandle)
+        CloseHandle(mMappingHandle);
+    if (mFileHandle)
+        CloseHandle(mFileHandle);
+
+    mIsOpen = false;
+    mData = nullptr;
+    mSize = 0;
+    mMappingHandle = nullptr;
+    mFileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::wstring &path)
+{
+    Close();
+
+    const int file = open(Utils::WstringToString(path).c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0)
+    {
+        Log::Error(L"MappedFile: Failed to get size of \"%s\"!", path.c_str());
+        close(file);
+        return false;
+    }
+
+    mSize = (size_t)fileStat.st_size;
+    if (mSize > 0) // Empty files cannot be mapped
+    {
+        void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            Log::Error(L"MappedFile: Failed to map \"%s\"!", path.c_str());
+            close(file);
+            mSize = 0;
+            return false;
+        }
+        mData = static_cast<const uint8_t*>(data);
+    }
+
+    // The mapping stays valid without the descriptor
+    close(file);
+
+    mIsOpen = true;
+
+    return true;
+}
+
+
+void MappedFile::Close()
+{
+    if (mData)
+        munmap(const_cast<uint8_t*>(mData), mSize);
+
+    mIsOpen = false;
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
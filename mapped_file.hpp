@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory
+class MappedFile
+{
+public:
+
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator =(const MappedFile &) = delete;
+
+    bool Open(const std::wstring &path);
+    void Close();
+
+    bool            IsOpen()    const { return mIsOpen; }
+    const uint8_t*  GetData()   const { return mData; }
+    size_t          GetSize()   const { return mSize; }
+
+private:
+
+    bool            mIsOpen = false;
+    const uint8_t*  mData = nullptr; // Null for empty files
+    size_t          mSize = 0;
+
+#ifdef _WIN32
+    void*           mFileHandle = nullptr;
+    void*           mMappingHandle = nullptr;
+#endif
+};
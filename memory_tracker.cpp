@@ -0,0 +1,197 @@
+#include "memory_tracker.hpp"
+
+#include "utils.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+
+
+MemoryTracker::MemoryTracker() :
+    mCurrentSizes{},
+    mPeakSizes{},
+    mCurrentTotalSize(0),
+    mPeakTotalSize(0)
+{}
+
+
+void MemoryTracker::AddToCategory(MemoryCategory category, size_t addedSize, size_t removedSize)
+{
+    auto &currentSize = mCurrentSizes[(size_t)category];
+    currentSize = currentSize + addedSize - removedSize;
+    mCurrentTotalSize = mCurrentTotalSize + addedSize - removedSize;
+
+    auto &peakSize = mPeakSizes[(size_t)category];
+    peakSize = std::max(peakSize, currentSize);
+    mPeakTotalSize = std::max(mPeakTotalSize, mCurrentTotalSize);
+}
+
+
+void MemoryTracker::SetAssetSize(MemoryCategory category, const std::string &name, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const auto key = std::make_pair(category, name);
+    auto asset = mAssets.find(key);
+    const size_t oldSize = (asset != mAssets.end()) ? asset->second : 0;
+
+    if (size == 0)
+    {
+        if (asset != mAssets.end())
+            mAssets.erase(asset);
+    }
+    else if (asset != mAssets.end())
+        asset->second = size;
+    else
+        mAssets.emplace(key, size);
+
+    AddToCategory(category, size, oldSize);
+}
+
+
+void MemoryTracker::ClearCategory(MemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto asset = mAssets.begin(); asset != mAssets.end();)
+    {
+        if (asset->first.first == category)
+        {
+            AddToCategory(category, 0, asset->second);
+            asset = mAssets.erase(asset);
+        }
+        else
+            ++asset;
+    }
+}
+
+
+void MemoryTracker::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mAssets.clear();
+    std::fill(std::begin(mCurrentSizes), std::end(mCurrentSizes), 0);
+    mCurrentTotalSize = 0;
+}
+
+
+size_t MemoryTracker::GetCurrentSize(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCurrentSizes[(size_t)category];
+}
+
+
+size_t MemoryTracker::GetPeakSize(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPeakSizes[(size_t)category];
+}
+
+
+size_t MemoryTracker::GetCurrentTotalSize() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCurrentTotalSize;
+}
+
+
+size_t MemoryTracker::GetPeakTotalSize() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPeakTotalSize;
+}
+
+
+std::vector<MemoryTracker::Asset> MemoryTracker::GetLargestAssets(size_t count) const
+{
+    std::vector<Asset> assets;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        assets.reserve(mAssets.size());
+        for (const auto &asset : mAssets)
+            assets.push_back(Asset{ asset.first.first, asset.first.second, asset.second });
+    }
+
+    count = std::min(count, assets.size());
+    std::partial_sort(assets.begin(), assets.begin() + count, assets.end(),
+                      [](const Asset &a, const Asset &b) { return a.size > b.size; });
+    assets.resize(count);
+
+    return assets;
+}
+
+
+void MemoryTracker::LogReport(const std::wstring &logPrefix, size_t largestAssetCount) const
+{
+    size_t currentSizes[(size_t)MemoryCategory::kCount];
+    size_t peakSizes[(size_t)MemoryCategory::kCount];
+    size_t currentDeviceSize = 0;
+    size_t currentTotalSize, peakTotalSize;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::copy(std::begin(mCurrentSizes), std::end(mCurrentSizes), currentSizes);
+        std::copy(std::begin(mPeakSizes), std::end(mPeakSizes), peakSizes);
+        currentTotalSize = mCurrentTotalSize;
+        peakTotalSize = mPeakTotalSize;
+    }
+    for (size_t i = 0; i < (size_t)MemoryCategory::kCount; i++)
+        if (IsDeviceCategory((MemoryCategory)i))
+            currentDeviceSize += currentSizes[i];
+
+    Log::Info(L"%sMemory: current %llu KB (CPU %llu KB, device %llu KB), peak %llu KB",
+              logPrefix.c_str(),
+              (unsigned long long)currentTotalSize >> 10,
+              (unsigned long long)(currentTotalSize - currentDeviceSize) >> 10,
+              (unsigned long long)currentDeviceSize >> 10,
+              (unsigned long long)peakTotalSize >> 10);
+
+    for (size_t i = 0; i < (size_t)MemoryCategory::kCount; i++)
+        if (peakSizes[i] > 0)
+            Log::Info(L"%s   %s: current %llu KB, peak %llu KB",
+                      logPrefix.c_str(),
+                      GetCategoryName((MemoryCategory)i),
+                      (unsigned long long)currentSizes[i] >> 10,
+                      (unsigned long long)peakSizes[i] >> 10);
+
+    const auto largestAssets = GetLargestAssets(largestAssetCount);
+    if (largestAssets.empty())
+        return;
+
+    Log::Info(L"%s   Largest assets:", logPrefix.c_str());
+    for (const auto &asset : largestAssets)
+        Log::Info(L"%s      %llu KB: %s, \"%s\"",
+                  logPrefix.c_str(),
+                  (unsigned long long)asset.size >> 10,
+                  GetCategoryName(asset.category),
+                  Utils::StringToWstring(asset.name).c_str());
+}
+
+
+const wchar_t* MemoryTracker::GetCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::kGltfData:                     return L"glTF data";
+    case MemoryCategory::kImages:                       return L"Images";
+    case MemoryCategory::kGeometry:                     return L"Geometry";
+    case MemoryCategory::kGeometryBuffers:              return L"Geometry buffers";
+    case MemoryCategory::kBaseColorTextures:            return L"Base color textures";
+    case MemoryCategory::kMetallicRoughnessTextures:    return L"Metallic/roughness textures";
+    case MemoryCategory::kSpecularTextures:             return L"Specular textures";
+    case MemoryCategory::kNormalTextures:               return L"Normal textures";
+    case MemoryCategory::kOcclusionTextures:            return L"Occlusion textures";
+    case MemoryCategory::kEmissionTextures:             return L"Emission textures";
+    case MemoryCategory::kConstantBuffers:              return L"Constant buffers";
+    case MemoryCategory::kRenderTargets:                return L"Render targets";
+    default:                                            return L"Unknown";
+    }
+}
+
+
+bool MemoryTracker::IsDeviceCategory(MemoryCategory category)
+{
+    return category >= MemoryCategory::kGeometryBuffers;
+}
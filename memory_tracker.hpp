@@ -0,0 +1,84 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Memory accounting of a single owner (a scene or the renderer). Each asset (a primitive, texture,
+// render target, ...) is tagged with a category and its owner keeps its current size up to date.
+// Current and peak usage is tracked per category and in total, so that budgets can be checked.
+// ------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class MemoryCategory
+{
+    // CPU memory
+    kGltfData,                      // Buffers and encoded images of a glTF model being loaded
+    kImages,                        // Decoded images and their mip chains waiting for upload
+    kGeometry,                      // Vertices and indices kept by primitives
+
+    // Device memory
+    kGeometryBuffers,               // Vertex and index buffers
+    kBaseColorTextures,             // Material textures by role, see SceneMaterial::GetTextures()
+    kMetallicRoughnessTextures,
+    kSpecularTextures,
+    kNormalTextures,
+    kOcclusionTextures,
+    kEmissionTextures,
+    kConstantBuffers,
+    kRenderTargets,
+
+    kCount
+};
+
+
+class MemoryTracker
+{
+public:
+
+    struct Asset
+    {
+        MemoryCategory  category;
+        std::string     name;
+        size_t          size;
+    };
+
+    MemoryTracker();
+
+    MemoryTracker(const MemoryTracker &) = delete;
+    MemoryTracker& operator =(const MemoryTracker &) = delete;
+
+    // Sets the current size of an asset; zero size removes it. Can be called from any thread.
+    void SetAssetSize(MemoryCategory category, const std::string &name, size_t size);
+
+    // Remove assets, but keep the peak values
+    void ClearCategory(MemoryCategory category);
+    void Clear();
+
+    size_t GetCurrentSize(MemoryCategory category) const;
+    size_t GetPeakSize(MemoryCategory category) const;
+    size_t GetCurrentTotalSize() const;
+    size_t GetPeakTotalSize() const; // Peak of the total, not a sum of the category peaks
+
+    // The largest of the current assets, largest first
+    std::vector<Asset> GetLargestAssets(size_t count) const;
+
+    void LogReport(const std::wstring &logPrefix, size_t largestAssetCount) const;
+
+    static const wchar_t* GetCategoryName(MemoryCategory category);
+    static bool IsDeviceCategory(MemoryCategory category);
+
+private:
+
+    void AddToCategory(MemoryCategory category, size_t addedSize, size_t removedSize);
+
+    mutable std::mutex                                          mMutex;
+    std::map<std::pair<MemoryCategory, std::string>, size_t>    mAssets;
+    size_t                                                      mCurrentSizes[(size_t)MemoryCategory::kCount];
+    size_t                                                      mPeakSizes[(size_t)MemoryCategory::kCount];
+    size_t                                                      mCurrentTotalSize;
+    size_t                                                      mPeakTotalSize;
+};
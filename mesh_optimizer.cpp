@@ -0,0 +1,540 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// FIFO vertex cache emulated with timestamps: a vertex is cached if it was inserted
+// less than cacheSize insertions ago
+class FifoCache
+{
+public:
+
+    FifoCache(size_t vertexCount, uint32_t cacheSize) :
+        mTimestamps(vertexCount, 0),
+        mTime(cacheSize + 1),
+        mCacheSize(cacheSize)
+    {}
+
+    bool IsCached(uint32_t vertex) const
+    {
+        return (mTime - mTimestamps[vertex]) <= mCacheSize;
+    }
+
+    // Returns true if the vertex had to be transformed
+    bool Access(uint32_t vertex)
+    {
+        if (IsCached(vertex))
+            return false;
+        mTimestamps[vertex] = mTime++;
+        return true;
+    }
+
+    // Makes all vertices expire
+    void Flush()
+    {
+        mTime += mCacheSize + 1;
+    }
+
+private:
+
+    std::vector<uint32_t>   mTimestamps;
+    uint32_t                mTime;
+    uint32_t                mCacheSize;
+};
+
+
+// Triangles adjacent to each vertex
+struct VertexAdjacency
+{
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    void Build(const uint32_t *indices, size_t indexCount, size_t vertexCount)
+    {
+        counts.assign(vertexCount, 0);
+        for (size_t i = 0; i < indexCount; i++)
+            counts[indices[i]]++;
+
+        offsets.resize(vertexCount + 1);
+        offsets[0] = 0;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + counts[v];
+
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        triangles.resize(indexCount);
+        for (size_t i = 0; i < indexCount; i++)
+            triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+};
+
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t *indices,
+                                                                  size_t indexCount,
+                                                                  size_t vertexCount,
+                                                                  uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangleCount = indexCount / 3;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<char> isUsed(vertexCount, false);
+    for (size_t i = 0; i < stats.triangleCount * 3; i++)
+    {
+        const auto vertex = indices[i];
+        if (cache.Access(vertex))
+            stats.transformedVertexCount++;
+        if (!isUsed[vertex])
+        {
+            isUsed[vertex] = true;
+            stats.vertexCount++;
+        }
+    }
+
+    return stats;
+}
+
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t *destination,
+                                        const uint32_t *indices,
+                                        size_t indexCount,
+                                        size_t vertexCount,
+                                        uint32_t cacheSize)
+{
+    const size_t triangleCount = indexCount / 3;
+    const uint32_t kNoVertex = ~0u;
+
+    VertexAdjacency adjacency;
+    adjacency.Build(indices, triangleCount * 3, vertexCount);
+
+    auto &liveCounts = adjacency.counts; // Triangles not emitted yet
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    std::vector<char> isEmitted(triangleCount, false);
+    std::vector<uint32_t> deadEndStack;
+    deadEndStack.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    size_t cursor = 0;
+
+    // Recently used vertex with live triangles, or just the next one in the input order
+    auto skipDeadEnd = [&]() -> uint32_t
+    {
+        while (!deadEndStack.empty())
+        {
+            const auto vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveCounts[vertex] > 0)
+                return vertex;
+        }
+        for (; cursor < vertexCount; cursor++)
+            if (liveCounts[cursor] > 0)
+                return (uint32_t)cursor;
+        return kNoVertex;
+    };
+
+    size_t outputIdx = 0;
+    uint32_t fanningVertex = skipDeadEnd();
+    while (fanningVertex != kNoVertex)
+    {
+        // Emit all remaining triangles around the fanning vertex
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanningVertex]; i < adjacency.offsets[fanningVertex + 1]; i++)
+        {
+            const auto triangle = adjacency.triangles[i];
+            if (isEmitted[triangle])
+                continue;
+            isEmitted[triangle] = true;
+
+            for (size_t j = 0; j < 3; j++)
+            {
+                const auto vertex = indices[triangle * 3 + j];
+                destination[outputIdx++] = vertex;
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                liveCounts[vertex]--;
+                if (time - cacheTimestamps[vertex] > cacheSize)
+                    cacheTimestamps[vertex] = time++;
+            }
+        }
+
+        // Next fanning vertex: the oldest candidate which stays in the cache while its triangles are emitted
+        uint32_t bestVertex = kNoVertex;
+        int64_t bestPriority = -1;
+        for (const auto vertex : candidates)
+        {
+            if (liveCounts[vertex] == 0)
+                continue;
+
+            int64_t priority = 0;
+            const uint32_t age = time - cacheTimestamps[vertex];
+            if (age + 2 * liveCounts[vertex] <= cacheSize)
+                priority = age;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = vertex;
+            }
+        }
+
+        fanningVertex = (bestVertex != kNoVertex) ? bestVertex : skipDeadEnd();
+    }
+}
+
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t *destination,
+                                     const uint32_t *indices,
+                                     size_t indexCount,
+                                     const float *positions,
+                                     size_t positionStride,
+                                     size_t vertexCount,
+                                     float threshold,
+                                     uint32_t cacheSize)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    FifoCache cache(vertexCount, cacheSize);
+    auto accessTriangle = [&](size_t triangle)
+    {
+        uint32_t misses = 0;
+        for (size_t j = 0; j < 3; j++)
+            misses += cache.Access(indices[triangle * 3 + j]) ? 1 : 0;
+        return misses;
+    };
+
+    // Hard boundaries: triangles which miss the cache with all their vertices
+    std::vector<size_t> hardClusters;
+    std::vector<uint32_t> triangleMisses(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleMisses[t] = accessTriangle(t);
+        if ((t == 0) || (triangleMisses[t] == 3))
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries: wherever the cache miss ratio since the last boundary gets close enough
+    // to the ratio of the whole hard cluster
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+    {
+        const size_t start = hardClusters[c];
+        const size_t end = hardClusters[c + 1];
+
+        uint32_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++)
+            clusterMisses += triangleMisses[t];
+        const float clusterAcmr = (float)clusterMisses / (end - start);
+
+        cache.Flush();
+        clusters.push_back(start);
+        uint32_t misses = 0;
+        size_t clusterStart = start;
+        for (size_t t = start; t < end; t++)
+        {
+            misses += accessTriangle(t);
+            const float acmr = (float)misses / (t - clusterStart + 1);
+            if ((acmr <= threshold * clusterAcmr) && (t + 1 < end))
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+    const size_t clusterCount = clusters.size();
+    clusters.push_back(triangleCount);
+
+    auto getPosition = [&](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+    };
+
+    // Area-weighted centroid and normal of each cluster
+    struct ClusterInfo
+    {
+        float   centroid[3];
+        float   normal[3];
+        float   area;
+        float   sortKey;
+    };
+    std::vector<ClusterInfo> clusterInfos(clusterCount);
+    float meshCentroid[3] = {};
+    float meshArea = 0.f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        auto &info = clusterInfos[c];
+        memset(&info, 0, sizeof(info));
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const float *p0 = getPosition(indices[t * 3 + 0]);
+            const float *p1 = getPosition(indices[t * 3 + 1]);
+            const float *p2 = getPosition(indices[t * 3 + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                      e1[2] * e2[0] - e1[0] * e2[2],
+                                      e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                info.centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.f);
+                info.normal[k] += normal[k];
+            }
+            info.area += area;
+        }
+
+        for (size_t k = 0; k < 3; k++)
+            meshCentroid[k] += info.centroid[k];
+        meshArea += info.area;
+
+        if (info.area > 0.f)
+            for (size_t k = 0; k < 3; k++)
+                info.centroid[k] /= info.area;
+    }
+    if (meshArea > 0.f)
+        for (size_t k = 0; k < 3; k++)
+            meshCentroid[k] /= meshArea;
+
+    // Clusters facing away from the center are more likely to occlude the rest of the mesh
+    for (auto &info : clusterInfos)
+    {
+        const float normalLength = std::sqrt(info.normal[0] * info.normal[0] +
+                                             info.normal[1] * info.normal[1] +
+                                             info.normal[2] * info.normal[2]);
+        info.sortKey = 0.f;
+        if (normalLength > 0.f)
+            for (size_t k = 0; k < 3; k++)
+                info.sortKey += (info.centroid[k] - meshCentroid[k]) * info.normal[k] / normalLength;
+    }
+
+    std::vector<size_t> clusterOrder(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        clusterOrder[c] = c;
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b)
+    {
+        return clusterInfos[a].sortKey > clusterInfos[b].sortKey;
+    });
+
+    size_t outputIdx = 0;
+    for (const auto c : clusterOrder)
+        for (size_t i = clusters[c] * 3; i < clusters[c + 1] * 3; i++)
+            destination[outputIdx++] = indices[i];
+}
+
+
+size_t MeshOptimizer::GenerateVertexFetchRemap(uint32_t *remap,
+                                               const uint32_t *indices,
+                                               size_t indexCount,
+                                               size_t vertexCount)
+{
+    std::fill(remap, remap + vertexCount, MeshOptimizer::kUnusedVertex);
+
+    uint32_t usedCount = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        const auto vertex = indices[i];
+        if (remap[vertex] == MeshOptimizer::kUnusedVertex)
+            remap[vertex] = usedCount++;
+    }
+
+    return usedCount;
+}
+
+
+// MurmurHash2-style mixing of 32-bit words
+static uint32_t HashBytes(const uint8_t *data, size_t size)
+{
+    const uint32_t m = 0x5bd1e995;
+    uint32_t h = (uint32_t)size;
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        uint32_t k;
+        memcpy(&k, data + i, sizeof(k));
+        k *= m;
+        k ^= k >> 24;
+        k *= m;
+        h = (h * m) ^ k;
+    }
+    for (; i < size; i++)
+        h = (h ^ data[i]) * m;
+
+    h ^= h >> 13;
+    h *= m;
+    h ^= h >> 15;
+    return h;
+}
+
+
+// Open addressing with linear probing: a power of two with at least half of the slots empty
+static size_t GetHashTableSize(size_t elementCount)
+{
+    size_t size = 16;
+    while (size < elementCount * 2)
+        size *= 2;
+    return size;
+}
+
+
+size_t MeshOptimizer::GenerateWeldRemap(uint32_t *remap,
+                                        const void *vertices,
+                                        size_t vertexCount,
+                                        size_t vertexSize)
+{
+    const auto bytes = static_cast<const uint8_t*>(vertices);
+    const uint32_t kEmpty = ~0u;
+
+    // First occurrences of unique vertices
+    std::vector<uint32_t> table(GetHashTableSize(vertexCount), kEmpty);
+    const size_t mask = table.size() - 1;
+
+    uint32_t uniqueCount = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        const auto vertex = bytes + v * vertexSize;
+        size_t slot = HashBytes(vertex, vertexSize) & mask;
+        while ((table[slot] != kEmpty) && (memcmp(bytes + table[slot] * vertexSize, vertex, vertexSize) != 0))
+            slot = (slot + 1) & mask;
+
+        if (table[slot] == kEmpty)
+        {
+            table[slot] = (uint32_t)v;
+            remap[v] = uniqueCount++;
+        }
+        else
+            remap[v] = remap[table[slot]];
+    }
+
+    return uniqueCount;
+}
+
+
+// Cell coordinate along one axis; the side is -1 or 1 depending on which half of the cell the value lies in
+static int64_t GetGridCoord(float value, float cellSize, int64_t &side)
+{
+    side = 1;
+    if (!std::isfinite(value))
+        return 0;
+
+    const double kLimit = 4.6e18; // Stay within int64_t
+    const double cell = std::max(std::min(std::floor((double)value / cellSize), kLimit), -kLimit);
+    side = ((double)value / cellSize - cell < 0.5) ? -1 : 1;
+    return (int64_t)cell;
+}
+
+
+size_t MeshOptimizer::GenerateWeldRemap(uint32_t *remap,
+                                        const float *vertices,
+                                        size_t vertexCount,
+                                        size_t componentCount,
+                                        float epsilon)
+{
+    if (epsilon <= 0.f)
+        return GenerateWeldRemap(remap, vertices, vertexCount, componentCount * sizeof(float));
+
+    const uint32_t kNoVertex = ~0u;
+    const float cellSize = 2.f * epsilon;
+
+    // Uniform grid of cells twice the size of epsilon: a position within epsilon of another one lies
+    // in its cell or in one of the 7 neighboring cells towards the nearest cell corner.
+    // Vertices with different other components never weld, so each occupied cell is split by them and
+    // holds a list of the unique vertices inside. Otherwise a cell full of vertices sharing a position
+    // but not a normal (e.g. a small smooth part) would be searched through for each of them.
+    struct GridCell
+    {
+        int64_t     coords[3];
+        uint32_t    attributesHash;
+        uint32_t    firstVertex;
+    };
+    GridCell emptyCell = {};
+    emptyCell.firstVertex = kNoVertex;
+    std::vector<GridCell> cells(GetHashTableSize(vertexCount), emptyCell);
+    std::vector<uint32_t> nextInCell(vertexCount, kNoVertex);
+    const size_t mask = cells.size() - 1;
+
+    auto areAttributesEqual = [&](const float *a, const float *b)
+    {
+        for (size_t k = 3; k < componentCount; k++)
+            if (a[k] != b[k])
+                return false;
+        return true;
+    };
+
+    std::vector<float> attributes(componentCount - 3);
+    auto hashAttributes = [&](const float *vertex)
+    {
+        for (size_t k = 3; k < componentCount; k++)
+            attributes[k - 3] = (vertex[k] == 0.f) ? 0.f : vertex[k]; // 0 equals -0
+        return HashBytes(reinterpret_cast<const uint8_t*>(attributes.data()), attributes.size() * sizeof(float));
+    };
+
+    auto findCell = [&](const int64_t coords[3], uint32_t attributesHash, const float *vertex) -> GridCell&
+    {
+        size_t slot = (HashBytes(reinterpret_cast<const uint8_t*>(coords), 3 * sizeof(int64_t)) ^ attributesHash) & mask;
+        while ((cells[slot].firstVertex != kNoVertex) &&
+               ((memcmp(cells[slot].coords, coords, 3 * sizeof(int64_t)) != 0) ||
+                (cells[slot].attributesHash != attributesHash) ||
+                !areAttributesEqual(vertices + cells[slot].firstVertex * componentCount, vertex)))
+            slot = (slot + 1) & mask;
+        return cells[slot];
+    };
+
+    auto arePositionsNear = [&](const float *a, const float *b)
+    {
+        for (size_t k = 0; k < 3; k++)
+            if (!(std::abs(a[k] - b[k]) <= epsilon))
+                return false;
+        return true;
+    };
+
+    uint32_t uniqueCount = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        const float *vertex = vertices + v * componentCount;
+        int64_t coords[3], sides[3];
+        for (size_t k = 0; k < 3; k++)
+            coords[k] = GetGridCoord(vertex[k], cellSize, sides[k]);
+        const auto attributesHash = hashAttributes(vertex);
+
+        uint32_t match = kNoVertex;
+        for (uint32_t neighbor = 0; (neighbor < 8) && (match == kNoVertex); neighbor++)
+        {
+            int64_t neighborCoords[3];
+            for (size_t k = 0; k < 3; k++)
+                neighborCoords[k] = coords[k] + (((neighbor >> k) & 1) ? sides[k] : 0);
+
+            for (auto u = findCell(neighborCoords, attributesHash, vertex).firstVertex; u != kNoVertex; u = nextInCell[u])
+                if (arePositionsNear(vertices + u * componentCount, vertex))
+                {
+                    match = u;
+                    break;
+                }
+        }
+
+        if (match != kNoVertex)
+        {
+            remap[v] = remap[match];
+            continue;
+        }
+
+        auto &cell = findCell(coords, attributesHash, vertex);
+        if (cell.firstVertex == kNoVertex)
+        {
+            memcpy(cell.coords, coords, sizeof(coords));
+            cell.attributesHash = attributesHash;
+        }
+        nextInCell[v] = cell.firstVertex;
+        cell.firstVertex = (uint32_t)v;
+        remap[v] = uniqueCount++;
+    }
+
+    return uniqueCount;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Reordering of indexed triangle lists for the GPU: triangles for the post-transform vertex cache
+// (Tipsify by Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw", 2007), clusters of triangles for less overdraw (from the same paper) and vertices
+// for fetch locality. The vertex cache is modelled as a FIFO of a given size. Duplicate vertices
+// (e.g. the corners of non-indexed geometry) are welded with a hash table.
+// ------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MeshOptimizer
+{
+    // Typical size of a post-transform vertex cache
+    const uint32_t kCacheSize = 16;
+
+    struct VertexCacheStats
+    {
+        uint64_t    triangleCount = 0;
+        uint64_t    vertexCount = 0;            // Vertices referenced by the triangles
+        uint64_t    transformedVertexCount = 0; // Cache misses
+
+        // Average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst)
+        float GetAcmr() const { return triangleCount ? (float)transformedVertexCount / triangleCount : 0.f; }
+
+        // Average transformed vertex ratio: transformed vertices per vertex (1 at best)
+        float GetAtvr() const { return vertexCount ? (float)transformedVertexCount / vertexCount : 0.f; }
+
+        void Add(const VertexCacheStats &other)
+        {
+            triangleCount           += other.triangleCount;
+            vertexCount             += other.vertexCount;
+            transformedVertexCount  += other.transformedVertexCount;
+        }
+    };
+
+    VertexCacheStats AnalyzeVertexCache(const uint32_t *indices,
+                                        size_t indexCount,
+                                        size_t vertexCount,
+                                        uint32_t cacheSize = kCacheSize);
+
+    // Reorders triangles for vertex cache locality. Destination must not overlap the source.
+    void OptimizeVertexCache(uint32_t *destination,
+                             const uint32_t *indices,
+                             size_t indexCount,
+                             size_t vertexCount,
+                             uint32_t cacheSize = kCacheSize);
+
+    // Splits cache-optimized triangles into clusters and sorts them so that the ones facing away
+    // from the mesh center go first. Clusters are only split where the cache miss ratio of the part
+    // stays within the threshold times the ratio of the whole, so most of the cache locality is kept.
+    // Positions are 3 floats each, spaced by positionStride bytes. Destination must not overlap
+    // the source.
+    void OptimizeOverdraw(uint32_t *destination,
+                          const uint32_t *indices,
+                          size_t indexCount,
+                          const float *positions,
+                          size_t positionStride,
+                          size_t vertexCount,
+                          float threshold = 1.05f,
+                          uint32_t cacheSize = kCacheSize);
+
+    // Fills the new index of each vertex in the order of first use by the triangles; unused vertices
+    // get kUnusedVertex. Returns the number of used vertices.
+    const uint32_t kUnusedVertex = ~0u;
+    size_t GenerateVertexFetchRemap(uint32_t *remap,
+                                    const uint32_t *indices,
+                                    size_t indexCount,
+                                    size_t vertexCount);
+
+    // Maps each vertex to a unique vertex index in the order of first occurrence, vertices being equal
+    // if their vertexSize bytes are bitwise identical. Returns the number of unique vertices.
+    size_t GenerateWeldRemap(uint32_t *remap,
+                             const void *vertices,
+                             size_t vertexCount,
+                             size_t vertexSize);
+
+    // Same as above for vertices made of componentCount floats, the first three of them a position.
+    // A vertex is welded to an earlier unique one if their positions differ by at most epsilon in each
+    // coordinate and all other components are equal.
+    size_t GenerateWeldRemap(uint32_t *remap,
+                             const float *vertices,
+                             size_t vertexCount,
+                             size_t componentCount,
+                             float epsilon);
+}
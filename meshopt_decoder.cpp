@@ -0,0 +1,641 @@
+#include "meshopt_decoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define MESHOPT_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Bitstream headers (high nibble) and the versions we understand (low nibble)
+static const uint8_t kVertexHeader          = 0xa0;
+static const uint8_t kVertexMaxVersion      = 0;
+static const uint8_t kIndexHeader           = 0xe0;
+static const uint8_t kIndexMaxVersion       = 1;
+static const uint8_t kSequenceHeader        = 0xd0;
+static const uint8_t kSequenceMaxVersion    = 1;
+
+static const size_t kVertexBlockSizeBytes   = 8192;
+static const size_t kVertexBlockMaxSize     = 256;
+static const size_t kVertexMaxStride        = 256;
+static const size_t kByteGroupSize          = 16;
+static const size_t kByteGroupMaxDataSize   = 24; // 4-bit values plus explicit bytes
+static const size_t kVertexTailMinSize      = 32;
+static const size_t kIndexTailSize          = 16; // Table of common codeaux values
+static const size_t kSequenceTailSize       = 4;
+
+
+static size_t GetVertexBlockSize(size_t stride)
+{
+    // Whole byte groups which fit into the block byte budget
+    const size_t size = (kVertexBlockSizeBytes / stride) & ~(kByteGroupSize - 1);
+    return std::min(size, kVertexBlockMaxSize);
+}
+
+
+// A group of 16 bytes stored in 0, 2, 4 or 8 bits per byte. In the 2 and 4 bit modes, values are
+// packed from the most significant bits and the largest value means that the byte is stored
+// explicitly after the packed values.
+static const uint8_t* DecodeBytesGroup(const uint8_t *data, uint8_t *output, int bitsLog2)
+{
+    switch (bitsLog2)
+    {
+    case 0:
+        memset(output, 0, kByteGroupSize);
+        return data;
+
+    case 1:
+    case 2:
+    {
+        const size_t bits = (size_t)1 << bitsLog2;
+        const uint8_t escape = (uint8_t)((1u << bits) - 1);
+        const uint8_t *explicitBytes = data + kByteGroupSize * bits / 8;
+        for (size_t i = 0; i < kByteGroupSize; i++)
+        {
+            const size_t bitOffset = i * bits;
+            const uint8_t value = (data[bitOffset / 8] >> (8 - bits - bitOffset % 8)) & escape;
+            output[i] = (value == escape) ? *explicitBytes++ : value;
+        }
+        return explicitBytes;
+    }
+
+    default:
+        memcpy(output, data, kByteGroupSize);
+        return data + kByteGroupSize;
+    }
+}
+
+
+// Decodes count bytes (a multiple of the group size); returns nullptr if the data is too short
+static const uint8_t* DecodeBytes(const uint8_t *data, const uint8_t *dataEnd, uint8_t *output, size_t count)
+{
+    // Modes of the groups, 2 bits each
+    const uint8_t *header = data;
+    const size_t headerSize = (count / kByteGroupSize + 3) / 4;
+    if ((size_t)(dataEnd - data) < headerSize)
+        return nullptr;
+    data += headerSize;
+
+    for (size_t i = 0; i < count; i += kByteGroupSize)
+    {
+        if ((size_t)(dataEnd - data) < kByteGroupMaxDataSize)
+            return nullptr;
+
+        const size_t group = i / kByteGroupSize;
+        const int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+        data = DecodeBytesGroup(data, output + i, bitsLog2);
+    }
+
+    return data;
+}
+
+
+#ifndef MESHOPT_DECODER_SSE2
+
+static uint8_t Unzigzag8(uint8_t value)
+{
+    return (uint8_t)(-(value & 1) ^ (value >> 1));
+}
+
+#else
+
+static __m128i Unzigzag8(__m128i values)
+{
+    const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1)));
+    const __m128i magnitude = _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(127));
+    return _mm_xor_si128(sign, magnitude);
+}
+
+
+// Four byte channels of 16 vertices: deltas are transposed into 4-byte vertex chunks, which are
+// summed up 4 vertices at a time
+static void DecodeVertexChannels4(uint8_t *vertices,
+                                  size_t stride,
+                                  const uint8_t * const channels[4],
+                                  __m128i &previous)
+{
+    const __m128i r0 = _mm_load_si128(reinterpret_cast<const __m128i*>(channels[0]));
+    const __m128i r1 = _mm_load_si128(reinterpret_cast<const __m128i*>(channels[1]));
+    const __m128i r2 = _mm_load_si128(reinterpret_cast<const __m128i*>(channels[2]));
+    const __m128i r3 = _mm_load_si128(reinterpret_cast<const __m128i*>(channels[3]));
+
+    const __m128i lo01 = _mm_unpacklo_epi8(r0, r1);
+    const __m128i hi01 = _mm_unpackhi_epi8(r0, r1);
+    const __m128i lo23 = _mm_unpacklo_epi8(r2, r3);
+    const __m128i hi23 = _mm_unpackhi_epi8(r2, r3);
+
+    const __m128i deltas[4] =
+    {
+        _mm_unpacklo_epi16(lo01, lo23),
+        _mm_unpackhi_epi16(lo01, lo23),
+        _mm_unpacklo_epi16(hi01, hi23),
+        _mm_unpackhi_epi16(hi01, hi23),
+    };
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        __m128i values = Unzigzag8(deltas[i]);
+        values = _mm_add_epi8(values, _mm_slli_si128(values, 4));
+        values = _mm_add_epi8(values, _mm_slli_si128(values, 8));
+        values = _mm_add_epi8(values, previous);
+        previous = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+
+        for (size_t v = 0; v < 4; v++)
+        {
+            const int32_t chunk = _mm_cvtsi128_si32(values);
+            memcpy(vertices + (i * 4 + v) * stride, &chunk, sizeof(chunk));
+            values = _mm_srli_si128(values, 4);
+        }
+    }
+}
+
+#endif // MESHOPT_DECODER_SSE2
+
+
+// Byte k of each vertex is delta-encoded against byte k of the previous one (lastVertex for the
+// first vertex of the block); each byte channel is stored separately
+static const uint8_t* DecodeVertexBlock(const uint8_t *data,
+                                        const uint8_t *dataEnd,
+                                        uint8_t *output,
+                                        size_t count,
+                                        size_t stride,
+                                        uint8_t *lastVertex)
+{
+    alignas(16) uint8_t channels[4][kVertexBlockMaxSize];
+    alignas(16) uint8_t transposed[kVertexBlockSizeBytes];
+
+    const size_t alignedCount = (count + kByteGroupSize - 1) & ~(kByteGroupSize - 1);
+
+    for (size_t k = 0; k < stride; k += 4)
+    {
+        for (size_t c = 0; c < 4; c++)
+        {
+            data = DecodeBytes(data, dataEnd, channels[c], alignedCount);
+            if (!data)
+                return nullptr;
+        }
+
+#ifdef MESHOPT_DECODER_SSE2
+        int32_t last;
+        memcpy(&last, lastVertex + k, sizeof(last));
+        __m128i previous = _mm_shuffle_epi32(_mm_cvtsi32_si128(last), 0);
+        for (size_t i = 0; i < alignedCount; i += kByteGroupSize)
+        {
+            const uint8_t * const groupChannels[4] =
+                { channels[0] + i, channels[1] + i, channels[2] + i, channels[3] + i };
+            DecodeVertexChannels4(transposed + i * stride + k, stride, groupChannels, previous);
+        }
+#else
+        for (size_t c = 0; c < 4; c++)
+        {
+            uint8_t previous = lastVertex[k + c];
+            for (size_t i = 0; i < count; i++)
+            {
+                previous += Unzigzag8(channels[c][i]);
+                transposed[i * stride + k + c] = previous;
+            }
+        }
+#endif
+    }
+
+    memcpy(output, transposed, count * stride);
+    memcpy(lastVertex, transposed + (count - 1) * stride, stride);
+
+    return data;
+}
+
+
+bool MeshoptDecoder::DecodeVertexBuffer(uint8_t *output,
+                                        size_t count,
+                                        size_t stride,
+                                        const uint8_t *data,
+                                        size_t dataSize)
+{
+    if ((stride == 0) || (stride > kVertexMaxStride) || (stride % 4 != 0))
+        return false;
+    if ((dataSize < 1 + stride) ||
+        ((data[0] & 0xf0) != kVertexHeader) ||
+        ((data[0] & 0x0f) > kVertexMaxVersion))
+        return false;
+
+    // The tail holds the first vertex prediction, padded to a minimal size
+    const uint8_t *dataEnd = data + dataSize;
+    const size_t tailSize = std::max(stride, kVertexTailMinSize);
+    data++;
+    if ((size_t)(dataEnd - data) < tailSize)
+        return false;
+
+    uint8_t lastVertex[kVertexMaxStride];
+    memcpy(lastVertex, dataEnd - stride, stride);
+
+    const size_t blockSize = GetVertexBlockSize(stride);
+    for (size_t offset = 0; offset < count; offset += blockSize)
+    {
+        const size_t blockCount = std::min(blockSize, count - offset);
+        data = DecodeVertexBlock(data, dataEnd, output + offset * stride, blockCount, stride, lastVertex);
+        if (!data)
+            return false;
+    }
+
+    return (size_t)(dataEnd - data) == tailSize;
+}
+
+
+static void WriteIndex(uint8_t *output, size_t i, size_t indexSize, uint32_t index)
+{
+    if (indexSize == 2)
+    {
+        const uint16_t index16 = (uint16_t)index;
+        memcpy(output + i * 2, &index16, sizeof(index16));
+    }
+    else
+        memcpy(output + i * 4, &index, sizeof(index));
+}
+
+
+static uint32_t DecodeVByte(const uint8_t *&data)
+{
+    const uint8_t lead = *data++;
+    if (lead < 128)
+        return lead;
+
+    // Up to 4 more 7-bit groups
+    uint32_t result = lead & 127;
+    uint32_t shift = 7;
+    for (int i = 0; i < 4; i++)
+    {
+        const uint8_t group = *data++;
+        result |= (uint32_t)(group & 127) << shift;
+        shift += 7;
+        if (group < 128)
+            break;
+    }
+
+    return result;
+}
+
+
+static uint32_t Unzigzag32(uint32_t value)
+{
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+
+static uint32_t DecodeIndexDelta(const uint8_t *&data, uint32_t last)
+{
+    return last + Unzigzag32(DecodeVByte(data));
+}
+
+
+struct IndexFifos
+{
+    uint32_t    edges[16][2];
+    uint32_t    vertices[16];
+    size_t      edgeOffset = 0;
+    size_t      vertexOffset = 0;
+
+    IndexFifos()
+    {
+        memset(edges, 0xff, sizeof(edges));
+        memset(vertices, 0xff, sizeof(vertices));
+    }
+
+    void PushEdge(uint32_t a, uint32_t b)
+    {
+        edges[edgeOffset][0] = a;
+        edges[edgeOffset][1] = b;
+        edgeOffset = (edgeOffset + 1) & 15;
+    }
+
+    void PushVertex(uint32_t v, bool condition = true)
+    {
+        vertices[vertexOffset] = v;
+        vertexOffset = (vertexOffset + (condition ? 1 : 0)) & 15;
+    }
+};
+
+
+// Each triangle has a code byte. Triangles sharing an edge with a recent triangle refer to the edge
+// FIFO and take their third vertex from the vertex FIFO, as the next new vertex, or encoded
+// explicitly; other triangles encode all three vertices similarly.
+bool MeshoptDecoder::DecodeIndexBuffer(uint8_t *output,
+                                       size_t count,
+                                       size_t indexSize,
+                                       const uint8_t *data,
+                                       size_t dataSize)
+{
+    if ((count % 3 != 0) || ((indexSize != 2) && (indexSize != 4)))
+        return false;
+    if ((dataSize < 1 + count / 3 + kIndexTailSize) ||
+        ((data[0] & 0xf0) != kIndexHeader) ||
+        ((data[0] & 0x0f) > kIndexMaxVersion))
+        return false;
+
+    // Version 1 encodes the last explicit index +-1 via the two highest vertex FIFO codes
+    const uint32_t version = data[0] & 0x0f;
+    const uint32_t vertexFifoMax = (version >= 1) ? 13 : 15;
+
+    IndexFifos fifos;
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    const uint8_t *code = data + 1;
+    const uint8_t *triangleData = code + count / 3;
+    const uint8_t *triangleDataEnd = data + dataSize - kIndexTailSize;
+    const uint8_t *codeauxTable = triangleDataEnd;
+
+    for (size_t i = 0; i < count; i += 3)
+    {
+        // Each triangle reads at most 16 bytes, which the table at the end keeps within the data
+        if (triangleData > triangleDataEnd)
+            return false;
+
+        const uint8_t codeTri = *code++;
+        if (codeTri < 0xf0)
+        {
+            const size_t edge = (fifos.edgeOffset - 1 - (codeTri >> 4)) & 15;
+            const uint32_t a = fifos.edges[edge][0];
+            const uint32_t b = fifos.edges[edge][1];
+
+            const uint32_t fec = codeTri & 15;
+            uint32_t c;
+            bool isFifoVertex = false;
+            if (fec == 0)
+                c = next++;
+            else if (fec < vertexFifoMax)
+            {
+                c = fifos.vertices[(fifos.vertexOffset - 1 - fec) & 15];
+                isFifoVertex = true;
+            }
+            else if (fec != 15)
+                c = last = last + ((fec == 13) ? (uint32_t)-1 : 1u);
+            else
+                c = last = DecodeIndexDelta(triangleData, last);
+
+            WriteIndex(output, i + 0, indexSize, a);
+            WriteIndex(output, i + 1, indexSize, b);
+            WriteIndex(output, i + 2, indexSize, c);
+
+            // Vertices from the FIFO are not pushed again
+            fifos.PushVertex(c, !isFifoVertex);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+        else
+        {
+            uint32_t fea, feb, fec;
+            if (codeTri < 0xfe)
+            {
+                // Common pair of vertex codes from the table, the first vertex is new
+                const uint8_t codeaux = codeauxTable[codeTri & 15];
+                fea = 0;
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+            }
+            else
+            {
+                const uint8_t codeaux = *triangleData++;
+                fea = (codeTri == 0xfe) ? 0 : 15;
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+
+                // Restart of the new vertex numbering
+                if (codeaux == 0)
+                    next = 0;
+            }
+
+            uint32_t a = (fea == 0) ? next++ : 0;
+            uint32_t b = (feb == 0) ? next++ : fifos.vertices[(fifos.vertexOffset - feb) & 15];
+            uint32_t c = (fec == 0) ? next++ : fifos.vertices[(fifos.vertexOffset - fec) & 15];
+            if (fea == 15)
+                a = last = DecodeIndexDelta(triangleData, last);
+            if (feb == 15)
+                b = last = DecodeIndexDelta(triangleData, last);
+            if (fec == 15)
+                c = last = DecodeIndexDelta(triangleData, last);
+
+            WriteIndex(output, i + 0, indexSize, a);
+            WriteIndex(output, i + 1, indexSize, b);
+            WriteIndex(output, i + 2, indexSize, c);
+
+            fifos.PushVertex(a);
+            fifos.PushVertex(b, (feb == 0) || (feb == 15));
+            fifos.PushVertex(c, (fec == 0) || (fec == 15));
+            fifos.PushEdge(b, a);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+    }
+
+    // All triangle data must be consumed
+    return triangleData == triangleDataEnd;
+}
+
+
+// Each index is a delta against one of two previous indices, selected by the lowest bit
+bool MeshoptDecoder::DecodeIndexSequence(uint8_t *output,
+                                         size_t count,
+                                         size_t indexSize,
+                                         const uint8_t *data,
+                                         size_t dataSize)
+{
+    if ((indexSize != 2) && (indexSize != 4))
+        return false;
+    if ((dataSize < 1 + count + kSequenceTailSize) ||
+        ((data[0] & 0xf0) != kSequenceHeader) ||
+        ((data[0] & 0x0f) > kSequenceMaxVersion))
+        return false;
+
+    // Each index reads at most 5 bytes, which the tail keeps within the data
+    const uint8_t *indexData = data + 1;
+    const uint8_t *indexDataEnd = data + dataSize - kSequenceTailSize;
+
+    uint32_t last[2] = { 0, 0 };
+    for (size_t i = 0; i < count; i++)
+    {
+        if (indexData >= indexDataEnd)
+            return false;
+
+        const uint32_t value = DecodeVByte(indexData);
+        const uint32_t baseline = value & 1;
+        last[baseline] += Unzigzag32(value >> 1);
+        WriteIndex(output, i, indexSize, last[baseline]);
+    }
+
+    return indexData == indexDataEnd;
+}
+
+
+template <typename T>
+static T RoundToSigned(float value)
+{
+    return (T)(int32_t)(value + ((value >= 0.f) ? 0.5f : -0.5f));
+}
+
+
+// x and y are octahedral coordinates scaled so that z holds one; w is kept as is
+template <typename T>
+static void DecodeOctahedralFilter(uint8_t *data, size_t count)
+{
+    const float max = (float)((1 << (sizeof(T) * 8 - 1)) - 1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        T values[4];
+        memcpy(values, data + i * sizeof(values), sizeof(values));
+
+        float x = (float)values[0];
+        float y = (float)values[1];
+        const float z = (float)values[2] - std::abs(x) - std::abs(y);
+
+        // Unfold the lower hemisphere
+        const float t = std::min(z, 0.f);
+        x += (x >= 0.f) ? t : -t;
+        y += (y >= 0.f) ? t : -t;
+
+        const float scale = max / std::sqrt(x * x + y * y + z * z);
+        values[0] = RoundToSigned<T>(x * scale);
+        values[1] = RoundToSigned<T>(y * scale);
+        values[2] = RoundToSigned<T>(z * scale);
+
+        memcpy(data + i * sizeof(values), values, sizeof(values));
+    }
+}
+
+
+// Three smallest components scaled by 1/sqrt(2); w stores the scale in its upper bits and the index
+// of the largest (omitted) component in its lowest two bits
+static void DecodeQuaternionFilter(uint8_t *data, size_t count)
+{
+    const float scale = 1.f / std::sqrt(2.f);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int16_t values[4];
+        memcpy(values, data + i * sizeof(values), sizeof(values));
+
+        const float componentScale = scale / (float)(values[3] | 3);
+        const float x = values[0] * componentScale;
+        const float y = values[1] * componentScale;
+        const float z = values[2] * componentScale;
+        const float w = std::sqrt(std::max(1.f - x * x - y * y - z * z, 0.f));
+
+        const int maxComponent = values[3] & 3;
+        values[(maxComponent + 1) & 3] = RoundToSigned<int16_t>(x * 32767.f);
+        values[(maxComponent + 2) & 3] = RoundToSigned<int16_t>(y * 32767.f);
+        values[(maxComponent + 3) & 3] = RoundToSigned<int16_t>(z * 32767.f);
+        values[(maxComponent + 0) & 3] = RoundToSigned<int16_t>(w * 32767.f);
+
+        memcpy(data + i * sizeof(values), values, sizeof(values));
+    }
+}
+
+
+static float DecodeExponential(uint32_t value)
+{
+    // Signed 24-bit mantissa and signed 8-bit exponent; 2^exponent is built directly
+    const int32_t mantissa = (int32_t)(value << 8) >> 8;
+    const int32_t exponent = (int32_t)value >> 24;
+    const uint32_t powerBits = (uint32_t)(exponent + 127) << 23;
+    float power;
+    memcpy(&power, &powerBits, sizeof(power));
+    return power * (float)mantissa;
+}
+
+
+static void DecodeExponentialFilter(uint8_t *data, size_t valueCount)
+{
+    size_t i = 0;
+
+#ifdef MESHOPT_DECODER_SSE2
+    for (; i + 4 <= valueCount; i += 4)
+    {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+        const __m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(values, 8), 8);
+        const __m128i exponent = _mm_srai_epi32(values, 24);
+        const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+        _mm_storeu_ps(reinterpret_cast<float*>(data + i * 4), _mm_mul_ps(power, _mm_cvtepi32_ps(mantissa)));
+    }
+#endif
+
+    for (; i < valueCount; i++)
+    {
+        uint32_t value;
+        memcpy(&value, data + i * 4, sizeof(value));
+        const float decoded = DecodeExponential(value);
+        memcpy(data + i * 4, &decoded, sizeof(decoded));
+    }
+}
+
+
+bool MeshoptDecoder::ApplyFilter(uint8_t *data, size_t count, size_t stride, MeshoptFilter filter)
+{
+    switch (filter)
+    {
+    case MeshoptFilter::kNone:
+        return true;
+
+    case MeshoptFilter::kOctahedral:
+        if (stride == 4)
+            DecodeOctahedralFilter<int8_t>(data, count);
+        else if (stride == 8)
+            DecodeOctahedralFilter<int16_t>(data, count);
+        else
+            return false;
+        return true;
+
+    case MeshoptFilter::kQuaternion:
+        if (stride != 8)
+            return false;
+        DecodeQuaternionFilter(data, count);
+        return true;
+
+    case MeshoptFilter::kExponential:
+        if (stride % 4 != 0)
+            return false;
+        DecodeExponentialFilter(data, count * stride / 4);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+bool MeshoptDecoder::DecodeBufferView(uint8_t *output,
+                                      size_t count,
+                                      size_t stride,
+                                      MeshoptMode mode,
+                                      MeshoptFilter filter,
+                                      const uint8_t *data,
+                                      size_t dataSize)
+{
+    switch (mode)
+    {
+    case MeshoptMode::kAttributes:
+        if (!DecodeVertexBuffer(output, count, stride, data, dataSize))
+            return false;
+        break;
+
+    case MeshoptMode::kTriangles:
+        if (!DecodeIndexBuffer(output, count, stride, data, dataSize))
+            return false;
+        break;
+
+    case MeshoptMode::kIndices:
+        if (!DecodeIndexSequence(output, count, stride, data, dataSize))
+            return false;
+        break;
+
+    default:
+        return false;
+    }
+
+    // Filters are defined just for vertex data
+    if ((mode != MeshoptMode::kAttributes) && (filter != MeshoptFilter::kNone))
+        return false;
+
+    return ApplyFilter(output, count, stride, filter);
+}
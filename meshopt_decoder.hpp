@@ -0,0 +1,46 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Decoder of buffer views compressed by the EXT_meshopt_compression glTF extension (meshoptimizer
+// bitstreams). Vertex data is decoded in blocks of byte channels which are un-delta-encoded and
+// transposed into the output with SSE2; filters are applied in place afterwards.
+// ------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+enum class MeshoptMode
+{
+    kAttributes,    // Vertex data, stride 4-256 bytes (multiple of 4)
+    kTriangles,     // Triangle list indices, stride 2 or 4 bytes
+    kIndices,       // Other index data, stride 2 or 4 bytes
+};
+
+
+enum class MeshoptFilter
+{
+    kNone,
+    kOctahedral,    // Unit vectors, stride 4 or 8 bytes
+    kQuaternion,    // Unit quaternions, stride 8 bytes
+    kExponential,   // Floats with shared or separate exponents, stride multiple of 4 bytes
+};
+
+
+namespace MeshoptDecoder
+{
+    // Decodes count elements of given stride into output (count * stride bytes) and applies the filter.
+    // Returns false if the parameters are not valid or if the data is malformed.
+    bool DecodeBufferView(uint8_t *output,
+                          size_t count,
+                          size_t stride,
+                          MeshoptMode mode,
+                          MeshoptFilter filter,
+                          const uint8_t *data,
+                          size_t dataSize);
+
+    bool DecodeVertexBuffer(uint8_t *output, size_t count, size_t stride, const uint8_t *data, size_t dataSize);
+    bool DecodeIndexBuffer(uint8_t *output, size_t count, size_t indexSize, const uint8_t *data, size_t dataSize);
+    bool DecodeIndexSequence(uint8_t *output, size_t count, size_t indexSize, const uint8_t *data, size_t dataSize);
+
+    bool ApplyFilter(uint8_t *data, size_t count, size_t stride, MeshoptFilter filter);
+}
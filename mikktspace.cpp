@@ -27,6 +27,11 @@
 
 #include "mikktspace.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define MIKKTSPACE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define TFALSE		0
 #define TTRUE		1
 
@@ -877,10 +882,19 @@ static int GenerateInitialVerticesIndexList(STriInfo pTriInfos[], int piTriList_
 	return iTSpacesOffs;
 }
 
+// genTangSpaceMesh() passes a context without an interface, the mesh is read directly then
+static const float * GetMeshAttribute(const SMikkTSpaceContext * pContext, const int iAttribute, const int index);
+
 static SVec3 GetPosition(const SMikkTSpaceContext * pContext, const int index)
 {
 	int iF, iI;
 	SVec3 res; float pos[3];
+	if (pContext->m_pInterface==NULL)
+	{
+		const float * pPos = GetMeshAttribute(pContext, 0, index);
+		res.x=pPos[0]; res.y=pPos[1]; res.z=pPos[2];
+		return res;
+	}
 	IndexToData(&iF, &iI, index);
 	pContext->m_pInterface->m_getPosition(pContext, pos, iF, iI);
 	res.x=pos[0]; res.y=pos[1]; res.z=pos[2];
@@ -891,6 +905,12 @@ static SVec3 GetNormal(const SMikkTSpaceContext * pContext, const int index)
 {
 	int iF, iI;
 	SVec3 res; float norm[3];
+	if (pContext->m_pInterface==NULL)
+	{
+		const float * pNorm = GetMeshAttribute(pContext, 1, index);
+		res.x=pNorm[0]; res.y=pNorm[1]; res.z=pNorm[2];
+		return res;
+	}
 	IndexToData(&iF, &iI, index);
 	pContext->m_pInterface->m_getNormal(pContext, norm, iF, iI);
 	res.x=norm[0]; res.y=norm[1]; res.z=norm[2];
@@ -901,6 +921,12 @@ static SVec3 GetTexCoord(const SMikkTSpaceContext * pContext, const int index)
 {
 	int iF, iI;
 	SVec3 res; float texc[2];
+	if (pContext->m_pInterface==NULL)
+	{
+		const float * pTexc = GetMeshAttribute(pContext, 2, index);
+		res.x=pTexc[0]; res.y=pTexc[1]; res.z=1.0f;
+		return res;
+	}
 	IndexToData(&iF, &iI, index);
 	pContext->m_pInterface->m_getTexCoord(pContext, texc, iF, iI);
 	res.x=texc[0]; res.y=texc[1]; res.z=1.0f;
@@ -918,7 +944,7 @@ typedef union {
 	int array[3];
 } SEdge;
 
-static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int piTriListIn[], const int iNrTrianglesIn);
+static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int piTriListIn[], const int iNrTrianglesIn, tbool * pbLastRunOrderDependent);
 static void BuildNeighborsSlow(STriInfo pTriInfos[], const int piTriListIn[], const int iNrTrianglesIn);
 
 // returns the texture area times 2
@@ -938,29 +964,9 @@ static float CalcTexArea(const SMikkTSpaceContext * pContext, const int indices[
 	return fSignedAreaSTx2<0 ? (-fSignedAreaSTx2) : fSignedAreaSTx2;
 }
 
-static void InitTriInfo(STriInfo pTriInfos[], const int piTriListIn[], const SMikkTSpaceContext * pContext, const int iNrTrianglesIn)
+// evaluates first order derivatives of triangle f
+static void InitTriDerivatives(STriInfo pTriInfos[], const int piTriListIn[], const SMikkTSpaceContext * pContext, const int f)
 {
-	int f=0, i=0, t=0;
-	// pTriInfos[f].iFlag is cleared in GenerateInitialVerticesIndexList() which is called before this function.
-
-	// generate neighbor info list
-	for (f=0; f<iNrTrianglesIn; f++)
-		for (i=0; i<3; i++)
-		{
-			pTriInfos[f].FaceNeighbors[i] = -1;
-			pTriInfos[f].AssignedGroup[i] = NULL;
-
-			pTriInfos[f].vOs.x=0.0f; pTriInfos[f].vOs.y=0.0f; pTriInfos[f].vOs.z=0.0f;
-			pTriInfos[f].vOt.x=0.0f; pTriInfos[f].vOt.y=0.0f; pTriInfos[f].vOt.z=0.0f;
-			pTriInfos[f].fMagS = 0;
-			pTriInfos[f].fMagT = 0;
-
-			// assumed bad
-			pTriInfos[f].iFlag |= GROUP_WITH_ANY;
-		}
-
-	// evaluate first order derivatives
-	for (f=0; f<iNrTrianglesIn; f++)
 	{
 		// initial values
 		const SVec3 v1 = GetPosition(pContext, piTriListIn[f*3+0]);
@@ -1002,6 +1008,32 @@ static void InitTriInfo(STriInfo pTriInfos[], const int piTriListIn[], const SMi
 				pTriInfos[f].iFlag &= (~GROUP_WITH_ANY);
 		}
 	}
+}
+
+static void InitTriInfo(STriInfo pTriInfos[], const int piTriListIn[], const SMikkTSpaceContext * pContext, const int iNrTrianglesIn)
+{
+	int f=0, i=0, t=0;
+	// pTriInfos[f].iFlag is cleared in GenerateInitialVerticesIndexList() which is called before this function.
+
+	// generate neighbor info list
+	for (f=0; f<iNrTrianglesIn; f++)
+		for (i=0; i<3; i++)
+		{
+			pTriInfos[f].FaceNeighbors[i] = -1;
+			pTriInfos[f].AssignedGroup[i] = NULL;
+
+			pTriInfos[f].vOs.x=0.0f; pTriInfos[f].vOs.y=0.0f; pTriInfos[f].vOs.z=0.0f;
+			pTriInfos[f].vOt.x=0.0f; pTriInfos[f].vOt.y=0.0f; pTriInfos[f].vOt.z=0.0f;
+			pTriInfos[f].fMagS = 0;
+			pTriInfos[f].fMagT = 0;
+
+			// assumed bad
+			pTriInfos[f].iFlag |= GROUP_WITH_ANY;
+		}
+
+	// evaluate first order derivatives
+	for (f=0; f<iNrTrianglesIn; f++)
+		InitTriDerivatives(pTriInfos, piTriListIn, pContext, f);
 
 	// force otherwise healthy quads to a fixed orientation
 	while (t<(iNrTrianglesIn-1))
@@ -1050,7 +1082,7 @@ static void InitTriInfo(STriInfo pTriInfos[], const int piTriListIn[], const SMi
 			BuildNeighborsSlow(pTriInfos, piTriListIn, iNrTrianglesIn);
 		else
 		{
-			BuildNeighborsFast(pTriInfos, pEdges, piTriListIn, iNrTrianglesIn);
+			BuildNeighborsFast(pTriInfos, pEdges, piTriListIn, iNrTrianglesIn, NULL);
 	
 			free(pEdges);
 		}
@@ -1494,11 +1526,14 @@ static void QuickSort(int* pSortBuffer, int iLeft, int iRight, unsigned int uSee
 static void QuickSortEdges(SEdge * pSortBuffer, int iLeft, int iRight, const int channel, unsigned int uSeed);
 static void GetEdge(int * i0_out, int * i1_out, int * edgenum_out, const int indices[], const int i0_in, const int i1_in);
 
-static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int piTriListIn[], const int iNrTrianglesIn)
+// If pbLastRunOrderDependent is given, it tells whether the neighbors could have been paired differently
+// if the last run of edges (the only one never sub sorted) had been in another order. Only then can the
+// result depend on how the run ended up ordered by the channel 0 sort.
+static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int piTriListIn[], const int iNrTrianglesIn, tbool * pbLastRunOrderDependent)
 {
 	// build array of edges
 	unsigned int uSeed = INTERNAL_RND_SORT_SEED;				// could replace with a random seed?
-	int iEntries=0, iCurStartIndex=-1, i=0;
+	int iEntries=0, iCurStartIndex=-1, iLastRunStartIndex=0, i=0;
 	for (int f=0; f<iNrTrianglesIn; f++)
 		for (i=0; i<3; i++)
 		{
@@ -1528,6 +1563,7 @@ static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int p
 			QuickSortEdges(pEdges, iL, iR, 1, uSeed);	// sort channel 1 which is i1
 		}
 	}
+	iLastRunStartIndex = iCurStartIndex;
 
 	// sub sort over f, which should be fast.
 	// this step is to remain compliant with BuildNeighborsSlow() when
@@ -1587,6 +1623,20 @@ static void BuildNeighborsFast(STriInfo pTriInfos[], SEdge * pEdges, const int p
 			}
 		}
 	}
+
+	// the run shares i0, so a single pair of edges is paired up in any order, while
+	// more edges can only be affected if some of them share i1 as well
+	if (pbLastRunOrderDependent!=NULL)
+	{
+		*pbLastRunOrderDependent = TFALSE;
+		if ((iEntries-iLastRunStartIndex)>2)
+		{
+			QuickSortEdges(pEdges, iLastRunStartIndex, iEntries-1, 1, uSeed);	// no longer needed
+			for (i=iLastRunStartIndex+1; i<iEntries; i++)
+				if (pEdges[i-1].i1==pEdges[i].i1)
+					*pbLastRunOrderDependent = TTRUE;
+		}
+	}
 }
 
 static void BuildNeighborsSlow(STriInfo pTriInfos[], const int piTriListIn[], const int iNrTrianglesIn)
@@ -1892,3 +1942,608 @@ static void DegenEpilogue(STSpace psTspace[], STriInfo pTriInfos[], int piTriLis
 		}
 	}
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////// Direct mesh access //////////////////////////////////////
+
+// genTangSpaceMesh() passes this as the user data of a context without an interface
+typedef struct {
+	const SMikkTSpaceMesh * pMesh;
+	const float * pAttributes[3];	// positions, normals, texture coordinates
+	const int * piCornerVerts;		// mesh vertex of each corner of the processed triangles
+} SMeshAccess;
+
+static const float * GetVertexAttribute(const SMeshAccess * pAccess, const int iAttribute, const int iVert)
+{
+	return (const float *) ((const char *) pAccess->pAttributes[iAttribute] + (size_t)iVert*pAccess->pMesh->m_iVertexStride);
+}
+
+static const float * GetMeshAttribute(const SMikkTSpaceContext * pContext, const int iAttribute, const int index)
+{
+	const SMeshAccess * pAccess = (const SMeshAccess *) pContext->m_pUserData;
+	return GetVertexAttribute(pAccess, iAttribute, pAccess->piCornerVerts[(index>>2)*3 + (index&0x3)]);
+}
+
+static unsigned int HashVertexKey(const float fvKey[8])
+{
+	unsigned int uHash = 2166136261u;
+	for (int i=0; i<8; i++)
+	{
+		// 0 and -0 are equal, so they must hash the same
+		const float fVal = fvKey[i]==0.0f ? 0.0f : fvKey[i];
+		unsigned int uBits;
+		memcpy(&uBits, &fVal, sizeof(uBits));
+		uHash = (uHash ^ uBits) * 16777619u;
+		uHash ^= uHash >> 15;
+	}
+	return uHash;
+}
+
+static void GetVertexKey(float fvKey_out[8], const SMeshAccess * pAccess, const int iVert)
+{
+	const float * pPos = GetVertexAttribute(pAccess, 0, iVert);
+	const float * pNorm = GetVertexAttribute(pAccess, 1, iVert);
+	const float * pTexc = GetVertexAttribute(pAccess, 2, iVert);
+	fvKey_out[0]=pPos[0]; fvKey_out[1]=pPos[1]; fvKey_out[2]=pPos[2];
+	fvKey_out[3]=pNorm[0]; fvKey_out[4]=pNorm[1]; fvKey_out[5]=pNorm[2];
+	fvKey_out[6]=pTexc[0]; fvKey_out[7]=pTexc[1];
+}
+
+// Same welding as GenerateSharedVerticesIndexList(), but vertices are looked up in a hash table.
+// Each group of identical corners is represented by its first corner instead of the one picked by
+// MergeVertsFast(). The representatives are only compared with each other from now on, so the choice
+// makes no difference unless they differ in bits (0 vs -0) or MergeVertsFast() misses some welds
+// (non-finite or huge positions). FALSE is returned in such cases and nothing is changed.
+static tbool GenerateSharedVerticesIndexListHash(int piTriList_in_and_out[], const SMeshAccess * pAccess, const int iNrTrianglesIn)
+{
+	const int iNrCorners = iNrTrianglesIn*3;
+	int * piTable = NULL, * piVertGroup = NULL;
+	int iNrVerts = 0, iTableSize = 1, i=0;
+	tbool bRes = TTRUE;
+
+	for (i=0; i<iNrCorners; i++)
+		if (iNrVerts <= pAccess->piCornerVerts[i])
+			iNrVerts = pAccess->piCornerVerts[i]+1;
+	while (iTableSize < 2*iNrCorners)
+		iTableSize <<= 1;
+
+	// first corner of the group of each vertex and of each used table slot
+	piVertGroup = (int *) malloc(sizeof(int)*iNrVerts);
+	piTable = (int *) malloc(sizeof(int)*iTableSize);
+	if (piVertGroup==NULL || piTable==NULL)
+	{
+		if (piVertGroup!=NULL) free(piVertGroup);
+		if (piTable!=NULL) free(piTable);
+		return TFALSE;
+	}
+	memset(piVertGroup, 0xff, sizeof(int)*iNrVerts);
+	memset(piTable, 0xff, sizeof(int)*iTableSize);
+
+	for (i=0; i<iNrCorners && bRes; i++)
+	{
+		const int iVert = pAccess->piCornerVerts[i];
+		float fvKey[8];
+		int iSlot = 0, k=0;
+		if (piVertGroup[iVert]>=0) continue;
+
+		GetVertexKey(fvKey, pAccess, iVert);
+		for (k=0; k<8; k++)
+			if (!(fabsf(fvKey[k]) <= (k<3 ? (0.25f*FLT_MAX) : FLT_MAX)))
+				bRes = TFALSE;
+		if (!bRes) break;
+
+		iSlot = (int) (HashVertexKey(fvKey) & (unsigned int) (iTableSize-1));
+		while (piTable[iSlot]>=0)
+		{
+			float fvKey2[8];
+			tbool bEqual = TTRUE;
+			GetVertexKey(fvKey2, pAccess, pAccess->piCornerVerts[piTable[iSlot]]);
+			for (k=0; k<8; k++)
+				bEqual = bEqual && fvKey[k]==fvKey2[k];
+			if (bEqual)
+			{
+				if (memcmp(fvKey, fvKey2, sizeof(fvKey))!=0)
+					bRes = TFALSE;
+				break;
+			}
+			iSlot = (iSlot+1) & (iTableSize-1);
+		}
+		if (piTable[iSlot]<0)
+			piTable[iSlot] = i;
+		piVertGroup[iVert] = piTable[iSlot];
+	}
+
+	if (bRes)
+		for (i=0; i<iNrCorners; i++)
+			piTriList_in_and_out[i] = piTriList_in_and_out[piVertGroup[pAccess->piCornerVerts[i]]];
+
+	free(piVertGroup);
+	free(piTable);
+
+	return bRes;
+}
+
+#ifdef MIKKTSPACE_SSE2
+// InitTriDerivatives() of four triangles at once. Each operation is the same as in the scalar code
+// (no fused multiply-adds; square roots and divisions are exact), so the results are identical.
+static void InitTriDerivativesSSE2(STriInfo pTriInfos[], const int piTriListIn[], const SMikkTSpaceContext * pContext, const int f)
+{
+	// positions and texture coordinates of all three corners, one triangle per lane
+	float fvIn[3][5][4];
+	float fvOut[8][4];
+	int t=0, i=0, c=0;
+	for (t=0; t<4; t++)
+		for (i=0; i<3; i++)
+		{
+			const int index = piTriListIn[(f+t)*3+i];
+			const float * pPos = GetMeshAttribute(pContext, 0, index);
+			const float * pTexc = GetMeshAttribute(pContext, 2, index);
+			fvIn[i][0][t] = pPos[0]; fvIn[i][1][t] = pPos[1]; fvIn[i][2][t] = pPos[2];
+			fvIn[i][3][t] = pTexc[0]; fvIn[i][4][t] = pTexc[1];
+		}
+
+	{
+		const __m128 vSignMask = _mm_set1_ps(-0.0f);
+		const __m128 vZero = _mm_setzero_ps();
+		const __m128 vOne = _mm_set1_ps(1.0f);
+		const __m128 vFltMin = _mm_set1_ps(FLT_MIN);
+
+		const __m128 t21x = _mm_sub_ps(_mm_loadu_ps(fvIn[1][3]), _mm_loadu_ps(fvIn[0][3]));
+		const __m128 t21y = _mm_sub_ps(_mm_loadu_ps(fvIn[1][4]), _mm_loadu_ps(fvIn[0][4]));
+		const __m128 t31x = _mm_sub_ps(_mm_loadu_ps(fvIn[2][3]), _mm_loadu_ps(fvIn[0][3]));
+		const __m128 t31y = _mm_sub_ps(_mm_loadu_ps(fvIn[2][4]), _mm_loadu_ps(fvIn[0][4]));
+		const __m128 fSignedAreaSTx2 = _mm_sub_ps(_mm_mul_ps(t21x, t31y), _mm_mul_ps(t21y, t31x));
+		const __m128 vNegT31x = _mm_xor_ps(t31x, vSignMask);
+
+		__m128 vOs[3], vOt[3];
+		for (c=0; c<3; c++)
+		{
+			const __m128 d1 = _mm_sub_ps(_mm_loadu_ps(fvIn[1][c]), _mm_loadu_ps(fvIn[0][c]));
+			const __m128 d2 = _mm_sub_ps(_mm_loadu_ps(fvIn[2][c]), _mm_loadu_ps(fvIn[0][c]));
+			vOs[c] = _mm_sub_ps(_mm_mul_ps(t31y, d1), _mm_mul_ps(t21y, d2));		// eq 18
+			vOt[c] = _mm_add_ps(_mm_mul_ps(vNegT31x, d1), _mm_mul_ps(t21x, d2));	// eq 19
+		}
+
+		{
+			const __m128 bOrient = _mm_cmpgt_ps(fSignedAreaSTx2, vZero);
+			const __m128 fAbsArea = _mm_andnot_ps(vSignMask, fSignedAreaSTx2);
+			const __m128 bAreaNotZero = _mm_cmpgt_ps(fAbsArea, vFltMin);
+			const __m128 fS = _mm_or_ps(_mm_and_ps(bOrient, vOne), _mm_andnot_ps(bOrient, _mm_xor_ps(vOne, vSignMask)));
+			const __m128 fLenOs = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vOs[0], vOs[0]), _mm_mul_ps(vOs[1], vOs[1])), _mm_mul_ps(vOs[2], vOs[2])));
+			const __m128 fLenOt = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vOt[0], vOt[0]), _mm_mul_ps(vOt[1], vOt[1])), _mm_mul_ps(vOt[2], vOt[2])));
+			const __m128 bOsNotZero = _mm_and_ps(bAreaNotZero, _mm_cmpgt_ps(fLenOs, vFltMin));
+			const __m128 bOtNotZero = _mm_and_ps(bAreaNotZero, _mm_cmpgt_ps(fLenOt, vFltMin));
+			const __m128 fScaleOs = _mm_div_ps(fS, fLenOs);
+			const __m128 fScaleOt = _mm_div_ps(fS, fLenOt);
+			const __m128 fMagS = _mm_and_ps(bAreaNotZero, _mm_div_ps(fLenOs, fAbsArea));
+			const __m128 fMagT = _mm_and_ps(bAreaNotZero, _mm_div_ps(fLenOt, fAbsArea));
+			const __m128 bGood = _mm_and_ps(_mm_cmpgt_ps(_mm_andnot_ps(vSignMask, fMagS), vFltMin),
+			                                _mm_cmpgt_ps(_mm_andnot_ps(vSignMask, fMagT), vFltMin));
+			for (c=0; c<3; c++)
+			{
+				_mm_storeu_ps(fvOut[c], _mm_and_ps(bOsNotZero, _mm_mul_ps(fScaleOs, vOs[c])));
+				_mm_storeu_ps(fvOut[3+c], _mm_and_ps(bOtNotZero, _mm_mul_ps(fScaleOt, vOt[c])));
+			}
+			_mm_storeu_ps(fvOut[6], fMagS);
+			_mm_storeu_ps(fvOut[7], fMagT);
+
+			{
+				const int iOrientMask = _mm_movemask_ps(bOrient);
+				const int iGoodMask = _mm_movemask_ps(bGood);
+				for (t=0; t<4; t++)
+				{
+					STriInfo * pTriInfo = &pTriInfos[f+t];
+					pTriInfo->vOs.x = fvOut[0][t]; pTriInfo->vOs.y = fvOut[1][t]; pTriInfo->vOs.z = fvOut[2][t];
+					pTriInfo->vOt.x = fvOut[3][t]; pTriInfo->vOt.y = fvOut[4][t]; pTriInfo->vOt.z = fvOut[5][t];
+					pTriInfo->fMagS = fvOut[6][t];
+					pTriInfo->fMagT = fvOut[7][t];
+					if ((iOrientMask>>t)&1) pTriInfo->iFlag |= ORIENT_PRESERVING;
+					if ((iGoodMask>>t)&1) pTriInfo->iFlag &= (~GROUP_WITH_ANY);
+				}
+			}
+		}
+	}
+}
+#endif
+
+// InitTriInfo() of a mesh without quads
+static void InitTriInfoMesh(STriInfo pTriInfos[], const int piTriListIn[], const SMikkTSpaceContext * pContext, const int iNrTrianglesIn, tbool * pbEdgeOrderDependent)
+{
+	int f=0, i=0;
+
+	for (f=0; f<iNrTrianglesIn; f++)
+		for (i=0; i<3; i++)
+		{
+			pTriInfos[f].FaceNeighbors[i] = -1;
+			pTriInfos[f].AssignedGroup[i] = NULL;
+
+			pTriInfos[f].vOs.x=0.0f; pTriInfos[f].vOs.y=0.0f; pTriInfos[f].vOs.z=0.0f;
+			pTriInfos[f].vOt.x=0.0f; pTriInfos[f].vOt.y=0.0f; pTriInfos[f].vOt.z=0.0f;
+			pTriInfos[f].fMagS = 0;
+			pTriInfos[f].fMagT = 0;
+
+			// assumed bad
+			pTriInfos[f].iFlag |= GROUP_WITH_ANY;
+		}
+
+	f = 0;
+#ifdef MIKKTSPACE_SSE2
+	for (; (f+4)<=iNrTrianglesIn; f+=4)
+		InitTriDerivativesSSE2(pTriInfos, piTriListIn, pContext, f);
+#endif
+	for (; f<iNrTrianglesIn; f++)
+		InitTriDerivatives(pTriInfos, piTriListIn, pContext, f);
+
+	// match up edge pairs
+	{
+		SEdge * pEdges = (SEdge *) malloc(sizeof(SEdge)*iNrTrianglesIn*3);
+		if (pEdges==NULL)
+			BuildNeighborsSlow(pTriInfos, piTriListIn, iNrTrianglesIn);
+		else
+		{
+			BuildNeighborsFast(pTriInfos, pEdges, piTriListIn, iNrTrianglesIn, pbEdgeOrderDependent);
+
+			free(pEdges);
+		}
+	}
+}
+
+// Same as GenerateTSpaces(), but the derivatives of the group triangles are projected into
+// the tangent plane of the group vertex just once instead of once for each other group triangle
+static tbool GenerateTSpacesMesh(STSpace psTspace[], const STriInfo pTriInfos[], const SGroup pGroups[],
+                                 const int iNrActiveGroups, const int piTriListIn[], const float fThresCos,
+                                 const SMikkTSpaceContext * pContext)
+{
+	STSpace * pSubGroupTspace = NULL;
+	SSubGroup * pUniSubGroups = NULL;
+	SVec3 * pProjOs = NULL, * pProjOt = NULL;
+	int * pTmpMembers = NULL;
+	int iMaxNrFaces=0, g=0, i=0;
+	for (g=0; g<iNrActiveGroups; g++)
+		if (iMaxNrFaces < pGroups[g].iNrFaces)
+			iMaxNrFaces = pGroups[g].iNrFaces;
+
+	if (iMaxNrFaces == 0) return TTRUE;
+
+	// make initial allocations
+	pSubGroupTspace = (STSpace *) malloc(sizeof(STSpace)*iMaxNrFaces);
+	pUniSubGroups = (SSubGroup *) malloc(sizeof(SSubGroup)*iMaxNrFaces);
+	pTmpMembers = (int *) malloc(sizeof(int)*iMaxNrFaces);
+	pProjOs = (SVec3 *) malloc(sizeof(SVec3)*iMaxNrFaces);
+	pProjOt = (SVec3 *) malloc(sizeof(SVec3)*iMaxNrFaces);
+	if (pSubGroupTspace==NULL || pUniSubGroups==NULL || pTmpMembers==NULL || pProjOs==NULL || pProjOt==NULL)
+	{
+		if (pSubGroupTspace!=NULL) free(pSubGroupTspace);
+		if (pUniSubGroups!=NULL) free(pUniSubGroups);
+		if (pTmpMembers!=NULL) free(pTmpMembers);
+		if (pProjOs!=NULL) free(pProjOs);
+		if (pProjOt!=NULL) free(pProjOt);
+		return TFALSE;
+	}
+
+	for (g=0; g<iNrActiveGroups; g++)
+	{
+		const SGroup * pGroup = &pGroups[g];
+		int iUniqueSubGroups = 0;
+
+		// all group triangles share the vertex and thus the normal, which is normalized already
+		const SVec3 n = GetNormal(pContext, pGroup->iVertexRepresentitive);
+		for (i=0; i<pGroup->iNrFaces; i++)
+		{
+			const int t = pGroup->pFaceIndices[i];
+			SVec3 vOs = vsub(pTriInfos[t].vOs, vscale(vdot(n,pTriInfos[t].vOs), n));
+			SVec3 vOt = vsub(pTriInfos[t].vOt, vscale(vdot(n,pTriInfos[t].vOt), n));
+			if ( VNotZero(vOs) ) vOs = Normalize(vOs);
+			if ( VNotZero(vOt) ) vOt = Normalize(vOt);
+			pProjOs[i] = vOs;
+			pProjOt[i] = vOt;
+		}
+
+		for (i=0; i<pGroup->iNrFaces; i++)	// triangles
+		{
+			const int f = pGroup->pFaceIndices[i];	// triangle number
+			int index=-1, iOF_1=-1, iMembers=0, j=0, l=0;
+			SSubGroup tmp_group;
+			tbool bFound;
+			if (pTriInfos[f].AssignedGroup[0]==pGroup) index=0;
+			else if (pTriInfos[f].AssignedGroup[1]==pGroup) index=1;
+			else if (pTriInfos[f].AssignedGroup[2]==pGroup) index=2;
+			assert(index>=0 && index<3);
+			assert(piTriListIn[f*3+index]==pGroup->iVertexRepresentitive);
+
+			// original face number
+			iOF_1 = pTriInfos[f].iOrgFaceNumber;
+
+			iMembers = 0;
+			for (j=0; j<pGroup->iNrFaces; j++)
+			{
+				const int t = pGroup->pFaceIndices[j];	// triangle number
+				const int iOF_2 = pTriInfos[t].iOrgFaceNumber;
+				const tbool bAny = ( (pTriInfos[f].iFlag | pTriInfos[t].iFlag) & GROUP_WITH_ANY )!=0 ? TTRUE : TFALSE;
+				// make sure triangles which belong to the same quad are joined.
+				const tbool bSameOrgFace = iOF_1==iOF_2 ? TTRUE : TFALSE;
+
+				const float fCosS = vdot(pProjOs[i],pProjOs[j]);
+				const float fCosT = vdot(pProjOt[i],pProjOt[j]);
+
+				assert(f!=t || bSameOrgFace);	// sanity check
+				if (bAny || bSameOrgFace || (fCosS>fThresCos && fCosT>fThresCos))
+					pTmpMembers[iMembers++] = t;
+			}
+
+			// sort pTmpMembers
+			tmp_group.iNrFaces = iMembers;
+			tmp_group.pTriMembers = pTmpMembers;
+			if (iMembers>1)
+			{
+				unsigned int uSeed = INTERNAL_RND_SORT_SEED;	// could replace with a random seed?
+				QuickSort(pTmpMembers, 0, iMembers-1, uSeed);
+			}
+
+			// look for an existing match
+			bFound = TFALSE;
+			l=0;
+			while (l<iUniqueSubGroups && !bFound)
+			{
+				bFound = CompareSubGroups(&tmp_group, &pUniSubGroups[l]);
+				if (!bFound) ++l;
+			}
+
+			// if no match was found we allocate a new subgroup
+			if (!bFound)
+			{
+				// insert new subgroup
+				int * pIndices = (int *) malloc(sizeof(int)*iMembers);
+				if (pIndices==NULL)
+				{
+					// clean up and return false
+					for (int s=0; s<iUniqueSubGroups; s++)
+						free(pUniSubGroups[s].pTriMembers);
+					free(pUniSubGroups);
+					free(pTmpMembers);
+					free(pSubGroupTspace);
+					free(pProjOs);
+					free(pProjOt);
+					return TFALSE;
+				}
+				pUniSubGroups[iUniqueSubGroups].iNrFaces = iMembers;
+				pUniSubGroups[iUniqueSubGroups].pTriMembers = pIndices;
+				memcpy(pIndices, tmp_group.pTriMembers, iMembers*sizeof(int));
+				pSubGroupTspace[iUniqueSubGroups] =
+					EvalTspace(tmp_group.pTriMembers, iMembers, piTriListIn, pTriInfos, pContext, pGroup->iVertexRepresentitive);
+				++iUniqueSubGroups;
+			}
+
+			// output tspace
+			{
+				const int iOffs = pTriInfos[f].iTSpacesOffs;
+				const int iVert = pTriInfos[f].vert_num[index];
+				STSpace * pTS_out = &psTspace[iOffs+iVert];
+				assert(pTS_out->iCounter<2);
+				assert(((pTriInfos[f].iFlag&ORIENT_PRESERVING)!=0) == pGroup->bOrientPreservering);
+				if (pTS_out->iCounter==1)
+				{
+					*pTS_out = AvgTSpace(pTS_out, &pSubGroupTspace[l]);
+					pTS_out->iCounter = 2;	// update counter
+					pTS_out->bOrient = pGroup->bOrientPreservering;
+				}
+				else
+				{
+					assert(pTS_out->iCounter==0);
+					*pTS_out = pSubGroupTspace[l];
+					pTS_out->iCounter = 1;	// update counter
+					pTS_out->bOrient = pGroup->bOrientPreservering;
+				}
+			}
+		}
+
+		// clean up
+		for (int s=0; s<iUniqueSubGroups; s++)
+			free(pUniSubGroups[s].pTriMembers);
+	}
+
+	// clean up
+	free(pUniSubGroups);
+	free(pTmpMembers);
+	free(pSubGroupTspace);
+	free(pProjOs);
+	free(pProjOt);
+
+	return TTRUE;
+}
+
+// DegenEpilogue() of a mesh without quads: the first good corner with the same welded index
+// is found in a table instead of by a linear search
+static void DegenEpilogueMesh(STSpace psTspace[], STriInfo pTriInfos[], int piTriListIn[], const SMikkTSpaceContext * pContext, const int iNrTrianglesIn, const int iTotTris)
+{
+	int * piFirstGoodCorner = NULL;
+	int j=0;
+	if (iNrTrianglesIn==iTotTris) return;
+
+	// welded indices are made by MakeIndex() from the triangle numbers
+	piFirstGoodCorner = (int *) malloc(sizeof(int)*iTotTris*4);
+	if (piFirstGoodCorner==NULL)
+	{
+		DegenEpilogue(psTspace, pTriInfos, piTriListIn, pContext, iNrTrianglesIn, iTotTris);
+		return;
+	}
+	memset(piFirstGoodCorner, 0xff, sizeof(int)*iTotTris*4);
+	for (j=(3*iNrTrianglesIn)-1; j>=0; j--)
+		piFirstGoodCorner[piTriListIn[j]] = j;
+
+	for (int t=iNrTrianglesIn; t<iTotTris; t++)
+	{
+		assert((pTriInfos[t].iFlag&QUAD_ONE_DEGEN_TRI)==0);
+		for (int i=0; i<3; i++)
+		{
+			j = piFirstGoodCorner[piTriListIn[t*3+i]];
+			if (j>=0)
+			{
+				const int iTri = j/3;
+				const int iVert = j%3;
+				const int iSrcVert=pTriInfos[iTri].vert_num[iVert];
+				const int iSrcOffs=pTriInfos[iTri].iTSpacesOffs;
+				const int iDstVert=pTriInfos[t].vert_num[i];
+				const int iDstOffs=pTriInfos[t].iTSpacesOffs;
+
+				// copy tspace
+				psTspace[iDstOffs+iDstVert] = psTspace[iSrcOffs+iSrcVert];
+			}
+		}
+	}
+
+	free(piFirstGoodCorner);
+}
+
+tbool genTangSpaceMeshDefault(const SMikkTSpaceMesh * pMesh)
+{
+	return genTangSpaceMesh(pMesh, 180.0f);
+}
+
+tbool genTangSpaceMesh(const SMikkTSpaceMesh * pMesh, const float fAngularThreshold)
+{
+	SMeshAccess sAccess;
+	SMikkTSpaceContext sContext;
+	int * piTriListIn = NULL, * piGroupTrianglesBuffer = NULL, * piCornerVerts = NULL;
+	STriInfo * pTriInfos = NULL;
+	SGroup * pGroups = NULL;
+	STSpace * psTspace = NULL;
+	const int iNrFaces = pMesh->m_iNrFaces;
+	int iNrTrianglesIn = iNrFaces, iNrTSPaces = iNrFaces*3, iTotTris = 0, iDegenTriangles = 0;
+	int iNrActiveGroups = 0, f=0, t=0, i=0;
+	tbool bRes = TFALSE;
+	const float fThresCos = (float) cos((fAngularThreshold*(float)M_PI)/180.0f);
+
+	if (pMesh->m_pPositions==NULL || pMesh->m_pNormals==NULL || pMesh->m_pTexCoords==NULL ||
+		pMesh->m_pTangents==NULL || pMesh->m_piIndices==NULL)
+		return TFALSE;
+	if (iNrTrianglesIn<=0) return TFALSE;
+
+	// allocate memory for an index list
+	piCornerVerts = (int *) malloc(sizeof(int)*3*iNrTrianglesIn);
+	piTriListIn = (int *) malloc(sizeof(int)*3*iNrTrianglesIn);
+	pTriInfos = (STriInfo *) malloc(sizeof(STriInfo)*iNrTrianglesIn);
+	if (piCornerVerts==NULL || piTriListIn==NULL || pTriInfos==NULL)
+	{
+		if (piCornerVerts!=NULL) free(piCornerVerts);
+		if (piTriListIn!=NULL) free(piTriListIn);
+		if (pTriInfos!=NULL) free(pTriInfos);
+		return TFALSE;
+	}
+
+	// make an initial triangle --> face index list
+	for (f=0; f<iNrFaces; f++)
+	{
+		const unsigned int iFace = pMesh->m_piFaces!=NULL ? pMesh->m_piFaces[f] : (unsigned int) f;
+		pTriInfos[f].iOrgFaceNumber = f;
+		pTriInfos[f].iTSpacesOffs = f*3;
+		pTriInfos[f].iFlag = 0;
+		for (i=0; i<3; i++)
+		{
+			pTriInfos[f].vert_num[i] = (unsigned char) i;
+			piTriListIn[f*3+i] = MakeIndex(f, i);
+			piCornerVerts[f*3+i] = (int) pMesh->m_piIndices[iFace*3+i];
+		}
+	}
+
+	sAccess.pMesh = pMesh;
+	sAccess.pAttributes[0] = pMesh->m_pPositions;
+	sAccess.pAttributes[1] = pMesh->m_pNormals;
+	sAccess.pAttributes[2] = pMesh->m_pTexCoords;
+	sAccess.piCornerVerts = piCornerVerts;
+	sContext.m_pInterface = NULL;
+	sContext.m_pUserData = &sAccess;
+
+	// make a welded index list of identical positions and attributes (pos, norm, texc)
+	if (!GenerateSharedVerticesIndexListHash(piTriListIn, &sAccess, iNrTrianglesIn))
+		GenerateSharedVerticesIndexList(piTriListIn, &sContext, iNrTrianglesIn);
+
+	// Mark all degenerate triangles
+	iTotTris = iNrTrianglesIn;
+	iDegenTriangles = 0;
+	for (t=0; t<iTotTris; t++)
+	{
+		const int i0 = piTriListIn[t*3+0];
+		const int i1 = piTriListIn[t*3+1];
+		const int i2 = piTriListIn[t*3+2];
+		const SVec3 p0 = GetPosition(&sContext, i0);
+		const SVec3 p1 = GetPosition(&sContext, i1);
+		const SVec3 p2 = GetPosition(&sContext, i2);
+		if (veq(p0,p1) || veq(p0,p2) || veq(p1,p2))	// degenerate
+		{
+			pTriInfos[t].iFlag |= MARK_DEGENERATE;
+			++iDegenTriangles;
+		}
+	}
+	iNrTrianglesIn = iTotTris - iDegenTriangles;
+
+	// move all good triangles to the start of pTriInfos[] and piTriListIn[]
+	// without changing order and put the degenerate triangles last.
+	DegenPrologue(pTriInfos, piTriListIn, iNrTrianglesIn, iTotTris);
+
+	// evaluate triangle level attributes and neighbor list
+	if (pMesh->m_pbEdgeOrderDependent!=NULL) *pMesh->m_pbEdgeOrderDependent = TFALSE;
+	InitTriInfoMesh(pTriInfos, piTriListIn, &sContext, iNrTrianglesIn, pMesh->m_pbEdgeOrderDependent);
+
+	// based on the 4 rules, identify groups based on connectivity
+	pGroups = (SGroup *) malloc(sizeof(SGroup)*iNrTrianglesIn*3);
+	piGroupTrianglesBuffer = (int *) malloc(sizeof(int)*iNrTrianglesIn*3);
+	psTspace = (STSpace *) malloc(sizeof(STSpace)*iNrTSPaces);
+	if (pGroups==NULL || piGroupTrianglesBuffer==NULL || psTspace==NULL)
+	{
+		if (pGroups!=NULL) free(pGroups);
+		if (piGroupTrianglesBuffer!=NULL) free(piGroupTrianglesBuffer);
+		if (psTspace!=NULL) free(psTspace);
+		free(piCornerVerts);
+		free(piTriListIn);
+		free(pTriInfos);
+		return TFALSE;
+	}
+	iNrActiveGroups =
+		Build4RuleGroups(pTriInfos, pGroups, piGroupTrianglesBuffer, piTriListIn, iNrTrianglesIn);
+
+	memset(psTspace, 0, sizeof(STSpace)*iNrTSPaces);
+	for (t=0; t<iNrTSPaces; t++)
+	{
+		psTspace[t].vOs.x=1.0f; psTspace[t].vOs.y=0.0f; psTspace[t].vOs.z=0.0f; psTspace[t].fMagS = 1.0f;
+		psTspace[t].vOt.x=0.0f; psTspace[t].vOt.y=1.0f; psTspace[t].vOt.z=0.0f; psTspace[t].fMagT = 1.0f;
+	}
+
+	// make tspaces, each group is split up into subgroups if necessary
+	// based on fAngularThreshold. Finally a tangent space is made for
+	// every resulting subgroup
+	bRes = GenerateTSpacesMesh(psTspace, pTriInfos, pGroups, iNrActiveGroups, piTriListIn, fThresCos, &sContext);
+
+	// clean up
+	free(pGroups);
+	free(piGroupTrianglesBuffer);
+
+	if (!bRes)	// if an allocation in GenerateTSpacesMesh() failed
+	{
+		// clean up and return false
+		free(piCornerVerts); free(pTriInfos); free(piTriListIn); free(psTspace);
+		return TFALSE;
+	}
+
+	// degenerate triangles just copy a space from any good triangle
+	// with the same welded index in piTriListIn[].
+	DegenEpilogueMesh(psTspace, pTriInfos, piTriListIn, &sContext, iNrTrianglesIn, iTotTris);
+
+	free(pTriInfos); free(piTriListIn);
+
+	// set data
+	for (t=0; t<iNrTSPaces; t++)
+	{
+		const STSpace * pTSpace = &psTspace[t];
+		float * pTangent = (float *) ((char *) pMesh->m_pTangents + (size_t)piCornerVerts[t]*pMesh->m_iVertexStride);
+		pTangent[0] = pTSpace->vOs.x;
+		pTangent[1] = pTSpace->vOs.y;
+		pTangent[2] = pTSpace->vOs.z;
+		pTangent[3] = pTSpace->bOrient==TTRUE ? 1.0f : (-1.0f);
+	}
+
+	free(piCornerVerts);
+	free(psTspace);
+
+	return TTRUE;
+}
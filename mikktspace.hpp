@@ -111,6 +111,33 @@ tbool genTangSpaceDefault(const SMikkTSpaceContext * pContext);	// Default (reco
 tbool genTangSpace(const SMikkTSpaceContext * pContext, const float fAngularThreshold);
 
 
+// Indexed triangle mesh read directly by genTangSpaceMesh() instead of through the call-backs.
+// All vertex arrays share the same stride. Tangents are written per triangle corner in the same order
+// as genTangSpace() calls m_setTSpaceBasic(), so vertices shared by several corners end up with the same
+// tangent as if m_setTSpaceBasic() wrote into the vertex referenced by the corner.
+typedef struct {
+	const float * m_pPositions;			// x, y, z
+	const float * m_pNormals;			// x, y, z
+	const float * m_pTexCoords;			// u, v
+	float * m_pTangents;				// x, y, z, sign (output)
+	int m_iVertexStride;				// in bytes
+	const unsigned int * m_piIndices;	// 3 vertex indices per triangle, which must be valid
+	const unsigned int * m_piFaces;		// triangles to process in this order (NULL for all)
+	int m_iNrFaces;						// number of processed triangles
+	tbool * m_pbEdgeOrderDependent;		// optional output, see below
+} SMikkTSpaceMesh;
+
+// Same results as genTangSpace() with call-backs reading the same mesh (bit for bit), only faster:
+// shared vertices are found with a hash table, triangle derivatives are computed four at a time
+// and the work per tangent space group is linear in the number of its triangles instead of quadratic.
+// Triangle neighbors are found by sorting their edges, but the edges whose smaller vertex index is the
+// highest one stay in whatever order the sort leaves them. If m_pbEdgeOrderDependent is given, it is set when
+// that order could have mattered, i.e. when a run over more triangles could give different results for
+// these ones.
+tbool genTangSpaceMeshDefault(const SMikkTSpaceMesh * pMesh);
+tbool genTangSpaceMesh(const SMikkTSpaceMesh * pMesh, const float fAngularThreshold);
+
+
 // To avoid visual errors (distortions/unwanted hard edges in lighting), when using sampled normal maps, the
 // normal map sampler must use the exact inverse of the pixel shader transformation.
 // The most efficient transformation we can possibly do in the pixel shader is
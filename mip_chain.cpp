@@ -0,0 +1,237 @@
+#include "mip_chain.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define MIP_CHAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+
+uint32_t MipChain::GetFullLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+        count++;
+    return count;
+}
+
+
+static uint32_t NextLevelSize(uint32_t size)
+{
+    return std::max(size / 2, 1u);
+}
+
+
+// Linear values of all sRGB-encoded byte values
+static const float* GetSrgbToLinearTable()
+{
+    static const std::vector<float> table = []()
+    {
+        std::vector<float> values(256);
+        for (int i = 0; i < 256; i++)
+        {
+            const float c = i / 255.f;
+            values[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+
+// Linear values in the middle between two neighbouring sRGB-encoded byte values
+static const float* GetLinearToSrgbThresholds()
+{
+    static const std::vector<float> table = []()
+    {
+        std::vector<float> thresholds(255);
+        for (int i = 0; i < 255; i++)
+        {
+            const float c = (i + 0.5f) / 255.f;
+            thresholds[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return thresholds;
+    }();
+    return table.data();
+}
+
+
+static uint8_t LinearToSrgb(float value, const float *thresholds)
+{
+    return (uint8_t)(std::upper_bound(thresholds, thresholds + 255, value) - thresholds);
+}
+
+
+// Source texel with coordinates clamped to the level size (odd sizes)
+static const uint8_t* SourceTexel(const MipChain::Level &src, uint32_t x, uint32_t y)
+{
+    x = std::min(x, src.width - 1);
+    y = std::min(y, src.height - 1);
+    return src.data + ((size_t)y * src.width + x) * 4;
+}
+
+
+static void DownsampleLinear(const MipChain::Level &src, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+        uint32_t x = 0;
+        uint8_t *dstRow = dst + (size_t)y * dstWidth * 4;
+
+#ifdef MIP_CHAIN_SSE2
+        // Two destination texels from 2x4 source texels at once where no clamping is needed
+        if (2 * y + 1 < src.height)
+        {
+            const uint8_t *srcRow0 = src.data + (size_t)(2 * y) * src.width * 4;
+            const uint8_t *srcRow1 = srcRow0 + (size_t)src.width * 4;
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            for (; 2 * x + 3 < src.width; x += 2)
+            {
+                const __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + 8 * x));
+                const __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1 + 8 * x));
+
+                // Vertical sums of source texel pairs 0,1 and 2,3 as 16-bit channels
+                const __m128i sum01 = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+                const __m128i sum23 = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+
+                // Horizontal sums end up in the lower halves
+                const __m128i box0 = _mm_add_epi16(sum01, _mm_srli_si128(sum01, 8));
+                const __m128i box1 = _mm_add_epi16(sum23, _mm_srli_si128(sum23, 8));
+
+                __m128i result = _mm_unpacklo_epi64(box0, box1);
+                result = _mm_srli_epi16(_mm_add_epi16(result, rounding), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dstRow + 4 * x), _mm_packus_epi16(result, zero));
+            }
+        }
+#endif
+
+        for (; x < dstWidth; x++)
+        {
+            const uint8_t *t00 = SourceTexel(src, 2 * x,     2 * y);
+            const uint8_t *t10 = SourceTexel(src, 2 * x + 1, 2 * y);
+            const uint8_t *t01 = SourceTexel(src, 2 * x,     2 * y + 1);
+            const uint8_t *t11 = SourceTexel(src, 2 * x + 1, 2 * y + 1);
+            for (int c = 0; c < 4; c++)
+                dstRow[4 * x + c] = (uint8_t)((t00[c] + t10[c] + t01[c] + t11[c] + 2) >> 2);
+        }
+    }
+}
+
+
+static void DownsampleSrgb(const MipChain::Level &src, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    const float *toLinear = GetSrgbToLinearTable();
+    const float *thresholds = GetLinearToSrgbThresholds();
+
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+        uint8_t *dstTexel = dst + (size_t)y * dstWidth * 4;
+        for (uint32_t x = 0; x < dstWidth; x++, dstTexel += 4)
+        {
+            const uint8_t *t00 = SourceTexel(src, 2 * x,     2 * y);
+            const uint8_t *t10 = SourceTexel(src, 2 * x + 1, 2 * y);
+            const uint8_t *t01 = SourceTexel(src, 2 * x,     2 * y + 1);
+            const uint8_t *t11 = SourceTexel(src, 2 * x + 1, 2 * y + 1);
+            for (int c = 0; c < 3; c++)
+            {
+                const float linear =
+                    (toLinear[t00[c]] + toLinear[t10[c]] + toLinear[t01[c]] + toLinear[t11[c]]) * 0.25f;
+                dstTexel[c] = LinearToSrgb(linear, thresholds);
+            }
+            dstTexel[3] = (uint8_t)((t00[3] + t10[3] + t01[3] + t11[3] + 2) >> 2);
+        }
+    }
+}
+
+
+void MipChain::Generate(uint32_t width, uint32_t height, const uint8_t *texels, bool isSrgb)
+{
+    const uint32_t levelCount = GetFullLevelCount(width, height);
+
+    // Allocate all levels at once so that the level pointers stay valid
+    size_t texelCount = 0;
+    for (uint32_t level = 1, w = width, h = height; level < levelCount; level++)
+    {
+        w = NextLevelSize(w);
+        h = NextLevelSize(h);
+        texelCount += (size_t)w * h;
+    }
+    mTexels.resize(texelCount * 4);
+
+    mFormat = BcEncoder::Format::kNone;
+    mLevels.clear();
+    mLevels.reserve(levelCount);
+    mLevels.push_back(Level{ width, height, texels });
+
+    uint8_t *dst = mTexels.data();
+    for (uint32_t level = 1; level < levelCount; level++)
+    {
+        const Level src = mLevels.back();
+        const uint32_t dstWidth  = NextLevelSize(src.width);
+        const uint32_t dstHeight = NextLevelSize(src.height);
+
+        if (isSrgb)
+            DownsampleSrgb(src, dst, dstWidth, dstHeight);
+        else
+            DownsampleLinear(src, dst, dstWidth, dstHeight);
+
+        mLevels.push_back(Level{ dstWidth, dstHeight, dst });
+        dst += (size_t)dstWidth * dstHeight * 4;
+    }
+}
+
+
+void MipChain::Encode(const MipChain &src,
+                      BcEncoder::Format format,
+                      BcEncoder::Quality quality,
+                      ThreadPool *pool)
+{
+    size_t dataSize = 0;
+    for (const auto &level : src.mLevels)
+        dataSize += BcEncoder::GetImageSize(format, level.width, level.height);
+    mTexels.resize(dataSize);
+
+    mFormat = format;
+    mLevels.clear();
+    mLevels.reserve(src.mLevels.size());
+
+    uint8_t *dst = mTexels.data();
+    for (const auto &level : src.mLevels)
+    {
+        BcEncoder::EncodeImage(dst, format, quality, level.width, level.height, level.data, pool);
+        mLevels.push_back(Level{ level.width, level.height, dst });
+        dst += BcEncoder::GetImageSize(format, level.width, level.height);
+    }
+}
+
+
+void MipChain::SetLevels(const std::vector<Level> &levels, BcEncoder::Format format)
+{
+    mTexels.clear();
+    mFormat = format;
+    mLevels = levels;
+}
+
+
+uint32_t MipChain::GetLevelPitch(size_t level) const
+{
+    return BcEncoder::GetRowPitch(mFormat, mLevels[level].width);
+}
+
+
+size_t MipChain::GetLevelSize(size_t level) const
+{
+    return BcEncoder::GetImageSize(mFormat, mLevels[level].width, mLevels[level].height);
+}
+
+
+size_t MipChain::GetSize() const
+{
+    size_t size = 0;
+    for (size_t level = 0; level < mLevels.size(); level++)
+        size += GetLevelSize(level);
+    return size;
+}
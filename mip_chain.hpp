@@ -0,0 +1,58 @@
+#pragma once
+
+#include "bc_encoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// RGBA8 image together with all its downsampled levels (down to 1x1). Each level is created
+// from the previous one with a 2x2 box filter; color channels of sRGB images are averaged
+// in linear space, alpha is always treated as linear. A chain can also hold a block-compressed
+// copy of another chain (see Encode()).
+class MipChain
+{
+public:
+
+    struct Level
+    {
+        uint32_t        width;
+        uint32_t        height;
+        const uint8_t  *data;   // Tightly packed RGBA8 rows or rows of blocks (see GetFormat())
+    };
+
+    MipChain() {}
+    MipChain(MipChain &&) = default;
+    MipChain& operator =(MipChain &&) = default;
+
+    // Levels point to the owned storage
+    MipChain(const MipChain &) = delete;
+    MipChain& operator =(const MipChain &) = delete;
+
+    // The top level is just referenced, so its texels must outlive the chain
+    void Generate(uint32_t width, uint32_t height, const uint8_t *texels, bool isSrgb);
+
+    // Block-compresses all levels of an uncompressed chain
+    void Encode(const MipChain &src,
+                BcEncoder::Format format,
+                BcEncoder::Quality quality,
+                ThreadPool *pool = nullptr);
+
+    // Uses already existing levels (e.g. from a scene cache) without generating anything
+    void SetLevels(const std::vector<Level> &levels, BcEncoder::Format format = BcEncoder::Format::kNone);
+
+    BcEncoder::Format GetFormat()           const { return mFormat; }
+    size_t          GetLevelCount()         const { return mLevels.size(); }
+    const Level&    GetLevel(size_t level)  const { return mLevels[level]; }
+    uint32_t        GetLevelPitch(size_t level) const;
+    size_t          GetLevelSize(size_t level)  const;
+    size_t          GetSize()                   const; // All levels
+
+    static uint32_t GetFullLevelCount(uint32_t width, uint32_t height);
+
+private:
+
+    BcEncoder::Format       mFormat = BcEncoder::Format::kNone;
+    std::vector<Level>      mLevels;
+    std::vector<uint8_t>    mTexels; // All generated or encoded levels
+};
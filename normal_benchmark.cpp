@@ -0,0 +1,236 @@
+// Measures normals generation (see NormalGenerator) of glTF triangle primitives by each normal method,
+// serial and on the given number of worker threads, and compares the generated normals with the authored
+// ones: maximum and mean angle between them and the number of vertices after splitting. Parallel results
+// are checked to be bit-identical to the serial ones.
+//
+// Usage: normal_benchmark [thread count] [repeat count] [crease angle] [glTF files...]
+//
+// Zero thread count means one per hardware thread. Each time is the best of repeat count runs.
+// Without files, the bundled sample scenes are measured (paths are relative to the Bin directory).
+
+#include "scene.hpp"
+#include "scene_geometry.hpp"
+#include "thread_pool.hpp"
+#include "gltf_utils.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Scene::SceneId sSampleScenes[] =
+{
+    Scene::eGltfSample2CylinderEngine,
+    Scene::eGltfSampleDuck,
+    Scene::eGltfSampleDamagedHelmet,
+    Scene::eSpotMiniRigged,
+    Scene::eSalazarSkull,
+};
+
+static const wchar_t *sMethodNames[] =
+{
+    L"flat",
+    L"area-weighted",
+    L"angle-weighted",
+};
+
+
+struct NormalDeviation
+{
+    size_t  vertexCount = 0;
+    size_t  splitVertexCount = 0;
+    size_t  cornerCount = 0;
+    double  maxAngle = 0.;      // Degrees
+    double  angleSum = 0.;
+};
+
+
+// Normal of each face corner
+static std::vector<SceneMath::Float3> GetCornerNormals(const SceneGeometry &geometry)
+{
+    std::vector<SceneMath::Float3> normals;
+    const auto &corners = geometry.GetFaceCorners();
+    const auto &vertices = geometry.GetVertices();
+    normals.reserve(corners.size());
+    for (size_t i = 0; i < geometry.GetFacesCount() * 3; i++)
+        normals.push_back(vertices[corners[i]].Normal);
+    return normals;
+}
+
+
+// Best time of the given number of runs in ms; each run starts from the loaded geometry
+static double MeasureRuns(std::vector<SceneGeometry> &results,
+                          const std::vector<SceneGeometry> &geometries,
+                          NormalMethod method,
+                          float creaseAngle,
+                          ThreadPool *pool,
+                          size_t repeatCount)
+{
+    double bestTime = 0.;
+    for (size_t i = 0; i < repeatCount; i++)
+    {
+        results = geometries;
+
+        const auto start = Clock::now();
+        for (auto &geometry : results)
+            if (!geometry.GenerateNormals(method, creaseAngle, L"   ", pool))
+                return -1.;
+        const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bestTime = (i == 0) ? time : std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+
+static NormalDeviation GetDeviation(const std::vector<SceneGeometry> &results,
+                                    const std::vector<std::vector<SceneMath::Float3>> &authoredNormals)
+{
+    NormalDeviation deviation;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto normals = GetCornerNormals(results[i]);
+        for (size_t corner = 0; corner < normals.size(); corner++)
+        {
+            const auto &normal = normals[corner];
+            const auto &authored = authoredNormals[i][corner];
+            const double dot = (double)normal.x * authored.x + (double)normal.y * authored.y + (double)normal.z * authored.z;
+            const double lengths = std::sqrt(((double)normal.x * normal.x + (double)normal.y * normal.y + (double)normal.z * normal.z) *
+                                             ((double)authored.x * authored.x + (double)authored.y * authored.y + (double)authored.z * authored.z));
+            const double cosAngle = (lengths > 0.) ? std::max(-1., std::min(dot / lengths, 1.)) : -1.;
+            const double angle = std::acos(cosAngle) * 180. / SceneMath::kPi;
+
+            deviation.cornerCount++;
+            deviation.maxAngle = std::max(deviation.maxAngle, angle);
+            deviation.angleSum += angle;
+        }
+        deviation.splitVertexCount += results[i].GetVertices().size();
+    }
+    return deviation;
+}
+
+
+static bool IsSameResult(const std::vector<SceneGeometry> &results, const std::vector<SceneGeometry> &expected)
+{
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto &vertices = results[i].GetVertices();
+        const auto &expectedVertices = expected[i].GetVertices();
+        if ((vertices.size() != expectedVertices.size()) ||
+            (results[i].GetIndices() != expected[i].GetIndices()) ||
+            (memcmp(vertices.data(), expectedVertices.data(), vertices.size() * sizeof(SceneVertex)) != 0))
+            return false;
+    }
+    return true;
+}
+
+
+static bool RunBenchmark(const std::wstring &filePath, size_t threadCount, size_t repeatCount, float creaseAngle)
+{
+    tinygltf::Model model;
+    if (!GltfUtils::LoadModel(model, filePath, true))
+        return false;
+
+    std::vector<SceneGeometry> geometries;
+    std::vector<std::vector<SceneMath::Float3>> authoredNormals;
+    size_t vertexCount = 0;
+    size_t faceCount = 0;
+    for (const auto &mesh : model.meshes)
+        for (int i = 0; i < (int)mesh.primitives.size(); i++)
+        {
+            if (mesh.primitives[i].attributes.count("NORMAL") == 0)
+                continue;
+
+            SceneGeometry geometry;
+            if (!geometry.LoadDataFromGLTF(model, mesh, i, L"   "))
+                return false;
+            if (geometry.GetVerticesPerFace() != 3)
+                continue;
+
+            authoredNormals.push_back(GetCornerNormals(geometry));
+            vertexCount += geometry.GetVertices().size();
+            faceCount += geometry.GetFacesCount();
+            geometries.push_back(std::move(geometry));
+        }
+    if (geometries.empty())
+    {
+        Log::Error(L"   No triangle primitives with normals!");
+        return false;
+    }
+
+    Log::Info(L"   %d primitive(s), %d vertices, %d triangles",
+              (int)geometries.size(), (int)vertexCount, (int)faceCount);
+
+    ThreadPool pool(threadCount);
+    bool identical = true;
+    for (int method = (int)NormalMethod::kFlat; method <= (int)NormalMethod::kAngleWeighted; method++)
+    {
+        std::vector<SceneGeometry> serialResults, parallelResults;
+        const double serialTime = MeasureRuns(serialResults, geometries, (NormalMethod)method, creaseAngle,
+                                              nullptr, repeatCount);
+        const double parallelTime = MeasureRuns(parallelResults, geometries, (NormalMethod)method, creaseAngle,
+                                                &pool, repeatCount);
+        if ((serialTime < 0.) || (parallelTime < 0.))
+        {
+            Log::Error(L"   Normals generation failed!");
+            return false;
+        }
+
+        const bool parallelIdentical = IsSameResult(parallelResults, serialResults);
+        const auto deviation = GetDeviation(serialResults, authoredNormals);
+        Log::Info(L"   %s: %d vertices, max %.3f deg, mean %.3f deg; serial %.2f ms, %d thread(s) %.2f ms (%.2fx)%s",
+                  sMethodNames[method],
+                  (int)deviation.splitVertexCount,
+                  deviation.maxAngle,
+                  (deviation.cornerCount > 0) ? deviation.angleSum / deviation.cornerCount : 0.,
+                  serialTime,
+                  (int)pool.GetThreadCount(),
+                  parallelTime,
+                  serialTime / parallelTime,
+                  parallelIdentical ? L"" : L" MISMATCH");
+
+        identical = identical && parallelIdentical;
+    }
+
+    if (!identical)
+        Log::Error(L"   Parallel normals differ from the serial ones!");
+
+    return identical;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Log::sLoggingLevel = Log::eInfo;
+
+    const size_t threadCount = (argc > 1) ? (size_t)std::max(std::atoi(argv[1]), 0) : 0;
+    const size_t repeatCount = (argc > 2) ? (size_t)std::max(std::atoi(argv[2]), 1) : 3;
+    const float creaseAngle = (argc > 3) ? (float)std::atof(argv[3]) : 60.f;
+    std::vector<std::wstring> filePaths;
+    for (int i = 4; i < argc; i++)
+        filePaths.push_back(Utils::StringToWstring(argv[i]));
+    if (filePaths.empty())
+        for (const auto sceneId : sSampleScenes)
+            filePaths.push_back(Scene::GetSceneFilePath(sceneId));
+
+    int failedCount = 0;
+    for (const auto &filePath : filePaths)
+    {
+        Log::Info(L"Scene \"%s\" (crease angle %.1f deg):", filePath.c_str(), creaseAngle);
+
+        if (!RunBenchmark(filePath, threadCount, repeatCount, creaseAngle))
+            failedCount++;
+    }
+
+    return failedCount == 0 ? 0 : -1;
+}
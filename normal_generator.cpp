@@ -0,0 +1,336 @@
+#include "normal_generator.hpp"
+
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define NORMAL_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace SceneMath;
+
+// Smaller meshes are not worth the parallelization
+static const size_t kMinParallelFaceCount = 16384;
+
+// Work items of the worker threads. The face count is a multiple of 4, so that the SIMD batches
+// are the same as in the serial run.
+static const size_t kFacesPerTask = 4096;
+static const size_t kPositionsPerTask = 4096;
+
+
+struct FaceData
+{
+    float       *normals[3];    // SoA unit normals, zero for degenerate triangles
+    float       *weights;       // Weight of each face corner
+    const float *positions;     // x, y, z of each vertex
+    const uint32_t *corners;
+    bool        areaWeights;    // Angle weights otherwise
+};
+
+
+// Corner angle given the dot product and squared lengths of its edges, zero if an edge is degenerate
+static float GetCornerAngle(float dot, float lengthSqr1, float lengthSqr2)
+{
+    const float lengths = std::sqrt(lengthSqr1 * lengthSqr2);
+    if (!(lengths > 0.f))
+        return 0.f;
+    return std::acos(std::max(-1.f, std::min(dot / lengths, 1.f)));
+}
+
+
+static void CalculateFaceNormal(FaceData &data, size_t face)
+{
+    const float *p0 = data.positions + 3 * data.corners[face * 3 + 0];
+    const float *p1 = data.positions + 3 * data.corners[face * 3 + 1];
+    const float *p2 = data.positions + 3 * data.corners[face * 3 + 2];
+
+    const float e1x = p1[0] - p0[0], e1y = p1[1] - p0[1], e1z = p1[2] - p0[2];
+    const float e2x = p2[0] - p0[0], e2y = p2[1] - p0[1], e2z = p2[2] - p0[2];
+    const float cx = e1y * e2z - e1z * e2y;
+    const float cy = e1z * e2x - e1x * e2z;
+    const float cz = e1x * e2y - e1y * e2x;
+    const float length = std::sqrt(cx * cx + cy * cy + cz * cz);
+    const bool isDegenerate = !(length > 0.f);
+
+    data.normals[0][face] = isDegenerate ? 0.f : cx / length;
+    data.normals[1][face] = isDegenerate ? 0.f : cy / length;
+    data.normals[2][face] = isDegenerate ? 0.f : cz / length;
+
+    float *weights = data.weights + face * 3;
+    if (data.areaWeights)
+    {
+        weights[0] = weights[1] = weights[2] = isDegenerate ? 0.f : length;
+        return;
+    }
+
+    const float e3x = p2[0] - p1[0], e3y = p2[1] - p1[1], e3z = p2[2] - p1[2];
+    const float l1 = e1x * e1x + e1y * e1y + e1z * e1z;
+    const float l2 = e2x * e2x + e2y * e2y + e2z * e2z;
+    const float l3 = e3x * e3x + e3y * e3y + e3z * e3z;
+    weights[0] = GetCornerAngle(  e1x * e2x + e1y * e2y + e1z * e2z,  l1, l2);
+    weights[1] = GetCornerAngle(-(e1x * e3x + e1y * e3y + e1z * e3z), l1, l3);
+    weights[2] = GetCornerAngle(  e2x * e3x + e2y * e3y + e2z * e3z,  l2, l3);
+}
+
+
+#ifdef NORMAL_GENERATOR_SSE2
+// CalculateFaceNormal() of four faces at once; only the arc cosines are scalar
+static void CalculateFaceNormals4(FaceData &data, size_t face)
+{
+    float p[3][3][4]; // corner, component, face
+    for (size_t f = 0; f < 4; f++)
+        for (size_t i = 0; i < 3; i++)
+        {
+            const float *position = data.positions + 3 * data.corners[(face + f) * 3 + i];
+            p[i][0][f] = position[0];
+            p[i][1][f] = position[1];
+            p[i][2][f] = position[2];
+        }
+
+    const __m128 p0x = _mm_loadu_ps(p[0][0]), p0y = _mm_loadu_ps(p[0][1]), p0z = _mm_loadu_ps(p[0][2]);
+    const __m128 p1x = _mm_loadu_ps(p[1][0]), p1y = _mm_loadu_ps(p[1][1]), p1z = _mm_loadu_ps(p[1][2]);
+    const __m128 p2x = _mm_loadu_ps(p[2][0]), p2y = _mm_loadu_ps(p[2][1]), p2z = _mm_loadu_ps(p[2][2]);
+
+    const __m128 e1x = _mm_sub_ps(p1x, p0x), e1y = _mm_sub_ps(p1y, p0y), e1z = _mm_sub_ps(p1z, p0z);
+    const __m128 e2x = _mm_sub_ps(p2x, p0x), e2y = _mm_sub_ps(p2y, p0y), e2z = _mm_sub_ps(p2z, p0z);
+    const __m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+    const __m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+    const __m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+    const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)),
+                                                 _mm_mul_ps(cz, cz)));
+    const __m128 isValid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+
+    _mm_storeu_ps(data.normals[0] + face, _mm_and_ps(isValid, _mm_div_ps(cx, length)));
+    _mm_storeu_ps(data.normals[1] + face, _mm_and_ps(isValid, _mm_div_ps(cy, length)));
+    _mm_storeu_ps(data.normals[2] + face, _mm_and_ps(isValid, _mm_div_ps(cz, length)));
+
+    float *weights = data.weights + face * 3;
+    if (data.areaWeights)
+    {
+        float areas[4];
+        _mm_storeu_ps(areas, _mm_and_ps(isValid, length));
+        for (size_t f = 0; f < 4; f++)
+            weights[f * 3 + 0] = weights[f * 3 + 1] = weights[f * 3 + 2] = areas[f];
+        return;
+    }
+
+    const __m128 e3x = _mm_sub_ps(p2x, p1x), e3y = _mm_sub_ps(p2y, p1y), e3z = _mm_sub_ps(p2z, p1z);
+    const __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e1x), _mm_mul_ps(e1y, e1y)), _mm_mul_ps(e1z, e1z));
+    const __m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e2x), _mm_mul_ps(e2y, e2y)), _mm_mul_ps(e2z, e2z));
+    const __m128 l3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e3x, e3x), _mm_mul_ps(e3y, e3y)), _mm_mul_ps(e3z, e3z));
+    const __m128 d12 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e2x), _mm_mul_ps(e1y, e2y)), _mm_mul_ps(e1z, e2z));
+    const __m128 d13 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e3x), _mm_mul_ps(e1y, e3y)), _mm_mul_ps(e1z, e3z));
+    const __m128 d23 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e3x), _mm_mul_ps(e2y, e3y)), _mm_mul_ps(e2z, e3z));
+
+    float dots[3][4], lengthsSqr[3][4];
+    _mm_storeu_ps(dots[0], d12);
+    _mm_storeu_ps(dots[1], _mm_xor_ps(d13, _mm_set1_ps(-0.f)));
+    _mm_storeu_ps(dots[2], d23);
+    _mm_storeu_ps(lengthsSqr[0], l1);
+    _mm_storeu_ps(lengthsSqr[1], l2);
+    _mm_storeu_ps(lengthsSqr[2], l3);
+    for (size_t f = 0; f < 4; f++)
+    {
+        weights[f * 3 + 0] = GetCornerAngle(dots[0][f], lengthsSqr[0][f], lengthsSqr[1][f]);
+        weights[f * 3 + 1] = GetCornerAngle(dots[1][f], lengthsSqr[0][f], lengthsSqr[2][f]);
+        weights[f * 3 + 2] = GetCornerAngle(dots[2][f], lengthsSqr[1][f], lengthsSqr[2][f]);
+    }
+}
+#endif
+
+
+static void CalculateFaceNormals(FaceData &data, size_t firstFace, size_t endFace)
+{
+    size_t face = firstFace;
+#ifdef NORMAL_GENERATOR_SSE2
+    for (; face + 4 <= endFace; face += 4)
+        CalculateFaceNormals4(data, face);
+#endif
+    for (; face < endFace; face++)
+        CalculateFaceNormal(data, face);
+}
+
+
+// Corners sharing a position, listed in the ascending order of corners for each position
+struct PositionCorners
+{
+    std::vector<uint32_t>   starts; // Position count + 1
+    std::vector<uint32_t>   corners;
+};
+
+
+static void CalculateCornerNormals(std::vector<Float3> &cornerNormals,
+                                   const FaceData &data,
+                                   const PositionCorners &positionCorners,
+                                   NormalMethod method,
+                                   float cosCreaseAngle,
+                                   size_t firstPosition,
+                                   size_t endPosition)
+{
+    const float *nx = data.normals[0], *ny = data.normals[1], *nz = data.normals[2];
+    const uint32_t *corners = positionCorners.corners.data();
+
+    auto normalize = [](float &x, float &y, float &z)
+    {
+        const float length = std::sqrt(x * x + y * y + z * z);
+        if (!(length > 0.f))
+            return false;
+        x /= length; y /= length; z /= length;
+        return true;
+    };
+
+    for (size_t position = firstPosition; position < endPosition; position++)
+    {
+        const uint32_t start = positionCorners.starts[position];
+        const uint32_t end = positionCorners.starts[position + 1];
+
+        // Fallback for degenerate triangles: all triangles around, up to the placeholder normal
+        float allX = 0.f, allY = 0.f, allZ = 0.f;
+        for (uint32_t i = start; i < end; i++)
+        {
+            const auto corner = corners[i];
+            const auto face = corner / 3;
+            allX += nx[face] * data.weights[corner];
+            allY += ny[face] * data.weights[corner];
+            allZ += nz[face] * data.weights[corner];
+        }
+        if (!normalize(allX, allY, allZ))
+        {
+            allX = 0.f; allY = 0.f; allZ = 1.f;
+        }
+
+        for (uint32_t i = start; i < end; i++)
+        {
+            const auto corner = corners[i];
+            const auto face = corner / 3;
+            const bool isDegenerate = (nx[face] == 0.f) && (ny[face] == 0.f) && (nz[face] == 0.f);
+            auto &normal = cornerNormals[corner];
+
+            float x, y, z;
+            if (isDegenerate)
+            {
+                x = allX; y = allY; z = allZ;
+            }
+            else if (method == NormalMethod::kFlat)
+            {
+                x = nx[face]; y = ny[face]; z = nz[face];
+            }
+            else if (cosCreaseAngle <= -1.f)
+            {
+                x = allX; y = allY; z = allZ;
+            }
+            else
+            {
+                x = 0.f; y = 0.f; z = 0.f;
+                for (uint32_t j = start; j < end; j++)
+                {
+                    const auto otherCorner = corners[j];
+                    const auto otherFace = otherCorner / 3;
+                    const float cosAngle = nx[face] * nx[otherFace] + ny[face] * ny[otherFace] + nz[face] * nz[otherFace];
+                    if (cosAngle < cosCreaseAngle)
+                        continue;
+                    x += nx[otherFace] * data.weights[otherCorner];
+                    y += ny[otherFace] * data.weights[otherCorner];
+                    z += nz[otherFace] * data.weights[otherCorner];
+                }
+                if (!normalize(x, y, z))
+                {
+                    x = nx[face]; y = ny[face]; z = nz[face];
+                }
+            }
+
+            normal = Float3(x, y, z);
+        }
+    }
+}
+
+
+bool NormalGenerator::Calculate(std::vector<Float3> &cornerNormals,
+                                const SceneGeometry &geometry,
+                                NormalMethod method,
+                                float creaseAngle,
+                                ThreadPool *pool)
+{
+    if (geometry.GetVerticesPerFace() != 3)
+        return false;
+
+    const auto &corners = geometry.GetFaceCorners();
+    const auto &vertices = geometry.GetVertices();
+    const size_t vertexCount = vertices.size();
+    const size_t faceCount = corners.size() / 3;
+    for (size_t i = 0; i < faceCount * 3; i++)
+        if (corners[i] >= vertexCount)
+            return false;
+
+    const bool isParallel = pool && (pool->GetThreadCount() > 1) && (faceCount >= kMinParallelFaceCount);
+    auto run = [pool, isParallel](size_t count, size_t countPerTask, const std::function<void(size_t, size_t)> &job)
+    {
+        if (!isParallel)
+        {
+            job(0, count);
+            return;
+        }
+        pool->ParallelFor((count + countPerTask - 1) / countPerTask, [&](size_t task)
+        {
+            job(task * countPerTask, std::min((task + 1) * countPerTask, count));
+        });
+    };
+
+    // Positions, which also identify vertices sharing a normal (0 equals -0)
+    std::vector<float> positions(vertexCount * 3);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const auto &pos = vertices[i].Pos;
+        positions[i * 3 + 0] = (pos.x == 0.f) ? 0.f : pos.x;
+        positions[i * 3 + 1] = (pos.y == 0.f) ? 0.f : pos.y;
+        positions[i * 3 + 2] = (pos.z == 0.f) ? 0.f : pos.z;
+    }
+
+    std::vector<float> faceData(faceCount * 6);
+    FaceData data;
+    data.normals[0] = faceData.data();
+    data.normals[1] = faceData.data() + faceCount;
+    data.normals[2] = faceData.data() + faceCount * 2;
+    data.weights = faceData.data() + faceCount * 3;
+    data.positions = positions.data();
+    data.corners = corners.data();
+    data.areaWeights = (method == NormalMethod::kAreaWeighted);
+
+    run(faceCount, kFacesPerTask, [&data](size_t first, size_t end)
+    {
+        CalculateFaceNormals(data, first, end);
+    });
+
+    std::vector<uint32_t> vertexPositions(vertexCount);
+    const auto positionCount = MeshOptimizer::GenerateWeldRemap(vertexPositions.data(),
+                                                                (const void *)positions.data(),
+                                                                vertexCount,
+                                                                3 * sizeof(float));
+
+    PositionCorners positionCorners;
+    positionCorners.starts.assign(positionCount + 1, 0);
+    positionCorners.corners.resize(faceCount * 3);
+    for (size_t i = 0; i < faceCount * 3; i++)
+        positionCorners.starts[vertexPositions[corners[i]] + 1]++;
+    for (size_t i = 0; i < positionCount; i++)
+        positionCorners.starts[i + 1] += positionCorners.starts[i];
+    {
+        std::vector<uint32_t> nextSlots(positionCorners.starts.begin(), positionCorners.starts.end() - 1);
+        for (size_t i = 0; i < faceCount * 3; i++)
+            positionCorners.corners[nextSlots[vertexPositions[corners[i]]]++] = (uint32_t)i;
+    }
+
+    const float cosCreaseAngle = (creaseAngle >= 180.f) ? -1.f : std::cos(creaseAngle * kPi / 180.f);
+    cornerNormals.resize(faceCount * 3);
+    run(positionCount, kPositionsPerTask, [&](size_t first, size_t end)
+    {
+        CalculateCornerNormals(cornerNormals, data, positionCorners, method, cosCreaseAngle, first, end);
+    });
+
+    return true;
+}
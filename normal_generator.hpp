@@ -0,0 +1,24 @@
+#pragma once
+
+#include "scene_geometry.hpp"
+
+#include <vector>
+
+class ThreadPool;
+
+class NormalGenerator
+{
+public:
+    NormalGenerator() = delete; // force abstract
+
+    // Unit normal of each face corner (see GetFaceCorners()) of a triangle geometry. Smooth normals
+    // are averaged over the triangles around the corner position whose face normals are within
+    // creaseAngle (degrees) of the corner triangle; corners of degenerate triangles get the average
+    // of all triangles around. If a pool is given, large meshes are processed on its workers (must not
+    // be called from a worker of the same pool). The result does not depend on the pool.
+    static bool Calculate(std::vector<SceneMath::Float3> &cornerNormals,
+                          const SceneGeometry &geometry,
+                          NormalMethod method,
+                          float creaseAngle,
+                          ThreadPool *pool = nullptr);
+};
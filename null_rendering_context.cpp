@@ -0,0 +1,244 @@
+#include "null_rendering_context.hpp"
+
+#include "log.hpp"
+#include "utils.hpp"
+
+#include "Libs/tinygltf-2.5.0/stb_image.h" // just the interfaces (no implementation)
+
+#include <algorithm>
+
+
+// Placeholder device resource
+template <typename Interface>
+class NullResource : public Interface
+{
+public:
+
+    NullResource(uint32_t byteSize = 0) : mByteSize(byteSize) {}
+    virtual ~NullResource() {}
+
+    virtual void AddRef() override { mRefCount++; }
+    virtual void Release() override
+    {
+        if (--mRefCount == 0)
+            delete this;
+    }
+
+    uint32_t GetByteSize() const { return mByteSize; }
+
+private:
+
+    uint32_t    mByteSize;
+    uint32_t    mRefCount = 1;
+};
+
+typedef NullResource<IDeviceBuffer>     NullBuffer;
+typedef NullResource<IDeviceTexture>    NullTexture;
+typedef NullResource<IVertexShader>     NullVertexShader;
+typedef NullResource<IPixelShader>      NullPixelShader;
+typedef NullResource<ISamplerState>     NullSamplerState;
+
+
+NullRenderingContext::NullRenderingContext(uint32_t wndWidth, uint32_t wndHeight) :
+    mWndWidth(wndWidth),
+    mWndHeight(wndHeight)
+{}
+
+
+NullRenderingContext::~NullRenderingContext()
+{}
+
+
+bool NullRenderingContext::CreateVertexShader(const wchar_t *fileName,
+                                              const char *entryPoint,
+                                              const char *shaderModel,
+                                              const std::vector<VertexElementDesc> &layout,
+                                              IVertexShader *&vertexShader)
+{
+    if (!fileName || !entryPoint || !shaderModel || layout.empty())
+        return false;
+
+    vertexShader = new NullVertexShader();
+    mCounters.shaderCreations++;
+
+    return true;
+}
+
+
+bool NullRenderingContext::CreatePixelShader(const wchar_t *fileName,
+                                             const char *entryPoint,
+                                             const char *shaderModel,
+                                             IPixelShader *&pixelShader)
+{
+    if (!fileName || !entryPoint || !shaderModel)
+        return false;
+
+    pixelShader = new NullPixelShader();
+    mCounters.shaderCreations++;
+
+    return true;
+}
+
+
+bool NullRenderingContext::CreateBuffer(DeviceBufferType type,
+                                        const void *data,
+                                        uint32_t byteWidth,
+                                        IDeviceBuffer *&buffer)
+{
+    if ((byteWidth == 0) || (!data && (type != DeviceBufferType::kConstant)))
+        return false;
+
+    buffer = new NullBuffer(byteWidth);
+    mCounters.bufferCreations++;
+    mCounters.bufferBytes += byteWidth;
+
+    return true;
+}
+
+
+bool NullRenderingContext::CreateTexture(uint32_t width,
+                                         uint32_t height,
+                                         TextureFormat format,
+                                         const TextureMipData *mips,
+                                         uint32_t mipCount,
+                                         IDeviceTexture *&texture)
+{
+    uint32_t elementDim;
+    const auto elementSize = GetTextureFormatElementSize(format, elementDim);
+    if ((width == 0) || (height == 0) || !mips || (mipCount == 0) || (elementSize == 0))
+        return false;
+
+    uint32_t byteSize = 0;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        const uint32_t mipWidth  = std::max(width >> mip, 1u);
+        const uint32_t mipHeight = std::max(height >> mip, 1u);
+        const uint32_t rowSize   = (mipWidth + elementDim - 1) / elementDim * elementSize;
+        const uint32_t rowCount  = (mipHeight + elementDim - 1) / elementDim;
+        if (!mips[mip].data || (mips[mip].lineMemPitch < rowSize))
+            return false;
+        byteSize += rowSize * rowCount;
+    }
+
+    texture = new NullTexture(byteSize);
+    mCounters.textureCreations++;
+    mCounters.textureBytes += byteSize;
+
+    return true;
+}
+
+
+bool NullRenderingContext::CreateTextureFromFile(const wchar_t *path,
+                                                 bool isSrgb,
+                                                 IDeviceTexture *&texture)
+{
+    if (!path)
+        return false;
+
+    // Decode the image anyway so that the CPU cost of loading is not hidden
+    int width, height, components;
+    auto data = stbi_load(Utils::WstringToString(path).c_str(), &width, &height, &components, 4);
+    if (!data)
+    {
+        Log::Error(L"NullRenderingContext: Failed to load texture \"%s\"!", path);
+        return false;
+    }
+
+    const auto format = isSrgb ? TextureFormat::kR8G8B8A8UnormSrgb : TextureFormat::kR8G8B8A8Unorm;
+    const TextureMipData mip = { data, (uint32_t)width * 4 };
+    const bool success = CreateTexture((uint32_t)width, (uint32_t)height, format, &mip, 1, texture);
+    stbi_image_free(data);
+
+    return success;
+}
+
+
+bool NullRenderingContext::CreateSamplerState(ISamplerState *&sampler)
+{
+    sampler = new NullSamplerState();
+    mCounters.samplerCreations++;
+
+    return true;
+}
+
+
+void NullRenderingContext::UpdateConstantBuffer(IDeviceBuffer *buffer, const void *data)
+{
+    if (!buffer || !data)
+        return;
+
+    mCounters.constantBufferUpdates++;
+    mCounters.constantBufferBytes += static_cast<NullBuffer*>(buffer)->GetByteSize();
+}
+
+
+void NullRenderingContext::VSSetShader(IVertexShader *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::VSSetConstantBuffer(uint32_t, IDeviceBuffer *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::PSSetShader(IPixelShader *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::PSSetConstantBuffer(uint32_t, IDeviceBuffer *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::PSSetSampler(uint32_t, ISamplerState *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::PSSetTexture(uint32_t, IDeviceTexture *)
+{
+    mCounters.stateChanges++;
+}
+
+
+void NullRenderingContext::DrawIndexed(IDeviceBuffer *vertexBuffer,
+                                       uint32_t,
+                                       IDeviceBuffer *indexBuffer,
+                                       IndexFormat,
+                                       uint32_t indexCount,
+                                       PrimitiveTopology)
+{
+    if (!vertexBuffer || !indexBuffer)
+        return;
+
+    mCounters.drawCalls++;
+    mCounters.drawnIndices += indexCount;
+}
+
+
+bool NullRenderingContext::GetWindowSize(uint32_t &width,
+                                         uint32_t &height) const
+{
+    width   = mWndWidth;
+    height  = mWndHeight;
+    return true;
+}
+
+
+float NullRenderingContext::GetFrameAnimationTime() const
+{
+    return mFrameAnimationTime;
+}
+
+
+bool NullRenderingContext::IsValid() const
+{
+    return true;
+}
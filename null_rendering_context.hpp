@@ -0,0 +1,89 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Rendering context without any device behind it. Created resources are just placeholders and
+// all commands are only counted, which allows running scenes headless (e.g. on a machine without
+// a GPU) and measuring the CPU-side cost of loading and rendering without driver noise.
+// ------------------------------------------------------------------------------------------------
+
+#include "irenderingcontext.hpp"
+
+#include <cstdint>
+
+class NullRenderingContext : public IRenderingContext
+{
+public:
+
+    struct Counters
+    {
+        uint64_t bufferCreations        = 0;
+        uint64_t bufferBytes            = 0;
+        uint64_t textureCreations       = 0;
+        uint64_t textureBytes           = 0;
+        uint64_t shaderCreations        = 0;
+        uint64_t samplerCreations       = 0;
+        uint64_t constantBufferUpdates  = 0;
+        uint64_t constantBufferBytes    = 0;
+        uint64_t stateChanges           = 0; // Shader, constant buffer, sampler and texture bindings
+        uint64_t drawCalls              = 0;
+        uint64_t drawnIndices           = 0;
+    };
+
+    NullRenderingContext(uint32_t wndWidth = 1200u, uint32_t wndHeight = 900u);
+    virtual ~NullRenderingContext();
+
+    void                            SetFrameAnimationTime(float time) { mFrameAnimationTime = time; }
+
+    const Counters&                 GetCounters() const { return mCounters; }
+    void                            ResetCounters() { mCounters = Counters(); }
+
+    // IRenderingContext interface
+    virtual bool                    CreateVertexShader(const wchar_t *fileName,
+                                                       const char *entryPoint,
+                                                       const char *shaderModel,
+                                                       const std::vector<VertexElementDesc> &layout,
+                                                       IVertexShader *&vertexShader) override;
+    virtual bool                    CreatePixelShader(const wchar_t *fileName,
+                                                      const char *entryPoint,
+                                                      const char *shaderModel,
+                                                      IPixelShader *&pixelShader) override;
+    virtual bool                    CreateBuffer(DeviceBufferType type,
+                                                 const void *data,
+                                                 uint32_t byteWidth,
+                                                 IDeviceBuffer *&buffer) override;
+    virtual bool                    CreateTexture(uint32_t width,
+                                                  uint32_t height,
+                                                  TextureFormat format,
+                                                  const TextureMipData *mips,
+                                                  uint32_t mipCount,
+                                                  IDeviceTexture *&texture) override;
+    virtual bool                    CreateTextureFromFile(const wchar_t *path,
+                                                          bool isSrgb,
+                                                          IDeviceTexture *&texture) override;
+    virtual bool                    CreateSamplerState(ISamplerState *&sampler) override;
+    virtual void                    UpdateConstantBuffer(IDeviceBuffer *buffer, const void *data) override;
+    virtual void                    VSSetShader(IVertexShader *shader) override;
+    virtual void                    VSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) override;
+    virtual void                    PSSetShader(IPixelShader *shader) override;
+    virtual void                    PSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) override;
+    virtual void                    PSSetSampler(uint32_t slot, ISamplerState *sampler) override;
+    virtual void                    PSSetTexture(uint32_t slot, IDeviceTexture *texture) override;
+    virtual void                    DrawIndexed(IDeviceBuffer *vertexBuffer,
+                                                uint32_t vertexStride,
+                                                IDeviceBuffer *indexBuffer,
+                                                IndexFormat indexFormat,
+                                                uint32_t indexCount,
+                                                PrimitiveTopology topology) override;
+    virtual bool                    GetWindowSize(uint32_t &width,
+                                                  uint32_t &height) const override;
+    virtual float                   GetFrameAnimationTime() const override; // In seconds
+    virtual bool                    IsValid() const override;
+
+private:
+
+    uint32_t                    mWndWidth;
+    uint32_t                    mWndHeight;
+    float                       mFrameAnimationTime = 0.f;
+
+    Counters                    mCounters;
+};
@@ -11,6 +11,112 @@
 #include <cmath>
 
 
+// Device-independent resource handle owning a reference to a D3D object
+template <typename Interface, typename D3DObject>
+class DX11Resource : public Interface
+{
+public:
+
+    DX11Resource(D3DObject *object, uint32_t byteSize = 0) : mObject(object), mByteSize(byteSize) {}
+    virtual ~DX11Resource() { Utils::ReleaseAndMakeNull(mObject); }
+
+    virtual void AddRef() override { mRefCount++; }
+    virtual void Release() override
+    {
+        if (--mRefCount == 0)
+            delete this;
+    }
+
+    D3DObject* Get() const { return mObject; }
+    uint32_t GetByteSize() const { return mByteSize; }
+
+private:
+
+    D3DObject   *mObject;
+    uint32_t    mByteSize;
+    uint32_t    mRefCount = 1;
+};
+
+typedef DX11Resource<IDeviceBuffer, ID3D11Buffer>               DX11Buffer;
+typedef DX11Resource<IDeviceTexture, ID3D11ShaderResourceView>  DX11Texture;
+typedef DX11Resource<IPixelShader, ID3D11PixelShader>           DX11PixelShader;
+typedef DX11Resource<ISamplerState, ID3D11SamplerState>         DX11SamplerState;
+
+class DX11VertexShader : public DX11Resource<IVertexShader, ID3D11VertexShader>
+{
+public:
+
+    DX11VertexShader(ID3D11VertexShader *shader, ID3D11InputLayout *layout) :
+        DX11Resource(shader),
+        mLayout(layout)
+    {}
+    virtual ~DX11VertexShader() { Utils::ReleaseAndMakeNull(mLayout); }
+
+    ID3D11InputLayout* GetLayout() const { return mLayout; }
+
+private:
+
+    ID3D11InputLayout *mLayout;
+};
+
+
+template <typename Wrapper, typename Interface>
+static auto Unwrap(Interface *resource) -> decltype(static_cast<Wrapper*>(resource)->Get())
+{
+    return resource ? static_cast<Wrapper*>(resource)->Get() : nullptr;
+}
+
+
+static DXGI_FORMAT VertexElementFormatToDxgi(VertexElementFormat format)
+{
+    switch (format)
+    {
+    case VertexElementFormat::kFloat2:          return DXGI_FORMAT_R32G32_FLOAT;
+    case VertexElementFormat::kFloat3:          return DXGI_FORMAT_R32G32B32_FLOAT;
+    case VertexElementFormat::kFloat4:          return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case VertexElementFormat::kHalf2:           return DXGI_FORMAT_R16G16_FLOAT;
+    case VertexElementFormat::kShort4Snorm:     return DXGI_FORMAT_R16G16B16A16_SNORM;
+    case VertexElementFormat::kUShort2Unorm:    return DXGI_FORMAT_R16G16_UNORM;
+    case VertexElementFormat::kUShort4Unorm:    return DXGI_FORMAT_R16G16B16A16_UNORM;
+    default:                                    return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+
+static DXGI_FORMAT TextureFormatToDxgi(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::kR8G8B8A8Unorm:         return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case TextureFormat::kR8G8B8A8UnormSrgb:     return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    case TextureFormat::kR32G32B32A32Float:     return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case TextureFormat::kBC1Unorm:              return DXGI_FORMAT_BC1_UNORM;
+    case TextureFormat::kBC1UnormSrgb:          return DXGI_FORMAT_BC1_UNORM_SRGB;
+    case TextureFormat::kBC3Unorm:              return DXGI_FORMAT_BC3_UNORM;
+    case TextureFormat::kBC3UnormSrgb:          return DXGI_FORMAT_BC3_UNORM_SRGB;
+    case TextureFormat::kBC4Unorm:              return DXGI_FORMAT_BC4_UNORM;
+    case TextureFormat::kBC5Unorm:              return DXGI_FORMAT_BC5_UNORM;
+    case TextureFormat::kBC7Unorm:              return DXGI_FORMAT_BC7_UNORM;
+    case TextureFormat::kBC7UnormSrgb:          return DXGI_FORMAT_BC7_UNORM_SRGB;
+    default:                                    return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+
+static D3D11_PRIMITIVE_TOPOLOGY TopologyToD3D(PrimitiveTopology topology)
+{
+    switch (topology)
+    {
+    case PrimitiveTopology::kPointList:     return D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+    case PrimitiveTopology::kLineList:      return D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+    case PrimitiveTopology::kLineStrip:     return D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP;
+    case PrimitiveTopology::kTriangleList:  return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    case PrimitiveTopology::kTriangleStrip: return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+    default:                                return D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    }
+}
+
+
 SimpleDX11Renderer::SimpleDX11Renderer(std::shared_ptr<IScene> scene,
                                        bool startWithAnimationActive) :
     mScene(scene),
@@ -255,6 +361,12 @@ ID3D11DeviceContext* SimpleDX11Renderer::GetImmediateContext() const
 }
 
 
+bool SimpleDX11Renderer::IsValid() const
+{
+    return mDevice && mImmediateContext;
+}
+
+
 const wchar_t * DriverTypeToString(D3D_DRIVER_TYPE type)
 {
     switch (type)
@@ -396,6 +508,10 @@ bool SimpleDX11Renderer::CreateDevice()
     swapChainBuffer->Release();
     if (FAILED(hr))
         return false;
+    mMemoryTracker.SetAssetSize(MemoryCategory::kRenderTargets,
+                                "swap chain",
+                                (size_t)GetTextureByteSize(mWndWidth, mWndHeight, TextureFormat::kR8G8B8A8Unorm, 1) *
+                                GetMsaaCount());
 
     // Depth stencil texture
     D3D11_TEXTURE2D_DESC depthDesc;
@@ -412,6 +528,11 @@ bool SimpleDX11Renderer::CreateDevice()
     hr = mDevice->CreateTexture2D(&depthDesc, nullptr, &mSwapChainDSTex);
     if (FAILED(hr))
         return false;
+    // 32 bits per sample, same as RGBA8
+    mMemoryTracker.SetAssetSize(MemoryCategory::kRenderTargets,
+                                "depth stencil",
+                                (size_t)GetTextureByteSize(mWndWidth, mWndHeight, TextureFormat::kR8G8B8A8Unorm, 1) *
+                                GetMsaaCount());
 
     // Depth stencil view
     D3D11_DEPTH_STENCIL_VIEW_DESC depthSVDesc;
@@ -597,11 +718,11 @@ bool SimpleDX11Renderer::CreatePostprocessingResources()
                                                       PassBuffer::eSrv |
                                                       PassBuffer::eSingleSample);
     if (mUseMSAA)
-        mRenderBuffMS.Create(*this, msaaBufferFlags, 1);
-    mRenderBuff.Create(*this, postBufferFlags, 1);
-    mBloomHorzBuff.Create(*this, postBufferFlags, mBloomDownscaleFactor);
-    mBloomVertBuff.Create(*this, postBufferFlags, mBloomDownscaleFactor);
-    mBloomBuff.Create(*this, postBufferFlags, 1);
+        mRenderBuffMS.Create(*this, "render buffer (MSAA)", msaaBufferFlags, 1);
+    mRenderBuff.Create(*this, "render buffer", postBufferFlags, 1);
+    mBloomHorzBuff.Create(*this, "bloom horizontal buffer", postBufferFlags, mBloomDownscaleFactor);
+    mBloomVertBuff.Create(*this, "bloom vertical buffer", postBufferFlags, mBloomDownscaleFactor);
+    mBloomBuff.Create(*this, "bloom buffer", postBufferFlags, 1);
 
     // Samplers
     D3D11_SAMPLER_DESC descSampler;
@@ -630,6 +751,7 @@ bool SimpleDX11Renderer::CreatePostprocessingResources()
     hr = mDevice->CreateBuffer(&descBloomCB, NULL, &mBloomCB);
     if (FAILED(hr))
         return false;
+    mMemoryTracker.SetAssetSize(MemoryCategory::kConstantBuffers, "bloom", descBloomCB.ByteWidth);
 
     // Shaders
     if (!CreatePixelShader(L"../post_shaders.fx", "BloomPrePassPS", "ps_4_0", mBloomPrePassPS))
@@ -677,11 +799,14 @@ void SimpleDX11Renderer::DestroyDevice()
     Utils::ReleaseAndMakeNull(mImmediateContext);
     Utils::ReleaseAndMakeNull(mDevice);
 
+    mMemoryTracker.Clear();
+
     ReleaseAdapters();
 }
 
 
-bool SimpleDX11Renderer::PassBuffer::Create(IRenderingContext &ctx,
+bool SimpleDX11Renderer::PassBuffer::Create(SimpleDX11Renderer &ctx,
+                                            const char *name,
                                             ECreateFlags flags,
                                             uint32_t scaleDownFactor)
 {
@@ -720,6 +845,16 @@ bool SimpleDX11Renderer::PassBuffer::Create(IRenderingContext &ctx,
     if (FAILED(hr))
         return false;
 
+    // The actual number of generated mip levels
+    tex->GetDesc(&textDesc);
+    ctx.mMemoryTracker.SetAssetSize(MemoryCategory::kRenderTargets,
+                                    name,
+                                    (size_t)GetTextureByteSize(textDesc.Width,
+                                                               textDesc.Height,
+                                                               TextureFormat::kR32G32B32A32Float,
+                                                               textDesc.MipLevels) *
+                                    textDesc.SampleDesc.Count);
+
     bool isMultiSample = !singleSample && ctx.UsesMSAA();
 
     // Render target view
@@ -781,7 +916,7 @@ void SimpleDX11Renderer::DestroyScene()
 }
 
 
-bool SimpleDX11Renderer::CompileShader(WCHAR* szFileName,
+bool SimpleDX11Renderer::CompileShader(LPCWSTR szFileName,
                                        LPCSTR szEntryPoint,
                                        LPCSTR szShaderModel,
                                        ID3DBlob** ppBlobOut) const
@@ -821,7 +956,7 @@ bool SimpleDX11Renderer::CompileShader(WCHAR* szFileName,
 }
 
 
-bool SimpleDX11Renderer::CreateVertexShader(WCHAR* szFileName,
+bool SimpleDX11Renderer::CreateVertexShader(LPCWSTR szFileName,
                                             LPCSTR szEntryPoint,
                                             LPCSTR szShaderModel,
                                             ID3DBlob *&pVsBlob,
@@ -850,7 +985,7 @@ bool SimpleDX11Renderer::CreateVertexShader(WCHAR* szFileName,
 }
 
 
-bool SimpleDX11Renderer::CreatePixelShader(WCHAR* szFileName,
+bool SimpleDX11Renderer::CreatePixelShader(LPCWSTR szFileName,
                                            LPCSTR szEntryPoint,
                                            LPCSTR szShaderModel,
                                            ID3D11PixelShader *&pPixelShader) const
@@ -879,6 +1014,289 @@ bool SimpleDX11Renderer::CreatePixelShader(WCHAR* szFileName,
 }
 
 
+bool SimpleDX11Renderer::CreateVertexShader(const wchar_t *fileName,
+                                            const char *entryPoint,
+                                            const char *shaderModel,
+                                            const std::vector<VertexElementDesc> &layout,
+                                            IVertexShader *&vertexShader)
+{
+    HRESULT hr = S_OK;
+
+    ID3DBlob* pVsBlob = nullptr;
+    ID3D11VertexShader *d3dShader = nullptr;
+    if (!CreateVertexShader(fileName, entryPoint, shaderModel, pVsBlob, d3dShader))
+        return false;
+
+    // Input layout
+    std::vector<D3D11_INPUT_ELEMENT_DESC> layoutDesc;
+    layoutDesc.reserve(layout.size());
+    for (const auto &elem : layout)
+        layoutDesc.push_back({ elem.semanticName, 0, VertexElementFormatToDxgi(elem.format), 0,
+                               D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+
+    ID3D11InputLayout *inputLayout = nullptr;
+    hr = mDevice->CreateInputLayout(layoutDesc.data(),
+                                    (UINT)layoutDesc.size(),
+                                    pVsBlob->GetBufferPointer(),
+                                    pVsBlob->GetBufferSize(),
+                                    &inputLayout);
+    pVsBlob->Release();
+    if (FAILED(hr))
+    {
+        Log::Error(L"mDevice->CreateInputLayout failed.");
+        d3dShader->Release();
+        return false;
+    }
+
+    vertexShader = new DX11VertexShader(d3dShader, inputLayout);
+
+    return true;
+}
+
+
+bool SimpleDX11Renderer::CreatePixelShader(const wchar_t *fileName,
+                                           const char *entryPoint,
+                                           const char *shaderModel,
+                                           IPixelShader *&pixelShader)
+{
+    ID3D11PixelShader *d3dShader = nullptr;
+    if (!CreatePixelShader(fileName, entryPoint, shaderModel, d3dShader))
+        return false;
+
+    pixelShader = new DX11PixelShader(d3dShader);
+
+    return true;
+}
+
+
+bool SimpleDX11Renderer::CreateBuffer(DeviceBufferType type,
+                                      const void *data,
+                                      uint32_t byteWidth,
+                                      IDeviceBuffer *&buffer)
+{
+    if (!mDevice)
+        return false;
+
+    D3D11_BUFFER_DESC bd;
+    ZeroMemory(&bd, sizeof(bd));
+    bd.Usage = D3D11_USAGE_DEFAULT;
+    bd.ByteWidth = byteWidth;
+    bd.CPUAccessFlags = 0;
+    switch (type)
+    {
+    case DeviceBufferType::kVertex:     bd.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+    case DeviceBufferType::kIndex:      bd.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+    case DeviceBufferType::kConstant:   bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+    default:
+        return false;
+    }
+
+    D3D11_SUBRESOURCE_DATA initData;
+    ZeroMemory(&initData, sizeof(initData));
+    initData.pSysMem = data;
+
+    ID3D11Buffer *d3dBuffer = nullptr;
+    HRESULT hr = mDevice->CreateBuffer(&bd, data ? &initData : nullptr, &d3dBuffer);
+    if (FAILED(hr))
+        return false;
+
+    buffer = new DX11Buffer(d3dBuffer, byteWidth);
+
+    return true;
+}
+
+
+bool SimpleDX11Renderer::CreateTexture(uint32_t width,
+                                       uint32_t height,
+                                       TextureFormat format,
+                                       const TextureMipData *mips,
+                                       uint32_t mipCount,
+                                       IDeviceTexture *&texture)
+{
+    if (!mDevice || !mips || (mipCount == 0) || (mipCount > D3D11_REQ_MIP_LEVELS))
+        return false;
+
+    HRESULT hr = S_OK;
+    ID3D11Texture2D *tex = nullptr;
+
+    // Texture
+    D3D11_TEXTURE2D_DESC descTex;
+    ZeroMemory(&descTex, sizeof(D3D11_TEXTURE2D_DESC));
+    descTex.ArraySize = 1;
+    descTex.Usage = D3D11_USAGE_IMMUTABLE;
+    descTex.Format = TextureFormatToDxgi(format);
+    descTex.Width = width;
+    descTex.Height = height;
+    descTex.MipLevels = mipCount;
+    descTex.SampleDesc.Count = 1;
+    descTex.SampleDesc.Quality = 0;
+    descTex.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA initData[D3D11_REQ_MIP_LEVELS];
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+        initData[mip] = { mips[mip].data, mips[mip].lineMemPitch, 0 };
+    hr = mDevice->CreateTexture2D(&descTex, initData, &tex);
+    if (FAILED(hr))
+        return false;
+
+    // Shader resource view
+    ID3D11ShaderResourceView *srv = nullptr;
+    D3D11_SHADER_RESOURCE_VIEW_DESC descSRV;
+    descSRV.Format = descTex.Format;
+    descSRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    descSRV.Texture2D.MipLevels = mipCount;
+    descSRV.Texture2D.MostDetailedMip = 0;
+    hr = mDevice->CreateShaderResourceView(tex, &descSRV, &srv);
+    Utils::ReleaseAndMakeNull(tex);
+    if (FAILED(hr))
+        return false;
+
+    texture = new DX11Texture(srv, GetTextureByteSize(width, height, format, mipCount));
+
+    return true;
+}
+
+
+bool SimpleDX11Renderer::CreateTextureFromFile(const wchar_t *path,
+                                               bool isSrgb,
+                                               IDeviceTexture *&texture)
+{
+    if (!mDevice)
+        return false;
+
+    D3DX11_IMAGE_LOAD_INFO ili;
+    ili.Usage = D3D11_USAGE_IMMUTABLE;
+    if (isSrgb)
+    {
+        ili.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        ili.Filter = D3DX11_FILTER_SRGB | D3DX11_FILTER_NONE;
+    }
+    else
+    {
+        ili.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    ID3D11ShaderResourceView *srv = nullptr;
+    HRESULT hr = D3DX11CreateShaderResourceViewFromFile(mDevice, path, &ili, nullptr, &srv, nullptr);
+    if (FAILED(hr))
+        return false;
+
+    // Dimensions and mip levels are given by the file
+    uint32_t byteSize = 0;
+    ID3D11Resource *resource = nullptr;
+    ID3D11Texture2D *tex = nullptr;
+    srv->GetResource(&resource);
+    if (resource && SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), (void **)&tex)))
+    {
+        D3D11_TEXTURE2D_DESC descTex;
+        tex->GetDesc(&descTex);
+        byteSize = GetTextureByteSize(descTex.Width,
+                                      descTex.Height,
+                                      isSrgb ? TextureFormat::kR8G8B8A8UnormSrgb : TextureFormat::kR8G8B8A8Unorm,
+                                      descTex.MipLevels);
+    }
+    Utils::ReleaseAndMakeNull(tex);
+    Utils::ReleaseAndMakeNull(resource);
+
+    texture = new DX11Texture(srv, byteSize);
+
+    return true;
+}
+
+
+bool SimpleDX11Renderer::CreateSamplerState(ISamplerState *&sampler)
+{
+    if (!mDevice)
+        return false;
+
+    D3D11_SAMPLER_DESC sampDesc;
+    ZeroMemory(&sampDesc, sizeof(sampDesc));
+    sampDesc.Filter = D3D11_FILTER_ANISOTROPIC; // D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sampDesc.MinLOD = 0;
+    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+    ID3D11SamplerState *d3dSampler = nullptr;
+    HRESULT hr = mDevice->CreateSamplerState(&sampDesc, &d3dSampler);
+    if (FAILED(hr))
+        return false;
+
+    sampler = new DX11SamplerState(d3dSampler);
+
+    return true;
+}
+
+
+void SimpleDX11Renderer::UpdateConstantBuffer(IDeviceBuffer *buffer, const void *data)
+{
+    mImmediateContext->UpdateSubresource(Unwrap<DX11Buffer>(buffer), 0, nullptr, data, 0, 0);
+}
+
+
+void SimpleDX11Renderer::VSSetShader(IVertexShader *shader)
+{
+    auto dx11Shader = static_cast<DX11VertexShader*>(shader);
+    mImmediateContext->IASetInputLayout(dx11Shader ? dx11Shader->GetLayout() : nullptr);
+    mImmediateContext->VSSetShader(Unwrap<DX11VertexShader>(shader), nullptr, 0);
+}
+
+
+void SimpleDX11Renderer::VSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer)
+{
+    ID3D11Buffer *d3dBuffer = Unwrap<DX11Buffer>(buffer);
+    mImmediateContext->VSSetConstantBuffers(slot, 1, &d3dBuffer);
+}
+
+
+void SimpleDX11Renderer::PSSetShader(IPixelShader *shader)
+{
+    mImmediateContext->PSSetShader(Unwrap<DX11PixelShader>(shader), nullptr, 0);
+}
+
+
+void SimpleDX11Renderer::PSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer)
+{
+    ID3D11Buffer *d3dBuffer = Unwrap<DX11Buffer>(buffer);
+    mImmediateContext->PSSetConstantBuffers(slot, 1, &d3dBuffer);
+}
+
+
+void SimpleDX11Renderer::PSSetSampler(uint32_t slot, ISamplerState *sampler)
+{
+    ID3D11SamplerState *d3dSampler = Unwrap<DX11SamplerState>(sampler);
+    mImmediateContext->PSSetSamplers(slot, 1, &d3dSampler);
+}
+
+
+void SimpleDX11Renderer::PSSetTexture(uint32_t slot, IDeviceTexture *texture)
+{
+    ID3D11ShaderResourceView *srv = Unwrap<DX11Texture>(texture);
+    mImmediateContext->PSSetShaderResources(slot, 1, &srv);
+}
+
+
+void SimpleDX11Renderer::DrawIndexed(IDeviceBuffer *vertexBuffer,
+                                     uint32_t vertexStride,
+                                     IDeviceBuffer *indexBuffer,
+                                     IndexFormat indexFormat,
+                                     uint32_t indexCount,
+                                     PrimitiveTopology topology)
+{
+    ID3D11Buffer *d3dVertexBuffer = Unwrap<DX11Buffer>(vertexBuffer);
+    UINT stride = vertexStride;
+    UINT offset = 0;
+    mImmediateContext->IASetVertexBuffers(0, 1, &d3dVertexBuffer, &stride, &offset);
+    mImmediateContext->IASetIndexBuffer(Unwrap<DX11Buffer>(indexBuffer),
+                                        (indexFormat == IndexFormat::kUint16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+                                        0);
+    mImmediateContext->IASetPrimitiveTopology(TopologyToD3D(topology));
+
+    mImmediateContext->DrawIndexed(indexCount, 0, 0);
+}
+
+
 void SimpleDX11Renderer::RenderFrame()
 {
     StartFrame();
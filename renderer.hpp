@@ -9,6 +9,7 @@
 
 #include "irenderingcontext.hpp"
 #include "iscene.hpp"
+#include "memory_tracker.hpp"
 
 #include <windows.h>
 
@@ -46,27 +47,59 @@ public:
     void SetTimeout(double timeout);
     int Run();
 
+    // Memory of the renderer's own resources (render targets and constant buffers)
+    const MemoryTracker& GetMemoryTracker() const { return mMemoryTracker; }
+
     // IRenderingContext interface
-    virtual ID3D11Device*           GetDevice() const override;
-    virtual ID3D11DeviceContext*    GetImmediateContext() const override;
-    virtual bool                    CreateVertexShader(WCHAR* szFileName,
-                                                       LPCSTR szEntryPoint,
-                                                       LPCSTR szShaderModel,
-                                                       ID3DBlob *&pVsBlob,
-                                                       ID3D11VertexShader *&pVertexShader) const override;
-    virtual bool                    CreatePixelShader(WCHAR* szFileName,
-                                                      LPCSTR szEntryPoint,
-                                                      LPCSTR szShaderModel,
-                                                      ID3D11PixelShader *&pPixelShader) const override;
+    virtual bool                    CreateVertexShader(const wchar_t *fileName,
+                                                       const char *entryPoint,
+                                                       const char *shaderModel,
+                                                       const std::vector<VertexElementDesc> &layout,
+                                                       IVertexShader *&vertexShader) override;
+    virtual bool                    CreatePixelShader(const wchar_t *fileName,
+                                                      const char *entryPoint,
+                                                      const char *shaderModel,
+                                                      IPixelShader *&pixelShader) override;
+    virtual bool                    CreateBuffer(DeviceBufferType type,
+                                                 const void *data,
+                                                 uint32_t byteWidth,
+                                                 IDeviceBuffer *&buffer) override;
+    virtual bool                    CreateTexture(uint32_t width,
+                                                  uint32_t height,
+                                                  TextureFormat format,
+                                                  const TextureMipData *mips,
+                                                  uint32_t mipCount,
+                                                  IDeviceTexture *&texture) override;
+    virtual bool                    CreateTextureFromFile(const wchar_t *path,
+                                                          bool isSrgb,
+                                                          IDeviceTexture *&texture) override;
+    virtual bool                    CreateSamplerState(ISamplerState *&sampler) override;
+    virtual void                    UpdateConstantBuffer(IDeviceBuffer *buffer, const void *data) override;
+    virtual void                    VSSetShader(IVertexShader *shader) override;
+    virtual void                    VSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) override;
+    virtual void                    PSSetShader(IPixelShader *shader) override;
+    virtual void                    PSSetConstantBuffer(uint32_t slot, IDeviceBuffer *buffer) override;
+    virtual void                    PSSetSampler(uint32_t slot, ISamplerState *sampler) override;
+    virtual void                    PSSetTexture(uint32_t slot, IDeviceTexture *texture) override;
+    virtual void                    DrawIndexed(IDeviceBuffer *vertexBuffer,
+                                                uint32_t vertexStride,
+                                                IDeviceBuffer *indexBuffer,
+                                                IndexFormat indexFormat,
+                                                uint32_t indexCount,
+                                                PrimitiveTopology topology) override;
     virtual bool                    GetWindowSize(uint32_t &width,
                                                   uint32_t &height) const override;
-    virtual bool                    UsesMSAA() const;
-    virtual uint32_t                GetMsaaCount() const;
-    virtual uint32_t                GetMsaaQuality() const;
+    virtual float                   GetFrameAnimationTime() const override; // In seconds
+    virtual bool                    IsValid() const override;
+
+    ID3D11Device*                   GetDevice() const;
+    ID3D11DeviceContext*            GetImmediateContext() const;
+    bool                            UsesMSAA() const;
+    uint32_t                        GetMsaaCount() const;
+    uint32_t                        GetMsaaQuality() const;
 
     virtual float                   GetCurrentAnimationTime(); // In seconds
     virtual void                    StartFrame(); // Saves time of the current frame
-    virtual float                   GetFrameAnimationTime() const override; // In seconds
 
 
 private:
@@ -93,11 +126,22 @@ private:
     void DestroyScene();
     void RenderFrame();
 
-    bool                            CompileShader(WCHAR* szFileName,
+    bool                            CompileShader(LPCWSTR szFileName,
                                                   LPCSTR szEntryPoint,
                                                   LPCSTR szShaderModel,
                                                   ID3DBlob** ppBlobOut) const;
 
+    bool                            CreateVertexShader(LPCWSTR szFileName,
+                                                       LPCSTR szEntryPoint,
+                                                       LPCSTR szShaderModel,
+                                                       ID3DBlob *&pVsBlob,
+                                                       ID3D11VertexShader *&pVertexShader) const;
+
+    bool                            CreatePixelShader(LPCWSTR szFileName,
+                                                      LPCSTR szEntryPoint,
+                                                      LPCSTR szShaderModel,
+                                                      ID3D11PixelShader *&pPixelShader) const;
+
     void                            DrawFullScreenQuad(ID3D11PixelShader* PS,
                                                        UINT width,
                                                        UINT height);
@@ -147,6 +191,8 @@ private:
 
     float                       mFrameAnimationTime = 0;
 
+    MemoryTracker               mMemoryTracker;
+
     class PassBuffer
     {
     public:
@@ -161,7 +207,8 @@ private:
             eSingleSample   = 0x04
         };
 
-        bool Create(IRenderingContext &ctx,
+        bool Create(SimpleDX11Renderer &ctx,
+                    const char *name,
                     ECreateFlags flags,
                     uint32_t scaleDownFactor);
         void Destroy();
@@ -1,19 +1,23 @@
 #include "scene.hpp"
 
-#include "tangent_calculator.hpp"
 #include "scene_utils.hpp"
 #include "gltf_utils.hpp"
+#include "load_profiler.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 #include "log.hpp"
 
 #include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
 
+#include <algorithm>
 #include <cassert>
-#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
 #include <vector>
 
-#define UNUSED_COLOR XMFLOAT4(1.f, 0.f, 1.f, 1.f)
-#define STRIP_BREAK static_cast<uint32_t>(-1)
+#define UNUSED_COLOR Float4(1.f, 0.f, 1.f, 1.f)
 
 // debug: redirecting cout to string
 // TODO: Move to Utils
@@ -34,33 +38,48 @@ private:
     std::streambuf * old;
 };
 
-typedef D3D11_INPUT_ELEMENT_DESC InputElmDesc;
-#define AUTO_ALIGN      D3D11_APPEND_ALIGNED_ELEMENT
-#define VERTEX_DATA     D3D11_INPUT_PER_VERTEX_DATA
-const std::vector<InputElmDesc> sVertexLayoutDesc =
+using namespace SceneMath;
+
+const std::vector<VertexElementDesc> sVertexLayoutDesc =
+{
+    VertexElementDesc{ "POSITION", VertexElementFormat::kFloat3 },
+    VertexElementDesc{ "NORMAL",   VertexElementFormat::kFloat3 },
+    VertexElementDesc{ "TANGENT",  VertexElementFormat::kFloat4 },
+    VertexElementDesc{ "TEXCOORD", VertexElementFormat::kFloat2 },
+};
+
+// CompactSceneVertex
+const std::vector<VertexElementDesc> sCompactVertexLayoutDesc =
 {
-    InputElmDesc{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, AUTO_ALIGN, VERTEX_DATA, 0 },
-    InputElmDesc{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, AUTO_ALIGN, VERTEX_DATA, 0 },
-    InputElmDesc{ "TANGENT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, AUTO_ALIGN, VERTEX_DATA, 0 },
-    InputElmDesc{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,       0, AUTO_ALIGN, VERTEX_DATA, 0 },
+    VertexElementDesc{ "POSITION", VertexElementFormat::kFloat3 },
+    VertexElementDesc{ "NORMAL",   VertexElementFormat::kShort4Snorm },
+    VertexElementDesc{ "TEXCOORD", VertexElementFormat::kHalf2 },
+};
+
+// QuantizedSceneVertex
+const std::vector<VertexElementDesc> sQuantizedVertexLayoutDesc =
+{
+    VertexElementDesc{ "POSITION", VertexElementFormat::kUShort4Unorm },
+    VertexElementDesc{ "NORMAL",   VertexElementFormat::kShort4Snorm },
+    VertexElementDesc{ "TEXCOORD", VertexElementFormat::kUShort2Unorm },
 };
 
 struct CbScene
 {
-    XMMATRIX ViewMtrx;
-    XMFLOAT4 CameraPos;
-    XMMATRIX ProjectionMtrx;
+    Matrix   ViewMtrx;
+    Float4   CameraPos;
+    Matrix   ProjectionMtrx;
 };
 
 struct CbFrame
 {
-    XMFLOAT4 AmbientLightLuminance;
+    Float4   AmbientLightLuminance;
 
-    XMFLOAT4 DirectLightDirs[DIRECT_LIGHTS_MAX_COUNT];
-    XMFLOAT4 DirectLightLuminances[DIRECT_LIGHTS_MAX_COUNT];
+    Float4   DirectLightDirs[DIRECT_LIGHTS_MAX_COUNT];
+    Float4   DirectLightLuminances[DIRECT_LIGHTS_MAX_COUNT];
 
-    XMFLOAT4 PointLightPositions[POINT_LIGHTS_MAX_COUNT];
-    XMFLOAT4 PointLightIntensities[POINT_LIGHTS_MAX_COUNT];
+    Float4   PointLightPositions[POINT_LIGHTS_MAX_COUNT];
+    Float4   PointLightIntensities[POINT_LIGHTS_MAX_COUNT];
 
     int32_t  DirectLightsCount; // at the end to avoid 16-byte packing issues
     int32_t  PointLightsCount;  // at the end to avoid 16-byte packing issues
@@ -69,33 +88,38 @@ struct CbFrame
 
 struct CbSceneNode
 {
-    XMMATRIX WorldMtrx;
-    XMFLOAT4 MeshColor; // May be eventually replaced by the emmisive component of the standard surface shader
+    Matrix   WorldMtrx;
+    Float4   MeshColor; // May be eventually replaced by the emmisive component of the standard surface shader
+    VertexDequantization Dequantization; // Of the currently drawn primitive
 };
 
 struct CbScenePrimitive
 {
     // Metallness
-    XMFLOAT4 BaseColorFactor;
-    XMFLOAT4 MetallicRoughnessFactor;
+    Float4   BaseColorFactor;
+    Float4   MetallicRoughnessFactor;
 
     // Specularity
-    XMFLOAT4 DiffuseColorFactor;
-    XMFLOAT4 SpecularFactor;
+    Float4   DiffuseColorFactor;
+    Float4   SpecularFactor;
 
     // Both workflows
     float    NormalTexScale;
     float    OcclusionTexStrength;
     float    padding[2];  // padding to 16 bytes
-    XMFLOAT4 EmissionFactor;
+    Float4   EmissionFactor;
 };
 
-Scene::Scene(const SceneId sceneId) :
-    mSceneId(sceneId)
+Scene::Scene(const SceneId sceneId, const SceneLoadOptions &loadOptions) :
+    mSceneId(sceneId),
+    mLoadOptions(loadOptions),
+    mRootMtrx(MatrixIdentity()),
+    mAnimationMtrx(MatrixIdentity()),
+    mTextureCache(loadOptions.textureCache ? loadOptions.textureCache : &mOwnTextureCache)
 {
-    mViewData.eye = XMVectorSet(0.0f,  4.0f, 10.0f, 1.0f);
-    mViewData.at  = XMVectorSet(0.0f, -0.2f,  0.0f, 1.0f);
-    mViewData.up  = XMVectorSet(0.0f,  1.0f,  0.0f, 1.0f);
+    mViewData.eye = Float4(0.0f,  4.0f, 10.0f, 1.0f);
+    mViewData.at  = Float4(0.0f, -0.2f,  0.0f, 1.0f);
+    mViewData.up  = Float4(0.0f,  1.0f,  0.0f, 1.0f);
 }
 
 Scene::~Scene()
@@ -113,70 +137,41 @@ bool Scene::Init(IRenderingContext &ctx)
     if (!ctx.GetWindowSize(wndWidth, wndHeight))
         return false;
 
-    auto device = ctx.GetDevice();
-    auto immCtx = ctx.GetImmediateContext();
-
-    HRESULT hr = S_OK;
-
-    // Vertex shader
-    ID3DBlob* pVsBlob = nullptr;
-    if (!ctx.CreateVertexShader(L"../scene_shaders.fx", "VS", "vs_4_0", pVsBlob, mVertexShader))
-        return false;
-
-    // Input layout
-    hr = device->CreateInputLayout(sVertexLayoutDesc.data(),
-                                   (UINT)sVertexLayoutDesc.size(),
-                                   pVsBlob->GetBufferPointer(),
-                                   pVsBlob->GetBufferSize(),
-                                   &mVertexLayout);
-    pVsBlob->Release();
-    if (FAILED(hr))
-        return false;
+    // Vertex shader & input layout
+    {
+        LoadProfiler::ScopedTimer timer("shader compilation", "vertex shaders");
+        if (!ctx.CreateVertexShader(L"../scene_shaders.fx", "VS", "vs_4_0", sVertexLayoutDesc, mVertexShader))
+            return false;
+        if (!ctx.CreateVertexShader(L"../scene_shaders.fx", "VsCompact", "vs_4_0", sCompactVertexLayoutDesc, mVsCompact))
+            return false;
+        if (!ctx.CreateVertexShader(L"../scene_shaders.fx", "VsCompact", "vs_4_0", sQuantizedVertexLayoutDesc, mVsQuantized))
+            return false;
+    }
 
     // Pixel shaders
-    if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsPbrMetalness", "ps_4_0", mPsPbrMetalness))
+    {
+        LoadProfiler::ScopedTimer timer("shader compilation", "pixel shaders");
+        if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsPbrMetalness", "ps_4_0", mPsPbrMetalness))
+            return false;
+        if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsPbrSpecularity", "ps_4_0", mPsPbrSpecularity))
+            return false;
+        if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsConstEmissive", "ps_4_0", mPsConstEmmisive))
+            return false;
+    }
+
+    // Create constant buffers
+    if (!ctx.CreateBuffer(DeviceBufferType::kConstant, nullptr, sizeof(CbScene), mCbScene))
         return false;
-    if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsPbrSpecularity", "ps_4_0", mPsPbrSpecularity))
+    if (!ctx.CreateBuffer(DeviceBufferType::kConstant, nullptr, sizeof(CbFrame), mCbFrame))
         return false;
-    if (!ctx.CreatePixelShader(L"../scene_shaders.fx", "PsConstEmissive", "ps_4_0", mPsConstEmmisive))
+    if (!ctx.CreateBuffer(DeviceBufferType::kConstant, nullptr, sizeof(CbSceneNode), mCbSceneNode))
         return false;
-
-    // Create constant buffers
-    D3D11_BUFFER_DESC bd;
-    ZeroMemory(&bd, sizeof(bd));
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    bd.CPUAccessFlags = 0;
-    bd.ByteWidth = sizeof(CbScene);
-    hr = device->CreateBuffer(&bd, nullptr, &mCbScene);
-    if (FAILED(hr))
+    if (!ctx.CreateBuffer(DeviceBufferType::kConstant, nullptr, sizeof(CbScenePrimitive), mCbScenePrimitive))
         return false;
-    bd.ByteWidth = sizeof(CbFrame);
-    hr = device->CreateBuffer(&bd, nullptr, &mCbFrame);
-    if (FAILED(hr))
-        return hr;
-    bd.ByteWidth = sizeof(CbSceneNode);
-    hr = device->CreateBuffer(&bd, nullptr, &mCbSceneNode);
-    if (FAILED(hr))
-        return hr;
-    bd.ByteWidth = sizeof(CbScenePrimitive);
-    hr = device->CreateBuffer(&bd, nullptr, &mCbScenePrimitive);
-    if (FAILED(hr))
-        return hr;
 
     // Create sampler state
-    D3D11_SAMPLER_DESC sampDesc;
-    ZeroMemory(&sampDesc, sizeof(sampDesc));
-    sampDesc.Filter = D3D11_FILTER_ANISOTROPIC; // D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-    sampDesc.MinLOD = 0;
-    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-    hr = device->CreateSamplerState(&sampDesc, &mSamplerLinear);
-    if (FAILED(hr))
-        return hr;
+    if (!ctx.CreateSamplerState(mSamplerLinear))
+        return false;
 
     // Load scene
 
@@ -186,25 +181,21 @@ bool Scene::Init(IRenderingContext &ctx)
     if (!mPointLightProxy.CreateSphere(ctx, 8, 16))
         return false;
 
+    mDefaultMaterial.SetTextureCache(mTextureCache);
     if (!mDefaultMaterial.CreatePbrSpecularity(ctx,
                                                nullptr,
-                                               XMFLOAT4(0.5f, 0.5f, 0.5f, 1.f),
+                                               Float4(0.5f, 0.5f, 0.5f, 1.f),
                                                nullptr,
-                                               XMFLOAT4(0.f, 0.f, 0.f, 1.f)))
+                                               Float4(0.f, 0.f, 0.f, 1.f)))
         return false;
 
     // Matrices
-    mViewMtrx = XMMatrixLookAtLH(mViewData.eye, mViewData.at, mViewData.up);
-    mProjectionMtrx = XMMatrixPerspectiveFovLH(XM_PIDIV4,
-                                               (FLOAT)wndWidth / wndHeight,
-                                               0.01f, 100.0f);
+    mViewMtrx = MatrixLookAtLH(mViewData.eye, mViewData.at, mViewData.up);
+    mProjectionMtrx = MatrixPerspectiveFovLH(kPiDiv4,
+                                             (float)wndWidth / wndHeight,
+                                             0.01f, 100.0f);
 
-    // Scene constant buffer can be updated now
-    CbScene cbScene;
-    cbScene.ViewMtrx = XMMatrixTranspose(mViewMtrx);
-    XMStoreFloat4(&cbScene.CameraPos, mViewData.eye);
-    cbScene.ProjectionMtrx = XMMatrixTranspose(mProjectionMtrx);
-    immCtx->UpdateSubresource(mCbScene, 0, NULL, &cbScene, 0, 0);
+    UpdateMemoryUsage();
 
     return true;
 }
@@ -227,155 +218,70 @@ bool Scene::LoadExternal(IRenderingContext &ctx, const std::wstring &filePath)
 
 
 
-const tinygltf::Accessor& GetPrimitiveAttrAccessor(bool &accessorLoaded,
-                                                   const tinygltf::Model &model,
-                                                   const std::map<std::string, int> &attributes,
-                                                   const int primitiveIdx,
-                                                   bool requiredData,
-                                                   const std::string &attrName,
-                                                   const std::wstring &logPrefix)
-{
-    static tinygltf::Accessor dummyAccessor;
-
-    const auto attrIt = attributes.find(attrName);
-    if (attrIt == attributes.end())
-    {
-        Log::Write(requiredData ? Log::eError : Log::eDebug,
-                   L"%sNo %s attribute present in primitive %d!",
-                   logPrefix.c_str(),
-                   Utils::StringToWstring(attrName).c_str(),
-                   primitiveIdx);
-        accessorLoaded = false;
-        return dummyAccessor;
-    }
-
-    const auto accessorIdx = attrIt->second;
-    if ((accessorIdx < 0) || (accessorIdx >= model.accessors.size()))
-    {
-        Log::Error(L"%sInvalid %s accessor index (%d/%d)!",
-                   logPrefix.c_str(),
-                   Utils::StringToWstring(attrName).c_str(),
-                   accessorIdx,
-                   model.accessors.size());
-        accessorLoaded = false;
-        return dummyAccessor;
-    }
-
-    accessorLoaded = true;
-    return model.accessors[accessorIdx];
-}
 
-template <typename ComponentType,
-          size_t ComponentCount,
-          typename TDataConsumer>
-bool IterateGltfAccesorData(const tinygltf::Model &model,
-                            const tinygltf::Accessor &accessor,
-                            TDataConsumer DataConsumer,
-                            const wchar_t *logPrefix,
-                            const wchar_t *logDataName)
+bool Scene::LoadGLTF(IRenderingContext &ctx,
+                     const std::wstring &filePath)
 {
-    Log::Debug(L"%s%s accesor \"%s\": view %d, offset %d, type %s<%s>, count %d",
-               logPrefix,
-               logDataName,
-               Utils::StringToWstring(accessor.name).c_str(),
-               accessor.bufferView,
-               accessor.byteOffset,
-               GltfUtils::TypeToWstring(accessor.type).c_str(),
-               GltfUtils::ComponentTypeToWstring(accessor.componentType).c_str(),
-               accessor.count);
-
-    // Buffer view
+    using namespace std;
 
-    const auto bufferViewIdx = accessor.bufferView;
+    Log::Debug(L"");
+    const std::wstring logPrefix = L"LoadGLTF: ";
 
-    if ((bufferViewIdx < 0) || (bufferViewIdx >= model.bufferViews.size()))
+    if (mLoadOptions.useSceneCache && LoadSceneCache(ctx, filePath, logPrefix))
     {
-        Log::Error(L"%sInvalid %s view buffer index (%d/%d)!",
-                   logPrefix, logDataName, bufferViewIdx, model.bufferViews.size());
-        return false;
+        SetupDefaultLights();
+        return true;
     }
 
-    const auto &bufferView = model.bufferViews[bufferViewIdx];
-
-    //Log::Debug(L"%s%s buffer view %d \"%s\": buffer %d, offset %d, length %d, stride %d, target %s",
-    //           logPrefix,
-    //           logDataName,
-    //           bufferViewIdx,
-    //           Utils::StringToWstring(bufferView.name).c_str(),
-    //           bufferView.buffer,
-    //           bufferView.byteOffset,
-    //           bufferView.byteLength,
-    //           bufferView.byteStride,
-    //           GltfUtils::TargetToWstring(bufferView.target).c_str());
+    // Kept alive by asynchronous loading until all of its data is on the device
+    std::unique_ptr<tinygltf::Model> modelPtr(new tinygltf::Model);
+    auto &model = *modelPtr;
+    // Images are decoded later, only if their textures are not in the texture cache yet
+    if (!GltfUtils::LoadModel(model, filePath, true, mLoadOptions.gltfFrontEnd))
+        return false;
 
-    // Buffer
+    // Released together with the model
+    const std::string modelName = Utils::WstringToString(filePath);
+    size_t modelSize = 0;
+    for (const auto &buffer : model.buffers)
+        modelSize += buffer.data.size();
+    for (const auto &image : model.images)
+        modelSize += image.image.size();
+    mMemoryTracker.SetAssetSize(MemoryCategory::kGltfData, modelName, modelSize);
 
-    const auto bufferIdx = bufferView.buffer;
+    Log::Debug(L"");
 
-    if ((bufferIdx < 0) || (bufferIdx >= model.buffers.size()))
-    {
-        Log::Error(L"%sInvalid %s buffer index (%d/%d)!",
-                   logPrefix, logDataName, bufferIdx, model.buffers.size());
+    if (!LoadMaterialsFromGltf(ctx, model, logPrefix))
         return false;
-    }
-
-    const auto &buffer = model.buffers[bufferIdx];
 
-    const auto byteEnd = bufferView.byteOffset + bufferView.byteLength;
-    if (byteEnd > buffer.data.size())
+    if (mLoadOptions.asyncLoading)
     {
-        Log::Error(L"%sAccessing data chunk outside %s buffer %d!",
-                   logPrefix, logDataName, bufferIdx);
-        return false;
-    }
-
-    //Log::Debug(L"%s%s buffer %d \"%s\": data %x, size %d, uri \"%s\"",
-    //           logPrefix,
-    //           logDataName,
-    //           bufferIdx,
-    //           Utils::StringToWstring(buffer.name).c_str(),
-    //           buffer.data.data(),
-    //           buffer.data.size(),
-    //           Utils::StringToWstring(buffer.uri).c_str());
-
-    // TODO: Check that buffer view is large enough to contain all data from accessor?
-
-    // Data
-
-    const auto componentSize = sizeof(ComponentType);
-    const auto typeSize = ComponentCount * componentSize;
-    const auto stride = bufferView.byteStride;
-    const auto typeOffset = (stride == 0) ? typeSize : stride;
-
-    auto ptr = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-    int idx = 0;
-    for (; idx < accessor.count; ++idx, ptr += typeOffset)
-        DataConsumer(idx, ptr);
-
-    return true;
-}
-
-
-bool Scene::LoadGLTF(IRenderingContext &ctx,
-                     const std::wstring &filePath)
-{
-    using namespace std;
+        // Just the node hierarchy now, primitives and textures follow in the background
+        if (!LoadSceneFromGltf(ctx, model, logPrefix))
+            return false;
+        if (!StartAsyncLoad(ctx, std::move(modelPtr), filePath, logPrefix))
+            return false;
 
-    Log::Debug(L"");
-    const std::wstring logPrefix = L"LoadGLTF: ";
+        SetupDefaultLights();
+        return true;
+    }
 
-    tinygltf::Model model;
-    if (!GltfUtils::LoadModel(model, filePath))
+    if (!LoadTexturesFromGltf(ctx, model, filePath, logPrefix))
         return false;
 
-    Log::Debug(L"");
-
-    if (!LoadMaterialsFromGltf(ctx, model, logPrefix))
+    if (!LoadSceneFromGltf(ctx, model, logPrefix))
         return false;
 
-    if (!LoadSceneFromGltf(ctx, model, logPrefix))
+    if (!LoadPrimitivesFromGltf(ctx, model, logPrefix))
         return false;
 
+    // The scene is fine even if the cache cannot be saved
+    if (mLoadOptions.useSceneCache)
+        SaveSceneCache(model, filePath, logPrefix);
+
+    mMemoryTracker.SetAssetSize(MemoryCategory::kGltfData, modelName, 0);
+    mMemoryTracker.ClearCategory(MemoryCategory::kImages);
+
     SetupDefaultLights();
 
     Log::Debug(L"");
@@ -407,7 +313,11 @@ bool Scene::LoadMaterialsFromGltf(IRenderingContext &ctx,
                    materials.size(),
                    Utils::StringToWstring(material.name).c_str());
 
+        LoadProfiler::ScopedTimer timer("material", material.name);
+
         SceneMaterial sceneMaterial;
+        sceneMaterial.SetTextureCompression(mLoadOptions.textureCompression);
+        sceneMaterial.SetTextureCache(mTextureCache);
         if (!sceneMaterial.LoadFromGltf(ctx, model, material, valueLogPrefix))
             return false;
         mMaterials.push_back(std::move(sceneMaterial));
@@ -436,28 +346,57 @@ bool Scene::LoadSceneFromGltf(IRenderingContext &ctx,
                Utils::StringToWstring(scene.name).c_str(),
                scene.nodes.size());
 
-    // Nodes hierarchy
-    mRootNodes.clear();
-    mRootNodes.reserve(scene.nodes.size());
+    // Nodes hierarchy; meshes used by the nodes get their (still empty) primitives
+    mMeshes.clear();
+    mMeshes.resize(model.meshes.size());
+    mSceneGraph.Clear();
+    mSceneGraph.Reserve(model.nodes.size());
     for (const auto nodeIdx : scene.nodes)
-    {
-        SceneNode sceneNode(true);
-        if (!LoadSceneNodeFromGLTF(ctx, sceneNode, model, nodeIdx, logPrefix + L"   "))
+        if (!LoadSceneNodeFromGLTF(ctx, model, nodeIdx, SceneGraph::kNoParent, logPrefix + L"   "))
             return false;
-        mRootNodes.push_back(std::move(sceneNode));
+
+    if (Log::sLoggingLevel >= Log::eDebug)
+    {
+        size_t usedMeshCount = 0, meshNodeCount = 0;
+        for (const auto &mesh : mMeshes)
+            usedMeshCount += mesh.primitives.empty() ? 0 : 1;
+        for (uint32_t node = 0; node < mSceneGraph.GetNodeCount(); node++)
+            meshNodeCount += (mSceneGraph.GetMeshIdx(node) >= 0) ? 1 : 0;
+        Log::Debug(L"%sMeshes: %d used by %d node(s)", logPrefix.c_str(), (int)usedMeshCount, (int)meshNodeCount);
+    }
+
+    return true;
+}
+
+
+// Converts an optional glTF vector; returns false if it is present but of incorrect size
+static bool GetGltfVector(float *out,
+                          const std::vector<double> &vec,
+                          size_t size,
+                          const wchar_t *name,
+                          const std::wstring &logPrefix)
+{
+    if (vec.size() != size)
+    {
+        if (vec.size() != 0)
+            Log::Warning(L"%sNode %s: vector of incorrect size (%d instead of %d)",
+                         logPrefix.c_str(), name, (int)vec.size(), (int)size);
+        return false;
     }
 
+    for (size_t i = 0; i < size; i++)
+        out[i] = (float)vec[i];
     return true;
 }
 
 
 bool Scene::LoadSceneNodeFromGLTF(IRenderingContext &ctx,
-                                  SceneNode &sceneNode,
                                   const tinygltf::Model &model,
                                   int nodeIdx,
+                                  uint32_t parent,
                                   const std::wstring &logPrefix)
 {
-    if (nodeIdx >= model.nodes.size())
+    if ((nodeIdx < 0) || (nodeIdx >= model.nodes.size()))
     {
         Log::Error(L"%sInvalid node index (%d/%d)!", logPrefix.c_str(), nodeIdx, model.nodes.size());
         return false;
@@ -465,1640 +404,1574 @@ bool Scene::LoadSceneNodeFromGLTF(IRenderingContext &ctx,
 
     const auto &node = model.nodes[nodeIdx];
 
-    // Node itself
-    if (!sceneNode.LoadFromGLTF(ctx, model, node, nodeIdx, logPrefix))
+    // debug
+    if (Log::sLoggingLevel >= Log::eDebug)
+    {
+        std::wstring transforms;
+        if (!node.rotation.empty())
+            transforms += L"rotation ";
+        if (!node.scale.empty())
+            transforms += L"scale ";
+        if (!node.translation.empty())
+            transforms += L"translation ";
+        if (!node.matrix.empty())
+            transforms += L"matrix ";
+        if (transforms.empty())
+            transforms = L"none";
+        Log::Debug(L"%sNode %d/%d \"%s\": mesh %d, transform %s, children %d",
+                   logPrefix.c_str(), 
+                   nodeIdx,
+                   model.nodes.size(),
+                   Utils::StringToWstring(node.name).c_str(),
+                   node.mesh,
+                   transforms.c_str(),
+                   node.children.size());
+    }
+
+    const std::wstring &subItemsLogPrefix = logPrefix + L"   ";
+
+    // Mesh; its primitives are loaded later for all meshes at once
+    const auto meshIdx = node.mesh;
+    if (meshIdx >= (int)model.meshes.size())
+    {
+        Log::Error(L"%sInvalid mesh index (%d/%d)!", subItemsLogPrefix.c_str(), meshIdx, model.meshes.size());
         return false;
+    }
+    if (meshIdx >= 0)
+    {
+        const auto &mesh = model.meshes[meshIdx];
+
+        Log::Debug(L"%sMesh %d/%d \"%s\": %d primitive(s)",
+                   subItemsLogPrefix.c_str(),
+                   meshIdx,
+                   model.meshes.size(),
+                   Utils::StringToWstring(mesh.name).c_str(),
+                   mesh.primitives.size());
+
+        auto &primitives = mMeshes[meshIdx].primitives;
+        if (primitives.empty())
+            primitives.resize(mesh.primitives.size());
+    }
+
+    const auto sceneNode = mSceneGraph.AddNode(parent, std::max(meshIdx, -1));
+
+    // Local transformation
+    if (node.matrix.size() == 16)
+    {
+        Matrix mtrx;
+        for (int i = 0; i < 16; i++)
+            mtrx.m[i / 4][i % 4] = (float)node.matrix[i];
+        mSceneGraph.SetLocalMtrx(sceneNode, mtrx);
+
+        // Sanity checking
+        if (!node.scale.empty())
+            Log::Warning(L"%sNode %d/%d \"%s\": node.scale is not empty when tranformation matrix is provided. Ignoring.",
+                         logPrefix.c_str(),
+                         nodeIdx,
+                         model.nodes.size(),
+                         Utils::StringToWstring(node.name).c_str());
+        if (!node.rotation.empty())
+            Log::Warning(L"%sNode %d/%d \"%s\": node.rotation is not empty when tranformation matrix is provided. Ignoring.",
+                         logPrefix.c_str(),
+                         nodeIdx,
+                         model.nodes.size(),
+                         Utils::StringToWstring(node.name).c_str());
+        if (!node.translation.empty())
+            Log::Warning(L"%sNode %d/%d \"%s\": node.translation is not empty when tranformation matrix is provided. Ignoring.",
+                         logPrefix.c_str(),
+                         nodeIdx,
+                         model.nodes.size(),
+                         Utils::StringToWstring(node.name).c_str());
+    }
+    else
+    {
+        if (!node.matrix.empty())
+            Log::Warning(L"%sNode matrix: vector of incorrect size (%d instead of 16)",
+                         logPrefix.c_str(), (int)node.matrix.size());
+
+        Float3 translation(0.f, 0.f, 0.f);
+        Float4 rotation(0.f, 0.f, 0.f, 1.f);
+        Float3 scale(1.f, 1.f, 1.f);
+        const bool hasTranslation = GetGltfVector(&translation.x, node.translation, 3, L"translation", logPrefix);
+        const bool hasRotation    = GetGltfVector(&rotation.x,    node.rotation,    4, L"rotation",    logPrefix);
+        const bool hasScale       = GetGltfVector(&scale.x,       node.scale,       3, L"scale",       logPrefix);
+        if (hasTranslation || hasRotation || hasScale)
+            mSceneGraph.SetLocalTRS(sceneNode, translation, rotation, scale);
+    }
 
     // Children
-    sceneNode.mChildren.clear();
-    sceneNode.mChildren.reserve(node.children.size());
-    const std::wstring &childLogPrefix = logPrefix + L"   ";
     for (const auto childIdx : node.children)
     {
         if ((childIdx < 0) || (childIdx >= model.nodes.size()))
         {
-            Log::Error(L"%sInvalid child node index (%d/%d)!", childLogPrefix.c_str(), childIdx, model.nodes.size());
+            Log::Error(L"%sInvalid child node index (%d/%d)!", subItemsLogPrefix.c_str(), childIdx, model.nodes.size());
             return false;
         }
 
         //Log::Debug(L"%sLoading child %d \"%s\"",
-        //           childLogPrefix.c_str(),
+        //           subItemsLogPrefix.c_str(),
         //           childIdx,
         //           Utils::StringToWstring(model.nodes[childIdx].name).c_str());
 
-        SceneNode childNode;
-        if (!LoadSceneNodeFromGLTF(ctx, childNode, model, childIdx, childLogPrefix))
+        if (!LoadSceneNodeFromGLTF(ctx, model, childIdx, sceneNode, subItemsLogPrefix))
             return false;
-        sceneNode.mChildren.push_back(std::move(childNode));
     }
 
     return true;
 }
 
 
-const SceneMaterial& Scene::GetMaterial(const ScenePrimitive &primitive) const
+void Scene::GatherPrimitiveJobs(std::vector<PrimitiveJob> &jobs, const tinygltf::Model &model)
 {
-    const int idx = primitive.GetMaterialIdx();
+    // Primitives of all meshes used by the nodes, each just once
+    jobs.clear();
+    for (size_t meshIdx = 0; meshIdx < mMeshes.size(); ++meshIdx)
+    {
+        auto &primitives = mMeshes[meshIdx].primitives;
+        for (size_t i = 0; i < primitives.size(); ++i)
+        {
+            PrimitiveJob job;
+            job.primitive = &primitives[i];
+            job.mesh = &model.meshes[meshIdx];
+            job.primitiveIdx = (int)i;
+            jobs.push_back(job);
+        }
+    }
+}
 
-    if (idx >= 0 && idx < mMaterials.size())
-        return mMaterials[idx];
-    else
-        return mDefaultMaterial;
+
+std::string Scene::GetPrimitiveName(const tinygltf::Model &model, const PrimitiveJob &job)
+{
+    return "mesh " + std::to_string(job.mesh - model.meshes.data()) + " \"" + job.mesh->name + "\"" +
+           " primitive " + std::to_string(job.primitiveIdx);
 }
 
 
-void Scene::Destroy()
+bool Scene::DecodePrimitive(PrimitiveJob &job,
+                            const tinygltf::Model &model,
+                            const std::wstring &logPrefix,
+                            ThreadPool *tangentPool) const
 {
-    Utils::ReleaseAndMakeNull(mVertexShader);
+    LoadProfiler::ScopedTimer timer("primitive decode", GetPrimitiveName(model, job));
 
-    Utils::ReleaseAndMakeNull(mPsPbrMetalness);
-    Utils::ReleaseAndMakeNull(mPsPbrSpecularity);
-    Utils::ReleaseAndMakeNull(mPsConstEmmisive);
+    if (!job.primitive->LoadDataFromGLTF(model, *job.mesh, job.primitiveIdx, logPrefix,
+                                         mLoadOptions.normalMethod, mLoadOptions.normalCreaseAngle,
+                                         mLoadOptions.tangentMethod, tangentPool))
+    {
+        job.error = L"loading of glTF data failed";
+        return false;
+    }
 
-    Utils::ReleaseAndMakeNull(mVertexLayout);
+    if (mLoadOptions.weldEpsilon > 0.f)
+    {
+        LoadProfiler::ScopedTimer weldTimer("vertex welding");
+        if (!job.primitive->WeldGeometry(mLoadOptions.weldEpsilon, logPrefix))
+        {
+            job.error = L"vertex welding failed";
+            return false;
+        }
+    }
+    if (mLoadOptions.meshOptimization != MeshOptimization::kNone)
+    {
+        LoadProfiler::ScopedTimer optimizationTimer("mesh optimization");
+        if (!job.primitive->OptimizeGeometry(mLoadOptions.meshOptimization == MeshOptimization::kVertexCacheAndOverdraw,
+                                             job.statsBefore,
+                                             job.statsAfter))
+        {
+            job.error = L"mesh optimization failed";
+            return false;
+        }
+    }
 
-    Utils::ReleaseAndMakeNull(mCbScene);
-    Utils::ReleaseAndMakeNull(mCbFrame);
-    Utils::ReleaseAndMakeNull(mCbSceneNode);
-    Utils::ReleaseAndMakeNull(mCbScenePrimitive);
+    return true;
+}
 
-    Utils::ReleaseAndMakeNull(mSamplerLinear);
 
-    mRootNodes.clear();
-    mPointLightProxy.Destroy();
+bool Scene::CreatePrimitiveDeviceBuffers(IRenderingContext &ctx, const tinygltf::Model &model, PrimitiveJob &job)
+{
+    LoadProfiler::ScopedTimer timer("buffer creation", GetPrimitiveName(model, job));
+    if (!job.primitive->CreateDeviceBuffers(ctx, mLoadOptions.vertexFormat))
+    {
+        job.error = L"device buffer creation failed";
+        return false;
+    }
+    timer.SetBytes(job.primitive->GetDeviceBufferSize());
+    return true;
 }
 
 
-void Scene::AnimateFrame(IRenderingContext &ctx)
+void Scene::LogMeshOptimizationStats(const std::vector<PrimitiveJob> &jobs,
+                                     const std::wstring &logPrefix) const
 {
-    if (!ctx.IsValid())
+    if (mLoadOptions.meshOptimization == MeshOptimization::kNone)
         return;
 
-    // debug: Materials
-    for (auto &material : mMaterials)
-        material.Animate(ctx);
-
-    // Scene geometry
-    for (auto &node : mRootNodes)
-        node.Animate(ctx);
+    MeshOptimizer::VertexCacheStats totalBefore, totalAfter;
+    for (const auto &job : jobs)
+    {
+        totalBefore.Add(job.statsBefore);
+        totalAfter.Add(job.statsAfter);
+    }
+    Log::Info(L"%sMesh optimization: %llu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+              logPrefix.c_str(),
+              (unsigned long long)totalBefore.triangleCount,
+              totalBefore.GetAcmr(),
+              totalAfter.GetAcmr(),
+              totalBefore.GetAtvr(),
+              totalAfter.GetAtvr());
+}
 
-    // Directional lights (are steady for now)
-    for (auto &dirLight : mDirectLights)
-        dirLight.dirTransf = dirLight.dir;
 
-    // Animate point lights (harwired animation for now)
+bool Scene::LoadPrimitivesFromGltf(IRenderingContext &ctx,
+                                   const tinygltf::Model &model,
+                                   const std::wstring &logPrefix)
+{
+    std::vector<PrimitiveJob> jobs;
+    GatherPrimitiveJobs(jobs, model);
 
-    const float time = ctx.GetFrameAnimationTime();
-    const float period = 15.f; //seconds
-    const float totalAnimPos = time / period;
-    const float angle = totalAnimPos * XM_2PI;
+    const std::wstring primitiveLogPrefix = logPrefix + L"   ";
+    std::vector<char> decoded(jobs.size(), false); // std::vector<bool> is not safe for concurrent writes
 
-    const auto pointCount = mPointLights.size();
-    for (int i = 0; i < pointCount; i++)
+    if (mLoadOptions.parallelGeometry)
     {
-        const float lightRelOffsetCircular = (float)i / pointCount;
-        const float lightRelOffsetInterval = (float)i / (pointCount - 1);
-
-        const float rotationAngle = -2.f * angle - lightRelOffsetCircular * XM_2PI;
-        const float orbitInclination = Utils::Lerp(mPointLights[i].orbitInclinationMin,
-                                                   mPointLights[i].orbitInclinationMax,
-                                                   lightRelOffsetInterval);
+        // Primitive workers block while their large primitives are split among the tangent workers
+        ThreadPool pool(mLoadOptions.workerThreadCount);
+        ThreadPool tangentPool(mLoadOptions.workerThreadCount);
 
-        const XMMATRIX translationMtrx  = XMMatrixTranslation(mPointLights[i].orbitRadius, 0.f, 0.f);
-        const XMMATRIX rotationMtrx     = XMMatrixRotationY(rotationAngle);
-        const XMMATRIX inclinationMtrx  = XMMatrixRotationZ(orbitInclination);
-        const XMMATRIX transfMtrx = translationMtrx * rotationMtrx * inclinationMtrx;
+        Log::Debug(L"%sDecoding %d primitive(s) on %d worker thread(s)",
+                   logPrefix.c_str(), jobs.size(), pool.GetThreadCount());
 
-        const XMFLOAT4 basePos{ 0.f, 0.f, 0.f, 0.f };
-        const XMVECTOR lightVec = XMLoadFloat4(&basePos);
-        const XMVECTOR lightVecTransf = XMVector3Transform(lightVec, transfMtrx);
-        XMStoreFloat4(&mPointLights[i].posTransf, lightVecTransf);
+        pool.ParallelFor(jobs.size(), [&](size_t i)
+        {
+            decoded[i] = DecodePrimitive(jobs[i], model, primitiveLogPrefix, &tangentPool);
+        });
     }
+    else
+        for (size_t i = 0; i < jobs.size(); ++i)
+            decoded[i] = DecodePrimitive(jobs[i], model, primitiveLogPrefix, nullptr);
+
+    // Device buffers are created on this thread only
+    for (size_t i = 0; i < jobs.size(); ++i)
+        if (!decoded[i] || !CreatePrimitiveDeviceBuffers(ctx, model, jobs[i]))
+        {
+            Log::Error(L"%sFailed to load %s: %s!",
+                       logPrefix.c_str(),
+                       Utils::StringToWstring(GetPrimitiveName(model, jobs[i])).c_str(),
+                       jobs[i].error.c_str());
+            return false;
+        }
+
+    // While the glTF data is still alive, so that the peak usage includes both
+    UpdateMemoryUsage();
+
+    LogMeshOptimizationStats(jobs, logPrefix);
+
+    return true;
 }
 
 
-void Scene::RenderFrame(IRenderingContext &ctx)
+void Scene::CreateImageMipChains(std::vector<ImageMipChain> &mipChains,
+                                 std::vector<size_t> &textureMipChains,
+                                 const tinygltf::Image &image,
+                                 const std::vector<SceneTexture*> &textures,
+                                 ThreadPool *encoderPool)
 {
-    if (!ctx.IsValid())
-        return;
+    // Uncompressed linear and sRGB chains which compressed ones are encoded from
+    MipChain sourceMipChains[2];
 
-    if (mPointLights.size() > POINT_LIGHTS_MAX_COUNT)
-        return;
-    if (mDirectLights.size() > DIRECT_LIGHTS_MAX_COUNT)
-        return;
+    const auto &imageName = image.name.empty() ? image.uri : image.name;
 
-    auto immCtx = ctx.GetImmediateContext();
-
-    // Frame constant buffer
-    CbFrame cbFrame;
-    cbFrame.AmbientLightLuminance = mAmbientLight.luminance;
-    cbFrame.DirectLightsCount = (int32_t)mDirectLights.size();
-    for (int i = 0; i < cbFrame.DirectLightsCount; i++)
+    mipChains.clear();
+    textureMipChains.clear();
+    for (auto texture : textures)
     {
-        cbFrame.DirectLightDirs[i]       = mDirectLights[i].dirTransf;
-        cbFrame.DirectLightLuminances[i] = mDirectLights[i].luminance;
-    }
-    cbFrame.PointLightsCount = (int32_t)mPointLights.size();
-    for (int i = 0; i < cbFrame.PointLightsCount; i++)
-    {
-        cbFrame.PointLightPositions[i]   = mPointLights[i].posTransf;
-        cbFrame.PointLightIntensities[i] = mPointLights[i].intensity;
+        const bool isSrgb = texture->IsSrgb();
+        const auto format = texture->SelectBcFormat(image.width, image.height, image.image.data());
+
+        size_t chainIdx = 0;
+        while ((chainIdx < mipChains.size()) &&
+               ((mipChains[chainIdx].isSrgb != isSrgb) || (mipChains[chainIdx].format != format)))
+            chainIdx++;
+        textureMipChains.push_back(chainIdx);
+        if (chainIdx < mipChains.size())
+            continue;
+
+        mipChains.push_back(ImageMipChain{ isSrgb, format, MipChain() });
+        auto &mipChain = mipChains.back().mipChain;
+        if (format == BcEncoder::Format::kNone)
+        {
+            LoadProfiler::ScopedTimer timer("mip generation", imageName, image.image.size());
+            mipChain.Generate(image.width, image.height, image.image.data(), isSrgb);
+        }
+        else
+        {
+            auto &sourceMipChain = sourceMipChains[isSrgb];
+            if (sourceMipChain.GetLevelCount() == 0)
+            {
+                LoadProfiler::ScopedTimer timer("mip generation", imageName, image.image.size());
+                sourceMipChain.Generate(image.width, image.height, image.image.data(), isSrgb);
+            }
+            LoadProfiler::ScopedTimer timer("texture compression", imageName);
+            mipChain.Encode(sourceMipChain, format, texture->GetBcQuality(), encoderPool);
+            timer.SetBytes(mipChain.GetSize());
+        }
     }
-    immCtx->UpdateSubresource(mCbFrame, 0, nullptr, &cbFrame, 0, 0);
+}
 
-    // Setup vertex shader
-    immCtx->VSSetShader(mVertexShader, nullptr, 0);
-    immCtx->VSSetConstantBuffers(0, 1, &mCbScene);
-    immCtx->VSSetConstantBuffers(1, 1, &mCbFrame);
-    immCtx->VSSetConstantBuffers(2, 1, &mCbSceneNode);
 
-    // Setup pixel shader data (shader itself is chosen later for each material)
-    immCtx->PSSetConstantBuffers(0, 1, &mCbScene);
-    immCtx->PSSetConstantBuffers(1, 1, &mCbFrame);
-    immCtx->PSSetConstantBuffers(2, 1, &mCbSceneNode);
-    immCtx->PSSetConstantBuffers(3, 1, &mCbScenePrimitive);
-    immCtx->PSSetSamplers(0, 1, &mSamplerLinear);
+TextureCache::ImageKey Scene::GetImageKey(const std::wstring &sourcePath, const SceneTexture &texture)
+{
+    return TextureCache::ImageKey{ sourcePath, texture.GetImageIdx(), texture.IsSrgb(), texture.GetEncodingKey() };
+}
 
-    // Scene geometry
-    for (auto &node : mRootNodes)
-        RenderNode(ctx, node, XMMatrixIdentity());
 
-    // Proxy geometry for point lights
-    for (int i = 0; i < mPointLights.size(); i++)
-    {
-        CbSceneNode cbSceneNode;
+void Scene::GatherImageJobs(ImageJobs &jobs,
+                            const tinygltf::Model &model,
+                            const std::wstring &sourcePath,
+                            const std::wstring &logPrefix)
+{
+    std::vector<SceneTexture*> pendingTextures;
+    for (auto &material : mMaterials)
+        material.GatherPendingTextures(pendingTextures);
+
+    // Textures which are already in the cache (from another material or scene) are just referenced.
+    // Each of the other images is decoded just once, even if more textures use it.
+    jobs.imageIndices.clear();
+    jobs.textures.clear();
+    jobs.textures.resize(model.images.size());
+    jobs.mipChains.clear();
+    jobs.mipChains.resize(model.images.size());
+    jobs.textureMipChains.clear();
+    jobs.textureMipChains.resize(model.images.size());
+    size_t cachedTextureCount = 0;
+    for (auto texture : pendingTextures)
+    {
+        auto cachedTexture = mTextureCache->FindImageTexture(GetImageKey(sourcePath, *texture));
+        if (cachedTexture)
+        {
+            texture->SetImageTexture(cachedTexture);
+            cachedTextureCount++;
+            continue;
+        }
 
-        const float radius = 0.07f;
-        XMMATRIX lightScaleMtrx = XMMatrixScaling(radius, radius, radius);
-        XMMATRIX lightTrnslMtrx = XMMatrixTranslationFromVector(XMLoadFloat4(&mPointLights[i].posTransf));
-        XMMATRIX lightMtrx = lightScaleMtrx * lightTrnslMtrx;
-        cbSceneNode.WorldMtrx = XMMatrixTranspose(lightMtrx);
+        const int imageIdx = texture->GetImageIdx();
+        if (jobs.textures[imageIdx].empty())
+            jobs.imageIndices.push_back(imageIdx);
+        jobs.textures[imageIdx].push_back(texture);
+    }
 
-        const float radius2 = radius * radius;
-        cbSceneNode.MeshColor = {
-            mPointLights[i].intensity.x / radius2,
-            mPointLights[i].intensity.y / radius2,
-            mPointLights[i].intensity.z / radius2,
-            mPointLights[i].intensity.w / radius2,
-        };
+    Log::Debug(L"%s%d texture(s) taken from the texture cache, %d image(s) to decode",
+               logPrefix.c_str(), cachedTextureCount, jobs.imageIndices.size());
+}
 
-        immCtx->UpdateSubresource(mCbSceneNode, 0, nullptr, &cbSceneNode, 0, 0);
 
-        immCtx->PSSetShader(mPsConstEmmisive, nullptr, 0);
-        mPointLightProxy.DrawGeometry(ctx, mVertexLayout);
-    }
+std::string Scene::GetImageName(const tinygltf::Model &model, int imageIdx)
+{
+    const auto &image = model.images[imageIdx];
+    if (!image.name.empty())
+        return image.name;
+    else if (!image.uri.empty())
+        return image.uri;
+    else
+        return "image " + std::to_string(imageIdx);
 }
 
 
-void Scene::SetupDefaultLights()
+bool Scene::DecodeGltfImage(ImageJobs &jobs, tinygltf::Model &model, int imageIdx)
 {
-    const uint8_t amb = 120;
-    mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
+    // Mip chains are generated (and block-compressed) along with decoding, once for each distinct
+    // color space and format
+    auto &image = model.images[imageIdx];
+    if (!GltfUtils::DecodeImage(image))
+        return false;
+    CreateImageMipChains(jobs.mipChains[imageIdx], jobs.textureMipChains[imageIdx], image, jobs.textures[imageIdx]);
 
-    const float lum = 3.0f;
-    mDirectLights.resize(1);
-    mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-    mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+    size_t imageSize = image.image.size();
+    for (const auto &mipChain : jobs.mipChains[imageIdx])
+        imageSize += mipChain.mipChain.GetSize();
+    mMemoryTracker.SetAssetSize(MemoryCategory::kImages, GetImageName(model, imageIdx), imageSize);
 
-    SetupPointLights(3);
+    return true;
 }
 
 
-bool Scene::SetupPointLights(size_t count,
-                             float intensity,
-                             float orbitRadius,
-                             float orbitInclMin,
-                             float orbitInclMax)
+bool Scene::UploadImageTextures(IRenderingContext &ctx,
+                                ImageJobs &jobs,
+                                tinygltf::Model &model,
+                                int imageIdx,
+                                const std::wstring &sourcePath,
+                                const std::wstring &logPrefix,
+                                size_t &uploadedBytes)
 {
-    if (count > POINT_LIGHTS_MAX_COUNT)
+    auto &image = model.images[imageIdx];
+    auto &textures = jobs.textures[imageIdx];
+    auto &mipChains = jobs.mipChains[imageIdx];
+    const auto &textureMipChains = jobs.textureMipChains[imageIdx];
+    for (size_t t = 0; t < textures.size(); t++)
     {
-        Log::Error(L"SetupPointLights: requested number of point lights (%d) exceeds the limit (%d)", count, POINT_LIGHTS_MAX_COUNT);
-        return false;
-    }
-
-    mPointLights.resize(count);
+        // Textures of the same image can still share the device texture
+        const auto key = GetImageKey(sourcePath, *textures[t]);
+        auto cachedTexture = mTextureCache->FindImageTexture(key);
+        if (cachedTexture)
+            textures[t]->SetImageTexture(cachedTexture);
+        else
+        {
+            const auto &mipChain = mipChains[textureMipChains[t]].mipChain;
+            LoadProfiler::ScopedTimer timer("texture creation", image.name.empty() ? image.uri : image.name,
+                                            mipChain.GetSize());
+            if (!textures[t]->CreateFromGltfImage(ctx, image, logPrefix, &mipChain))
+                return false;
+            mTextureCache->AddImageTexture(key, textures[t]->srv);
 
-    for (auto &light : mPointLights)
-    {
-        light.intensity = XMFLOAT4(intensity, intensity, intensity, 1.0f);
-        light.orbitRadius = orbitRadius;
-        light.orbitInclinationMin = orbitInclMin;
-        light.orbitInclinationMax = orbitInclMax;
+            uploadedBytes += mipChain.GetSize();
+        }
     }
 
+    // Pixels are not needed anymore once they are on the device (unless baked into the cache)
+    std::vector<ImageMipChain>().swap(mipChains);
+    if (!mLoadOptions.useSceneCache)
+        std::vector<unsigned char>().swap(image.image);
+    mMemoryTracker.SetAssetSize(MemoryCategory::kImages, GetImageName(model, imageIdx), image.image.size());
+
     return true;
 }
 
 
-bool Scene::SetupPointLights(const std::initializer_list<XMFLOAT4> &intensities,
-                             float orbitRadius,
-                             float orbitInclMin,
-                             float orbitInclMax)
+bool Scene::LoadTexturesFromGltf(IRenderingContext &ctx,
+                                 tinygltf::Model &model,
+                                 const std::wstring &sourcePath,
+                                 const std::wstring &logPrefix)
 {
-    if (intensities.size() > POINT_LIGHTS_MAX_COUNT)
-    {
-        Log::Error(L"SetupPointLights: requested number of point lights (%d) exceeds the limit (%d)",
-                   intensities.size(), POINT_LIGHTS_MAX_COUNT);
-        return false;
-    }
+    ImageJobs jobs;
+    GatherImageJobs(jobs, model, sourcePath, logPrefix);
 
-    if (intensities.size() != intensities.size())
+    if (jobs.imageIndices.empty())
+        return true;
+
+    const std::wstring textureLogPrefix = logPrefix + L"   ";
+    size_t uploadedBytes = 0;
+
+    if (!mLoadOptions.parallelImages)
     {
-        Log::Error(L"SetupPointLights: provided intensities count (%d) doesn't match the light count (%d)",
-                   intensities.size(), POINT_LIGHTS_MAX_COUNT);
-        return false;
+        for (const auto imageIdx : jobs.imageIndices)
+        {
+            if (!DecodeGltfImage(jobs, model, imageIdx))
+                return false;
+            if (!UploadImageTextures(ctx, jobs, model, imageIdx, sourcePath, textureLogPrefix, uploadedBytes))
+                return false;
+        }
+
+        return true;
     }
 
-    mPointLights.resize(intensities.size());
+    // Decoded images are handed over to this thread (image index, success)
+    std::deque<std::pair<int, bool>> decodedImages;
+    std::mutex decodedMutex;
+    std::condition_variable decodedCondition;
 
-    auto itLight = mPointLights.begin();
-    auto itIntensity = intensities.begin();
-    for (; itLight != mPointLights.end() && itIntensity != intensities.end(); ++itLight, ++itIntensity)
+    // Destroyed first, so queued decodings finish before the objects above go away
+    ThreadPool pool(mLoadOptions.workerThreadCount);
+
+    Log::Debug(L"%sDecoding %d image(s) on %d worker thread(s)",
+               logPrefix.c_str(), jobs.imageIndices.size(), pool.GetThreadCount());
+
+    for (const auto imageIdx : jobs.imageIndices)
+        pool.Enqueue([&, imageIdx]()
+        {
+            const bool success = DecodeGltfImage(jobs, model, imageIdx);
+
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            decodedImages.emplace_back(imageIdx, success);
+            decodedCondition.notify_one();
+        });
+
+    // Textures are uploaded in the order in which their images get decoded
+    for (size_t i = 0; i < jobs.imageIndices.size(); ++i)
     {
-        auto &light = *itLight;
+        std::pair<int, bool> decoded;
+        {
+            std::unique_lock<std::mutex> lock(decodedMutex);
+            decodedCondition.wait(lock, [&] { return !decodedImages.empty(); });
+            decoded = decodedImages.front();
+            decodedImages.pop_front();
+        }
 
-        light.intensity = *itIntensity;
-        light.orbitRadius = orbitRadius;
-        light.orbitInclinationMin = orbitInclMin;
-        light.orbitInclinationMax = orbitInclMax;
+        if (!decoded.second ||
+            !UploadImageTextures(ctx, jobs, model, decoded.first, sourcePath, textureLogPrefix, uploadedBytes))
+            return false;
     }
 
     return true;
 }
 
 
-void Scene::AddScaleToRoots(double scale)
+bool Scene::StartAsyncLoad(IRenderingContext &ctx,
+                           std::unique_ptr<tinygltf::Model> model,
+                           const std::wstring &sourcePath,
+                           const std::wstring &logPrefix)
 {
-    for (auto &rootNode : mRootNodes)
-        rootNode.AddScale(scale);
-}
-
+    mAsyncLoad.reset(new AsyncLoad);
+    auto &load = *mAsyncLoad;
+    load.model = std::move(model);
+    load.sourcePath = sourcePath;
+    load.logPrefix = logPrefix;
+    load.startTime = std::chrono::steady_clock::now();
 
-void Scene::AddScaleToRoots(const std::vector<double> &vec)
-{
-    for (auto &rootNode : mRootNodes)
-        rootNode.AddScale(vec);
-}
+    GatherPrimitiveJobs(load.primitiveJobs, *load.model);
+    GatherImageJobs(load.imageJobs, *load.model, sourcePath, logPrefix);
 
+    // Materials use neutral textures until their images are uploaded
+    for (const auto imageIdx : load.imageJobs.imageIndices)
+        for (auto texture : load.imageJobs.textures[imageIdx])
+            if (!texture->CreateNeutral(ctx))
+                return false;
 
-void Scene::AddRotationQuaternionToRoots(const std::vector<double> &vec)
-{
-    for (auto &rootNode : mRootNodes)
-        rootNode.AddRotationQuaternion(vec);
-}
+    load.pendingJobCount = load.primitiveJobs.size() + load.imageJobs.imageIndices.size();
+    load.tangentPool.reset(new ThreadPool(mLoadOptions.workerThreadCount));
+    load.pool.reset(new ThreadPool(mLoadOptions.workerThreadCount));
 
+    Log::Debug(L"%sLoading %d primitive(s) and %d image(s) in the background on %d worker thread(s)",
+               logPrefix.c_str(),
+               (int)load.primitiveJobs.size(),
+               (int)load.imageJobs.imageIndices.size(),
+               (int)load.pool->GetThreadCount());
 
-void Scene::AddTranslationToRoots(const std::vector<double> &vec)
-{
-    for (auto &rootNode : mRootNodes)
-        rootNode.AddTranslation(vec);
-}
+    auto finishJob = [&load](bool isImage, size_t index, bool success)
+    {
+        std::lock_guard<std::mutex> lock(load.finishedMutex);
+        load.finishedJobs.push_back(AsyncLoad::FinishedJob{ isImage, index, success });
+    };
 
+    // Geometry goes first, so that the scene shape shows up as soon as possible
+    const std::wstring itemLogPrefix = logPrefix + L"   ";
+    for (size_t i = 0; i < load.primitiveJobs.size(); ++i)
+        load.pool->Enqueue([this, &load, finishJob, itemLogPrefix, i]()
+        {
+            const bool success = !load.isCancelled &&
+                                 DecodePrimitive(load.primitiveJobs[i],
+                                                 *load.model,
+                                                 itemLogPrefix,
+                                                 load.tangentPool.get());
+            finishJob(false, i, success);
+        });
+    for (const auto imageIdx : load.imageJobs.imageIndices)
+        load.pool->Enqueue([this, &load, finishJob, imageIdx]()
+        {
+            const bool success = !load.isCancelled &&
+                                 DecodeGltfImage(load.imageJobs, *load.model, imageIdx);
+            finishJob(true, (size_t)imageIdx, success);
+        });
 
-void Scene::AddMatrixToRoots(const std::vector<double> &vec)
-{
-    for (auto &rootNode : mRootNodes)
-        rootNode.AddMatrix(vec);
+    return true;
 }
 
 
-void Scene::RenderNode(IRenderingContext &ctx,
-                       const SceneNode &node,
-                       const XMMATRIX &parentWorldMtrx)
+void Scene::ContinueAsyncLoad(IRenderingContext &ctx)
 {
-    if (!ctx.IsValid())
+    if (!mAsyncLoad)
         return;
 
-    auto immCtx = ctx.GetImmediateContext();
-
-    const auto worldMtrx = node.GetWorldMtrx() * parentWorldMtrx;
+    auto &load = *mAsyncLoad;
+    load.frameCount++;
 
-    // Per-node constant buffer
-    CbSceneNode cbSceneNode;
-    cbSceneNode.WorldMtrx = XMMatrixTranspose(worldMtrx);
-    cbSceneNode.MeshColor = { 0.f, 1.f, 0.f, 1.f, };
-    immCtx->UpdateSubresource(mCbSceneNode, 0, nullptr, &cbSceneNode, 0, 0);
-
-    // Draw current node
-    for (auto &primitive : node.mPrimitives)
+    // Finished jobs are uploaded until the frame budget is exhausted (at least one per frame)
+    const std::wstring itemLogPrefix = load.logPrefix + L"   ";
+    size_t uploadedBytes = 0;
+    size_t uploadedJobCount = 0;
+    while ((load.pendingJobCount > 0) && (uploadedBytes < mLoadOptions.uploadBudget))
     {
-        auto &material = GetMaterial(primitive);
-
-        switch (material.GetWorkflow())
+        AsyncLoad::FinishedJob job;
         {
-        case MaterialWorkflow::kPbrMetalness:
-        {
-            immCtx->PSSetShader(mPsPbrMetalness, nullptr, 0);
-            immCtx->PSSetShaderResources(0, 1, &material.GetBaseColorTexture().srv);
-            immCtx->PSSetShaderResources(1, 1, &material.GetMetallicRoughnessTexture().srv);
-            immCtx->PSSetShaderResources(4, 1, &material.GetNormalTexture().srv);
-            immCtx->PSSetShaderResources(5, 1, &material.GetOcclusionTexture().srv);
-            immCtx->PSSetShaderResources(6, 1, &material.GetEmissionTexture().srv);
-
-            CbScenePrimitive cbScenePrimitive;
-            cbScenePrimitive.BaseColorFactor            = material.GetBaseColorFactor();
-            cbScenePrimitive.MetallicRoughnessFactor    = material.GetMetallicRoughnessFactor();
-            cbScenePrimitive.DiffuseColorFactor         = UNUSED_COLOR;
-            cbScenePrimitive.SpecularFactor             = UNUSED_COLOR;
-            cbScenePrimitive.NormalTexScale             = material.GetNormalTexture().GetScale();
-            cbScenePrimitive.OcclusionTexStrength       = material.GetOcclusionTexture().GetStrength();
-            cbScenePrimitive.EmissionFactor             = material.GetEmissionFactor();
-            immCtx->UpdateSubresource(mCbScenePrimitive, 0, nullptr, &cbScenePrimitive, 0, 0);
-            break;
+            std::lock_guard<std::mutex> lock(load.finishedMutex);
+            if (load.finishedJobs.empty())
+                break;
+            job = load.finishedJobs.front();
+            load.finishedJobs.pop_front();
         }
-        case MaterialWorkflow::kPbrSpecularity:
-        {
-            immCtx->PSSetShader(mPsPbrSpecularity, nullptr, 0);
-            immCtx->PSSetShaderResources(2, 1, &material.GetBaseColorTexture().srv);
-            immCtx->PSSetShaderResources(3, 1, &material.GetSpecularTexture().srv);
-            immCtx->PSSetShaderResources(4, 1, &material.GetNormalTexture().srv);
-            immCtx->PSSetShaderResources(5, 1, &material.GetOcclusionTexture().srv);
-            immCtx->PSSetShaderResources(6, 1, &material.GetEmissionTexture().srv);
+        load.pendingJobCount--;
+        uploadedJobCount++;
 
-            CbScenePrimitive cbScenePrimitive;
-            cbScenePrimitive.DiffuseColorFactor         = material.GetBaseColorFactor();
-            cbScenePrimitive.SpecularFactor             = material.GetSpecularFactor();
-            cbScenePrimitive.BaseColorFactor            = UNUSED_COLOR;
-            cbScenePrimitive.MetallicRoughnessFactor    = UNUSED_COLOR;
-            cbScenePrimitive.NormalTexScale             = material.GetNormalTexture().GetScale();
-            cbScenePrimitive.OcclusionTexStrength       = material.GetOcclusionTexture().GetStrength();
-            cbScenePrimitive.EmissionFactor             = material.GetEmissionFactor();
-            immCtx->UpdateSubresource(mCbScenePrimitive, 0, nullptr, &cbScenePrimitive, 0, 0);
-            break;
+        // Failed primitive jobs know which step failed, images fail either in decoding or upload
+        bool success = job.success;
+        std::wstring name, error;
+        if (job.isImage)
+        {
+            if (success)
+                success = UploadImageTextures(ctx, load.imageJobs, *load.model, (int)job.index,
+                                              load.sourcePath, itemLogPrefix, uploadedBytes);
+            if (!success)
+            {
+                name = L"image " + std::to_wstring(job.index) + L" \"" +
+                       Utils::StringToWstring(GetImageName(*load.model, (int)job.index)) + L"\"";
+                error = job.success ? L"texture creation failed" : L"decoding failed";
+            }
         }
-        default:
-            continue;
+        else
+        {
+            auto &primitiveJob = load.primitiveJobs[job.index];
+            if (success)
+            {
+                success = CreatePrimitiveDeviceBuffers(ctx, *load.model, primitiveJob);
+                uploadedBytes += primitiveJob.primitive->GetDeviceBufferSize();
+            }
+            if (!success)
+            {
+                name = Utils::StringToWstring(GetPrimitiveName(*load.model, primitiveJob));
+                error = primitiveJob.error;
+            }
         }
 
-        primitive.DrawGeometry(ctx, mVertexLayout);
+        if (!success)
+        {
+            if (load.isCancelled)
+                error = L"cancelled";
+            else if (error.empty())
+                error = L"unknown error";
+            Log::Error(L"%sFailed to load %s in the background: %s!",
+                       load.logPrefix.c_str(), name.c_str(), error.c_str());
+            load.failedJobCount++;
+        }
     }
 
-    // Children
-    for (auto &child : node.mChildren)
-        RenderNode(ctx, child, worldMtrx);
-}
-
-bool Scene::GetAmbientColor(float(&rgba)[4])
-{
-    rgba[0] = mAmbientLight.luminance.x;
-    rgba[1] = mAmbientLight.luminance.y;
-    rgba[2] = mAmbientLight.luminance.z;
-    rgba[3] = mAmbientLight.luminance.w;
-    return true;
-}
-
-
-ScenePrimitive::ScenePrimitive()
-{}
+    if (uploadedJobCount > 0)
+        UpdateMemoryUsage();
 
-ScenePrimitive::ScenePrimitive(const ScenePrimitive &src) :
-    mVertices(src.mVertices),
-    mIndices(src.mIndices),
-    mTopology(src.mTopology),
-    mIsTangentPresent(src.mIsTangentPresent),
-    mVertexBuffer(src.mVertexBuffer),
-    mIndexBuffer(src.mIndexBuffer),
-    mMaterialIdx(src.mMaterialIdx)
-{
-    // We are creating new references of device resources
-    Utils::SafeAddRef(mVertexBuffer);
-    Utils::SafeAddRef(mIndexBuffer);
-}
+    if (load.pendingJobCount > 0)
+        return;
 
-ScenePrimitive::ScenePrimitive(ScenePrimitive &&src) :
-    mVertices(std::move(src.mVertices)),
-    mIndices(std::move(src.mIndices)),
-    mIsTangentPresent(Utils::Exchange(src.mIsTangentPresent, false)),
-    mTopology(Utils::Exchange(src.mTopology, D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED)),
-    mVertexBuffer(Utils::Exchange(src.mVertexBuffer, nullptr)),
-    mIndexBuffer(Utils::Exchange(src.mIndexBuffer, nullptr)),
-    mMaterialIdx(Utils::Exchange(src.mMaterialIdx, -1))
-{}
+    // Everything is on the device now
+    LogMeshOptimizationStats(load.primitiveJobs, load.logPrefix);
 
-ScenePrimitive& ScenePrimitive::operator =(const ScenePrimitive &src)
-{
-    mVertices = src.mVertices;
-    mIndices = src.mIndices;
-    mIsTangentPresent = src.mIsTangentPresent;
-    mTopology = src.mTopology;
-    mVertexBuffer = src.mVertexBuffer;
-    mIndexBuffer = src.mIndexBuffer;
+    if (load.failedJobCount == 0)
+    {
+        for (uint32_t node = 0; node < mSceneGraph.GetNodeCount(); node++)
+            NodeTangentSanityTest(node);
+        if (mLoadOptions.useSceneCache)
+            SaveSceneCache(*load.model, load.sourcePath, load.logPrefix);
+    }
 
-    // We are creating new references of device resources
-    Utils::SafeAddRef(mVertexBuffer);
-    Utils::SafeAddRef(mIndexBuffer);
+    Log::Info(L"%sBackground loading finished after %llu frame(s) and %.1f ms, %d job(s) failed",
+              load.logPrefix.c_str(),
+              (unsigned long long)load.frameCount,
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load.startTime).count(),
+              load.failedJobCount);
 
-    mMaterialIdx = src.mMaterialIdx;
+    mMemoryTracker.SetAssetSize(MemoryCategory::kGltfData, Utils::WstringToString(load.sourcePath), 0);
+    mMemoryTracker.ClearCategory(MemoryCategory::kImages);
 
-    return *this;
+    mAsyncLoad.reset();
 }
 
-ScenePrimitive& ScenePrimitive::operator =(ScenePrimitive &&src)
+
+void Scene::CancelAsyncLoad()
 {
-    mVertices = std::move(src.mVertices);
-    mIndices = std::move(src.mIndices);
-    mIsTangentPresent = Utils::Exchange(src.mIsTangentPresent, false);
-    mTopology = Utils::Exchange(src.mTopology, D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED);
-    mVertexBuffer = Utils::Exchange(src.mVertexBuffer, nullptr);
-    mIndexBuffer = Utils::Exchange(src.mIndexBuffer, nullptr);
+    if (!mAsyncLoad)
+        return;
 
-    mMaterialIdx = Utils::Exchange(src.mMaterialIdx, -1);
+    // Queued jobs just finish as failed; the pool waits for the running ones when destroyed
+    mAsyncLoad->isCancelled = true;
+    const auto sourcePath = mAsyncLoad->sourcePath;
+    mAsyncLoad.reset();
 
-    return *this;
+    mMemoryTracker.SetAssetSize(MemoryCategory::kGltfData, Utils::WstringToString(sourcePath), 0);
+    mMemoryTracker.ClearCategory(MemoryCategory::kImages);
 }
 
-ScenePrimitive::~ScenePrimitive()
-{
-    Destroy();
-}
 
-
-bool ScenePrimitive::CreateQuad(IRenderingContext & ctx)
+ScenePrimitive* Scene::CreateEmptyPrimitive(uint32_t node)
 {
-    if (!GenerateQuadGeometry())
-        return false;
-    if (!CreateDeviceBuffers(ctx))
-        return false;
+    mSceneGraph.SetMeshIdx(node, (int)mMeshes.size());
+    mMeshes.emplace_back();
+    mMeshes.back().primitives.resize(1);
 
-    return true;
+    return &mMeshes.back().primitives[0];
 }
 
 
-bool ScenePrimitive::CreateCube(IRenderingContext & ctx)
+const std::vector<ScenePrimitive>& Scene::GetNodePrimitives(uint32_t node) const
 {
-    if (!GenerateCubeGeometry())
-        return false;
-    if (!CreateDeviceBuffers(ctx))
-        return false;
+    static const std::vector<ScenePrimitive> noPrimitives;
 
-    return true;
+    const int idx = mSceneGraph.GetMeshIdx(node);
+
+    if (idx >= 0 && idx < mMeshes.size())
+        return mMeshes[idx].primitives;
+    else
+        return noPrimitives;
 }
 
 
-bool ScenePrimitive::CreateOctahedron(IRenderingContext & ctx)
+const SceneMaterial& Scene::GetMaterial(const ScenePrimitive &primitive) const
 {
-    if (!GenerateOctahedronGeometry())
-        return false;
-    if (!CreateDeviceBuffers(ctx))
-        return false;
+    const int idx = primitive.GetMaterialIdx();
 
-    return true;
+    if (idx >= 0 && idx < mMaterials.size())
+        return mMaterials[idx];
+    else
+        return mDefaultMaterial;
 }
 
 
-bool ScenePrimitive::CreateSphere(IRenderingContext & ctx,
-                                  const WORD vertSegmCount,
-                                  const WORD stripCount)
+std::string Scene::GetMaterialName(size_t materialIdx, const SceneMaterial &material)
 {
-    if (!GenerateSphereGeometry(vertSegmCount, stripCount))
-        return false;
-    if (!CreateDeviceBuffers(ctx))
-        return false;
-
-    return true;
+    std::string name = "material " + std::to_string(materialIdx);
+    if (!material.GetName().empty())
+        name += " (" + material.GetName() + ")";
+    return name;
 }
 
 
-bool ScenePrimitive::GenerateQuadGeometry()
+void Scene::UpdateMemoryUsage()
 {
-    mVertices =
+    const MemoryCategory sceneCategories[] =
     {
-        SceneVertex{ XMFLOAT3(-1.0f, 0.0f, -1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3( 1.0f, 0.0f, -1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3( 1.0f, 0.0f,  1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f, 0.0f,  1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
+        MemoryCategory::kGeometry,
+        MemoryCategory::kGeometryBuffers,
+        MemoryCategory::kBaseColorTextures,
+        MemoryCategory::kMetallicRoughnessTextures,
+        MemoryCategory::kSpecularTextures,
+        MemoryCategory::kNormalTextures,
+        MemoryCategory::kOcclusionTextures,
+        MemoryCategory::kEmissionTextures,
+        MemoryCategory::kConstantBuffers,
     };
-    
-    mIndices =
-    {
-        3, 1, 0,
-        2, 1, 3,
-    };
-
-    mTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-    CalculateTangentsIfNeeded();
+    for (const auto category : sceneCategories)
+        mMemoryTracker.ClearCategory(category);
 
-    return true;
-}
-
-
-bool ScenePrimitive::GenerateCubeGeometry()
-{
-    mVertices =
+    auto addPrimitive = [this](const std::string &name, const ScenePrimitive &primitive)
     {
-        // Up
-        SceneVertex{ XMFLOAT3(-1.0f, 1.0f, -1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, 1.0f, -1.0f),   XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, 1.0f,  1.0f),   XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f, 1.0f,  1.0f),  XMFLOAT3(0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
-
-        // Down
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f, -1.0f),  XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f,  1.0f),  XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f,  1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
-
-        // Side 1
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f,  1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f,  1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f,  1.0f,  1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
-
-        // Side 3
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f,  1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f,  1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(1.0f,  1.0f,  1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
+        // Geometry of primitives still being loaded is written by background jobs
+        if (!primitive.IsUploaded())
+            return;
 
-        // Side 2
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f, -1.0f),  XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f,  1.0f, -1.0f),  XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f,  1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
-
-        // Side 4
-        SceneVertex{ XMFLOAT3(-1.0f, -1.0f, 1.0f),  XMFLOAT3(0.0f, 0.0f, 1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f, -1.0f, 1.0f),   XMFLOAT3(0.0f, 0.0f, 1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 0.0f) },
-        SceneVertex{ XMFLOAT3(1.0f,  1.0f, 1.0f),   XMFLOAT3(0.0f, 0.0f, 1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-        SceneVertex{ XMFLOAT3(-1.0f,  1.0f, 1.0f),  XMFLOAT3(0.0f, 0.0f, 1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 1.0f) },
+        const auto &geometry = primitive.GetGeometry();
+        mMemoryTracker.SetAssetSize(MemoryCategory::kGeometry, name, geometry.GetSize());
+        mMemoryTracker.SetAssetSize(MemoryCategory::kGeometryBuffers, name, primitive.GetDeviceBufferSize());
     };
-
-    mIndices =
+    for (size_t meshIdx = 0; meshIdx < mMeshes.size(); ++meshIdx)
     {
-        // Up
-        3, 1, 0,
-        2, 1, 3,
-
-        // Down
-        6, 4, 5,
-        7, 4, 6,
-
-        // Side 1
-        11, 9, 8,
-        10, 9, 11,
-
-        // Side 3
-        14, 12, 13,
-        15, 12, 14,
-
-        // Side 2
-        19, 17, 16,
-        18, 17, 19,
+        const auto &primitives = mMeshes[meshIdx].primitives;
+        for (size_t i = 0; i < primitives.size(); ++i)
+            addPrimitive("mesh " + std::to_string(meshIdx) + " primitive " + std::to_string(i), primitives[i]);
+    }
+    addPrimitive("point light proxy", mPointLightProxy);
 
-        // Side 4
-        22, 20, 21,
-        23, 20, 22
+    // Device textures used by more materials (or roles) are accounted just once
+    std::set<const IDeviceTexture*> accountedTextures;
+    auto addMaterial = [this, &accountedTextures](const std::string &name, const SceneMaterial &material)
+    {
+        const SceneTexture *textures[SceneMaterial::kTextureCount];
+        material.GetTextures(textures);
+        for (size_t i = 0; i < SceneMaterial::kTextureCount; ++i)
+        {
+            const auto texture = textures[i]->srv;
+            if (!texture || !accountedTextures.insert(texture).second)
+                continue;
+            const auto category = (MemoryCategory)((size_t)MemoryCategory::kBaseColorTextures + i);
+            mMemoryTracker.SetAssetSize(category, name, texture->GetByteSize());
+        }
     };
+    for (size_t matIdx = 0; matIdx < mMaterials.size(); ++matIdx)
+        addMaterial(GetMaterialName(matIdx, mMaterials[matIdx]), mMaterials[matIdx]);
+    addMaterial("default material", mDefaultMaterial);
 
-    mTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-    CalculateTangentsIfNeeded();
-
-    return true;
+    const std::pair<const char*, IDeviceBuffer*> constantBuffers[] =
+    {
+        { "scene",      mCbScene },
+        { "frame",      mCbFrame },
+        { "node",       mCbSceneNode },
+        { "primitive",  mCbScenePrimitive },
+    };
+    for (const auto &buffer : constantBuffers)
+        if (buffer.second)
+            mMemoryTracker.SetAssetSize(MemoryCategory::kConstantBuffers, buffer.first, buffer.second->GetByteSize());
 }
 
 
-bool ScenePrimitive::GenerateOctahedronGeometry()
+void Scene::LogMemoryReport(size_t largestAssetCount) const
 {
-    mVertices =
-    {
-        // Noth pole
-        SceneVertex{ XMFLOAT3( 0.0f, 1.0f, 0.0f),  XMFLOAT3( 0.0f, 1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.0f, 0.0f) },
+    const std::wstring logPrefix = L"Scene: ";
 
-        // Points on equator
-        SceneVertex{ XMFLOAT3( 1.0f, 0.0f, 0.0f),  XMFLOAT3( 1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.00f, 0.5f) },
-        SceneVertex{ XMFLOAT3( 0.0f, 0.0f, 1.0f),  XMFLOAT3( 0.0f, 0.0f, 1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.25f, 0.5f) },
-        SceneVertex{ XMFLOAT3(-1.0f, 0.0f, 0.0f),  XMFLOAT3(-1.0f, 0.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.50f, 0.5f) },
-        SceneVertex{ XMFLOAT3( 0.0f, 0.0f,-1.0f),  XMFLOAT3( 0.0f, 0.0f,-1.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(0.75f, 0.5f) },
+    mMemoryTracker.LogReport(logPrefix, largestAssetCount);
 
-        // South pole
-        SceneVertex{ XMFLOAT3( 0.0f,-1.0f, 0.0f),  XMFLOAT3( 0.0f,-1.0f, 0.0f),  XMFLOAT4(0,0,0,0), XMFLOAT2(1.0f, 1.0f) },
-    };
-
-    mIndices =
+    // Textures shared by more materials count for each of them here
+    for (size_t matIdx = 0; matIdx < mMaterials.size(); ++matIdx)
     {
-        // Band ++
-        0, 2, 1,
-        1, 2, 5,
-
-        // Band -+
-        0, 3, 2,
-        2, 3, 5,
-
-        // Band --
-        0, 4, 3,
-        3, 4, 5,
-
-        // Band +-
-        0, 1, 4,
-        4, 1, 5,
-    };
-
-    mTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        const auto &material = mMaterials[matIdx];
+        const SceneTexture *textures[SceneMaterial::kTextureCount];
+        material.GetTextures(textures);
 
-    CalculateTangentsIfNeeded();
+        size_t textureSize = 0;
+        for (const auto texture : textures)
+            if (texture->srv)
+                textureSize += texture->srv->GetByteSize();
 
-    return true;
+        Log::Info(L"%s   Textures of %s: %llu KB",
+                  logPrefix.c_str(),
+                  Utils::StringToWstring(GetMaterialName(matIdx, material)).c_str(),
+                  (unsigned long long)textureSize >> 10);
+    }
 }
 
 
-bool ScenePrimitive::GenerateSphereGeometry(const WORD vertSegmCount, const WORD stripCount)
+void Scene::Destroy()
 {
-    if (vertSegmCount < 2)
-    {
-        Log::Error(L"Spherical stripe must have at least 2 vertical segments");
-        return false;
-    }
-    if (stripCount < 3)
-    {
-        Log::Error(L"Sphere must have at least 3 stripes");
-        return false;
-    }
-
-    const WORD horzLineCount = vertSegmCount - 1;
-    const WORD vertexCountPerStrip = 2 /*poles*/ + horzLineCount;
-    const WORD vertexCount = (stripCount + 1) * vertexCountPerStrip;
-    const WORD indexCount  = stripCount * (2 /*poles*/ + 2 * horzLineCount + 1 /*strip restart*/);
-
-    // Vertices
-    mVertices.reserve(vertexCount);
-    const float stripSizeAng = XM_2PI / stripCount;
-    const float stripSizeRel =    1.f / stripCount;
-    const float vertSegmSizeAng = XM_PI / vertSegmCount;
-    const float vertSegmSizeRel =   1.f / vertSegmCount;
-    for (WORD strip = 0; strip <= stripCount; strip++) // first and last vertices need to be replicated due to texture stitching
-    {
-        // Inner segments
-        const float phi = strip * stripSizeAng;
-        const float xBase = cos(phi);
-        const float zBase = sin(phi);
-        const float uLine = strip * stripSizeRel * 1.000001f;
-        for (WORD line = 0; line < horzLineCount; line++)
-        {
-            const float theta = (line + 1) * vertSegmSizeAng;
-            const float ringRadius = sin(theta);
-            const float y = cos(theta);
-            const XMFLOAT3 pt(xBase * ringRadius, y, zBase * ringRadius);
-            const float v = (line + 1) * vertSegmSizeRel;
-            mVertices.push_back(SceneVertex{ pt, pt,  XMFLOAT4(0,0,0,0), XMFLOAT2(uLine, v) }); // position==normal
-        }
+    // Background jobs use the scene data
+    CancelAsyncLoad();
 
-        // Poles
-        const XMFLOAT3 northPole(0.0f,  1.0f, 0.0f);
-        const XMFLOAT3 southPole(0.0f, -1.0f, 0.0f);
-        const float uPole = uLine + stripSizeRel / 2;
-        mVertices.push_back(SceneVertex{ northPole,  northPole,  XMFLOAT4(0,0,0,0), XMFLOAT2(uPole, 0.0f) }); // position==normal
-        mVertices.push_back(SceneVertex{ southPole,  southPole,  XMFLOAT4(0,0,0,0), XMFLOAT2(uPole, 1.0f) }); // position==normal
-    }
-
-    assert(mVertices.size() == vertexCount);
+    Utils::ReleaseAndMakeNull(mVertexShader);
+    Utils::ReleaseAndMakeNull(mVsCompact);
+    Utils::ReleaseAndMakeNull(mVsQuantized);
 
-    // Indices
-    mIndices.reserve(indexCount);
-    for (WORD strip = 0; strip < stripCount; strip++)
-    {
-        const WORD idxOffset = strip * vertexCountPerStrip;
-        mIndices.push_back(idxOffset + vertexCountPerStrip - 2); // north pole
-        for (WORD line = 0; line < horzLineCount; line++)
-        {
-            mIndices.push_back((idxOffset + line + vertexCountPerStrip) % vertexCount); // next strip, same line
-            mIndices.push_back( idxOffset + line);
-        }
-        mIndices.push_back(idxOffset + vertexCountPerStrip - 1); // south pole
-        mIndices.push_back(STRIP_BREAK);
-    }
+    Utils::ReleaseAndMakeNull(mPsPbrMetalness);
+    Utils::ReleaseAndMakeNull(mPsPbrSpecularity);
+    Utils::ReleaseAndMakeNull(mPsConstEmmisive);
 
-    assert(mIndices.size() == indexCount);
+    Utils::ReleaseAndMakeNull(mCbScene);
+    Utils::ReleaseAndMakeNull(mCbFrame);
+    Utils::ReleaseAndMakeNull(mCbSceneNode);
+    Utils::ReleaseAndMakeNull(mCbScenePrimitive);
 
-    mTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
-    //mTopology = D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP; // debug
+    Utils::ReleaseAndMakeNull(mSamplerLinear);
 
-    CalculateTangentsIfNeeded();
+    mSceneGraph.Clear();
+    mRootMtrx = MatrixIdentity();
+    mAnimationMtrx = MatrixIdentity();
+    mNodeCbWorldMatrices.clear();
+    mNodeCbWorldVersions.clear();
+    mNodeCbGraphVersion = 0;
+    mMeshes.clear();
+    mPointLightProxy.Destroy();
 
-    Log::Debug(L"ScenePrimitive::GenerateSphereGeometry: "
-               L"%d segments, %d strips => %d triangles, %d vertices, %d indices",
-               vertSegmCount, stripCount,
-               stripCount * (2 * horzLineCount),
-               vertexCount, indexCount);
+    // Textures shared with other scenes stay in their cache
+    mOwnTextureCache.Clear();
 
-    return true;
+    // Peak values are kept for reports
+    mMemoryTracker.Clear();
 }
 
 
-bool ScenePrimitive::LoadFromGLTF(IRenderingContext & ctx,
-                                  const tinygltf::Model &model,
-                                  const tinygltf::Mesh &mesh,
-                                  const int primitiveIdx,
-                                  const std::wstring &logPrefix)
+void Scene::AnimateFrame(IRenderingContext &ctx)
 {
-    if (!LoadDataFromGLTF(model, mesh, primitiveIdx, logPrefix))
-        return false;
-    if (!CreateDeviceBuffers(ctx))
-        return false;
-
-    return true;
-}
+    if (!ctx.IsValid())
+        return;
 
+    ContinueAsyncLoad(ctx);
 
-bool ScenePrimitive::LoadDataFromGLTF(const tinygltf::Model &model,
-                                      const tinygltf::Mesh &mesh,
-                                      const int primitiveIdx,
-                                      const std::wstring &logPrefix)
-{
-    bool success = false;
-    const auto &primitive = mesh.primitives[primitiveIdx];
-    const auto &attrs = primitive.attributes;
-    const auto subItemsLogPrefix = logPrefix + L"   ";
-    const auto dataConsumerLogPrefix = subItemsLogPrefix + L"   ";
-
-    Log::Debug(L"%sPrimitive %d/%d: mode %s, attributes [%s], indices %d, material %d",
-               logPrefix.c_str(),
-               primitiveIdx,
-               mesh.primitives.size(),
-               GltfUtils::ModeToWstring(primitive.mode).c_str(),
-               GltfUtils::StringIntMapToWstring(primitive.attributes).c_str(),
-               primitive.indices,
-               primitive.material);
-
-    // Positions
-
-    auto &posAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
-                                                 true, "POSITION", subItemsLogPrefix.c_str());
-    if (!success)
-        return false;
+    // debug: Materials
+    for (auto &material : mMaterials)
+        material.Animate(ctx);
 
-    if ((posAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) ||
-        (posAccessor.type != TINYGLTF_TYPE_VEC3))
+    // Scene geometry: nodes are static, so just the ones changed since the last frame are updated,
+    // while the whole scene rotates around the vertical axis. The rotation is a part of the view, so the
+    // camera and lights, which stay in place, are transformed into the scene space by its inverse.
+    mUpdatedNodeCount += mSceneGraph.UpdateWorldMatrices(mRootMtrx);
     {
-        Log::Error(L"%sUnsupported POSITION data type!", subItemsLogPrefix.c_str());
-        return false;
-    }
+        const float time = ctx.GetFrameAnimationTime();
+        const float period = 15.f; //seconds
+        const float totalAnimPos = time / period;
+        const float angle = totalAnimPos * k2Pi;
 
-    mVertices.clear();
-    mVertices.reserve(posAccessor.count);
-    if (mVertices.capacity() < posAccessor.count)
-    {
-        Log::Error(L"%sUnable to allocate %d vertices!", subItemsLogPrefix.c_str(), posAccessor.count);
-        mVertices.clear();
-        return false;
+        mAnimationMtrx = MatrixRotationY(angle);
     }
+    const Matrix worldToSceneMtrx = MatrixTranspose(mAnimationMtrx);
 
-    auto PositionDataConsumer = [this, &dataConsumerLogPrefix](int itemIdx, const unsigned char *ptr)
+    // Directional lights (are steady for now)
+    for (auto &dirLight : mDirectLights)
     {
-        auto pos = *reinterpret_cast<const XMFLOAT3*>(ptr);
-
-        itemIdx; // unused param
-        //Log::Debug(L"%s%d: pos [%.4f, %.4f, %.4f]",
-        //           dataConsumerLogPrefix.c_str(),
-        //           itemIdx,
-        //           pos.x, pos.y, pos.z);
+        dirLight.dirTransf = Vector3Transform(dirLight.dir, worldToSceneMtrx);
+        dirLight.dirTransf.w = dirLight.dir.w;
+    }
 
-        mVertices.push_back(SceneVertex{ XMFLOAT3(pos.x, pos.y, pos.z),
-                                         XMFLOAT3(0.0f, 0.0f, 1.0f), // TODO: Leave invalid?
-                                         XMFLOAT4(1.0f, 0.5f, 0.0f, 1.0f),  // debug; TODO: Leave invalid?
-                                         XMFLOAT2(0.0f, 0.0f) });
-    };
+    // Animate point lights (harwired animation for now)
 
-    if (!IterateGltfAccesorData<float, 3>(model,
-                                          posAccessor,
-                                          PositionDataConsumer,
-                                          subItemsLogPrefix.c_str(),
-                                          L"Position"))
-        return false;
+    const float time = ctx.GetFrameAnimationTime();
+    const float period = 15.f; //seconds
+    const float totalAnimPos = time / period;
+    const float angle = totalAnimPos * k2Pi;
 
-    // Normals
-    auto &normalAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
-                                                    false, "NORMAL", subItemsLogPrefix.c_str());
-    if (success)
+    const auto pointCount = mPointLights.size();
+    for (int i = 0; i < pointCount; i++)
     {
-        if ((normalAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) ||
-            (normalAccessor.type != TINYGLTF_TYPE_VEC3))
-        {
-            Log::Error(L"%sUnsupported NORMAL data type!", subItemsLogPrefix.c_str());
-            return false;
-        }
-
-        if (normalAccessor.count != posAccessor.count)
-        {
-            Log::Error(L"%sNormals count (%d) is different from position count (%d)!",
-                       subItemsLogPrefix.c_str(), normalAccessor.count, posAccessor.count);
-            return false;
-        }
-
-        auto NormalDataConsumer = [this, &dataConsumerLogPrefix](int itemIdx, const unsigned char *ptr)
-        {
-            auto normal = *reinterpret_cast<const XMFLOAT3*>(ptr);
+        const float lightRelOffsetCircular = (float)i / pointCount;
+        const float lightRelOffsetInterval = (float)i / (pointCount - 1);
 
-            //Log::Debug(L"%s%d: normal [%.4f, %.4f, %.4f]",
-            //           dataConsumerLogPrefix.c_str(),
-            //           itemIdx, normal.x, normal.y, normal.z);
+        const float rotationAngle = -2.f * angle - lightRelOffsetCircular * k2Pi;
+        const float orbitInclination = Utils::Lerp(mPointLights[i].orbitInclinationMin,
+                                                   mPointLights[i].orbitInclinationMax,
+                                                   lightRelOffsetInterval);
 
-            mVertices[itemIdx].Normal = normal;
-        };
+        const Matrix translationMtrx  = MatrixTranslation(mPointLights[i].orbitRadius, 0.f, 0.f);
+        const Matrix rotationMtrx     = MatrixRotationY(rotationAngle);
+        const Matrix inclinationMtrx  = MatrixRotationZ(orbitInclination);
+        const Matrix transfMtrx = translationMtrx * rotationMtrx * inclinationMtrx * worldToSceneMtrx;
 
-        if (!IterateGltfAccesorData<float, 3>(model,
-                                              normalAccessor,
-                                              NormalDataConsumer,
-                                              subItemsLogPrefix.c_str(),
-                                              L"Normal"))
-            return false;
+        const Float4 basePos{ 0.f, 0.f, 0.f, 0.f };
+        mPointLights[i].posTransf = Vector3Transform(basePos, transfMtrx);
     }
-    //else
-    //{
-    //    // No normals provided
-    //    // TODO: Generate?
-    //}
-
-    // Tangents
-    auto &tangentAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
-                                                     false, "TANGENT", subItemsLogPrefix.c_str());
-    if (success)
-    {
-        if ((tangentAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) ||
-            (tangentAccessor.type != TINYGLTF_TYPE_VEC4))
-        {
-            Log::Error(L"%sUnsupported TANGENT data type!", subItemsLogPrefix.c_str());
-            return false;
-        }
-
-        if (tangentAccessor.count != posAccessor.count)
-        {
-            Log::Error(L"%sTangents count (%d) is different from position count (%d)!",
-                       subItemsLogPrefix.c_str(), tangentAccessor.count, posAccessor.count);
-            return false;
-        }
-
-        auto TangentDataConsumer = [this, &dataConsumerLogPrefix](int itemIdx, const unsigned char *ptr)
-        {
-            auto tangent = *reinterpret_cast<const XMFLOAT4*>(ptr);
+}
 
-            //Log::Debug(L"%s%d: tangent [%7.4f, %7.4f, %7.4f] * %.1f",
-            //           dataConsumerLogPrefix.c_str(), itemIdx,
-            //           tangent.x, tangent.y, tangent.z, tangent.w);
 
-            if ((tangent.w != 1.f) && (tangent.w != -1.f))
-                Log::Warning(L"%s%d: tangent w component (handedness) is not equal to 1 or -1 but to %7.4f",
-                           dataConsumerLogPrefix.c_str(), itemIdx, tangent.w);
+void Scene::RenderFrame(IRenderingContext &ctx)
+{
+    if (!ctx.IsValid())
+        return;
 
-            mVertices[itemIdx].Tangent = tangent;
-        };
+    if (mPointLights.size() > POINT_LIGHTS_MAX_COUNT)
+        return;
+    if (mDirectLights.size() > DIRECT_LIGHTS_MAX_COUNT)
+        return;
 
-        if (!IterateGltfAccesorData<float, 4>(model,
-                                              tangentAccessor,
-                                              TangentDataConsumer,
-                                              subItemsLogPrefix.c_str(),
-                                              L"Tangent"))
-            return false;
+    // Scene constant buffer: the scene rotation is a part of the view (see AnimateFrame())
+    CbScene cbScene;
+    cbScene.ViewMtrx = MatrixTranspose(mAnimationMtrx * mViewMtrx);
+    cbScene.CameraPos = Vector3Transform(mViewData.eye, MatrixTranspose(mAnimationMtrx));
+    cbScene.ProjectionMtrx = MatrixTranspose(mProjectionMtrx);
+    ctx.UpdateConstantBuffer(mCbScene, &cbScene);
 
-        mIsTangentPresent = true;
+    // Frame constant buffer
+    CbFrame cbFrame;
+    cbFrame.AmbientLightLuminance = mAmbientLight.luminance;
+    cbFrame.DirectLightsCount = (int32_t)mDirectLights.size();
+    for (int i = 0; i < cbFrame.DirectLightsCount; i++)
+    {
+        cbFrame.DirectLightDirs[i]       = mDirectLights[i].dirTransf;
+        cbFrame.DirectLightLuminances[i] = mDirectLights[i].luminance;
     }
-    else
+    cbFrame.PointLightsCount = (int32_t)mPointLights.size();
+    for (int i = 0; i < cbFrame.PointLightsCount; i++)
     {
-        Log::Debug(L"%sTangents are not present", subItemsLogPrefix.c_str());
+        cbFrame.PointLightPositions[i]   = mPointLights[i].posTransf;
+        cbFrame.PointLightIntensities[i] = mPointLights[i].intensity;
     }
+    ctx.UpdateConstantBuffer(mCbFrame, &cbFrame);
 
-    // Texture coordinates
-    auto &texCoord0Accessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
-                                                       false, "TEXCOORD_0", subItemsLogPrefix.c_str());
-    if (success)
-    {
-        if ((texCoord0Accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) ||
-            (texCoord0Accessor.type != TINYGLTF_TYPE_VEC2))
-        {
-            Log::Error(L"%sUnsupported TEXCOORD_0 data type!", subItemsLogPrefix.c_str());
-            return false;
-        }
+    // Setup vertex shader data (shader itself is chosen later for each primitive)
+    mCurrentVertexShader = nullptr;
+    ctx.VSSetConstantBuffer(0, mCbScene);
+    ctx.VSSetConstantBuffer(1, mCbFrame);
+    ctx.VSSetConstantBuffer(2, mCbSceneNode);
 
-        if (texCoord0Accessor.count != posAccessor.count)
-        {
-            Log::Error(L"%sTexture coords count (%d) is different from position count (%d)!",
-                       subItemsLogPrefix.c_str(), texCoord0Accessor.count, posAccessor.count);
-            return false;
-        }
+    // Setup pixel shader data (shader itself is chosen later for each material)
+    ctx.PSSetConstantBuffer(0, mCbScene);
+    ctx.PSSetConstantBuffer(1, mCbFrame);
+    ctx.PSSetConstantBuffer(2, mCbSceneNode);
+    ctx.PSSetConstantBuffer(3, mCbScenePrimitive);
+    ctx.PSSetSampler(0, mSamplerLinear);
+
+    // Scene geometry; nodes are stored in depth-first order
+    UpdateNodeCbWorldMatrices();
+    for (uint32_t node = 0; node < mSceneGraph.GetNodeCount(); node++)
+        if (mSceneGraph.GetMeshIdx(node) >= 0)
+            RenderNode(ctx, node);
 
-        auto TexCoord0DataConsumer = [this, &dataConsumerLogPrefix](int itemIdx, const unsigned char *ptr)
-        {
-            auto texCoord0 = *reinterpret_cast<const XMFLOAT2*>(ptr);
+    // Proxy geometry for point lights
+    for (int i = 0; i < mPointLights.size(); i++)
+    {
+        CbSceneNode cbSceneNode;
 
-            //Log::Debug(L"%s%d: texCoord0 [%.1f, %.1f]",
-            //           dataConsumerLogPrefix.c_str(), itemIdx, texCoord0.x, texCoord0.y);
+        const float radius = 0.07f;
+        Matrix lightScaleMtrx = MatrixScaling(radius, radius, radius);
+        Matrix lightTrnslMtrx = MatrixTranslationFromVector(mPointLights[i].posTransf);
+        Matrix lightMtrx = lightScaleMtrx * lightTrnslMtrx;
+        cbSceneNode.WorldMtrx = MatrixTranspose(lightMtrx);
 
-            mVertices[itemIdx].Tex = texCoord0;
+        const float radius2 = radius * radius;
+        cbSceneNode.MeshColor = {
+            mPointLights[i].intensity.x / radius2,
+            mPointLights[i].intensity.y / radius2,
+            mPointLights[i].intensity.z / radius2,
+            mPointLights[i].intensity.w / radius2,
         };
 
-        if (!IterateGltfAccesorData<float, 2>(model,
-                                              texCoord0Accessor,
-                                              TexCoord0DataConsumer,
-                                              subItemsLogPrefix.c_str(),
-                                              L"Texture coordinates"))
-            return false;
+        ctx.UpdateConstantBuffer(mCbSceneNode, &cbSceneNode);
+
+        SetVertexShader(ctx, mPointLightProxy.GetVertexFormat());
+        ctx.PSSetShader(mPsConstEmmisive);
+        mPointLightProxy.DrawGeometry(ctx);
     }
+}
 
-    // Indices
 
-    const auto indicesAccessorIdx = primitive.indices;
-    if (indicesAccessorIdx >= model.accessors.size())
-    {
-        Log::Error(L"%sInvalid indices accessor index (%d/%d)!",
-                   subItemsLogPrefix.c_str(), indicesAccessorIdx, model.accessors.size());
-        return false;
-    }
-    if (indicesAccessorIdx < 0)
-    {
-        Log::Error(L"%sNon-indexed geometry is not supported!", subItemsLogPrefix.c_str());
-        return false;
-    }
+void Scene::SetupDefaultLights()
+{
+    const uint8_t amb = 120;
+    mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
 
-    const auto &indicesAccessor = model.accessors[indicesAccessorIdx];
+    const float lum = 3.0f;
+    mDirectLights.resize(1);
+    mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+    mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
 
-    if (indicesAccessor.type != TINYGLTF_TYPE_SCALAR)
-    {
-        Log::Error(L"%sUnsupported indices data type (must be scalar)!", subItemsLogPrefix.c_str());
-        return false;
-    }
-    if ((indicesAccessor.componentType < TINYGLTF_COMPONENT_TYPE_BYTE) ||
-        (indicesAccessor.componentType > TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT))
+    SetupPointLights(3);
+}
+
+
+bool Scene::SetupPointLights(size_t count,
+                             float intensity,
+                             float orbitRadius,
+                             float orbitInclMin,
+                             float orbitInclMax)
+{
+    if (count > POINT_LIGHTS_MAX_COUNT)
     {
-        Log::Error(L"%sUnsupported indices data component type (%d)!",
-                   subItemsLogPrefix.c_str(), indicesAccessor.componentType);
+        Log::Error(L"SetupPointLights: requested number of point lights (%d) exceeds the limit (%d)", count, POINT_LIGHTS_MAX_COUNT);
         return false;
     }
 
-    mIndices.clear();
-    mIndices.reserve(indicesAccessor.count);
-    if (mIndices.capacity() < indicesAccessor.count)
+    mPointLights.resize(count);
+
+    for (auto &light : mPointLights)
     {
-        Log::Error(L"%sUnable to allocate %d indices!", subItemsLogPrefix.c_str(), indicesAccessor.count);
-        return false;
+        light.intensity = Float4(intensity, intensity, intensity, 1.0f);
+        light.orbitRadius = orbitRadius;
+        light.orbitInclinationMin = orbitInclMin;
+        light.orbitInclinationMax = orbitInclMax;
     }
 
-    const auto indicesComponentType = indicesAccessor.componentType;
-    auto IndexDataConsumer =
-        [this, &dataConsumerLogPrefix, indicesComponentType]
-        (int itemIdx, const unsigned char *ptr)
-    {
-        switch (indicesComponentType)
-        {
-        case TINYGLTF_COMPONENT_TYPE_BYTE:              mIndices.push_back(*reinterpret_cast<const int8_t*>(ptr)); break;
-        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:     mIndices.push_back(*reinterpret_cast<const uint8_t*>(ptr)); break;
-        case TINYGLTF_COMPONENT_TYPE_SHORT:             mIndices.push_back(*reinterpret_cast<const int16_t*>(ptr)); break;
-        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:    mIndices.push_back(*reinterpret_cast<const uint16_t*>(ptr)); break;
-        case TINYGLTF_COMPONENT_TYPE_INT:               mIndices.push_back(*reinterpret_cast<const int32_t*>(ptr)); break;
-        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:      mIndices.push_back(*reinterpret_cast<const uint32_t*>(ptr)); break;
-        }
+    return true;
+}
 
-        // debug
-        itemIdx; // unused param
-        //Log::Debug(L"%s%d: %d",
-        //           dataConsumerLogPrefix.c_str(),
-        //           itemIdx,
-        //           mIndices.back());
-    };
 
-    // TODO: Wrap into IterateGltfAccesorData(componentType, ...)? std::forward()?
-    switch (indicesComponentType)
-    {
-    case TINYGLTF_COMPONENT_TYPE_BYTE:
-        IterateGltfAccesorData<const int8_t, 1>(model,
-                                                indicesAccessor,
-                                                IndexDataConsumer,
-                                                subItemsLogPrefix.c_str(),
-                                                L"Indices");
-        break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-        IterateGltfAccesorData<uint8_t, 1>(model,
-                                           indicesAccessor,
-                                           IndexDataConsumer,
-                                           subItemsLogPrefix.c_str(),
-                                           L"Indices");
-        break;
-    case TINYGLTF_COMPONENT_TYPE_SHORT:
-        IterateGltfAccesorData<int16_t, 1>(model,
-                                           indicesAccessor,
-                                           IndexDataConsumer,
-                                           subItemsLogPrefix.c_str(),
-                                           L"Indices");
-        break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-        IterateGltfAccesorData<uint16_t, 1>(model,
-                                            indicesAccessor,
-                                            IndexDataConsumer,
-                                            subItemsLogPrefix.c_str(),
-                                            L"Indices");
-        break;
-    case TINYGLTF_COMPONENT_TYPE_INT:
-        IterateGltfAccesorData<int32_t, 1>(model,
-                                           indicesAccessor,
-                                           IndexDataConsumer,
-                                           subItemsLogPrefix.c_str(),
-                                           L"Indices");
-        break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-        IterateGltfAccesorData<uint32_t, 1>(model,
-                                            indicesAccessor,
-                                            IndexDataConsumer,
-                                            subItemsLogPrefix.c_str(),
-                                            L"Indices");
-        break;
-    }
-    if (mIndices.size() != indicesAccessor.count)
+bool Scene::SetupPointLights(const std::initializer_list<Float4> &intensities,
+                             float orbitRadius,
+                             float orbitInclMin,
+                             float orbitInclMax)
+{
+    if (intensities.size() > POINT_LIGHTS_MAX_COUNT)
     {
-        Log::Error(L"%sFailed to load indices (loaded %d instead of %d))!",
-                   subItemsLogPrefix.c_str(), mIndices.size(), indicesAccessor.count);
+        Log::Error(L"SetupPointLights: requested number of point lights (%d) exceeds the limit (%d)",
+                   intensities.size(), POINT_LIGHTS_MAX_COUNT);
         return false;
     }
 
-    // DX primitive topology
-    mTopology = GltfUtils::ModeToTopology(primitive.mode);
-    if (mTopology == D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED)
+    if (intensities.size() != intensities.size())
     {
-        Log::Error(L"%sUnsupported primitive topology!", subItemsLogPrefix.c_str());
+        Log::Error(L"SetupPointLights: provided intensities count (%d) doesn't match the light count (%d)",
+                   intensities.size(), POINT_LIGHTS_MAX_COUNT);
         return false;
     }
 
-    // Material
-    const auto matIdx = primitive.material;
-    if (matIdx >= 0)
+    mPointLights.resize(intensities.size());
+
+    auto itLight = mPointLights.begin();
+    auto itIntensity = intensities.begin();
+    for (; itLight != mPointLights.end() && itIntensity != intensities.end(); ++itLight, ++itIntensity)
     {
-        if (matIdx >= model.materials.size())
-        {
-            Log::Error(L"%sInvalid material index (%d/%d)!",
-                       subItemsLogPrefix.c_str(), matIdx, model.materials.size());
-            return false;
-        }
+        auto &light = *itLight;
 
-        mMaterialIdx = matIdx;
+        light.intensity = *itIntensity;
+        light.orbitRadius = orbitRadius;
+        light.orbitInclinationMin = orbitInclMin;
+        light.orbitInclinationMax = orbitInclMax;
     }
 
-    CalculateTangentsIfNeeded(subItemsLogPrefix);
-
     return true;
 }
 
 
-bool ScenePrimitive::CalculateTangentsIfNeeded(const std::wstring &logPrefix)
+void Scene::AddScaleToRoots(double scale)
 {
-    // TODO: if (material needs tangents && are not present) ... GetMaterial()
-    // TODO: Requires position, normal, and texcoords
-    // TODO: Only for triangles?
-    if (!IsTangentPresent())
-    {
-        Log::Debug(L"%sComputing tangents...", logPrefix.c_str());
-
-        if (!TangentCalculator::Calculate(*this))
-        {
-            Log::Error(L"%sTangents computation failed!", logPrefix.c_str());
-            return false;
-        }
-        mIsTangentPresent = true;
-    }
-
-    return true;
+    AddScaleToRoots({ scale, scale, scale });
 }
 
-size_t ScenePrimitive::GetVerticesPerFace() const
+
+void Scene::AddScaleToRoots(const std::vector<double> &vec)
 {
-    switch (mTopology)
+    if (vec.size() != 3)
     {
-    case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-        return 1;
-    case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-        return 2;
-    case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-        return 2;
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-        return 3;
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
-        return 3;
-    default:
-        return 0;
+        if (vec.size() != 0)
+            Log::Warning(L"Scene::AddScaleToRoots: vector of incorrect size (%d instead of 3)",
+                         vec.size());
+        return;
     }
+
+    mRootMtrx = mRootMtrx * MatrixScaling((float)vec[0], (float)vec[1], (float)vec[2]);
 }
 
 
-size_t ScenePrimitive::GetFacesCount() const
+void Scene::AddRotationQuaternionToRoots(const std::vector<double> &vec)
 {
-    FillFaceStripsCacheIfNeeded();
-
-    switch (mTopology)
+    if (vec.size() != 4)
     {
-    case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-        return mIndices.size() / GetVerticesPerFace();
-
-    case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
-        return mFaceStripsTotalCount;
-
-    default:
-        return 0; // Unsupported
+        if (vec.size() != 0)
+            Log::Warning(L"Scene::AddRotationQuaternionToRoots: vector of incorrect size (%d instead of 4)",
+                         vec.size());
+        return;
     }
+
+    const Float4 quaternion((float)vec[0], (float)vec[1], (float)vec[2], (float)vec[3]);
+    mRootMtrx = mRootMtrx * MatrixRotationQuaternion(quaternion);
 }
 
 
-void ScenePrimitive::FillFaceStripsCacheIfNeeded() const
+void Scene::AddTranslationToRoots(const std::vector<double> &vec)
 {
-    if (mAreFaceStripsCached)
-        return;
-
-    switch (mTopology)
-    {
-    case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+    if (vec.size() != 3)
     {
-        mFaceStrips.clear();
-
-        const auto count = mIndices.size();
-        for (size_t i = 0; i < count; )
-        {
-            // Start
-            while ((i < count) && (mIndices[i] == STRIP_BREAK))
-            {
-                ++i;
-            }
-            const size_t start = i;
-
-            // Length
-            size_t length = 0;
-            while ((i < count) && (mIndices[i] != STRIP_BREAK))
-            {
-                ++length;
-                ++i;
-            }
+        if (vec.size() != 0)
+            Log::Warning(L"Scene::AddTranslationToRoots: vector of incorrect size (%d instead of 3)",
+                         vec.size());
+        return;
+    }
 
-            // Strip
-            if (length >= GetVerticesPerFace())
-            {
-                const auto faceCount = length - (GetVerticesPerFace() - 1);
-                mFaceStrips.push_back({ start, faceCount });
-            }
-        }
+    mRootMtrx = mRootMtrx * MatrixTranslation((float)vec[0], (float)vec[1], (float)vec[2]);
+}
 
-        mFaceStripsTotalCount = 0;
-        for (const auto &strip : mFaceStrips)
-            mFaceStripsTotalCount += strip.faceCount;
 
-        mAreFaceStripsCached = true;
+void Scene::AddMatrixToRoots(const std::vector<double> &vec)
+{
+    if (vec.size() != 16)
+    {
+        if (vec.size() != 0)
+            Log::Warning(L"Scene::AddMatrixToRoots: vector of incorrect size (%d instead of 16)",
+                         vec.size());
         return;
     }
 
-    case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-    default:
-        return;
-    }
+    const auto mtrx = Matrix(
+        (float)vec[0],  (float)vec[1],  (float)vec[2],  (float)vec[3],
+        (float)vec[4],  (float)vec[5],  (float)vec[6],  (float)vec[7],
+        (float)vec[8],  (float)vec[9],  (float)vec[10], (float)vec[11],
+        (float)vec[12], (float)vec[13], (float)vec[14], (float)vec[15]);
+
+    mRootMtrx = mRootMtrx * mtrx;
 }
 
 
-const size_t ScenePrimitive::GetVertexIndex(const int face, const int vertex) const
+void Scene::UpdateNodeCbWorldMatrices()
 {
-    if (vertex >= GetVerticesPerFace())
-        return 0;
-
-    switch (mTopology)
-    {
-    case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-        return vertex;
+    // Scene graph versions only grow, so a node whose version is the same has the same world matrix
+    const size_t nodeCount = mSceneGraph.GetNodeCount();
+    if ((mNodeCbWorldVersions.size() == nodeCount) && (mNodeCbGraphVersion == mSceneGraph.GetVersion()))
+        return;
 
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+    mNodeCbWorldMatrices.resize(nodeCount, MatrixIdentity());
+    mNodeCbWorldVersions.resize(nodeCount, 0); // Identity world matrix of a node never updated
+    for (uint32_t node = 0; node < nodeCount; node++)
     {
-        const bool isOdd = (face % 2 == 1);
-
-        if (isOdd && (vertex == 1))
-            return 2;
-        else if (isOdd && (vertex == 2))
-            return 1;
-        else
-            return vertex;
-    }
+        const auto version = mSceneGraph.GetWorldVersion(node);
+        if (mNodeCbWorldVersions[node] == version)
+            continue;
 
-    default:
-        return 0; // Unsupported
+        mNodeCbWorldMatrices[node] = MatrixTranspose(mSceneGraph.GetWorldMtrx(node));
+        mNodeCbWorldVersions[node] = version;
     }
+    mNodeCbGraphVersion = mSceneGraph.GetVersion();
 }
 
 
-const SceneVertex& ScenePrimitive::GetVertex(const int face, const int vertex) const
+void Scene::RenderNode(IRenderingContext &ctx, uint32_t node)
 {
-    static const SceneVertex invalidVert{};
-
-    FillFaceStripsCacheIfNeeded();
+    if (!ctx.IsValid())
+        return;
 
-    if (vertex >= GetVerticesPerFace())
-        return invalidVert;
+    // Per-node constant buffer; it is uploaded again only for primitives with different dequantization
+    CbSceneNode cbSceneNode;
+    cbSceneNode.WorldMtrx = mNodeCbWorldMatrices[node];
+    cbSceneNode.MeshColor = { 0.f, 1.f, 0.f, 1.f, };
+    bool isCbSceneNodeUpdated = false;
 
-    switch (mTopology)
-    {
-    case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+    // Draw current node
+    for (auto &primitive : GetNodePrimitives(node))
     {
-        const auto idx = face * GetVerticesPerFace() + vertex;
-        if ((idx < 0) || (idx >= mIndices.size()))
-            return invalidVert;
-        return mVertices[mIndices[idx]];
-    }
+        // Still being loaded in the background
+        if (!primitive.IsUploaded())
+            continue;
 
-    case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
-    case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
-    {
-        if (!mAreFaceStripsCached)
-            return invalidVert;
-        if (face >= mFaceStripsTotalCount)
-            return invalidVert;
+        auto &material = GetMaterial(primitive);
 
-        // Strip
-        // (naive impl for now, could be done in log time using cumulative counts and binary search)
-        size_t strip = 0;
-        size_t skippedFaces = 0;
-        for (; strip < mFaceStrips.size(); strip++)
+        if (!isCbSceneNodeUpdated || (primitive.GetDequantization() != cbSceneNode.Dequantization))
         {
-            const auto currentFaceCount = mFaceStrips[strip].faceCount;
-            if (face < (skippedFaces + currentFaceCount))
-                break; // found
-            skippedFaces += currentFaceCount;
+            cbSceneNode.Dequantization = primitive.GetDequantization();
+            ctx.UpdateConstantBuffer(mCbSceneNode, &cbSceneNode);
+            isCbSceneNodeUpdated = true;
         }
-        if (strip >= mFaceStrips.size())
-            return invalidVert;
+        SetVertexShader(ctx, primitive.GetVertexFormat());
 
-        // Face & vertex
-        const auto faceIdx   = face - skippedFaces;
-        const auto vertexIdx = GetVertexIndex((int)faceIdx, vertex);
-        const auto idx = mFaceStrips[strip].startIdx + faceIdx + vertexIdx;
-        if ((idx < 0) || (idx >= mIndices.size()))
-            return invalidVert;
-        return mVertices[mIndices[idx]];
-    }
+        switch (material.GetWorkflow())
+        {
+        case MaterialWorkflow::kPbrMetalness:
+        {
+            ctx.PSSetShader(mPsPbrMetalness);
+            ctx.PSSetTexture(0, material.GetBaseColorTexture().srv);
+            ctx.PSSetTexture(1, material.GetMetallicRoughnessTexture().srv);
+            ctx.PSSetTexture(4, material.GetNormalTexture().srv);
+            ctx.PSSetTexture(5, material.GetOcclusionTexture().srv);
+            ctx.PSSetTexture(6, material.GetEmissionTexture().srv);
 
-    default:
-        return invalidVert; // Unsupported
+            CbScenePrimitive cbScenePrimitive;
+            cbScenePrimitive.BaseColorFactor            = material.GetBaseColorFactor();
+            cbScenePrimitive.MetallicRoughnessFactor    = material.GetMetallicRoughnessFactor();
+            cbScenePrimitive.DiffuseColorFactor         = UNUSED_COLOR;
+            cbScenePrimitive.SpecularFactor             = UNUSED_COLOR;
+            cbScenePrimitive.NormalTexScale             = material.GetNormalTexture().GetScale();
+            cbScenePrimitive.OcclusionTexStrength       = material.GetOcclusionTexture().GetStrength();
+            cbScenePrimitive.EmissionFactor             = material.GetEmissionFactor();
+            ctx.UpdateConstantBuffer(mCbScenePrimitive, &cbScenePrimitive);
+            break;
+        }
+        case MaterialWorkflow::kPbrSpecularity:
+        {
+            ctx.PSSetShader(mPsPbrSpecularity);
+            ctx.PSSetTexture(2, material.GetBaseColorTexture().srv);
+            ctx.PSSetTexture(3, material.GetSpecularTexture().srv);
+            ctx.PSSetTexture(4, material.GetNormalTexture().srv);
+            ctx.PSSetTexture(5, material.GetOcclusionTexture().srv);
+            ctx.PSSetTexture(6, material.GetEmissionTexture().srv);
+
+            CbScenePrimitive cbScenePrimitive;
+            cbScenePrimitive.DiffuseColorFactor         = material.GetBaseColorFactor();
+            cbScenePrimitive.SpecularFactor             = material.GetSpecularFactor();
+            cbScenePrimitive.BaseColorFactor            = UNUSED_COLOR;
+            cbScenePrimitive.MetallicRoughnessFactor    = UNUSED_COLOR;
+            cbScenePrimitive.NormalTexScale             = material.GetNormalTexture().GetScale();
+            cbScenePrimitive.OcclusionTexStrength       = material.GetOcclusionTexture().GetStrength();
+            cbScenePrimitive.EmissionFactor             = material.GetEmissionFactor();
+            ctx.UpdateConstantBuffer(mCbScenePrimitive, &cbScenePrimitive);
+            break;
+        }
+        default:
+            continue;
+        }
+
+        primitive.DrawGeometry(ctx);
     }
 }
 
-
-SceneVertex& ScenePrimitive::GetVertex(const int face, const int vertex)
+void Scene::SetVertexShader(IRenderingContext &ctx, VertexFormat vertexFormat)
 {
-    return
-        const_cast<SceneVertex &>(
-            static_cast<const ScenePrimitive&>(*this).
-                GetVertex(face, vertex));
+    IVertexShader *shader = mVertexShader;
+    if (vertexFormat == VertexFormat::kCompact)
+        shader = mVsCompact;
+    else if (vertexFormat == VertexFormat::kQuantized)
+        shader = mVsQuantized;
+
+    if (shader != mCurrentVertexShader)
+    {
+        ctx.VSSetShader(shader);
+        mCurrentVertexShader = shader;
+    }
 }
 
 
-void ScenePrimitive::GetPosition(float outpos[],
-                                 const int face,
-                                 const int vertex) const
+bool Scene::GetAmbientColor(float(&rgba)[4])
 {
-    const auto &pos = GetVertex(face, vertex).Pos;
-    outpos[0] = pos.x;
-    outpos[1] = pos.y;
-    outpos[2] = pos.z;
+    rgba[0] = mAmbientLight.luminance.x;
+    rgba[1] = mAmbientLight.luminance.y;
+    rgba[2] = mAmbientLight.luminance.z;
+    rgba[3] = mAmbientLight.luminance.w;
+    return true;
 }
 
 
-void ScenePrimitive::GetNormal(float outnormal[],
-                               const int face,
-                               const int vertex) const
+ScenePrimitive::ScenePrimitive()
+{}
+
+ScenePrimitive::ScenePrimitive(const ScenePrimitive &src) :
+    mGeometry(src.mGeometry),
+    mVertexBuffer(src.mVertexBuffer),
+    mIndexBuffer(src.mIndexBuffer),
+    mIndexCount(src.mIndexCount),
+    mIndexFormat(src.mIndexFormat),
+    mTopology(src.mTopology),
+    mIsTangentPresent(src.mIsTangentPresent),
+    mVertexFormat(src.mVertexFormat),
+    mDequantization(src.mDequantization),
+    mMaterialIdx(src.mMaterialIdx)
 {
-    const auto &normal = GetVertex(face, vertex).Normal;
-    outnormal[0] = normal.x;
-    outnormal[1] = normal.y;
-    outnormal[2] = normal.z;
+    // We are creating new references of device resources
+    Utils::SafeAddRef(mVertexBuffer);
+    Utils::SafeAddRef(mIndexBuffer);
 }
 
+ScenePrimitive::ScenePrimitive(ScenePrimitive &&src) :
+    mGeometry(std::move(src.mGeometry)),
+    mVertexBuffer(Utils::Exchange(src.mVertexBuffer, nullptr)),
+    mIndexBuffer(Utils::Exchange(src.mIndexBuffer, nullptr)),
+    mIndexCount(Utils::Exchange(src.mIndexCount, 0u)),
+    mIndexFormat(Utils::Exchange(src.mIndexFormat, IndexFormat::kUint32)),
+    mTopology(Utils::Exchange(src.mTopology, PrimitiveTopology::kUndefined)),
+    mIsTangentPresent(Utils::Exchange(src.mIsTangentPresent, false)),
+    mVertexFormat(Utils::Exchange(src.mVertexFormat, VertexFormat::kFull)),
+    mDequantization(Utils::Exchange(src.mDequantization, VertexDequantization())),
+    mMaterialIdx(Utils::Exchange(src.mMaterialIdx, -1))
+{}
 
-void ScenePrimitive::GetTextCoord(float outuv[],
-                                  const int face,
-                                  const int vertex) const
+ScenePrimitive& ScenePrimitive::operator =(const ScenePrimitive &src)
 {
-    const auto &tex = GetVertex(face, vertex).Tex;
-    outuv[0] = tex.x;
-    outuv[1] = tex.y;
-}
+    mGeometry = src.mGeometry;
+    mVertexBuffer = src.mVertexBuffer;
+    mIndexBuffer = src.mIndexBuffer;
+    mIndexCount = src.mIndexCount;
+    mIndexFormat = src.mIndexFormat;
+    mTopology = src.mTopology;
+    mIsTangentPresent = src.mIsTangentPresent;
+    mVertexFormat = src.mVertexFormat;
+    mDequantization = src.mDequantization;
 
+    // We are creating new references of device resources
+    Utils::SafeAddRef(mVertexBuffer);
+    Utils::SafeAddRef(mIndexBuffer);
 
-void ScenePrimitive::SetTangent(const float intangent[],
-                                const float sign,
-                                const int face,
-                                const int vertex)
-{
-    auto &tangent = GetVertex(face, vertex).Tangent;
-    tangent.x = intangent[0];
-    tangent.y = intangent[1];
-    tangent.z = intangent[2];
-    tangent.w = sign;
-}
+    mMaterialIdx = src.mMaterialIdx;
 
+    return *this;
+}
 
-bool ScenePrimitive::CreateDeviceBuffers(IRenderingContext & ctx)
+ScenePrimitive& ScenePrimitive::operator =(ScenePrimitive &&src)
 {
-    DestroyDeviceBuffers();
+    mGeometry = std::move(src.mGeometry);
+    mVertexBuffer = Utils::Exchange(src.mVertexBuffer, nullptr);
+    mIndexBuffer = Utils::Exchange(src.mIndexBuffer, nullptr);
+    mIndexCount = Utils::Exchange(src.mIndexCount, 0u);
+    mIndexFormat = Utils::Exchange(src.mIndexFormat, IndexFormat::kUint32);
+    mTopology = Utils::Exchange(src.mTopology, PrimitiveTopology::kUndefined);
+    mIsTangentPresent = Utils::Exchange(src.mIsTangentPresent, false);
+    mVertexFormat = Utils::Exchange(src.mVertexFormat, VertexFormat::kFull);
+    mDequantization = Utils::Exchange(src.mDequantization, VertexDequantization());
 
-    auto device = ctx.GetDevice();
-    if (!device)
-        return false;
+    mMaterialIdx = Utils::Exchange(src.mMaterialIdx, -1);
 
-    HRESULT hr = S_OK;
+    return *this;
+}
 
-    D3D11_BUFFER_DESC bd;
-    ZeroMemory(&bd, sizeof(bd));
+ScenePrimitive::~ScenePrimitive()
+{
+    Destroy();
+}
 
-    D3D11_SUBRESOURCE_DATA initData;
-    ZeroMemory(&initData, sizeof(initData));
 
-    // Vertex buffer
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = (UINT)(sizeof(SceneVertex) * mVertices.size());
-    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    initData.pSysMem = mVertices.data();
-    hr = device->CreateBuffer(&bd, &initData, &mVertexBuffer);
-    if (FAILED(hr))
-    {
-        DestroyDeviceBuffers();
+bool ScenePrimitive::CreateQuad(IRenderingContext & ctx)
+{
+    if (!mGeometry.GenerateQuadGeometry())
         return false;
-    }
-
-    // Index buffer
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(uint32_t) * (UINT)mIndices.size();
-    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    initData.pSysMem = mIndices.data();
-    hr = device->CreateBuffer(&bd, &initData, &mIndexBuffer);
-    if (FAILED(hr))
-    {
-        DestroyDeviceBuffers();
+    if (!CreateDeviceBuffers(ctx))
         return false;
-    }
 
     return true;
 }
 
 
-void ScenePrimitive::Destroy()
+bool ScenePrimitive::CreateCube(IRenderingContext & ctx)
 {
-    DestroyGeomData();
-    DestroyDeviceBuffers();
-}
-
+    if (!mGeometry.GenerateCubeGeometry())
+        return false;
+    if (!CreateDeviceBuffers(ctx))
+        return false;
 
-void ScenePrimitive::DestroyGeomData()
-{
-    mVertices.clear();
-    mIndices.clear();
-    mTopology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    return true;
 }
 
 
-void ScenePrimitive::DestroyDeviceBuffers()
+bool ScenePrimitive::CreateOctahedron(IRenderingContext & ctx)
 {
-    Utils::ReleaseAndMakeNull(mVertexBuffer);
-    Utils::ReleaseAndMakeNull(mIndexBuffer);
+    if (!mGeometry.GenerateOctahedronGeometry())
+        return false;
+    if (!CreateDeviceBuffers(ctx))
+        return false;
+
+    return true;
 }
 
 
-void ScenePrimitive::DrawGeometry(IRenderingContext &ctx, ID3D11InputLayout* vertexLayout) const
+bool ScenePrimitive::CreateSphere(IRenderingContext & ctx,
+                                  const uint16_t vertSegmCount,
+                                  const uint16_t stripCount)
 {
-    auto immCtx = ctx.GetImmediateContext();
-
-    immCtx->IASetInputLayout(vertexLayout);
-    UINT stride = sizeof(SceneVertex);
-    UINT offset = 0;
-    immCtx->IASetVertexBuffers(0, 1, &mVertexBuffer, &stride, &offset);
-    immCtx->IASetIndexBuffer(mIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-    immCtx->IASetPrimitiveTopology(mTopology);
+    if (!mGeometry.GenerateSphereGeometry(vertSegmCount, stripCount))
+        return false;
+    if (!CreateDeviceBuffers(ctx))
+        return false;
 
-    immCtx->DrawIndexed((UINT)mIndices.size(), 0, 0);
+    return true;
 }
 
 
-SceneNode::SceneNode(bool isRootNode) :
-    mIsRootNode(isRootNode),
-    mLocalMtrx(XMMatrixIdentity()),
-    mWorldMtrx(XMMatrixIdentity())
-{}
-
-ScenePrimitive* SceneNode::CreateEmptyPrimitive()
+bool ScenePrimitive::LoadFromGLTF(IRenderingContext & ctx,
+                                  const tinygltf::Model &model,
+                                  const tinygltf::Mesh &mesh,
+                                  const int primitiveIdx,
+                                  const std::wstring &logPrefix)
 {
-    mPrimitives.clear();
-    mPrimitives.resize(1);
-    if (mPrimitives.size() != 1)
-        return nullptr;
+    if (!LoadDataFromGLTF(model, mesh, primitiveIdx, logPrefix))
+        return false;
+    if (!CreateDeviceBuffers(ctx))
+        return false;
 
-    return &mPrimitives[0];
+    return true;
 }
 
-void SceneNode::SetIdentity()
-{
-    mLocalMtrx = XMMatrixIdentity();
-}
 
-void SceneNode::AddScale(double scale)
+bool ScenePrimitive::LoadDataFromGLTF(const tinygltf::Model &model,
+                                      const tinygltf::Mesh &mesh,
+                                      const int primitiveIdx,
+                                      const std::wstring &logPrefix,
+                                      NormalMethod normalMethod,
+                                      float normalCreaseAngle,
+                                      TangentMethod tangentMethod,
+                                      ThreadPool *tangentPool)
 {
-    AddScale({ scale, scale, scale });
-}
+    if (!mGeometry.LoadDataFromGLTF(model, mesh, primitiveIdx, logPrefix,
+                                    normalMethod, normalCreaseAngle, tangentMethod, tangentPool))
+        return false;
 
-void SceneNode::AddScale(const std::vector<double> &vec)
-{
-    if (vec.size() != 3)
+    // Material
+    const auto matIdx = mesh.primitives[primitiveIdx].material;
+    if (matIdx >= 0)
     {
-        if (vec.size() != 0)
-            Log::Warning(L"SceneNode::AddScale: vector of incorrect size (%d instead of 3)",
-                         vec.size());
-        return;
-    }
-
-    const auto mtrx = XMMatrixScaling((float)vec[0], (float)vec[1], (float)vec[2]);
-
-    mLocalMtrx = mLocalMtrx * mtrx;
-}
+        if (matIdx >= model.materials.size())
+        {
+            Log::Error(L"%s   Invalid material index (%d/%d)!",
+                       logPrefix.c_str(), matIdx, model.materials.size());
+            return false;
+        }
 
-void SceneNode::AddRotationQuaternion(const std::vector<double> &vec)
-{
-    if (vec.size() != 4)
-    {
-        if (vec.size() != 0)
-            Log::Warning(L"SceneNode::AddRotationQuaternion: vector of incorrect size (%d instead of 4)",
-                         vec.size());
-        return;
+        mMaterialIdx = matIdx;
     }
 
-    const XMFLOAT4 quaternion((float)vec[0], (float)vec[1], (float)vec[2], (float)vec[3]);
-    const auto xmQuaternion = XMLoadFloat4(&quaternion);
-    const auto mtrx = XMMatrixRotationQuaternion(xmQuaternion);
-
-    mLocalMtrx = mLocalMtrx * mtrx;
+    return true;
 }
 
-void SceneNode::AddTranslation(const std::vector<double> &vec)
+
+bool ScenePrimitive::WeldGeometry(float epsilon, const std::wstring &logPrefix)
 {
-    if (vec.size() != 3)
-    {
-        if (vec.size() != 0)
-            Log::Warning(L"SceneNode::AddTranslation: vector of incorrect size (%d instead of 3)",
-                         vec.size());
-        return;
-    }
+    return mGeometry.WeldVertices(epsilon, logPrefix);
+}
 
-    const auto mtrx = XMMatrixTranslation((float)vec[0], (float)vec[1], (float)vec[2]);
 
-    mLocalMtrx = mLocalMtrx * mtrx;
+bool ScenePrimitive::OptimizeGeometry(bool reduceOverdraw,
+                                      MeshOptimizer::VertexCacheStats &statsBefore,
+                                      MeshOptimizer::VertexCacheStats &statsAfter)
+{
+    return mGeometry.OptimizeForRendering(reduceOverdraw, statsBefore, statsAfter);
 }
 
-void SceneNode::AddMatrix(const std::vector<double> &vec)
-{
-    if (vec.size() != 16)
-    {
-        if (vec.size() != 0)
-            Log::Warning(L"SceneNode::AddMatrix: vector of incorrect size (%d instead of 16)",
-                         vec.size());
-        return;
-    }
 
-    const auto mtrx = XMMatrixSet(
-        (float)vec[0],  (float)vec[1],  (float)vec[2],  (float)vec[3],
-        (float)vec[4],  (float)vec[5],  (float)vec[6],  (float)vec[7],
-        (float)vec[8],  (float)vec[9],  (float)vec[10], (float)vec[11],
-        (float)vec[12], (float)vec[13], (float)vec[14], (float)vec[15]);
+bool ScenePrimitive::CreateDeviceBuffers(IRenderingContext & ctx, VertexFormat vertexFormat)
+{
+    const auto &vertices = mGeometry.GetVertices();
+    const auto &indices  = mGeometry.GetIndices();
 
-    mLocalMtrx = mLocalMtrx * mtrx;
+    return CreateDeviceBuffers(ctx,
+                               vertices.data(),
+                               (uint32_t)vertices.size(),
+                               indices.data(),
+                               (uint32_t)indices.size(),
+                               mGeometry.GetTopology(),
+                               mGeometry.IsTangentPresent(),
+                               vertexFormat);
 }
 
 
-bool SceneNode::LoadFromGLTF(IRenderingContext & ctx,
-                             const tinygltf::Model &model,
-                             const tinygltf::Node &node,
-                             int nodeIdx,
-                             const std::wstring &logPrefix)
+bool ScenePrimitive::CreateDeviceBuffers(IRenderingContext &ctx,
+                                         const SceneVertex *vertices,
+                                         uint32_t vertexCount,
+                                         const uint32_t *indices,
+                                         uint32_t indexCount,
+                                         PrimitiveTopology topology,
+                                         bool isTangentPresent,
+                                         VertexFormat vertexFormat)
 {
-    // debug
-    if (Log::sLoggingLevel >= Log::eDebug)
-    {
-        std::wstring transforms;
-        if (!node.rotation.empty())
-            transforms += L"rotation ";
-        if (!node.scale.empty())
-            transforms += L"scale ";
-        if (!node.translation.empty())
-            transforms += L"translation ";
-        if (!node.matrix.empty())
-            transforms += L"matrix ";
-        if (transforms.empty())
-            transforms = L"none";
-        Log::Debug(L"%sNode %d/%d \"%s\": mesh %d, transform %s, children %d",
-                   logPrefix.c_str(), 
-                   nodeIdx,
-                   model.nodes.size(),
-                   Utils::StringToWstring(node.name).c_str(),
-                   node.mesh,
-                   transforms.c_str(),
-                   node.children.size());
-    }
+    DestroyDeviceBuffers();
 
-    const std::wstring &subItemsLogPrefix = logPrefix + L"   ";
+    mIndexCount         = indexCount;
+    mTopology           = topology;
+    mIsTangentPresent   = isTangentPresent;
+    mVertexFormat       = vertexFormat;
+    if ((vertexCount == 0) && (indexCount == 0))
+        return true;
 
-    // Local transformation
-    SetIdentity();
-    if (node.matrix.size() == 16)
+    // Full vertices and 32-bit indices are uploaded in place
+    const void *vertexData = vertices;
+    std::vector<uint8_t> packedVertices;
+    mDequantization = VertexDequantization();
+    if (vertexFormat != VertexFormat::kFull)
     {
-        AddMatrix(node.matrix);
-
-        // Sanity checking
-        if (!node.scale.empty())
-            Log::Warning(L"%sNode %d/%d \"%s\": node.scale is not empty when tranformation matrix is provided. Ignoring.",
-                         logPrefix.c_str(),
-                         nodeIdx,
-                         model.nodes.size(),
-                         Utils::StringToWstring(node.name).c_str());
-        if (!node.rotation.empty())
-            Log::Warning(L"%sNode %d/%d \"%s\": node.rotation is not empty when tranformation matrix is provided. Ignoring.",
-                         logPrefix.c_str(),
-                         nodeIdx,
-                         model.nodes.size(),
-                         Utils::StringToWstring(node.name).c_str());
-        if (!node.translation.empty())
-            Log::Warning(L"%sNode %d/%d \"%s\": node.translation is not empty when tranformation matrix is provided. Ignoring.",
-                         logPrefix.c_str(),
-                         nodeIdx,
-                         model.nodes.size(),
-                         Utils::StringToWstring(node.name).c_str());
+        VertexPacking::PackVertices(packedVertices, mDequantization, vertexFormat, vertices, vertexCount);
+        vertexData = packedVertices.data();
     }
-    else
+
+    const void *indexData = indices;
+    uint32_t indexSize = sizeof(uint32_t);
+    std::vector<uint16_t> packedIndices;
+    mIndexFormat = IndexFormat::kUint32;
+    if (VertexPacking::CanUse16BitIndices(vertexCount))
     {
-        AddScale(node.scale);
-        AddRotationQuaternion(node.rotation);
-        AddTranslation(node.translation);
+        VertexPacking::PackIndices16(packedIndices, indices, indexCount);
+        indexData = packedIndices.data();
+        indexSize = sizeof(uint16_t);
+        mIndexFormat = IndexFormat::kUint16;
     }
 
-    // Mesh
-    const auto meshIdx = node.mesh;
-    if (meshIdx >= (int)model.meshes.size())
+    if (!ctx.CreateBuffer(DeviceBufferType::kVertex,
+                          vertexData,
+                          VertexPacking::GetVertexSize(vertexFormat) * vertexCount,
+                          mVertexBuffer))
     {
-        Log::Error(L"%sInvalid mesh index (%d/%d)!", subItemsLogPrefix.c_str(), meshIdx, model.meshes.size());
+        DestroyDeviceBuffers();
         return false;
     }
-    if (meshIdx >= 0)
-    {
-        const auto &mesh = model.meshes[meshIdx];
-
-        Log::Debug(L"%sMesh %d/%d \"%s\": %d primitive(s)",
-                   subItemsLogPrefix.c_str(),
-                   meshIdx,
-                   model.meshes.size(),
-                   Utils::StringToWstring(mesh.name).c_str(),
-                   mesh.primitives.size());
 
-        // Primitives
-        const auto primitivesCount = mesh.primitives.size();
-        mPrimitives.reserve(primitivesCount);
-        for (size_t i = 0; i < primitivesCount; ++i)
-        {
-            ScenePrimitive primitive;
-            if (!primitive.LoadFromGLTF(ctx, model, mesh, (int)i, subItemsLogPrefix + L"   "))
-                return false;
-            mPrimitives.push_back(std::move(primitive));
-        }
+    if (!ctx.CreateBuffer(DeviceBufferType::kIndex,
+                          indexData,
+                          indexSize * indexCount,
+                          mIndexBuffer))
+    {
+        DestroyDeviceBuffers();
+        return false;
     }
 
     return true;
 }
 
 
-void SceneNode::Animate(IRenderingContext &ctx)
+void ScenePrimitive::Destroy()
 {
-    if (mIsRootNode)
-    {
-        const float time = ctx.GetFrameAnimationTime();
-        const float period = 15.f; //seconds
-        const float totalAnimPos = time / period;
-        const float angle = totalAnimPos * XM_2PI;
+    mGeometry.Clear();
+    DestroyDeviceBuffers();
+}
 
-        const XMMATRIX rotMtrx = XMMatrixRotationY(angle);
 
-        mWorldMtrx = mLocalMtrx * rotMtrx;
-    }
-    else
-        mWorldMtrx = mLocalMtrx;
+void ScenePrimitive::DestroyDeviceBuffers()
+{
+    Utils::ReleaseAndMakeNull(mVertexBuffer);
+    Utils::ReleaseAndMakeNull(mIndexBuffer);
+}
 
-    for (auto &child : mChildren)
-        child.Animate(ctx);
+
+size_t ScenePrimitive::GetDeviceBufferSize() const
+{
+    if (!IsUploaded())
+        return 0;
+
+    return (size_t)mVertexBuffer->GetByteSize() + mIndexBuffer->GetByteSize();
+}
+
+
+void ScenePrimitive::DrawGeometry(IRenderingContext &ctx) const
+{
+    ctx.DrawIndexed(mVertexBuffer,
+                    VertexPacking::GetVertexSize(mVertexFormat),
+                    mIndexBuffer,
+                    mIndexFormat,
+                    mIndexCount,
+                    mTopology);
 }
 
 
 SceneTexture::SceneTexture(const std::wstring &name,
                            ValueType valueType,
-                           XMFLOAT4 neutralValue) :
+                           Float4 neutralValue,
+                           Channels channels) :
     mName(name),
     mValueType(valueType),
     mNeutralValue(neutralValue),
+    mChannels(channels),
+    mCompression(TextureCompression::kNone),
+    mTextureCache(nullptr),
     mIsLoaded(false),
+    mImageIdx(-1),
     srv(nullptr)
 {}
 
@@ -2106,7 +1979,11 @@ SceneTexture::SceneTexture(const SceneTexture &src) :
     mName(src.mName),
     mValueType(src.mValueType),
     mNeutralValue(src.mNeutralValue),
+    mChannels(src.mChannels),
+    mCompression(src.mCompression),
+    mTextureCache(src.mTextureCache),
     mIsLoaded(src.mIsLoaded),
+    mImageIdx(src.mImageIdx),
     srv(src.srv)
 {
     // We are creating new reference of device resource
@@ -2118,7 +1995,11 @@ SceneTexture& SceneTexture::operator =(const SceneTexture &src)
     mName           = src.mName;
     mValueType      = src.mValueType;
     mNeutralValue   = src.mNeutralValue;
+    mChannels       = src.mChannels;
+    mCompression    = src.mCompression;
+    mTextureCache   = src.mTextureCache;
     mIsLoaded       = src.mIsLoaded;
+    mImageIdx       = src.mImageIdx;
     srv             = src.srv;
 
     // We are creating new reference of device resource
@@ -2130,8 +2011,12 @@ SceneTexture& SceneTexture::operator =(const SceneTexture &src)
 SceneTexture::SceneTexture(SceneTexture &&src) :
     mName(src.mName),
     mValueType(src.mValueType),
-    mNeutralValue(Utils::Exchange(src.mNeutralValue, XMFLOAT4(0.f, 0.f, 0.f, 0.f))),
+    mNeutralValue(Utils::Exchange(src.mNeutralValue, Float4(0.f, 0.f, 0.f, 0.f))),
+    mChannels(src.mChannels),
+    mCompression(src.mCompression),
+    mTextureCache(src.mTextureCache),
     mIsLoaded(Utils::Exchange(src.mIsLoaded, false)),
+    mImageIdx(Utils::Exchange(src.mImageIdx, -1)),
     srv(Utils::Exchange(src.srv, nullptr))
 {}
 
@@ -2139,8 +2024,12 @@ SceneTexture& SceneTexture::operator =(SceneTexture &&src)
 {
     mName           = src.mName;
     mValueType      = src.mValueType;
-    mNeutralValue   = Utils::Exchange(src.mNeutralValue, XMFLOAT4(0.f, 0.f, 0.f, 0.f));
+    mNeutralValue   = Utils::Exchange(src.mNeutralValue, Float4(0.f, 0.f, 0.f, 0.f));
+    mChannels       = src.mChannels;
+    mCompression    = src.mCompression;
+    mTextureCache   = src.mTextureCache;
     mIsLoaded       = Utils::Exchange(src.mIsLoaded, false);
+    mImageIdx       = Utils::Exchange(src.mImageIdx, -1);
     srv             = Utils::Exchange(src.srv, nullptr);
 
     return *this;
@@ -2154,30 +2043,15 @@ SceneTexture::~SceneTexture()
 
 bool SceneTexture::Create(IRenderingContext &ctx, const wchar_t *path)
 {
-    auto device = ctx.GetDevice();
-    if (!device)
-        return false;
-
-    HRESULT hr = S_OK;
-
     if (path)
     {
-        D3DX11_IMAGE_LOAD_INFO ili;
-        ili.Usage = D3D11_USAGE_IMMUTABLE;
 #ifdef CONVERT_SRGB_INPUT_TO_LINEAR
-        if (mValueType == SceneTexture::eSrgb)
-        {
-            ili.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-            ili.Filter = D3DX11_FILTER_SRGB | D3DX11_FILTER_NONE;
-        }
-        else
+        const bool isSrgb = (mValueType == SceneTexture::eSrgb);
+#else
+        const bool isSrgb = false;
 #endif
-        {
-            ili.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        }
 
-        hr = D3DX11CreateShaderResourceViewFromFile(device, path, &ili, nullptr, &srv, nullptr);
-        if (FAILED(hr))
+        if (!ctx.CreateTextureFromFile(path, isSrgb, srv))
             return false;
     }
     else
@@ -2193,7 +2067,37 @@ bool SceneTexture::Create(IRenderingContext &ctx, const wchar_t *path)
 
 bool SceneTexture::CreateNeutral(IRenderingContext &ctx)
 {
-    return SceneUtils::CreateConstantTextureSRV(ctx, srv, mNeutralValue);
+    if (!mTextureCache)
+        return SceneUtils::CreateConstantTextureSRV(ctx, srv, mNeutralValue);
+
+    auto texture = mTextureCache->GetConstantTexture(ctx, mNeutralValue);
+    if (!texture)
+        return false;
+
+    Utils::ReleaseAndMakeNull(srv);
+    srv = texture;
+    srv->AddRef();
+
+    return true;
+}
+
+
+void SceneTexture::SetImageTexture(IDeviceTexture *texture)
+{
+    Utils::ReleaseAndMakeNull(srv);
+    srv = texture;
+    Utils::SafeAddRef(srv);
+
+    mIsLoaded = (srv != nullptr);
+}
+
+
+uint32_t SceneTexture::GetEncodingKey() const
+{
+    if (mCompression == TextureCompression::kNone)
+        return 0;
+    else
+        return ((uint32_t)mCompression << 8) | (uint32_t)mChannels;
 }
 
 
@@ -2226,7 +2130,7 @@ bool SceneTexture::LoadTextureFromGltf(const int textureIndex,
                    GetName().c_str()
         );
 
-        if (!SceneUtils::CreateConstantTextureSRV(ctx, srv, mNeutralValue))
+        if (!SceneTexture::CreateNeutral(ctx))
         {
             Log::Error(L"%sFailed to create neutral constant texture for \"%s\"!",
                        logPrefix.c_str(),
@@ -2252,6 +2156,29 @@ bool SceneTexture::LoadTextureFromGltf(const int textureIndex,
 
     const auto &image = images[texSource];
 
+    mImageIdx = texSource;
+
+    if (image.as_is)
+    {
+        // Deferred image decoding - the scene uploads the texture once the image is decoded
+        Log::Debug(L"%s%s: \"%s\"/\"%s\", waiting for decoding",
+                   logPrefix.c_str(),
+                   GetName().c_str(),
+                   Utils::StringToWstring(image.name).c_str(),
+                   Utils::StringToWstring(image.uri).c_str());
+
+        return true;
+    }
+
+    return CreateFromGltfImage(ctx, image, logPrefix);
+}
+
+
+bool SceneTexture::CreateFromGltfImage(IRenderingContext &ctx,
+                                       const tinygltf::Image &image,
+                                       const std::wstring &logPrefix,
+                                       const MipChain *mipChain)
+{
     Log::Debug(L"%s%s: \"%s\"/\"%s\", %dx%d, %dx%db %s, data size %dB",
                logPrefix.c_str(),
                GetName().c_str(),
@@ -2286,21 +2213,10 @@ bool SceneTexture::LoadTextureFromGltf(const int textureIndex,
         return false;
     }
 
-    DXGI_FORMAT dataFormat;
-#ifdef CONVERT_SRGB_INPUT_TO_LINEAR
-    if (mValueType == SceneTexture::eSrgb)
-        dataFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-    else
-#endif
-        dataFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-    if (!SceneUtils::CreateTextureSrvFromData(ctx,
-                                              srv,
-                                              image.width,
-                                              image.height,
-                                              dataFormat,
-                                              image.image.data(),
-                                              image.width * 4 * sizeof(uint8_t)))
+    const bool created = (mipChain && (mipChain->GetLevelCount() > 0))
+        ? CreateFromMipChain(ctx, *mipChain)
+        : CreateFromRgbaData(ctx, image.width, image.height, image.image.data());
+    if (!created)
     {
         Log::Error(L"%sFailed to create texture & SRV for image \"%s\": \"%s\", %dx%d",
                    logPrefix.c_str(),
@@ -2311,14 +2227,106 @@ bool SceneTexture::LoadTextureFromGltf(const int textureIndex,
         return false;
     }
 
-    mIsLoaded = true;
-
     // TODO: Sampler
 
     return true;
 }
 
 
+bool SceneTexture::CreateFromRgbaData(IRenderingContext &ctx,
+                                      uint32_t width,
+                                      uint32_t height,
+                                      const uint8_t *data)
+{
+    MipChain mipChain;
+    mipChain.Generate(width, height, data, IsSrgb());
+
+    const auto bcFormat = SelectBcFormat(width, height, data);
+    if (bcFormat == BcEncoder::Format::kNone)
+        return CreateFromMipChain(ctx, mipChain);
+
+    MipChain encodedMipChain;
+    encodedMipChain.Encode(mipChain, bcFormat, GetBcQuality());
+
+    return CreateFromMipChain(ctx, encodedMipChain);
+}
+
+
+bool SceneTexture::CreateFromMipChain(IRenderingContext &ctx, const MipChain &mipChain)
+{
+#ifdef CONVERT_SRGB_INPUT_TO_LINEAR
+    const bool isSrgb = (mValueType == SceneTexture::eSrgb);
+#else
+    const bool isSrgb = false;
+#endif
+
+    TextureFormat dataFormat;
+    switch (mipChain.GetFormat())
+    {
+    case BcEncoder::Format::kBC1:
+        dataFormat = isSrgb ? TextureFormat::kBC1UnormSrgb : TextureFormat::kBC1Unorm;
+        break;
+    case BcEncoder::Format::kBC3:
+        dataFormat = isSrgb ? TextureFormat::kBC3UnormSrgb : TextureFormat::kBC3Unorm;
+        break;
+    case BcEncoder::Format::kBC4:
+        dataFormat = TextureFormat::kBC4Unorm;
+        break;
+    case BcEncoder::Format::kBC5:
+        dataFormat = TextureFormat::kBC5Unorm;
+        break;
+    case BcEncoder::Format::kBC7:
+        dataFormat = isSrgb ? TextureFormat::kBC7UnormSrgb : TextureFormat::kBC7Unorm;
+        break;
+    default:
+        dataFormat = isSrgb ? TextureFormat::kR8G8B8A8UnormSrgb : TextureFormat::kR8G8B8A8Unorm;
+        break;
+    }
+
+    // The previous (e.g. neutral) texture stays in use until the new one is created
+    IDeviceTexture *texture = nullptr;
+    if (!SceneUtils::CreateTextureSrvFromData(ctx, texture, mipChain, dataFormat))
+        return false;
+    Utils::ReleaseAndMakeNull(srv);
+    srv = texture;
+
+    mIsLoaded = true;
+
+    return true;
+}
+
+
+BcEncoder::Format SceneTexture::SelectBcFormat(uint32_t width, uint32_t height, const uint8_t *texels) const
+{
+    // The top level of block-compressed textures must consist of whole blocks
+    if ((mCompression == TextureCompression::kNone) || (width % 4 != 0) || (height % 4 != 0))
+        return BcEncoder::Format::kNone;
+
+    switch (mChannels)
+    {
+    case eR:
+        return BcEncoder::Format::kBC4;
+    case eRg:
+        return BcEncoder::Format::kBC5;
+    case eRgb:
+        return (mCompression == TextureCompression::kHigh) ? BcEncoder::Format::kBC7 : BcEncoder::Format::kBC1;
+    default:
+        if (mCompression == TextureCompression::kHigh)
+            return BcEncoder::Format::kBC7;
+        else if (BcEncoder::IsOpaque(texels, (size_t)width * height))
+            return BcEncoder::Format::kBC1;
+        else
+            return BcEncoder::Format::kBC3;
+    }
+}
+
+
+BcEncoder::Quality SceneTexture::GetBcQuality() const
+{
+    return (mCompression == TextureCompression::kHigh) ? BcEncoder::Quality::kHigh : BcEncoder::Quality::kFast;
+}
+
+
 bool SceneNormalTexture::CreateNeutral(IRenderingContext &ctx)
 {
     mScale = 1.f;
@@ -2375,26 +2383,27 @@ bool SceneOcclusionTexture::LoadTextureFromGltf(const tinygltf::OcclusionTexture
 
 SceneMaterial::SceneMaterial() :
     mWorkflow(MaterialWorkflow::kNone),
-    mBaseColorTexture(L"BaseColorTexture", SceneTexture::eSrgb, XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
-    mBaseColorFactor(XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
-    mMetallicRoughnessTexture(L"MetallicRoughnessTexture", SceneTexture::eLinear, XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
-    mMetallicRoughnessFactor(XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
+    mBaseColorTexture(L"BaseColorTexture", SceneTexture::eSrgb, Float4(1.f, 1.f, 1.f, 1.f)),
+    mBaseColorFactor(Float4(1.f, 1.f, 1.f, 1.f)),
+    mMetallicRoughnessTexture(L"MetallicRoughnessTexture", SceneTexture::eLinear, Float4(1.f, 1.f, 1.f, 1.f),
+                              SceneTexture::eRgb),
+    mMetallicRoughnessFactor(Float4(1.f, 1.f, 1.f, 1.f)),
 
-    mSpecularTexture(L"SpecularTexture", SceneTexture::eLinear, XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
-    mSpecularFactor(XMFLOAT4(1.f, 1.f, 1.f, 1.f)),
+    mSpecularTexture(L"SpecularTexture", SceneTexture::eLinear, Float4(1.f, 1.f, 1.f, 1.f)),
+    mSpecularFactor(Float4(1.f, 1.f, 1.f, 1.f)),
 
     mNormalTexture(L"NormalTexture"),
     mOcclusionTexture(L"OcclusionTexture"),
-    mEmissionTexture(L"EmissionTexture", SceneTexture::eSrgb, XMFLOAT4(0.f, 0.f, 0.f, 1.f)),
-    mEmissionFactor(XMFLOAT4(0.f, 0.f, 0.f, 1.f))
+    mEmissionTexture(L"EmissionTexture", SceneTexture::eSrgb, Float4(0.f, 0.f, 0.f, 1.f), SceneTexture::eRgb),
+    mEmissionFactor(Float4(0.f, 0.f, 0.f, 1.f))
 {}
 
 
 bool SceneMaterial::CreatePbrSpecularity(IRenderingContext &ctx,
                                          const wchar_t * diffuseTexPath,
-                                         XMFLOAT4 diffuseFactor,
+                                         Float4 diffuseFactor,
                                          const wchar_t * specularTexPath,
-                                         XMFLOAT4 specularFactor)
+                                         Float4 specularFactor)
 {
     if (!mBaseColorTexture.Create(ctx, diffuseTexPath))
         return false;
@@ -2412,7 +2421,7 @@ bool SceneMaterial::CreatePbrSpecularity(IRenderingContext &ctx,
 
     if (!mEmissionTexture.CreateNeutral(ctx))
         return false;
-    mEmissionFactor = XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+    mEmissionFactor = Float4(0.f, 0.f, 0.f, 1.f);
 
     mWorkflow = MaterialWorkflow::kPbrSpecularity;
 
@@ -2422,7 +2431,7 @@ bool SceneMaterial::CreatePbrSpecularity(IRenderingContext &ctx,
 
 bool SceneMaterial::CreatePbrMetalness(IRenderingContext &ctx,
                                        const wchar_t * baseColorTexPath,
-                                       XMFLOAT4 baseColorFactor,
+                                       Float4 baseColorFactor,
                                        const wchar_t * metallicRoughnessTexPath,
                                        float metallicFactor,
                                        float roughnessFactor)
@@ -2433,7 +2442,7 @@ bool SceneMaterial::CreatePbrMetalness(IRenderingContext &ctx,
 
     if (!mMetallicRoughnessTexture.Create(ctx, metallicRoughnessTexPath))
         return false;
-    mMetallicRoughnessFactor = XMFLOAT4(0.f, roughnessFactor, metallicFactor, 0.f);
+    mMetallicRoughnessFactor = Float4(0.f, roughnessFactor, metallicFactor, 0.f);
 
     if (!mNormalTexture.CreateNeutral(ctx))
         return false;
@@ -2443,7 +2452,7 @@ bool SceneMaterial::CreatePbrMetalness(IRenderingContext &ctx,
 
     if (!mEmissionTexture.CreateNeutral(ctx))
         return false;
-    mEmissionFactor = XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+    mEmissionFactor = Float4(0.f, 0.f, 0.f, 1.f);
 
     mWorkflow = MaterialWorkflow::kPbrMetalness;
 
@@ -2458,6 +2467,8 @@ bool SceneMaterial::LoadFromGltf(IRenderingContext &ctx,
 {
     auto &pbrMR = material.pbrMetallicRoughness;
 
+    mName = material.name;
+
     if (!mBaseColorTexture.LoadTextureFromGltf(pbrMR.baseColorTexture.index, ctx, model, logPrefix))
         return false;
 
@@ -2501,6 +2512,59 @@ bool SceneMaterial::LoadFromGltf(IRenderingContext &ctx,
 }
 
 
+void SceneMaterial::GatherPendingTextures(std::vector<SceneTexture*> &textures)
+{
+    SceneTexture *materialTextures[kTextureCount];
+    GetTextures(materialTextures);
+
+    for (auto texture : materialTextures)
+        if (texture->IsWaitingForImage())
+            textures.push_back(texture);
+}
+
+
+void SceneMaterial::SetTextureCompression(TextureCompression compression)
+{
+    SceneTexture *materialTextures[kTextureCount];
+    GetTextures(materialTextures);
+
+    for (auto texture : materialTextures)
+        texture->SetCompression(compression);
+}
+
+
+void SceneMaterial::SetTextureCache(TextureCache *cache)
+{
+    SceneTexture *materialTextures[kTextureCount];
+    GetTextures(materialTextures);
+
+    for (auto texture : materialTextures)
+        texture->SetTextureCache(cache);
+}
+
+
+void SceneMaterial::GetTextures(SceneTexture *(&textures)[kTextureCount])
+{
+    textures[0] = &mBaseColorTexture;
+    textures[1] = &mMetallicRoughnessTexture;
+    textures[2] = &mSpecularTexture;
+    textures[3] = &mNormalTexture;
+    textures[4] = &mOcclusionTexture;
+    textures[5] = &mEmissionTexture;
+}
+
+
+void SceneMaterial::GetTextures(const SceneTexture *(&textures)[kTextureCount]) const
+{
+    textures[0] = &mBaseColorTexture;
+    textures[1] = &mMetallicRoughnessTexture;
+    textures[2] = &mSpecularTexture;
+    textures[3] = &mNormalTexture;
+    textures[4] = &mOcclusionTexture;
+    textures[5] = &mEmissionTexture;
+}
+
+
 void SceneMaterial::Animate(IRenderingContext &ctx)
 {
     const float totalAnimPos = ctx.GetFrameAnimationTime() / 3.f/*seconds*/;
@@ -2509,5 +2573,5 @@ void SceneMaterial::Animate(IRenderingContext &ctx)
     //auto val = cos(totalAnimPos * XM_2PI) * 0.5f + 0.5f;
     ////mNormalTexture.SetScale(val);
     ////mOcclusionTexture.SetStrength(val >= .2f ? 1.f : 0.f);
-    //mEmissionFactor = XMFLOAT4(val, val, val, 1.f);
+    //mEmissionFactor = Float4(val, val, val, 1.f);
 }
@@ -2,34 +2,27 @@
 
 #include "iscene.hpp"
 #include "constants.hpp"
+#include "gltf_utils.hpp"
 
-// We are using an older version of DirectX headers which causes 
-// "warning C4005: '...' : macro redefinition"
-#pragma warning(push)
-#pragma warning(disable: 4005)
-#include <d3d11.h>
-#include <d3dx11.h>
-#pragma warning(pop)
-
-#pragma warning(push)
-#pragma warning(disable: 4838)
-#include <xnamath.h>
-#pragma warning(pop)
+#include "memory_tracker.hpp"
+#include "mip_chain.hpp"
+#include "scene_geometry.hpp"
+#include "scene_graph.hpp"
+#include "scene_math.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+#include "vertex_packing.hpp"
 
 #include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 
 
-struct SceneVertex
-{
-    XMFLOAT3 Pos;
-    XMFLOAT3 Normal;
-    XMFLOAT4 Tangent; // w represents handedness of the tangent basis and is either 1 or -1
-    XMFLOAT2 Tex;
-};
-
-
 class ScenePrimitive
 {
 public:
@@ -46,8 +39,8 @@ public:
     bool CreateCube(IRenderingContext & ctx);
     bool CreateOctahedron(IRenderingContext & ctx);
     bool CreateSphere(IRenderingContext & ctx,
-                      const WORD vertSegmCount = 40,
-                      const WORD stripCount = 80);
+                      const uint16_t vertSegmCount = 40,
+                      const uint16_t stripCount = 80);
 
     bool LoadFromGLTF(IRenderingContext & ctx,
                       const tinygltf::Model &model,
@@ -55,23 +48,50 @@ public:
                       const int primitiveIdx,
                       const std::wstring &logPrefix);
 
-    // Uses mikktspace tangent space calculator by Morten S. Mikkelsen.
-    // Requires position, normal, and texture coordinates to be already loaded.
-    bool CalculateTangentsIfNeeded(const std::wstring &logPrefix = std::wstring());
-
-    size_t GetVerticesPerFace() const;
-    size_t GetFacesCount() const;
-    const size_t GetVertexIndex(const int face, const int vertex) const;
-    const SceneVertex& GetVertex(const int face, const int vertex) const;
-          SceneVertex& GetVertex(const int face, const int vertex);
-    void GetPosition(float outpos[], const int face, const int vertex) const;
-    void GetNormal(float outnormal[], const int face, const int vertex) const;
-    void GetTextCoord(float outuv[], const int face, const int vertex) const;
-    void SetTangent(const float tangent[], const float sign, const int face, const int vertex);
+    // Split version of LoadFromGLTF(): CPU-side decoding, which doesn't touch the rendering context
+    // and can run on a worker thread, followed by creating device buffers on the owning thread
+    bool LoadDataFromGLTF(const tinygltf::Model &model,
+                          const tinygltf::Mesh &mesh,
+                          const int primitiveIdx,
+                          const std::wstring &logPrefix,
+                          NormalMethod normalMethod = NormalMethod::kAngleWeighted,
+                          float normalCreaseAngle = 60.f,
+                          TangentMethod tangentMethod = TangentMethod::kMikkTSpace,
+                          ThreadPool *tangentPool = nullptr);
+    // Vertices are packed into the given device format, 16-bit indices are used whenever possible
+    bool CreateDeviceBuffers(IRenderingContext &ctx, VertexFormat vertexFormat = VertexFormat::kFull);
+
+    // Optional steps between LoadDataFromGLTF() and CreateDeviceBuffers(), see SceneGeometry::WeldVertices()
+    // and SceneGeometry::OptimizeForRendering()
+    bool WeldGeometry(float epsilon, const std::wstring &logPrefix);
+    bool OptimizeGeometry(bool reduceOverdraw,
+                          MeshOptimizer::VertexCacheStats &statsBefore,
+                          MeshOptimizer::VertexCacheStats &statsAfter);
+
+    // Creates device buffers straight from external data (e.g. a memory-mapped scene cache)
+    // without keeping any CPU-side geometry. Empty geometry (see SceneGeometry::WeldVertices()) gets
+    // no buffers and is never drawn.
+    bool CreateDeviceBuffers(IRenderingContext &ctx,
+                             const SceneVertex *vertices,
+                             uint32_t vertexCount,
+                             const uint32_t *indices,
+                             uint32_t indexCount,
+                             PrimitiveTopology topology,
+                             bool isTangentPresent,
+                             VertexFormat vertexFormat = VertexFormat::kFull);
+
+    const SceneGeometry& GetGeometry() const { return mGeometry; }
+
+    VertexFormat GetVertexFormat() const { return mVertexFormat; }
+    const VertexDequantization& GetDequantization() const { return mDequantization; }
 
     bool IsTangentPresent() const { return mIsTangentPresent; }
 
-    void DrawGeometry(IRenderingContext &ctx, ID3D11InputLayout *vertexLayout) const;
+    // Device buffers are created, so the primitive can be drawn
+    bool IsUploaded() const { return mVertexBuffer && mIndexBuffer; }
+    size_t GetDeviceBufferSize() const;
+
+    void DrawGeometry(IRenderingContext &ctx) const;
 
     void SetMaterialIdx(int idx) { mMaterialIdx = idx; };
     int GetMaterialIdx() const { return mMaterialIdx; };
@@ -80,82 +100,51 @@ public:
 
 private:
 
-    bool GenerateQuadGeometry();
-    bool GenerateCubeGeometry();
-    bool GenerateOctahedronGeometry();
-    bool GenerateSphereGeometry(const WORD vertSegmCount, const WORD stripCount);
-
-    bool LoadDataFromGLTF(const tinygltf::Model &model,
-                              const tinygltf::Mesh &mesh,
-                              const int primitiveIdx,
-                              const std::wstring &logPrefix);
-
-    void FillFaceStripsCacheIfNeeded() const;
-    bool CreateDeviceBuffers(IRenderingContext &ctx);
-
-    void DestroyGeomData();
     void DestroyDeviceBuffers();
 
 private:
 
     // Geometry data
-    std::vector<SceneVertex>    mVertices;
-    std::vector<uint32_t>       mIndices;
-    D3D11_PRIMITIVE_TOPOLOGY    mTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
-    bool                        mIsTangentPresent = false;
-
-    // Cached geometry data
-    struct FaceStrip
-    {
-        size_t startIdx;
-        size_t faceCount;
-    };
-    mutable bool                    mAreFaceStripsCached = false;
-    mutable std::vector<FaceStrip>  mFaceStrips;
-    mutable size_t                  mFaceStripsTotalCount = 0;
+    SceneGeometry               mGeometry;
 
     // Device geometry data
-    ID3D11Buffer*               mVertexBuffer = nullptr;
-    ID3D11Buffer*               mIndexBuffer = nullptr;
+    IDeviceBuffer*              mVertexBuffer = nullptr;
+    IDeviceBuffer*              mIndexBuffer = nullptr;
+    uint32_t                    mIndexCount = 0;
+    IndexFormat                 mIndexFormat = IndexFormat::kUint32;
+    PrimitiveTopology           mTopology = PrimitiveTopology::kUndefined;
+    bool                        mIsTangentPresent = false;
+    VertexFormat                mVertexFormat = VertexFormat::kFull;
+    VertexDequantization        mDequantization;
 
     // Material
     int                         mMaterialIdx = -1;
 };
 
 
-class SceneNode
+// Geometry of one mesh. Meshes live in the scene's mesh table and nodes reference them by index,
+// so a mesh used by several nodes is decoded and uploaded just once.
+struct SceneMesh
 {
-public:
-    SceneNode(bool useDebugAnimation = false);
-
-    ScenePrimitive* CreateEmptyPrimitive();
-
-    void SetIdentity();
-    void AddScale(double scale);
-    void AddScale(const std::vector<double> &vec);
-    void AddRotationQuaternion(const std::vector<double> &vec);
-    void AddTranslation(const std::vector<double> &vec);
-    void AddMatrix(const std::vector<double> &vec);
-
-    bool LoadFromGLTF(IRenderingContext & ctx,
-                      const tinygltf::Model &model,
-                      const tinygltf::Node &node,
-                      int nodeIdx,
-                      const std::wstring &logPrefix);
+    std::vector<ScenePrimitive> primitives;
+};
 
-    void Animate(IRenderingContext &ctx);
 
-    XMMATRIX GetWorldMtrx() const { return mWorldMtrx; }
+// Reordering of glTF geometry for the GPU (see mesh_optimizer.hpp)
+enum class MeshOptimization
+{
+    kNone,
+    kVertexCache,               // Triangles for the post-transform vertex cache, vertices for fetch locality
+    kVertexCacheAndOverdraw,    // The same plus triangle clusters sorted to reduce overdraw
+};
 
-private:
-    friend class Scene;
-    std::vector<ScenePrimitive> mPrimitives;
-    std::vector<SceneNode>      mChildren;
 
-private:
-    bool        mIsRootNode;
-    XMMATRIX    mLocalMtrx;
-    XMMATRIX    mWorldMtrx;
+// Block compression of textures loaded from glTF images
+enum class TextureCompression
+{
+    kNone,
+    kFast,  // BC1/BC3 colors, fast endpoints
+    kHigh,  // BC7 colors, refined endpoints
 };
 
 
@@ -168,7 +157,19 @@ public:
         eSrgb,
     };
 
-    SceneTexture(const std::wstring &name, ValueType valueType, XMFLOAT4 neutralValue);
+    // Channels read by the shaders; they determine the block compression format
+    enum Channels
+    {
+        eRgba,
+        eRgb,
+        eRg,    // Normal maps; the shaders reconstruct z
+        eR,
+    };
+
+    SceneTexture(const std::wstring &name,
+                 ValueType valueType,
+                 SceneMath::Float4 neutralValue,
+                 Channels channels = eRgba);
 
     SceneTexture(const SceneTexture &src);
     SceneTexture& operator =(const SceneTexture &src);
@@ -182,19 +183,57 @@ public:
                              IRenderingContext &ctx,
                              const tinygltf::Model &model,
                              const std::wstring &logPrefix);
-
-    std::wstring    GetName()   const { return mName; }
-    bool            IsLoaded()  const { return mIsLoaded; }
+    // Mip chain of the image is generated unless it is passed in already
+    // (matching IsSrgb() and SelectBcFormat())
+    bool CreateFromGltfImage(IRenderingContext &ctx,
+                             const tinygltf::Image &image,
+                             const std::wstring &logPrefix,
+                             const MipChain *mipChain = nullptr);
+    bool CreateFromRgbaData(IRenderingContext &ctx,
+                            uint32_t width,
+                            uint32_t height,
+                            const uint8_t *data);
+    bool CreateFromMipChain(IRenderingContext &ctx, const MipChain &mipChain);
+
+    std::wstring        GetName()   const { return mName; }
+    bool                IsLoaded()  const { return mIsLoaded; }
+    bool                IsSrgb()    const { return mValueType == eSrgb; }
+
+    // Index of the glTF image used by the texture, -1 if none. With deferred image decoding
+    // (see GltfUtils::LoadModel) the texture is not loaded until CreateFromGltfImage() is called.
+    int                 GetImageIdx() const { return mImageIdx; }
+    bool                IsWaitingForImage() const { return !mIsLoaded && (mImageIdx >= 0); }
+
+    // Applies to textures created from image data afterwards
+    void                SetCompression(TextureCompression compression) { mCompression = compression; }
+
+    // Neutral constant textures are shared via the cache if set
+    void                SetTextureCache(TextureCache *cache) { mTextureCache = cache; }
+
+    // Uses a device texture created from the texture's image elsewhere (takes a new reference)
+    void                SetImageTexture(IDeviceTexture *texture);
+
+    // Identifies how texels of the image are stored for the texture (apart from the color space).
+    // Textures of the same image with equal keys can share one device texture.
+    uint32_t            GetEncodingKey() const;
+
+    // Block compression format of the texture created from the given RGBA8 image
+    BcEncoder::Format   SelectBcFormat(uint32_t width, uint32_t height, const uint8_t *texels) const;
+    BcEncoder::Quality  GetBcQuality() const;
 
 private:
-    std::wstring    mName;
-    ValueType       mValueType;
-    XMFLOAT4        mNeutralValue;
-    bool            mIsLoaded;
+    std::wstring        mName;
+    ValueType           mValueType;
+    SceneMath::Float4   mNeutralValue;
+    Channels            mChannels;
+    TextureCompression  mCompression;
+    TextureCache       *mTextureCache;
+    bool                mIsLoaded;
+    int                 mImageIdx;
     // TODO: sampler, texCoord
 
 public:
-    ID3D11ShaderResourceView* srv;
+    IDeviceTexture*     srv;
 };
 
 
@@ -202,7 +241,7 @@ class SceneNormalTexture : public SceneTexture
 {
 public:
     SceneNormalTexture(const std::wstring &name) :
-        SceneTexture(name, SceneTexture::eLinear, XMFLOAT4(0.5f, 0.5f, 1.f, 1.f)) {}
+        SceneTexture(name, SceneTexture::eLinear, SceneMath::Float4(0.5f, 0.5f, 1.f, 1.f), SceneTexture::eRg) {}
     ~SceneNormalTexture() {}
 
     bool CreateNeutral(IRenderingContext &ctx);
@@ -223,7 +262,7 @@ class SceneOcclusionTexture : public SceneTexture
 {
 public:
     SceneOcclusionTexture(const std::wstring &name) :
-        SceneTexture(name, SceneTexture::eLinear, XMFLOAT4(1.f, 0.f, 0.f, 1.f)) {}
+        SceneTexture(name, SceneTexture::eLinear, SceneMath::Float4(1.f, 0.f, 0.f, 1.f), SceneTexture::eR) {}
     ~SceneOcclusionTexture() {}
 
     bool CreateNeutral(IRenderingContext &ctx);
@@ -258,13 +297,13 @@ public:
 
     bool CreatePbrSpecularity(IRenderingContext &ctx,
                               const wchar_t * diffuseTexPath,
-                              XMFLOAT4 diffuseFactor,
+                              SceneMath::Float4 diffuseFactor,
                               const wchar_t * specularTexPath,
-                              XMFLOAT4 specularFactor);
+                              SceneMath::Float4 specularFactor);
 
     bool CreatePbrMetalness(IRenderingContext &ctx,
                             const wchar_t * baseColorTexPath,
-                            XMFLOAT4 baseColorFactor,
+                            SceneMath::Float4 baseColorFactor,
                             const wchar_t * metallicRoughnessTexPath,
                             float metallicFactor,
                             float roughnessFactor);
@@ -274,50 +313,64 @@ public:
                       const tinygltf::Material &material,
                       const std::wstring &logPrefix);
 
+    // Adds textures which wait for their glTF image to be decoded
+    void GatherPendingTextures(std::vector<SceneTexture*> &textures);
+
+    void SetTextureCompression(TextureCompression compression);
+    void SetTextureCache(TextureCache *cache);
+
+    // All textures in a fixed order: base color, metallic/roughness, specular, normal, occlusion, emission
+    static const size_t kTextureCount = 6;
+    void GetTextures(SceneTexture *(&textures)[kTextureCount]);
+    void GetTextures(const SceneTexture *(&textures)[kTextureCount]) const;
+
     MaterialWorkflow GetWorkflow() const { return mWorkflow; }
+    const std::string& GetName() const { return mName; } // Empty if not loaded from glTF
 
     const SceneTexture &            GetBaseColorTexture()           const { return mBaseColorTexture; };
-    XMFLOAT4                        GetBaseColorFactor()            const { return mBaseColorFactor; }
+    SceneMath::Float4               GetBaseColorFactor()            const { return mBaseColorFactor; }
     const SceneTexture &            GetMetallicRoughnessTexture()   const { return mMetallicRoughnessTexture; };
-    XMFLOAT4                        GetMetallicRoughnessFactor()    const { return mMetallicRoughnessFactor; }
+    SceneMath::Float4               GetMetallicRoughnessFactor()    const { return mMetallicRoughnessFactor; }
 
     const SceneTexture &            GetSpecularTexture()            const { return mSpecularTexture; };
-    XMFLOAT4                        GetSpecularFactor()             const { return mSpecularFactor; }
+    SceneMath::Float4               GetSpecularFactor()             const { return mSpecularFactor; }
 
     const SceneNormalTexture &      GetNormalTexture()              const { return mNormalTexture; };
     const SceneOcclusionTexture &   GetOcclusionTexture()           const { return mOcclusionTexture; };
     const SceneTexture &            GetEmissionTexture()            const { return mEmissionTexture; };
-    XMFLOAT4                        GetEmissionFactor()             const { return mEmissionFactor; }
+    SceneMath::Float4               GetEmissionFactor()             const { return mEmissionFactor; }
 
     void Animate(IRenderingContext &ctx);
 
 private:
+    friend class Scene;
 
-    MaterialWorkflow    mWorkflow;
+    std::string             mName;
+    MaterialWorkflow        mWorkflow;
 
     // Metal/roughness workflow
-    SceneTexture        mBaseColorTexture;
-    XMFLOAT4            mBaseColorFactor;
-    SceneTexture        mMetallicRoughnessTexture;
-    XMFLOAT4            mMetallicRoughnessFactor;
+    SceneTexture            mBaseColorTexture;
+    SceneMath::Float4       mBaseColorFactor;
+    SceneTexture            mMetallicRoughnessTexture;
+    SceneMath::Float4       mMetallicRoughnessFactor;
 
     // Specularity workflow
-    SceneTexture        mSpecularTexture;
-    XMFLOAT4            mSpecularFactor;
+    SceneTexture            mSpecularTexture;
+    SceneMath::Float4       mSpecularFactor;
     //TODO...
 
     // Both workflows
     SceneNormalTexture      mNormalTexture;
     SceneOcclusionTexture   mOcclusionTexture;
     SceneTexture            mEmissionTexture;
-    XMFLOAT4                mEmissionFactor;
+    SceneMath::Float4       mEmissionFactor;
 };
 
 
 
 struct AmbientLight
 {
-    XMFLOAT4 luminance; // omnidirectional luminance: lm * sr-1 * m-2
+    SceneMath::Float4 luminance; // omnidirectional luminance: lm * sr-1 * m-2
 
     AmbientLight() :
         luminance{}
@@ -328,9 +381,9 @@ struct AmbientLight
 // Directional light
 struct DirectLight
 {
-    XMFLOAT4 dir;
-    XMFLOAT4 dirTransf;
-    XMFLOAT4 luminance; // lm * sr-1 * m-2 ... Really???
+    SceneMath::Float4 dir;
+    SceneMath::Float4 dirTransf;
+    SceneMath::Float4 luminance; // lm * sr-1 * m-2 ... Really???
 
     DirectLight() :
         dir{},
@@ -343,13 +396,72 @@ struct DirectLight
 struct PointLight
 {
     // Parameters
-    XMFLOAT4 intensity = XMFLOAT4{ 0.f, 0.f, 0.f, 0.f }; // luminuous intensity [cd = lm * sr-1] = luminuous flux / 4Pi
+    SceneMath::Float4 intensity = SceneMath::Float4{ 0.f, 0.f, 0.f, 0.f }; // luminuous intensity [cd = lm * sr-1] = luminuous flux / 4Pi
     float orbitRadius = 5.5f;
-    float orbitInclinationMin = -XM_PIDIV4;
-    float orbitInclinationMax =  XM_PIDIV4;
+    float orbitInclinationMin = -SceneMath::kPiDiv4;
+    float orbitInclinationMax =  SceneMath::kPiDiv4;
 
     // Internals
-    XMFLOAT4 posTransf = XMFLOAT4{ 0.f, 0.f, 0.f, 0.f }; // Final position after animation
+    SceneMath::Float4 posTransf = SceneMath::Float4{ 0.f, 0.f, 0.f, 0.f }; // Final position after animation
+};
+
+
+struct SceneLoadOptions
+{
+    // Decode glTF primitives (including tangents calculation) on a pool of worker threads.
+    // Device buffers are still created on the thread which loads the scene.
+    bool        parallelGeometry = false;
+
+    // Decode glTF images on a pool of worker threads after the JSON and buffers are parsed.
+    // Each texture is uploaded on the thread which loads the scene as soon as its image is decoded.
+    bool        parallelImages = false;
+
+    // Load glTF scenes from a baked binary cache stored next to the scene file if it is up to date,
+    // otherwise load the glTF itself and (re)bake the cache (see scene_cache.hpp)
+    bool        useSceneCache = false;
+
+    // Parser of glTF files. The streaming one reads the JSON in a single pass without building
+    // a document first and skips everything the renderer does not use (animations, skins, extras).
+    GltfFrontEnd gltfFrontEnd = GltfFrontEnd::kTinyGltf;
+
+    // Block-compress glTF textures on the CPU before uploading them. Each texture role gets its own
+    // format: base color BC7 or BC1/BC3, normal map BC5, occlusion BC4, metallic/roughness BC7 or BC1.
+    TextureCompression textureCompression = TextureCompression::kNone;
+
+    // Reorder triangles and vertices of glTF primitives before their device buffers are created.
+    // ACMR/ATVR of the post-transform vertex cache before and after are reported.
+    MeshOptimization meshOptimization = MeshOptimization::kNone;
+
+    // Non-indexed glTF primitives are always welded bitwise. A positive epsilon additionally welds
+    // vertices of all glTF primitives whose components differ by at most epsilon (before optimization).
+    float       weldEpsilon = 0.f;
+
+    // Generation of normals missing in glTF triangle primitives. Smooth normals are not averaged across
+    // edges sharper than the crease angle (degrees); vertices on such edges are duplicated.
+    NormalMethod normalMethod = NormalMethod::kAngleWeighted;
+    float       normalCreaseAngle = 60.f;
+
+    // Calculation of tangents missing in glTF primitives. The fast method is several times cheaper than
+    // mikktspace, but normal maps baked against mikktspace tangents get slightly distorted shading.
+    TangentMethod tangentMethod = TangentMethod::kMikkTSpace;
+
+    // Device vertex layout of glTF primitives (see vertex_packing.hpp). Compact layouts roughly halve
+    // vertex memory and fetch bandwidth, the quantized one also needs per-primitive dequantization.
+    VertexFormat vertexFormat = VertexFormat::kFull;
+
+    // Texture cache shared with other scenes which use the same rendering context; it has to outlive
+    // the scene. If null, the scene uses its own cache, so textures are still shared among its materials.
+    TextureCache *textureCache = nullptr;
+
+    // Load glTF primitives and images on worker threads after Init() returns, so that frames can be
+    // rendered meanwhile. Nodes are drawn once their primitives are uploaded and materials use neutral
+    // textures until their images are uploaded. Uploads happen in AnimateFrame(), each frame stops
+    // after uploadBudget bytes (at least one primitive or image per frame).
+    bool        asyncLoading = false;
+    size_t      uploadBudget = 8u << 20;
+
+    // Number of worker threads; zero means one per hardware thread
+    uint32_t    workerThreadCount = 0;
 };
 
 
@@ -372,8 +484,8 @@ public:
         eHardwiredLightsOverQuad,
 
         eFirstSampleGltf, // Keep here!
-        //eGltfSampleTriangleWithoutIndices, // Non-indexed geometry not yet supported!
-        eGltfSampleTriangle = eFirstSampleGltf,
+        eGltfSampleTriangleWithoutIndices = eFirstSampleGltf,
+        eGltfSampleTriangle,
         eGltfSampleSimpleMeshes,
         eGltfSampleBox,
         eGltfSampleBoxInterleaved,
@@ -405,7 +517,7 @@ public:
         eLast = eHardhead, // Keep last!
     };
 
-    Scene(const SceneId sceneId);
+    Scene(const SceneId sceneId, const SceneLoadOptions &loadOptions = SceneLoadOptions());
     // TODO: Scene(const std::string &sceneFilePath);
     virtual ~Scene();
 
@@ -415,6 +527,25 @@ public:
     virtual void RenderFrame(IRenderingContext &ctx) override;
     virtual bool GetAmbientColor(float(&rgba)[4]) override;
 
+    // glTF file of the scene (relative to the Bin directory); empty for scenes built in code.
+    // Benchmarks use it to pick sample scenes, so that scene paths are kept in one place.
+    static std::wstring GetSceneFilePath(const SceneId sceneId);
+
+    // Primitives or textures are still being loaded in the background (see SceneLoadOptions::asyncLoading)
+    bool IsLoading() const { return mAsyncLoad != nullptr; }
+
+    // Memory owned by the scene; device textures shared with other scenes via a shared texture cache
+    // are accounted in each of them
+    const MemoryTracker& GetMemoryTracker() const { return mMemoryTracker; }
+
+    // Current and peak memory usage, texture memory of each material and the largest assets
+    void LogMemoryReport(size_t largestAssetCount) const;
+
+    const SceneGraph& GetSceneGraph() const { return mSceneGraph; }
+
+    // Scene graph nodes whose world matrices were recomputed by all frames so far
+    uint64_t GetUpdatedNodeCount() const { return mUpdatedNodeCount; }
+
 private:
 
     // Loads the scene specified via constructor
@@ -422,7 +553,7 @@ private:
     bool LoadExternal(IRenderingContext &ctx, const std::wstring &filePath);
 
     bool PostLoadSanityTest();
-    bool NodeTangentSanityTest(const SceneNode &node);
+    bool NodeTangentSanityTest(uint32_t node);
 
     // glTF loader
     bool LoadGLTF(IRenderingContext &ctx,
@@ -433,49 +564,161 @@ private:
     bool LoadSceneFromGltf(IRenderingContext &ctx,
                            const tinygltf::Model &model,
                            const std::wstring &logPrefix);
+    // Adds the node and its subtree to the scene graph in depth-first order
     bool LoadSceneNodeFromGLTF(IRenderingContext &ctx,
-                               SceneNode &sceneNode,
                                const tinygltf::Model &model,
                                int nodeIdx,
+                               uint32_t parent,
                                const std::wstring &logPrefix);
+    bool LoadPrimitivesFromGltf(IRenderingContext &ctx,
+                                const tinygltf::Model &model,
+                                const std::wstring &logPrefix);
+    bool LoadTexturesFromGltf(IRenderingContext &ctx,
+                              tinygltf::Model &model,
+                              const std::wstring &sourcePath,
+                              const std::wstring &logPrefix);
+
+    // Mip chain of a glTF image in the form needed by one or more of its textures
+    struct ImageMipChain
+    {
+        bool                isSrgb;
+        BcEncoder::Format   format;
+        MipChain            mipChain;
+    };
+
+    // Creates the distinct mip chains needed by textures of a decoded image.
+    // textureMipChains receives the index of the chain for each of the textures.
+    static void CreateImageMipChains(std::vector<ImageMipChain> &mipChains,
+                                     std::vector<size_t> &textureMipChains,
+                                     const tinygltf::Image &image,
+                                     const std::vector<SceneTexture*> &textures,
+                                     ThreadPool *encoderPool = nullptr);
+
+    static TextureCache::ImageKey GetImageKey(const std::wstring &sourcePath, const SceneTexture &texture);
+    static std::string GetImageName(const tinygltf::Model &model, int imageIdx);
+
+    // glTF primitive to decode, which doesn't touch the rendering context
+    struct PrimitiveJob
+    {
+        ScenePrimitive                  *primitive;
+        const tinygltf::Mesh            *mesh;
+        int                             primitiveIdx;
+        MeshOptimizer::VertexCacheStats statsBefore;
+        MeshOptimizer::VertexCacheStats statsAfter;
+        std::wstring                    error;  // Which step failed
+    };
+
+    void GatherPrimitiveJobs(std::vector<PrimitiveJob> &jobs, const tinygltf::Model &model);
+    static std::string GetPrimitiveName(const tinygltf::Model &model, const PrimitiveJob &job);
+    bool DecodePrimitive(PrimitiveJob &job,
+                         const tinygltf::Model &model,
+                         const std::wstring &logPrefix,
+                         ThreadPool *tangentPool) const;
+    bool CreatePrimitiveDeviceBuffers(IRenderingContext &ctx, const tinygltf::Model &model, PrimitiveJob &job);
+    void LogMeshOptimizationStats(const std::vector<PrimitiveJob> &jobs,
+                                  const std::wstring &logPrefix) const;
+
+    // glTF images to decode, each with the textures waiting for it (indexed by image)
+    struct ImageJobs
+    {
+        std::vector<int>                            imageIndices;
+        std::vector<std::vector<SceneTexture*>>     textures;
+        std::vector<std::vector<ImageMipChain>>     mipChains;
+        std::vector<std::vector<size_t>>            textureMipChains;
+    };
+
+    void GatherImageJobs(ImageJobs &jobs,
+                         const tinygltf::Model &model,
+                         const std::wstring &sourcePath,
+                         const std::wstring &logPrefix);
+    bool DecodeGltfImage(ImageJobs &jobs, tinygltf::Model &model, int imageIdx);
+    // Adds the size of the created device textures to uploadedBytes
+    bool UploadImageTextures(IRenderingContext &ctx,
+                             ImageJobs &jobs,
+                             tinygltf::Model &model,
+                             int imageIdx,
+                             const std::wstring &sourcePath,
+                             const std::wstring &logPrefix,
+                             size_t &uploadedBytes);
+
+    // Asynchronous loading
+    bool StartAsyncLoad(IRenderingContext &ctx,
+                        std::unique_ptr<tinygltf::Model> model,
+                        const std::wstring &sourcePath,
+                        const std::wstring &logPrefix);
+    void ContinueAsyncLoad(IRenderingContext &ctx);
+    void CancelAsyncLoad();
+
+    // Baked scene cache
+    bool SaveSceneCache(tinygltf::Model &model,
+                        const std::wstring &sourcePath,
+                        const std::wstring &logPrefix);
+    bool LoadSceneCache(IRenderingContext &ctx,
+                        const std::wstring &sourcePath,
+                        const std::wstring &logPrefix);
+
+    // Meshes
+    ScenePrimitive* CreateEmptyPrimitive(uint32_t node); // Adds a single-primitive mesh used by the node
+    const std::vector<ScenePrimitive>& GetNodePrimitives(uint32_t node) const;
 
     // Materials
     const SceneMaterial& GetMaterial(const ScenePrimitive &primitive) const;
+    static std::string GetMaterialName(size_t materialIdx, const SceneMaterial &material);
+
+    // Re-accounts the geometry, textures and constant buffers of the scene in its memory tracker
+    void UpdateMemoryUsage();
 
     // Lights
     void SetupDefaultLights();
     bool SetupPointLights(size_t count,
                           float intensity = 6.5f,
                           float orbitRadius = 5.5f,
-                          float orbitInclMin = -XM_PIDIV4,
-                          float orbitInclMax = XM_PIDIV4);
-    bool SetupPointLights(const std::initializer_list<XMFLOAT4> &intensities,
+                          float orbitInclMin = -SceneMath::kPiDiv4,
+                          float orbitInclMax = SceneMath::kPiDiv4);
+    bool SetupPointLights(const std::initializer_list<SceneMath::Float4> &intensities,
                           float orbitRadius = 5.5f,
-                          float orbitInclMin = -XM_PIDIV4,
-                          float orbitInclMax = XM_PIDIV4);
+                          float orbitInclMin = -SceneMath::kPiDiv4,
+                          float orbitInclMax = SceneMath::kPiDiv4);
 
-    // Transformations
+    // Transformations of the whole scene, applied after the local transformations of root nodes
     void AddScaleToRoots(double scale);
     void AddScaleToRoots(const std::vector<double> &vec);
     void AddRotationQuaternionToRoots(const std::vector<double> &vec);
     void AddTranslationToRoots(const std::vector<double> &vec);
     void AddMatrixToRoots(const std::vector<double> &vec);
 
-    void RenderNode(IRenderingContext &ctx,
-                    const SceneNode &node,
-                    const XMMATRIX &parentWorldMtrx);
+    // Rebuilds the constant buffer world matrices of nodes whose world matrices changed since the last call
+    void UpdateNodeCbWorldMatrices();
+
+    // Constant buffer world matrices are expected to be up to date
+    void RenderNode(IRenderingContext &ctx, uint32_t node);
+
+    // Sets the shader matching the vertex format of the primitive unless it is set already
+    void SetVertexShader(IRenderingContext &ctx, VertexFormat vertexFormat);
 
 private:
 
     const SceneId               mSceneId;
+    const SceneLoadOptions      mLoadOptions;
+
+    MemoryTracker               mMemoryTracker;
 
     // Geometry
-    std::vector<SceneNode>      mRootNodes;
+    SceneGraph                  mSceneGraph;
+    SceneMath::Matrix           mRootMtrx;  // See AddScaleToRoots() and others
+    SceneMath::Matrix           mAnimationMtrx; // Rotation of the whole scene, made a part of the view when rendering
+    uint64_t                    mUpdatedNodeCount = 0;
+    std::vector<SceneMath::Matrix>  mNodeCbWorldMatrices;   // Transposed for CbSceneNode, see UpdateNodeCbWorldMatrices()
+    std::vector<uint32_t>           mNodeCbWorldVersions;   // Scene graph world versions they were made from
+    uint32_t                        mNodeCbGraphVersion = 0;
+    std::vector<SceneMesh>      mMeshes;    // glTF scenes keep the glTF mesh indices
     ScenePrimitive              mPointLightProxy;
 
     // Materials
     std::vector<SceneMaterial>  mMaterials;
     SceneMaterial               mDefaultMaterial;
+    TextureCache                mOwnTextureCache;
+    TextureCache               *mTextureCache; // Own or shared
 
     // Lights
     AmbientLight                mAmbientLight;
@@ -484,25 +727,59 @@ private:
 
     // Camera
     struct {
-        XMVECTOR eye;
-        XMVECTOR at;
-        XMVECTOR up;
+        SceneMath::Float4 eye;
+        SceneMath::Float4 at;
+        SceneMath::Float4 up;
     }                           mViewData;
-    XMMATRIX                    mViewMtrx;
-    XMMATRIX                    mProjectionMtrx;
+    SceneMath::Matrix           mViewMtrx;
+    SceneMath::Matrix           mProjectionMtrx;
 
     // Shaders
 
-    ID3D11VertexShader*         mVertexShader = nullptr;
-    ID3D11PixelShader*          mPsPbrMetalness = nullptr;
-    ID3D11PixelShader*          mPsPbrSpecularity = nullptr;
-    ID3D11PixelShader*          mPsConstEmmisive = nullptr;
-    ID3D11InputLayout*          mVertexLayout = nullptr;
+    IVertexShader*              mVertexShader = nullptr;
+    IVertexShader*              mVsCompact = nullptr;   // Compact and quantized vertices share the shader
+    IVertexShader*              mVsQuantized = nullptr; // but not the input layout
+    IVertexShader*              mCurrentVertexShader = nullptr;
+    IPixelShader*               mPsPbrMetalness = nullptr;
+    IPixelShader*               mPsPbrSpecularity = nullptr;
+    IPixelShader*               mPsConstEmmisive = nullptr;
+
+    IDeviceBuffer*              mCbScene = nullptr;
+    IDeviceBuffer*              mCbFrame = nullptr;
+    IDeviceBuffer*              mCbSceneNode = nullptr;
+    IDeviceBuffer*              mCbScenePrimitive = nullptr;
 
-    ID3D11Buffer*               mCbScene = nullptr;
-    ID3D11Buffer*               mCbFrame = nullptr;
-    ID3D11Buffer*               mCbSceneNode = nullptr;
-    ID3D11Buffer*               mCbScenePrimitive = nullptr;
+    ISamplerState*              mSamplerLinear = nullptr;
 
-    ID3D11SamplerState*         mSamplerLinear = nullptr;
+    // Asynchronous loading in progress
+    struct AsyncLoad
+    {
+        std::unique_ptr<tinygltf::Model>        model;
+        std::wstring                            sourcePath;
+        std::wstring                            logPrefix;
+        std::vector<PrimitiveJob>               primitiveJobs;
+        ImageJobs                               imageJobs;
+        size_t                                  pendingJobCount = 0; // Not uploaded yet
+        int                                     failedJobCount = 0;
+        uint64_t                                frameCount = 0;
+        std::chrono::steady_clock::time_point   startTime;
+
+        // Jobs finished by the workers, waiting for upload
+        struct FinishedJob
+        {
+            bool    isImage;
+            size_t  index;      // Primitive job or image index
+            bool    success;
+        };
+        std::deque<FinishedJob>                 finishedJobs;
+        std::mutex                              finishedMutex;
+        std::atomic<bool>                       isCancelled{ false };
+
+        // Splits tangents calculation of large primitives, used by the jobs
+        std::unique_ptr<ThreadPool>             tangentPool;
+
+        // Destroyed first, so that no job outlives the data above
+        std::unique_ptr<ThreadPool>             pool;
+    };
+    std::unique_ptr<AsyncLoad>  mAsyncLoad;
 };
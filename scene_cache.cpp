@@ -0,0 +1,572 @@
+#include "scene_cache.hpp"
+
+#include "scene.hpp"
+#include "gltf_utils.hpp"
+#include "load_profiler.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+using namespace SceneMath;
+
+
+std::wstring SceneCache::GetCachePath(const std::wstring &sourcePath)
+{
+    return sourcePath + L".scenecache";
+}
+
+
+// URIs in glTF are percent-encoded
+static std::string DecodeUri(const std::string &uri)
+{
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if ((uri[i] == '%') && (i + 2 < uri.size()))
+        {
+            const std::string hex = uri.substr(i + 1, 2);
+            char *end = nullptr;
+            const long value = strtol(hex.c_str(), &end, 16);
+            if (end == hex.c_str() + 2)
+            {
+                decoded.push_back((char)value);
+                i += 2;
+                continue;
+            }
+        }
+        decoded.push_back(uri[i]);
+    }
+    return decoded;
+}
+
+
+bool SceneCache::HashSourceFiles(uint64_t &hash,
+                                 const std::wstring &sourcePath,
+                                 const std::vector<std::string> &dependencies)
+{
+    MappedFile file;
+    if (!file.Open(sourcePath))
+        return false;
+    hash = Utils::Hash64(file.GetData(), file.GetSize());
+
+    const auto lastSeparator = sourcePath.find_last_of(L"/\\");
+    const std::wstring baseDir =
+        (lastSeparator != std::wstring::npos) ? sourcePath.substr(0, lastSeparator + 1) : L"";
+
+    for (const auto &dependency : dependencies)
+    {
+        const auto dependencyPath = baseDir + Utils::StringToWstring(DecodeUri(dependency));
+        if (!file.Open(dependencyPath))
+        {
+            Log::Debug(L"SceneCache: Failed to open scene resource \"%s\"", dependencyPath.c_str());
+            return false;
+        }
+        hash = Utils::Hash64(dependency.data(), dependency.size(), hash);
+        hash = Utils::Hash64(file.GetData(), file.GetSize(), hash);
+    }
+
+    return true;
+}
+
+
+void SceneCache::Writer::WriteString(const std::string &str)
+{
+    Write((uint32_t)str.size());
+    WriteBytes(str.data(), str.size());
+}
+
+
+void SceneCache::Writer::WriteBytes(const void *data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    mData.insert(mData.end(), bytes, bytes + size);
+}
+
+
+void SceneCache::Writer::Align(size_t alignment)
+{
+    mData.resize((mData.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+
+bool SceneCache::Writer::SaveToFile(const std::wstring &path) const
+{
+    FILE *file = nullptr;
+#ifdef _MSC_VER
+    _wfopen_s(&file, path.c_str(), L"wb");
+#else
+    file = fopen(Utils::WstringToString(path).c_str(), "wb");
+#endif
+    if (!file)
+        return false;
+
+    const bool written = (fwrite(mData.data(), 1, mData.size(), file) == mData.size());
+    const bool closed = (fclose(file) == 0);
+    if (!written || !closed)
+    {
+        // Don't leave a truncated cache behind
+#ifdef _MSC_VER
+        _wremove(path.c_str());
+#else
+        remove(Utils::WstringToString(path).c_str());
+#endif
+        return false;
+    }
+
+    return true;
+}
+
+
+bool SceneCache::Reader::ReadString(std::string &str)
+{
+    uint32_t size;
+    if (!Read(size) || (size > mSize - mOffset))
+        return false;
+    str.assign(reinterpret_cast<const char*>(mData + mOffset), size);
+    mOffset += size;
+    return true;
+}
+
+
+bool SceneCache::Reader::ReadBytes(void *data, size_t size)
+{
+    if (size > mSize - mOffset)
+        return false;
+    memcpy(data, mData + mOffset, size);
+    mOffset += size;
+    return true;
+}
+
+
+bool SceneCache::Reader::Align(size_t alignment)
+{
+    const size_t alignedOffset = (mOffset + alignment - 1) / alignment * alignment;
+    if (alignedOffset > mSize)
+        return false;
+    mOffset = alignedOffset;
+    return true;
+}
+
+
+// Texture sources stored in the cache
+enum CachedTextureSource : int32_t
+{
+    eCachedTextureNone      = -2,
+    eCachedTextureNeutral   = -1,
+    // Non-negative values are indices of cached images
+};
+
+
+bool Scene::SaveSceneCache(tinygltf::Model &model,
+                           const std::wstring &sourcePath,
+                           const std::wstring &logPrefix)
+{
+    const auto cachePath = SceneCache::GetCachePath(sourcePath);
+
+    // External resources
+    std::vector<std::string> dependencies;
+    for (const auto &buffer : model.buffers)
+        if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri))
+            dependencies.push_back(buffer.uri);
+    for (const auto &image : model.images)
+        if (!image.uri.empty() && !tinygltf::IsDataURI(image.uri))
+            dependencies.push_back(image.uri);
+
+    SceneCache::Header header = {};
+    memcpy(header.magic, SceneCache::kMagic, sizeof(header.magic));
+    header.version      = SceneCache::kVersion;
+    header.vertexSize   = sizeof(SceneVertex);
+    header.textureCompression = (uint32_t)mLoadOptions.textureCompression;
+    header.meshOptimization = (uint32_t)mLoadOptions.meshOptimization;
+    header.weldEpsilon = mLoadOptions.weldEpsilon;
+    header.normalMethod = (uint32_t)mLoadOptions.normalMethod;
+    header.normalCreaseAngle = mLoadOptions.normalCreaseAngle;
+    header.tangentMethod = (uint32_t)mLoadOptions.tangentMethod;
+    if (!SceneCache::HashSourceFiles(header.sourceHash, sourcePath, dependencies))
+    {
+        Log::Warning(L"%sFailed to hash scene source files; scene cache is not saved", logPrefix.c_str());
+        return false;
+    }
+
+    SceneCache::Writer writer;
+    writer.Write(header);
+
+    writer.Write((uint32_t)dependencies.size());
+    for (const auto &dependency : dependencies)
+        writer.WriteString(dependency);
+
+    // Mip chains of images used by material textures, one for each distinct color space and format
+    std::vector<std::vector<SceneTexture*>> imageTextures(model.images.size());
+    for (auto &material : mMaterials)
+    {
+        SceneTexture *textures[SceneMaterial::kTextureCount];
+        material.GetTextures(textures);
+        for (auto texture : textures)
+            if (texture->GetImageIdx() >= 0)
+                imageTextures[texture->GetImageIdx()].push_back(texture);
+    }
+
+    // Textures are encoded again, this time with the blocks spread over worker threads
+    ThreadPool encoderPool(mLoadOptions.workerThreadCount);
+
+    std::map<const SceneTexture*, int32_t> cachedImageIndices;
+    const size_t cachedImageCountOffset = writer.GetSize();
+    uint32_t cachedImageCount = 0;
+    writer.Write(cachedImageCount);
+    for (size_t imageIdx = 0; imageIdx < model.images.size(); imageIdx++)
+    {
+        const auto &textures = imageTextures[imageIdx];
+        if (textures.empty())
+            continue;
+
+        // Textures taken from the texture cache did not need their images decoded
+        auto &image = model.images[imageIdx];
+        if (image.as_is && !GltfUtils::DecodeImage(image))
+        {
+            Log::Warning(L"%sFailed to decode image %d; scene cache is not saved", logPrefix.c_str(), imageIdx);
+            return false;
+        }
+        if ((image.width <= 0) ||
+            (image.height <= 0) ||
+            (image.image.size() != (size_t)image.width * image.height * 4))
+        {
+            Log::Warning(L"%sImage %d is not available in decoded form; scene cache is not saved",
+                         logPrefix.c_str(), imageIdx);
+            return false;
+        }
+
+        std::vector<ImageMipChain> mipChains;
+        std::vector<size_t> textureMipChains;
+        CreateImageMipChains(mipChains, textureMipChains, image, textures, &encoderPool);
+
+        for (size_t chainIdx = 0; chainIdx < mipChains.size(); chainIdx++)
+        {
+            // Identification for the texture cache, taken from the first texture using the chain
+            const size_t firstTexture =
+                std::find(textureMipChains.begin(), textureMipChains.end(), chainIdx) - textureMipChains.begin();
+            writer.Write((int32_t)imageIdx);
+            writer.Write((uint32_t)mipChains[chainIdx].isSrgb);
+            writer.Write(textures[firstTexture]->GetEncodingKey());
+
+            const auto &mipChain = mipChains[chainIdx].mipChain;
+            writer.Write((uint32_t)mipChain.GetFormat());
+            writer.Write((uint32_t)mipChain.GetLevelCount());
+            for (size_t level = 0; level < mipChain.GetLevelCount(); level++)
+            {
+                const auto &mipLevel = mipChain.GetLevel(level);
+                writer.Write(mipLevel.width);
+                writer.Write(mipLevel.height);
+                writer.WriteArray(mipLevel.data, mipChain.GetLevelSize(level));
+            }
+        }
+
+        for (size_t t = 0; t < textures.size(); t++)
+            cachedImageIndices[textures[t]] = (int32_t)(cachedImageCount + textureMipChains[t]);
+        cachedImageCount += (uint32_t)mipChains.size();
+    }
+    writer.Overwrite(cachedImageCountOffset, cachedImageCount);
+
+    // Materials
+    writer.Write((uint32_t)mMaterials.size());
+    for (auto &material : mMaterials)
+    {
+        writer.Write((uint32_t)material.mWorkflow);
+        writer.Write(material.mBaseColorFactor);
+        writer.Write(material.mMetallicRoughnessFactor);
+        writer.Write(material.mSpecularFactor);
+        writer.Write(material.mEmissionFactor);
+        writer.Write(material.mNormalTexture.GetScale());
+        writer.Write(material.mOcclusionTexture.GetStrength());
+
+        SceneTexture *textures[SceneMaterial::kTextureCount];
+        material.GetTextures(textures);
+        for (auto texture : textures)
+        {
+            int32_t source;
+            if (texture->GetImageIdx() >= 0)
+                source = cachedImageIndices[texture];
+            else if (texture->srv)
+                source = eCachedTextureNeutral;
+            else
+                source = eCachedTextureNone;
+            writer.Write(source);
+        }
+    }
+
+    // Meshes
+    writer.Write((uint32_t)mMeshes.size());
+    for (const auto &mesh : mMeshes)
+    {
+        writer.Write((uint32_t)mesh.primitives.size());
+        for (const auto &primitive : mesh.primitives)
+        {
+            const auto &geometry = primitive.GetGeometry();
+            writer.Write((int32_t)primitive.GetMaterialIdx());
+            writer.Write((uint32_t)geometry.GetTopology());
+            writer.Write((uint32_t)geometry.IsTangentPresent());
+            writer.WriteArray(geometry.GetVertices().data(), geometry.GetVertices().size());
+            writer.WriteArray(geometry.GetIndices().data(), geometry.GetIndices().size());
+        }
+    }
+
+    // Nodes hierarchy in the depth-first order of the scene graph
+    writer.Write((uint32_t)mSceneGraph.GetNodeCount());
+    for (uint32_t node = 0; node < mSceneGraph.GetNodeCount(); node++)
+    {
+        writer.Write(mSceneGraph.GetParent(node));
+        writer.Write((int32_t)mSceneGraph.GetMeshIdx(node));
+        writer.Write(mSceneGraph.GetTranslation(node));
+        writer.Write(mSceneGraph.GetRotation(node));
+        writer.Write(mSceneGraph.GetScale(node));
+        writer.Write(mSceneGraph.GetLocalMtrx(node));
+    }
+
+    writer.Align(SceneCache::Writer::kArrayAlignment);
+    header.fileSize = writer.GetSize();
+    writer.Overwrite(0, header);
+
+    if (!writer.SaveToFile(cachePath))
+    {
+        Log::Warning(L"%sFailed to save scene cache \"%s\"", logPrefix.c_str(), cachePath.c_str());
+        return false;
+    }
+
+    Log::Debug(L"%sSaved scene cache \"%s\" (%llu B)",
+               logPrefix.c_str(), cachePath.c_str(), (unsigned long long)header.fileSize);
+
+    return true;
+}
+
+
+bool Scene::LoadSceneCache(IRenderingContext &ctx,
+                           const std::wstring &sourcePath,
+                           const std::wstring &logPrefix)
+{
+    const auto cachePath = SceneCache::GetCachePath(sourcePath);
+
+    MappedFile file;
+    if (!file.Open(cachePath))
+    {
+        Log::Debug(L"%sNo scene cache \"%s\"", logPrefix.c_str(), cachePath.c_str());
+        return false;
+    }
+
+    // Including creation of all device resources
+    LoadProfiler::ScopedTimer timer("scene cache", Utils::WstringToString(cachePath), file.GetSize());
+
+    SceneCache::Reader reader(file.GetData(), file.GetSize());
+
+    SceneCache::Header header;
+    if (!reader.Read(header) ||
+        (memcmp(header.magic, SceneCache::kMagic, sizeof(header.magic)) != 0) ||
+        (header.version != SceneCache::kVersion) ||
+        (header.vertexSize != sizeof(SceneVertex)) ||
+        (header.textureCompression != (uint32_t)mLoadOptions.textureCompression) ||
+        (header.meshOptimization != (uint32_t)mLoadOptions.meshOptimization) ||
+        (header.weldEpsilon != mLoadOptions.weldEpsilon) ||
+        (header.normalMethod != (uint32_t)mLoadOptions.normalMethod) ||
+        (header.normalCreaseAngle != mLoadOptions.normalCreaseAngle) ||
+        (header.tangentMethod != (uint32_t)mLoadOptions.tangentMethod) ||
+        (header.fileSize != file.GetSize()))
+    {
+        Log::Info(L"%sScene cache \"%s\" is invalid or outdated, rebuilding it",
+                  logPrefix.c_str(), cachePath.c_str());
+        return false;
+    }
+
+    uint32_t dependencyCount;
+    if (!reader.Read(dependencyCount))
+        return false;
+    std::vector<std::string> dependencies(dependencyCount);
+    for (auto &dependency : dependencies)
+        if (!reader.ReadString(dependency))
+            return false;
+
+    uint64_t sourceHash;
+    if (!SceneCache::HashSourceFiles(sourceHash, sourcePath, dependencies) ||
+        (sourceHash != header.sourceHash))
+    {
+        Log::Info(L"%sScene cache \"%s\" is stale, rebuilding it", logPrefix.c_str(), cachePath.c_str());
+        return false;
+    }
+
+    // From now on the scene is being filled and has to be cleaned up upon failure
+    auto fail = [&]()
+    {
+        Log::Error(L"%sFailed to load scene cache \"%s\"!", logPrefix.c_str(), cachePath.c_str());
+        mMaterials.clear();
+        mMeshes.clear();
+        mSceneGraph.Clear();
+        return false;
+    };
+
+    // Images with mip chains
+    uint32_t imageCount;
+    if (!reader.Read(imageCount))
+        return fail();
+    std::vector<TextureCache::ImageKey> imageKeys(imageCount);
+    std::vector<MipChain> images(imageCount);
+    for (uint32_t imageIdx = 0; imageIdx < imageCount; imageIdx++)
+    {
+        int32_t gltfImageIdx;
+        uint32_t isSrgb, encodingKey, format, levelCount;
+        if (!reader.Read(gltfImageIdx) ||
+            !reader.Read(isSrgb) ||
+            !reader.Read(encodingKey) ||
+            !reader.Read(format) ||
+            (format > (uint32_t)BcEncoder::Format::kBC7) ||
+            !reader.Read(levelCount) ||
+            (levelCount == 0))
+            return fail();
+
+        std::vector<MipChain::Level> levels(levelCount);
+        for (auto &level : levels)
+        {
+            uint32_t dataSize;
+            if (!reader.Read(level.width) ||
+                !reader.Read(level.height) ||
+                !reader.ReadArray(level.data, dataSize) ||
+                (dataSize != BcEncoder::GetImageSize((BcEncoder::Format)format, level.width, level.height)))
+                return fail();
+        }
+        images[imageIdx].SetLevels(levels, (BcEncoder::Format)format);
+        imageKeys[imageIdx] = TextureCache::ImageKey{ sourcePath, gltfImageIdx, isSrgb != 0, encodingKey };
+    }
+
+    // Materials
+    uint32_t materialCount;
+    if (!reader.Read(materialCount))
+        return fail();
+    mMaterials.clear();
+    mMaterials.resize(materialCount);
+    for (auto &material : mMaterials)
+    {
+        material.SetTextureCache(mTextureCache);
+
+        uint32_t workflow;
+        float normalScale, occlusionStrength;
+        if (!reader.Read(workflow) ||
+            !reader.Read(material.mBaseColorFactor) ||
+            !reader.Read(material.mMetallicRoughnessFactor) ||
+            !reader.Read(material.mSpecularFactor) ||
+            !reader.Read(material.mEmissionFactor) ||
+            !reader.Read(normalScale) ||
+            !reader.Read(occlusionStrength))
+            return fail();
+        material.mWorkflow = (MaterialWorkflow)workflow;
+
+        SceneTexture *textures[SceneMaterial::kTextureCount];
+        material.GetTextures(textures);
+        for (auto texture : textures)
+        {
+            int32_t source;
+            if (!reader.Read(source))
+                return fail();
+
+            if (source >= (int32_t)images.size())
+                return fail();
+            else if (source >= 0)
+            {
+                auto cachedTexture = mTextureCache->FindImageTexture(imageKeys[source]);
+                if (cachedTexture)
+                    texture->SetImageTexture(cachedTexture);
+                else if (texture->CreateFromMipChain(ctx, images[source]))
+                    mTextureCache->AddImageTexture(imageKeys[source], texture->srv);
+                else
+                    return fail();
+            }
+            else if (source == eCachedTextureNeutral)
+            {
+                if (!texture->CreateNeutral(ctx))
+                    return fail();
+            }
+        }
+
+        material.mNormalTexture.SetScale(normalScale);
+        material.mOcclusionTexture.SetStrength(occlusionStrength);
+    }
+
+    // Meshes
+    uint32_t meshCount;
+    if (!reader.Read(meshCount))
+        return fail();
+    mMeshes.clear();
+    mMeshes.resize(meshCount);
+    for (auto &mesh : mMeshes)
+    {
+        uint32_t primitiveCount;
+        if (!reader.Read(primitiveCount))
+            return fail();
+
+        mesh.primitives.resize(primitiveCount);
+        for (auto &primitive : mesh.primitives)
+        {
+            int32_t materialIdx;
+            uint32_t topology, isTangentPresent, vertexCount, indexCount;
+            const SceneVertex *vertices;
+            const uint32_t *indices;
+            if (!reader.Read(materialIdx) ||
+                !reader.Read(topology) ||
+                !reader.Read(isTangentPresent) ||
+                !reader.ReadArray(vertices, vertexCount) ||
+                !reader.ReadArray(indices, indexCount))
+                return fail();
+
+            primitive.SetMaterialIdx(materialIdx);
+            if (!primitive.CreateDeviceBuffers(ctx,
+                                               vertices, vertexCount,
+                                               indices, indexCount,
+                                               (PrimitiveTopology)topology,
+                                               isTangentPresent != 0,
+                                               mLoadOptions.vertexFormat))
+                return fail();
+        }
+    }
+
+    // Nodes hierarchy; parents must precede their children
+    uint32_t nodeCount;
+    if (!reader.Read(nodeCount))
+        return fail();
+    mSceneGraph.Clear();
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        uint32_t parent;
+        int32_t meshIdx;
+        Float3 translation, scale;
+        Float4 rotation;
+        Matrix localMtrx;
+        if (!reader.Read(parent) ||
+            !reader.Read(meshIdx) ||
+            !reader.Read(translation) ||
+            !reader.Read(rotation) ||
+            !reader.Read(scale) ||
+            !reader.Read(localMtrx) ||
+            ((parent != SceneGraph::kNoParent) && (parent >= i)) ||
+            (meshIdx >= (int32_t)meshCount))
+            return fail();
+
+        const auto node = mSceneGraph.AddNode(parent, std::max(meshIdx, -1));
+
+        // The local matrix is either composed from TRS again (with the same result) or given directly
+        const bool isIdentityTRS =
+            (translation.x == 0.f) && (translation.y == 0.f) && (translation.z == 0.f) &&
+            (rotation.x == 0.f) && (rotation.y == 0.f) && (rotation.z == 0.f) && (rotation.w == 1.f) &&
+            (scale.x == 1.f) && (scale.y == 1.f) && (scale.z == 1.f);
+        if (isIdentityTRS)
+            mSceneGraph.SetLocalMtrx(node, localMtrx);
+        else
+            mSceneGraph.SetLocalTRS(node, translation, rotation, scale);
+    }
+
+    Log::Debug(L"%sLoaded scene cache \"%s\"", logPrefix.c_str(), cachePath.c_str());
+
+    return true;
+}
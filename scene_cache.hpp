@@ -0,0 +1,127 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Baked scene cache: a fully processed glTF scene (vertices with tangents, indices, node hierarchy,
+// materials and decoded texels including mip chains, block-compressed if requested) stored in a single
+// versioned binary file next to the source file.
+// The cache is memory-mapped when loading and its arrays are passed to device resource creation
+// in place. It is keyed by a hash of the source file and its external resources, so a stale cache
+// is just ignored and baked again.
+// ------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace SceneCache
+{
+    // Increase whenever the layout of the cache data changes
+    const uint32_t kVersion = 10;
+
+    struct Header
+    {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    vertexSize;     // sizeof(SceneVertex) - detects vertex layout changes
+        uint64_t    fileSize;       // Detects truncated files
+        uint64_t    sourceHash;
+        uint32_t    textureCompression; // SceneLoadOptions::textureCompression used when baking
+        uint32_t    meshOptimization;   // SceneLoadOptions::meshOptimization used when baking
+        float       weldEpsilon;        // SceneLoadOptions::weldEpsilon used when baking
+        uint32_t    normalMethod;       // SceneLoadOptions::normalMethod used when baking
+        float       normalCreaseAngle;  // SceneLoadOptions::normalCreaseAngle used when baking
+        uint32_t    tangentMethod;      // SceneLoadOptions::tangentMethod used when baking
+    };
+
+    const char kMagic[8] = { 'D', 'X', '1', '1', 'S', 'C', 'N', '\0' };
+
+    std::wstring GetCachePath(const std::wstring &sourcePath);
+
+    // Hashes the source file together with its external resources (URIs relative to the source file)
+    bool HashSourceFiles(uint64_t &hash,
+                         const std::wstring &sourcePath,
+                         const std::vector<std::string> &dependencies);
+
+
+    // Serializes data into a memory block. Arrays are aligned, so that they can be used in place
+    // once the block is memory-mapped.
+    class Writer
+    {
+    public:
+
+        template <typename T>
+        void Write(const T &value)
+        {
+            WriteBytes(&value, sizeof(T));
+        }
+
+        template <typename T>
+        void WriteArray(const T *data, size_t count)
+        {
+            Write((uint32_t)count);
+            Align(kArrayAlignment);
+            WriteBytes(data, count * sizeof(T));
+        }
+
+        void WriteString(const std::string &str);
+        void WriteBytes(const void *data, size_t size);
+        void Align(size_t alignment);
+
+        // Replaces already written data
+        template <typename T>
+        void Overwrite(size_t offset, const T &value)
+        {
+            memcpy(mData.data() + offset, &value, sizeof(T));
+        }
+
+        size_t GetSize() const { return mData.size(); }
+
+        bool SaveToFile(const std::wstring &path) const;
+
+        static const size_t kArrayAlignment = 16;
+
+    private:
+
+        std::vector<uint8_t> mData;
+    };
+
+
+    // Reads data written by Writer. Arrays are not copied, just pointed to.
+    class Reader
+    {
+    public:
+
+        Reader(const uint8_t *data, size_t size) : mData(data), mSize(size) {}
+
+        template <typename T>
+        bool Read(T &value)
+        {
+            return ReadBytes(&value, sizeof(T));
+        }
+
+        template <typename T>
+        bool ReadArray(const T *&data, uint32_t &count)
+        {
+            if (!Read(count) || !Align(Writer::kArrayAlignment))
+                return false;
+            const size_t byteSize = (size_t)count * sizeof(T);
+            if (byteSize > mSize - mOffset)
+                return false;
+            data = reinterpret_cast<const T*>(mData + mOffset);
+            mOffset += byteSize;
+            return true;
+        }
+
+        bool ReadString(std::string &str);
+        bool ReadBytes(void *data, size_t size);
+        bool Align(size_t alignment);
+
+    private:
+
+        const uint8_t  *mData;
+        size_t          mSize;
+        size_t          mOffset = 0;
+    };
+}
@@ -0,0 +1,984 @@
+#include "scene_geometry.hpp"
+
+#include "normal_generator.hpp"
+#include "tangent_calculator.hpp"
+#include "accessor_decoder.hpp"
+#include "gltf_utils.hpp"
+#include "load_profiler.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include <cassert>
+
+#define STRIP_BREAK static_cast<uint32_t>(-1)
+
+using namespace SceneMath;
+
+
+static const tinygltf::Accessor& GetPrimitiveAttrAccessor(bool &accessorLoaded,
+                                                   const tinygltf::Model &model,
+                                                   const std::map<std::string, int> &attributes,
+                                                   const int primitiveIdx,
+                                                   bool requiredData,
+                                                   const std::string &attrName,
+                                                   const std::wstring &logPrefix)
+{
+    static tinygltf::Accessor dummyAccessor;
+
+    const auto attrIt = attributes.find(attrName);
+    if (attrIt == attributes.end())
+    {
+        Log::Write(requiredData ? Log::eError : Log::eDebug,
+                   L"%sNo %s attribute present in primitive %d!",
+                   logPrefix.c_str(),
+                   Utils::StringToWstring(attrName).c_str(),
+                   primitiveIdx);
+        accessorLoaded = false;
+        return dummyAccessor;
+    }
+
+    const auto accessorIdx = attrIt->second;
+    if ((accessorIdx < 0) || (accessorIdx >= model.accessors.size()))
+    {
+        Log::Error(L"%sInvalid %s accessor index (%d/%d)!",
+                   logPrefix.c_str(),
+                   Utils::StringToWstring(attrName).c_str(),
+                   accessorIdx,
+                   model.accessors.size());
+        accessorLoaded = false;
+        return dummyAccessor;
+    }
+
+    accessorLoaded = true;
+    return model.accessors[accessorIdx];
+}
+
+
+bool SceneGeometry::GenerateQuadGeometry()
+{
+    mVertices =
+    {
+        SceneVertex{ Float3(-1.0f, 0.0f, -1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3( 1.0f, 0.0f, -1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3( 1.0f, 0.0f,  1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f, 0.0f,  1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+    };
+    
+    mIndices =
+    {
+        3, 1, 0,
+        2, 1, 3,
+    };
+
+    mTopology = PrimitiveTopology::kTriangleList;
+
+    CalculateTangentsIfNeeded();
+
+    return true;
+}
+
+
+bool SceneGeometry::GenerateCubeGeometry()
+{
+    mVertices =
+    {
+        // Up
+        SceneVertex{ Float3(-1.0f, 1.0f, -1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, 1.0f, -1.0f),   Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, 1.0f,  1.0f),   Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f, 1.0f,  1.0f),  Float3(0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+
+        // Down
+        SceneVertex{ Float3(-1.0f, -1.0f, -1.0f), Float3(0.0f, -1.0f, 0.0f), Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, -1.0f, -1.0f),  Float3(0.0f, -1.0f, 0.0f), Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, -1.0f,  1.0f),  Float3(0.0f, -1.0f, 0.0f), Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f, -1.0f,  1.0f), Float3(0.0f, -1.0f, 0.0f), Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+
+        // Side 1
+        SceneVertex{ Float3(-1.0f, -1.0f,  1.0f), Float3(-1.0f, 0.0f, 0.0f), Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(-1.0f, -1.0f, -1.0f), Float3(-1.0f, 0.0f, 0.0f), Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(-1.0f,  1.0f, -1.0f), Float3(-1.0f, 0.0f, 0.0f), Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f,  1.0f,  1.0f), Float3(-1.0f, 0.0f, 0.0f), Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+
+        // Side 3
+        SceneVertex{ Float3(1.0f, -1.0f,  1.0f), Float3(1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, -1.0f, -1.0f), Float3(1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f,  1.0f, -1.0f), Float3(1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(1.0f,  1.0f,  1.0f), Float3(1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+
+        // Side 2
+        SceneVertex{ Float3(-1.0f, -1.0f, -1.0f), Float3(0.0f, 0.0f, -1.0f), Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, -1.0f, -1.0f),  Float3(0.0f, 0.0f, -1.0f), Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f,  1.0f, -1.0f),  Float3(0.0f, 0.0f, -1.0f), Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f,  1.0f, -1.0f), Float3(0.0f, 0.0f, -1.0f), Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+
+        // Side 4
+        SceneVertex{ Float3(-1.0f, -1.0f, 1.0f),  Float3(0.0f, 0.0f, 1.0f),  Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f, -1.0f, 1.0f),   Float3(0.0f, 0.0f, 1.0f),  Float4(0,0,0,0), Float2(1.0f, 0.0f) },
+        SceneVertex{ Float3(1.0f,  1.0f, 1.0f),   Float3(0.0f, 0.0f, 1.0f),  Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+        SceneVertex{ Float3(-1.0f,  1.0f, 1.0f),  Float3(0.0f, 0.0f, 1.0f),  Float4(0,0,0,0), Float2(0.0f, 1.0f) },
+    };
+
+    mIndices =
+    {
+        // Up
+        3, 1, 0,
+        2, 1, 3,
+
+        // Down
+        6, 4, 5,
+        7, 4, 6,
+
+        // Side 1
+        11, 9, 8,
+        10, 9, 11,
+
+        // Side 3
+        14, 12, 13,
+        15, 12, 14,
+
+        // Side 2
+        19, 17, 16,
+        18, 17, 19,
+
+        // Side 4
+        22, 20, 21,
+        23, 20, 22
+    };
+
+    mTopology = PrimitiveTopology::kTriangleList;
+
+    CalculateTangentsIfNeeded();
+
+    return true;
+}
+
+
+bool SceneGeometry::GenerateOctahedronGeometry()
+{
+    mVertices =
+    {
+        // Noth pole
+        SceneVertex{ Float3( 0.0f, 1.0f, 0.0f),  Float3( 0.0f, 1.0f, 0.0f),  Float4(0,0,0,0), Float2(0.0f, 0.0f) },
+
+        // Points on equator
+        SceneVertex{ Float3( 1.0f, 0.0f, 0.0f),  Float3( 1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(0.00f, 0.5f) },
+        SceneVertex{ Float3( 0.0f, 0.0f, 1.0f),  Float3( 0.0f, 0.0f, 1.0f),  Float4(0,0,0,0), Float2(0.25f, 0.5f) },
+        SceneVertex{ Float3(-1.0f, 0.0f, 0.0f),  Float3(-1.0f, 0.0f, 0.0f),  Float4(0,0,0,0), Float2(0.50f, 0.5f) },
+        SceneVertex{ Float3( 0.0f, 0.0f,-1.0f),  Float3( 0.0f, 0.0f,-1.0f),  Float4(0,0,0,0), Float2(0.75f, 0.5f) },
+
+        // South pole
+        SceneVertex{ Float3( 0.0f,-1.0f, 0.0f),  Float3( 0.0f,-1.0f, 0.0f),  Float4(0,0,0,0), Float2(1.0f, 1.0f) },
+    };
+
+    mIndices =
+    {
+        // Band ++
+        0, 2, 1,
+        1, 2, 5,
+
+        // Band -+
+        0, 3, 2,
+        2, 3, 5,
+
+        // Band --
+        0, 4, 3,
+        3, 4, 5,
+
+        // Band +-
+        0, 1, 4,
+        4, 1, 5,
+    };
+
+    mTopology = PrimitiveTopology::kTriangleList;
+
+    CalculateTangentsIfNeeded();
+
+    return true;
+}
+
+
+bool SceneGeometry::GenerateSphereGeometry(const uint16_t vertSegmCount, const uint16_t stripCount)
+{
+    if (vertSegmCount < 2)
+    {
+        Log::Error(L"Spherical stripe must have at least 2 vertical segments");
+        return false;
+    }
+    if (stripCount < 3)
+    {
+        Log::Error(L"Sphere must have at least 3 stripes");
+        return false;
+    }
+
+    const uint16_t horzLineCount = vertSegmCount - 1;
+    const uint16_t vertexCountPerStrip = 2 /*poles*/ + horzLineCount;
+    const uint16_t vertexCount = (stripCount + 1) * vertexCountPerStrip;
+    const uint16_t indexCount  = stripCount * (2 /*poles*/ + 2 * horzLineCount + 1 /*strip restart*/);
+
+    // Vertices
+    mVertices.reserve(vertexCount);
+    const float stripSizeAng = k2Pi / stripCount;
+    const float stripSizeRel =    1.f / stripCount;
+    const float vertSegmSizeAng = kPi / vertSegmCount;
+    const float vertSegmSizeRel =   1.f / vertSegmCount;
+    for (uint16_t strip = 0; strip <= stripCount; strip++) // first and last vertices need to be replicated due to texture stitching
+    {
+        // Inner segments
+        const float phi = strip * stripSizeAng;
+        const float xBase = cos(phi);
+        const float zBase = sin(phi);
+        const float uLine = strip * stripSizeRel * 1.000001f;
+        for (uint16_t line = 0; line < horzLineCount; line++)
+        {
+            const float theta = (line + 1) * vertSegmSizeAng;
+            const float ringRadius = sin(theta);
+            const float y = cos(theta);
+            const Float3 pt(xBase * ringRadius, y, zBase * ringRadius);
+            const float v = (line + 1) * vertSegmSizeRel;
+            mVertices.push_back(SceneVertex{ pt, pt,  Float4(0,0,0,0), Float2(uLine, v) }); // position==normal
+        }
+
+        // Poles
+        const Float3 northPole(0.0f,  1.0f, 0.0f);
+        const Float3 southPole(0.0f, -1.0f, 0.0f);
+        const float uPole = uLine + stripSizeRel / 2;
+        mVertices.push_back(SceneVertex{ northPole,  northPole,  Float4(0,0,0,0), Float2(uPole, 0.0f) }); // position==normal
+        mVertices.push_back(SceneVertex{ southPole,  southPole,  Float4(0,0,0,0), Float2(uPole, 1.0f) }); // position==normal
+    }
+
+    assert(mVertices.size() == vertexCount);
+
+    // Indices
+    mIndices.reserve(indexCount);
+    for (uint16_t strip = 0; strip < stripCount; strip++)
+    {
+        const uint16_t idxOffset = strip * vertexCountPerStrip;
+        mIndices.push_back(idxOffset + vertexCountPerStrip - 2); // north pole
+        for (uint16_t line = 0; line < horzLineCount; line++)
+        {
+            mIndices.push_back((idxOffset + line + vertexCountPerStrip) % vertexCount); // next strip, same line
+            mIndices.push_back( idxOffset + line);
+        }
+        mIndices.push_back(idxOffset + vertexCountPerStrip - 1); // south pole
+        mIndices.push_back(STRIP_BREAK);
+    }
+
+    assert(mIndices.size() == indexCount);
+
+    mTopology = PrimitiveTopology::kTriangleStrip;
+    //mTopology = PrimitiveTopology::kLineStrip; // debug
+
+    CalculateTangentsIfNeeded();
+
+    Log::Debug(L"SceneGeometry::GenerateSphereGeometry: "
+               L"%d segments, %d strips => %d triangles, %d vertices, %d indices",
+               vertSegmCount, stripCount,
+               stripCount * (2 * horzLineCount),
+               vertexCount, indexCount);
+
+    return true;
+}
+
+
+// Formats accepted by the decoder: float everywhere, plus the integer formats of KHR_mesh_quantization
+static bool IsAttributeFormatSupported(const tinygltf::Accessor &accessor,
+                                       int type,
+                                       bool normalizedSignedOnly)
+{
+    if (accessor.type != type)
+        return false;
+
+    switch (accessor.componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        return !normalizedSignedOnly || accessor.normalized;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return !normalizedSignedOnly;
+    default:
+        return false;
+    }
+}
+
+
+bool SceneGeometry::LoadDataFromGLTF(const tinygltf::Model &model,
+                                      const tinygltf::Mesh &mesh,
+                                      const int primitiveIdx,
+                                      const std::wstring &logPrefix,
+                                      NormalMethod normalMethod,
+                                      float normalCreaseAngle,
+                                      TangentMethod tangentMethod,
+                                      ThreadPool *pool)
+{
+    bool success = false;
+    const auto &primitive = mesh.primitives[primitiveIdx];
+    const auto &attrs = primitive.attributes;
+    const auto subItemsLogPrefix = logPrefix + L"   ";
+    const auto dataConsumerLogPrefix = subItemsLogPrefix + L"   ";
+
+    Log::Debug(L"%sPrimitive %d/%d: mode %s, attributes [%s], indices %d, material %d",
+               logPrefix.c_str(),
+               primitiveIdx,
+               mesh.primitives.size(),
+               GltfUtils::ModeToWstring(primitive.mode).c_str(),
+               GltfUtils::StringIntMapToWstring(primitive.attributes).c_str(),
+               primitive.indices,
+               primitive.material);
+
+    AccessorDecoder::AccessorView view;
+
+    // Positions
+
+    auto &posAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
+                                                 true, "POSITION", subItemsLogPrefix.c_str());
+    if (!success)
+        return false;
+
+    if (!IsAttributeFormatSupported(posAccessor, TINYGLTF_TYPE_VEC3, false))
+    {
+        Log::Error(L"%sUnsupported POSITION data type!", subItemsLogPrefix.c_str());
+        return false;
+    }
+
+    if (!AccessorDecoder::GetAccessorView(view, model, posAccessor, subItemsLogPrefix.c_str(), L"Position"))
+        return false;
+
+    mVertices.clear();
+    mVertices.reserve(posAccessor.count);
+    if (mVertices.capacity() < posAccessor.count)
+    {
+        Log::Error(L"%sUnable to allocate %d vertices!", subItemsLogPrefix.c_str(), posAccessor.count);
+        mVertices.clear();
+        return false;
+    }
+
+    mVertices.assign(posAccessor.count,
+                     SceneVertex{ Float3(0.0f, 0.0f, 0.0f),
+                                  Float3(0.0f, 0.0f, 1.0f), // TODO: Leave invalid?
+                                  Float4(1.0f, 0.5f, 0.0f, 1.0f),  // debug; TODO: Leave invalid?
+                                  Float2(0.0f, 0.0f) });
+    if (!mVertices.empty())
+        AccessorDecoder::DecodeFloats(&mVertices[0].Pos.x, sizeof(SceneVertex), 3, view);
+
+    // Normals
+    auto &normalAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
+                                                    false, "NORMAL", subItemsLogPrefix.c_str());
+    if (success)
+    {
+        if (!IsAttributeFormatSupported(normalAccessor, TINYGLTF_TYPE_VEC3, true))
+        {
+            Log::Error(L"%sUnsupported NORMAL data type!", subItemsLogPrefix.c_str());
+            return false;
+        }
+
+        if (normalAccessor.count != posAccessor.count)
+        {
+            Log::Error(L"%sNormals count (%d) is different from position count (%d)!",
+                       subItemsLogPrefix.c_str(), normalAccessor.count, posAccessor.count);
+            return false;
+        }
+
+        if (!AccessorDecoder::GetAccessorView(view, model, normalAccessor, subItemsLogPrefix.c_str(), L"Normal"))
+            return false;
+
+        if (!mVertices.empty())
+            AccessorDecoder::DecodeFloats(&mVertices[0].Normal.x, sizeof(SceneVertex), 3, view);
+    }
+    const bool areNormalsPresent = success;
+
+    // Tangents
+    auto &tangentAccessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
+                                                     false, "TANGENT", subItemsLogPrefix.c_str());
+    if (success)
+    {
+        if (!IsAttributeFormatSupported(tangentAccessor, TINYGLTF_TYPE_VEC4, true))
+        {
+            Log::Error(L"%sUnsupported TANGENT data type!", subItemsLogPrefix.c_str());
+            return false;
+        }
+
+        if (tangentAccessor.count != posAccessor.count)
+        {
+            Log::Error(L"%sTangents count (%d) is different from position count (%d)!",
+                       subItemsLogPrefix.c_str(), tangentAccessor.count, posAccessor.count);
+            return false;
+        }
+
+        if (!AccessorDecoder::GetAccessorView(view, model, tangentAccessor, subItemsLogPrefix.c_str(), L"Tangent"))
+            return false;
+
+        if (!mVertices.empty())
+            AccessorDecoder::DecodeFloats(&mVertices[0].Tangent.x, sizeof(SceneVertex), 4, view);
+
+        for (size_t i = 0; i < mVertices.size(); i++)
+        {
+            const auto &tangent = mVertices[i].Tangent;
+            if ((tangent.w != 1.f) && (tangent.w != -1.f))
+                Log::Warning(L"%s%d: tangent w component (handedness) is not equal to 1 or -1 but to %7.4f",
+                             dataConsumerLogPrefix.c_str(), i, tangent.w);
+        }
+
+        mIsTangentPresent = true;
+    }
+    else
+    {
+        Log::Debug(L"%sTangents are not present", subItemsLogPrefix.c_str());
+    }
+
+    // Texture coordinates
+    auto &texCoord0Accessor = GetPrimitiveAttrAccessor(success, model, attrs, primitiveIdx,
+                                                       false, "TEXCOORD_0", subItemsLogPrefix.c_str());
+    if (success)
+    {
+        if (!IsAttributeFormatSupported(texCoord0Accessor, TINYGLTF_TYPE_VEC2, false))
+        {
+            Log::Error(L"%sUnsupported TEXCOORD_0 data type!", subItemsLogPrefix.c_str());
+            return false;
+        }
+
+        if (texCoord0Accessor.count != posAccessor.count)
+        {
+            Log::Error(L"%sTexture coords count (%d) is different from position count (%d)!",
+                       subItemsLogPrefix.c_str(), texCoord0Accessor.count, posAccessor.count);
+            return false;
+        }
+
+        if (!AccessorDecoder::GetAccessorView(view, model, texCoord0Accessor, subItemsLogPrefix.c_str(), L"Texture coordinates"))
+            return false;
+
+        if (!mVertices.empty())
+            AccessorDecoder::DecodeFloats(&mVertices[0].Tex.x, sizeof(SceneVertex), 2, view);
+    }
+
+    // Primitive topology
+    mTopology = GltfUtils::ModeToTopology(primitive.mode);
+    if (mTopology == PrimitiveTopology::kUndefined)
+    {
+        Log::Error(L"%sUnsupported primitive topology!", subItemsLogPrefix.c_str());
+        return false;
+    }
+
+    // Indices
+
+    const auto indicesAccessorIdx = primitive.indices;
+    if (indicesAccessorIdx < 0)
+    {
+        // Non-indexed geometry: index each vertex, then merge the duplicated ones
+        mIndices.resize(mVertices.size());
+        for (size_t i = 0; i < mIndices.size(); i++)
+            mIndices[i] = (uint32_t)i;
+
+        if (!mVertices.empty() && !WeldVertices(0.f, subItemsLogPrefix))
+        {
+            Log::Error(L"%sFailed to weld vertices!", subItemsLogPrefix.c_str());
+            return false;
+        }
+        if (!areNormalsPresent && (GetVerticesPerFace() == 3))
+            if (!GenerateNormals(normalMethod, normalCreaseAngle, subItemsLogPrefix, pool))
+                return false;
+        return CalculateTangentsIfNeeded(subItemsLogPrefix, tangentMethod, pool);
+    }
+
+    if (indicesAccessorIdx >= model.accessors.size())
+    {
+        Log::Error(L"%sInvalid indices accessor index (%d/%d)!",
+                   subItemsLogPrefix.c_str(), indicesAccessorIdx, model.accessors.size());
+        return false;
+    }
+
+    const auto &indicesAccessor = model.accessors[indicesAccessorIdx];
+
+    if (indicesAccessor.type != TINYGLTF_TYPE_SCALAR)
+    {
+        Log::Error(L"%sUnsupported indices data type (must be scalar)!", subItemsLogPrefix.c_str());
+        return false;
+    }
+    if ((indicesAccessor.componentType < TINYGLTF_COMPONENT_TYPE_BYTE) ||
+        (indicesAccessor.componentType > TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT))
+    {
+        Log::Error(L"%sUnsupported indices data component type (%d)!",
+                   subItemsLogPrefix.c_str(), indicesAccessor.componentType);
+        return false;
+    }
+
+    if (!AccessorDecoder::GetAccessorView(view, model, indicesAccessor, subItemsLogPrefix.c_str(), L"Indices"))
+        return false;
+
+    mIndices.clear();
+    mIndices.reserve(indicesAccessor.count);
+    if (mIndices.capacity() < indicesAccessor.count)
+    {
+        Log::Error(L"%sUnable to allocate %d indices!", subItemsLogPrefix.c_str(), indicesAccessor.count);
+        return false;
+    }
+
+    mIndices.resize(indicesAccessor.count);
+    if (!mIndices.empty())
+        AccessorDecoder::DecodeIndices(mIndices.data(), view);
+
+    // All following passes index vertex arrays directly
+    for (size_t i = 0; i < mIndices.size(); i++)
+        if (mIndices[i] >= mVertices.size())
+        {
+            Log::Error(L"%sIndex %d at %d is out of range (%d vertices)!",
+                       subItemsLogPrefix.c_str(), mIndices[i], (int)i, (int)mVertices.size());
+            return false;
+        }
+
+    if (!areNormalsPresent && (GetVerticesPerFace() == 3))
+        if (!GenerateNormals(normalMethod, normalCreaseAngle, subItemsLogPrefix, pool))
+            return false;
+    return CalculateTangentsIfNeeded(subItemsLogPrefix, tangentMethod, pool);
+}
+
+
+static float Dot(const Float3 &a, const Float3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+bool SceneGeometry::GenerateNormals(NormalMethod method,
+                                    float creaseAngle,
+                                    const std::wstring &logPrefix,
+                                    ThreadPool *pool)
+{
+    Log::Debug(L"%sGenerating normals...", logPrefix.c_str());
+
+    LoadProfiler::ScopedTimer timer("normals", std::string(), mVertices.size() * sizeof(SceneVertex));
+    std::vector<Float3> cornerNormals;
+    if (!NormalGenerator::Calculate(cornerNormals, *this, method, creaseAngle, pool))
+    {
+        Log::Error(L"%sNormals generation failed!", logPrefix.c_str());
+        return false;
+    }
+
+    // The first corner of a vertex sets its normal, the others reuse it or a copy of the vertex
+    // with the same normal up to rounding (e.g. flat normals of coplanar triangles), or make a new copy
+    const uint32_t kNoCopy = ~0u;
+    const float kSameNormalCos = 0.999999f;
+    const size_t vertexCount = mVertices.size();
+    std::vector<uint32_t> corners(GetFaceCorners().begin(), GetFaceCorners().begin() + cornerNormals.size());
+    std::vector<char> isNormalSet(vertexCount, false);
+    std::vector<uint32_t> nextCopies(vertexCount, kNoCopy);
+    for (size_t i = 0; i < corners.size(); i++)
+    {
+        auto vertex = corners[i];
+        const auto &normal = cornerNormals[i];
+        if (!isNormalSet[vertex])
+        {
+            mVertices[vertex].Normal = normal;
+            isNormalSet[vertex] = true;
+            continue;
+        }
+
+        while (Dot(mVertices[vertex].Normal, normal) < kSameNormalCos)
+        {
+            if (nextCopies[vertex] == kNoCopy)
+            {
+                nextCopies[vertex] = (uint32_t)mVertices.size();
+                nextCopies.push_back(kNoCopy);
+                mVertices.push_back(mVertices[corners[i]]);
+                mVertices.back().Normal = normal;
+            }
+            vertex = nextCopies[vertex];
+        }
+        corners[i] = vertex;
+    }
+
+    if (mVertices.size() > vertexCount)
+    {
+        Log::Debug(L"%s   %d vertices split by their normals into %d",
+                   logPrefix.c_str(), (int)vertexCount, (int)mVertices.size());
+
+        mIndices.swap(corners);
+        mTopology = PrimitiveTopology::kTriangleList;
+        mAreFaceCornersCached = false;
+        mFaceCorners.clear();
+    }
+
+    return true;
+}
+
+
+bool SceneGeometry::CalculateTangentsIfNeeded(const std::wstring &logPrefix,
+                                              TangentMethod method,
+                                              ThreadPool *pool)
+{
+    // TODO: if (material needs tangents && are not present) ... GetMaterial()
+    // TODO: Requires position, normal, and texcoords
+    // TODO: Only for triangles?
+    if (!IsTangentPresent())
+    {
+        Log::Debug(L"%sComputing tangents...", logPrefix.c_str());
+
+        LoadProfiler::ScopedTimer timer("tangents", std::string(), mVertices.size() * sizeof(SceneVertex));
+        size_t regionCount = 1;
+        if (!TangentCalculator::Calculate(*this, method, pool, &regionCount))
+        {
+            Log::Error(L"%sTangents computation failed!", logPrefix.c_str());
+            return false;
+        }
+        if (regionCount > 1)
+            Log::Debug(L"%s   %d regions processed in parallel", logPrefix.c_str(), (int)regionCount);
+        mIsTangentPresent = true;
+    }
+
+    return true;
+}
+
+bool SceneGeometry::WeldVertices(float epsilon, const std::wstring &logPrefix)
+{
+    if (mVertices.empty())
+    {
+        Log::Error(L"%sNo vertices to weld!", logPrefix.c_str());
+        return false;
+    }
+
+    // Strips would need restarts wherever a triangle collapses
+    if (mTopology == PrimitiveTopology::kTriangleStrip)
+    {
+        GetFaceCorners();
+        mIndices.swap(mFaceCorners);
+        mTopology = PrimitiveTopology::kTriangleList;
+        mAreFaceCornersCached = false;
+        mFaceCorners.clear();
+    }
+
+    for (const auto index : mIndices)
+        if (index >= mVertices.size())
+        {
+            if (index == STRIP_BREAK)
+                Log::Error(L"%sCannot weld vertices of a strip with restarts!", logPrefix.c_str());
+            else
+                Log::Error(L"%sVertex index out of range (%u/%u)!",
+                           logPrefix.c_str(), index, (uint32_t)mVertices.size());
+            return false;
+        }
+
+    std::vector<uint32_t> weldRemap(mVertices.size());
+    const auto uniqueCount = (epsilon > 0.f) ?
+        MeshOptimizer::GenerateWeldRemap(weldRemap.data(),
+                                         &mVertices[0].Pos.x,
+                                         mVertices.size(),
+                                         sizeof(SceneVertex) / sizeof(float),
+                                         epsilon) :
+        MeshOptimizer::GenerateWeldRemap(weldRemap.data(),
+                                         mVertices.data(),
+                                         mVertices.size(),
+                                         sizeof(SceneVertex));
+
+    for (auto &index : mIndices)
+        index = weldRemap[index];
+
+    // Triangles which lost their area
+    size_t degenerateCount = 0;
+    if (mTopology == PrimitiveTopology::kTriangleList)
+    {
+        size_t outputIdx = 0;
+        for (size_t i = 0; i + 2 < mIndices.size(); i += 3)
+        {
+            const auto i0 = mIndices[i], i1 = mIndices[i + 1], i2 = mIndices[i + 2];
+            if ((i0 == i1) || (i1 == i2) || (i2 == i0))
+            {
+                degenerateCount++;
+                continue;
+            }
+            mIndices[outputIdx++] = i0;
+            mIndices[outputIdx++] = i1;
+            mIndices[outputIdx++] = i2;
+        }
+        mIndices.resize(outputIdx);
+    }
+
+    // Unique vertices which are still used, in the order of first use
+    std::vector<uint32_t> fetchRemap(uniqueCount);
+    const auto usedCount = MeshOptimizer::GenerateVertexFetchRemap(fetchRemap.data(),
+                                                                   mIndices.data(),
+                                                                   mIndices.size(),
+                                                                   uniqueCount);
+    std::vector<SceneVertex> vertices(usedCount);
+    for (size_t i = 0; i < mVertices.size(); i++)
+    {
+        const auto vertex = fetchRemap[weldRemap[i]];
+        if (vertex != MeshOptimizer::kUnusedVertex)
+            vertices[vertex] = mVertices[i]; // The last welded one, all of them are equal enough
+    }
+    for (auto &index : mIndices)
+        index = fetchRemap[index];
+
+    Log::Debug(L"%sWelded %d vertices into %d, %d degenerate triangle(s) removed",
+               logPrefix.c_str(), (int)mVertices.size(), (int)vertices.size(), (int)degenerateCount);
+    if (vertices.empty())
+        Log::Warning(L"%sAll %d triangle(s) are smaller than the weld epsilon, the primitive is dropped",
+                     logPrefix.c_str(), (int)degenerateCount);
+
+    mVertices.swap(vertices);
+    mAreFaceCornersCached = false;
+
+    return true;
+}
+
+
+bool SceneGeometry::OptimizeForRendering(bool reduceOverdraw,
+                                         MeshOptimizer::VertexCacheStats &statsBefore,
+                                         MeshOptimizer::VertexCacheStats &statsAfter)
+{
+    statsBefore = statsAfter = MeshOptimizer::VertexCacheStats();
+    if ((mTopology != PrimitiveTopology::kTriangleList) || mIndices.empty() || (mIndices.size() % 3 != 0))
+        return true;
+    for (const auto index : mIndices)
+        if (index >= mVertices.size())
+            return false;
+
+    statsBefore = MeshOptimizer::AnalyzeVertexCache(mIndices.data(), mIndices.size(), mVertices.size());
+
+    std::vector<uint32_t> indices(mIndices.size());
+    MeshOptimizer::OptimizeVertexCache(indices.data(), mIndices.data(), mIndices.size(), mVertices.size());
+    if (reduceOverdraw)
+        MeshOptimizer::OptimizeOverdraw(mIndices.data(),
+                                        indices.data(),
+                                        indices.size(),
+                                        &mVertices[0].Pos.x,
+                                        sizeof(SceneVertex),
+                                        mVertices.size());
+    else
+        mIndices.swap(indices);
+
+    // Vertices in the order of first use
+    std::vector<uint32_t> remap(mVertices.size());
+    const auto usedCount = MeshOptimizer::GenerateVertexFetchRemap(remap.data(),
+                                                                   mIndices.data(),
+                                                                   mIndices.size(),
+                                                                   mVertices.size());
+    std::vector<SceneVertex> vertices(usedCount);
+    for (size_t i = 0; i < remap.size(); i++)
+        if (remap[i] != MeshOptimizer::kUnusedVertex)
+            vertices[remap[i]] = mVertices[i];
+    mVertices.swap(vertices);
+    for (auto &index : mIndices)
+        index = remap[index];
+
+    mAreFaceCornersCached = false;
+
+    statsAfter = MeshOptimizer::AnalyzeVertexCache(mIndices.data(), mIndices.size(), mVertices.size());
+
+    return true;
+}
+
+
+size_t SceneGeometry::GetVerticesPerFace() const
+{
+    switch (mTopology)
+    {
+    case PrimitiveTopology::kPointList:
+        return 1;
+    case PrimitiveTopology::kLineList:
+        return 2;
+    case PrimitiveTopology::kLineStrip:
+        return 2;
+    case PrimitiveTopology::kTriangleList:
+        return 3;
+    case PrimitiveTopology::kTriangleStrip:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+
+size_t SceneGeometry::GetFacesCount() const
+{
+    const auto verticesPerFace = GetVerticesPerFace();
+    if (verticesPerFace == 0)
+        return 0; // Unsupported
+
+    return GetFaceCorners().size() / verticesPerFace;
+}
+
+
+const std::vector<uint32_t>& SceneGeometry::GetFaceCorners() const
+{
+    switch (mTopology)
+    {
+    case PrimitiveTopology::kLineStrip:
+    case PrimitiveTopology::kTriangleStrip:
+        FillFaceCornersCacheIfNeeded();
+        return mFaceCorners;
+
+    case PrimitiveTopology::kPointList:
+    case PrimitiveTopology::kLineList:
+    case PrimitiveTopology::kTriangleList:
+    default:
+        return mIndices;
+    }
+}
+
+
+void SceneGeometry::FillFaceCornersCacheIfNeeded() const
+{
+    if (mAreFaceCornersCached)
+        return;
+
+    const auto verticesPerFace = GetVerticesPerFace();
+    const auto count = mIndices.size();
+
+    mFaceCorners.clear();
+    mFaceCorners.reserve(count * verticesPerFace);
+
+    for (size_t i = 0; i < count; )
+    {
+        // Start
+        while ((i < count) && (mIndices[i] == STRIP_BREAK))
+        {
+            ++i;
+        }
+        const size_t start = i;
+
+        // Length
+        size_t length = 0;
+        while ((i < count) && (mIndices[i] != STRIP_BREAK))
+        {
+            ++length;
+            ++i;
+        }
+
+        // Strip faces
+        if (length >= verticesPerFace)
+        {
+            const auto faceCount = length - (verticesPerFace - 1);
+            for (size_t face = 0; face < faceCount; face++)
+                for (size_t vertex = 0; vertex < verticesPerFace; vertex++)
+                    mFaceCorners.push_back(mIndices[start + face + GetVertexIndex((int)face, (int)vertex)]);
+        }
+    }
+
+    mAreFaceCornersCached = true;
+}
+
+
+size_t SceneGeometry::GetVertexIndex(const int face, const int vertex) const
+{
+    if (vertex >= GetVerticesPerFace())
+        return 0;
+
+    switch (mTopology)
+    {
+    case PrimitiveTopology::kPointList:
+    case PrimitiveTopology::kLineList:
+    case PrimitiveTopology::kTriangleList:
+    case PrimitiveTopology::kLineStrip:
+        return vertex;
+
+    case PrimitiveTopology::kTriangleStrip:
+    {
+        const bool isOdd = (face % 2 == 1);
+
+        if (isOdd && (vertex == 1))
+            return 2;
+        else if (isOdd && (vertex == 2))
+            return 1;
+        else
+            return vertex;
+    }
+
+    default:
+        return 0; // Unsupported
+    }
+}
+
+
+const SceneVertex& SceneGeometry::GetVertex(const int face, const int vertex) const
+{
+    static const SceneVertex invalidVert{};
+
+    const auto verticesPerFace = GetVerticesPerFace();
+    if ((face < 0) || (vertex < 0) || ((size_t)vertex >= verticesPerFace))
+        return invalidVert;
+
+    const auto &corners = GetFaceCorners();
+    const auto idx = face * verticesPerFace + vertex;
+    if (idx >= corners.size())
+        return invalidVert;
+    return mVertices[corners[idx]];
+}
+
+
+SceneVertex& SceneGeometry::GetVertex(const int face, const int vertex)
+{
+    return
+        const_cast<SceneVertex &>(
+            static_cast<const SceneGeometry&>(*this).
+                GetVertex(face, vertex));
+}
+
+
+void SceneGeometry::GetPosition(float outpos[],
+                                 const int face,
+                                 const int vertex) const
+{
+    const auto &pos = GetVertex(face, vertex).Pos;
+    outpos[0] = pos.x;
+    outpos[1] = pos.y;
+    outpos[2] = pos.z;
+}
+
+
+void SceneGeometry::GetNormal(float outnormal[],
+                               const int face,
+                               const int vertex) const
+{
+    const auto &normal = GetVertex(face, vertex).Normal;
+    outnormal[0] = normal.x;
+    outnormal[1] = normal.y;
+    outnormal[2] = normal.z;
+}
+
+
+void SceneGeometry::GetTextCoord(float outuv[],
+                                  const int face,
+                                  const int vertex) const
+{
+    const auto &tex = GetVertex(face, vertex).Tex;
+    outuv[0] = tex.x;
+    outuv[1] = tex.y;
+}
+
+
+void SceneGeometry::SetTangent(const float intangent[],
+                                const float sign,
+                                const int face,
+                                const int vertex)
+{
+    auto &tangent = GetVertex(face, vertex).Tangent;
+    tangent.x = intangent[0];
+    tangent.y = intangent[1];
+    tangent.z = intangent[2];
+    tangent.w = sign;
+}
+
+
+
+void SceneGeometry::Clear()
+{
+    mVertices.clear();
+    mIndices.clear();
+    mTopology = PrimitiveTopology::kUndefined;
+    mIsTangentPresent = false;
+
+    mAreFaceCornersCached = false;
+    mFaceCorners.clear();
+}
+
+
+size_t SceneGeometry::GetSize() const
+{
+    return
+        mVertices.capacity() * sizeof(SceneVertex) +
+        mIndices.capacity() * sizeof(uint32_t) +
+        mFaceCorners.capacity() * sizeof(uint32_t);
+}
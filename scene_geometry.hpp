@@ -0,0 +1,143 @@
+#pragma once
+
+#include "scene_math.hpp"
+#include "mesh_optimizer.hpp"
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct SceneVertex
+{
+    SceneMath::Float3 Pos;
+    SceneMath::Float3 Normal;
+    SceneMath::Float4 Tangent; // w represents handedness of the tangent basis and is either 1 or -1
+    SceneMath::Float2 Tex;
+};
+
+
+// Values match D3D_PRIMITIVE_TOPOLOGY so that rendering backends can pass them through
+enum class PrimitiveTopology
+{
+    kUndefined      = 0,
+    kPointList      = 1,
+    kLineList       = 2,
+    kLineStrip      = 3,
+    kTriangleList   = 4,
+    kTriangleStrip  = 5,
+};
+
+
+// Generation of missing normals (see NormalGenerator)
+enum class NormalMethod
+{
+    kFlat,          // Face normals; vertices are split wherever their triangles are not coplanar
+    kAreaWeighted,  // Smooth normals averaged over triangles weighted by their areas
+    kAngleWeighted, // Smooth normals averaged over triangles weighted by their corner angles
+};
+
+
+// Calculation of missing tangents (see TangentCalculator)
+enum class TangentMethod
+{
+    kMikkTSpace,    // Exact mikktspace tangents, which normal maps are usually baked with
+    kFast,          // Per-vertex accumulation of triangle tangents; approximates mikktspace
+};
+
+
+// CPU-side geometry of a scene primitive: no device resources are involved here
+class SceneGeometry
+{
+public:
+
+    bool GenerateQuadGeometry();
+    bool GenerateCubeGeometry();
+    bool GenerateOctahedronGeometry();
+    bool GenerateSphereGeometry(const uint16_t vertSegmCount = 40,
+                                const uint16_t stripCount = 80);
+
+    // Missing normals of triangles are generated (see GenerateNormals()) before tangents are calculated.
+    // Large meshes get their normals and tangents calculated on the workers of the pool, if given.
+    bool LoadDataFromGLTF(const tinygltf::Model &model,
+                          const tinygltf::Mesh &mesh,
+                          const int primitiveIdx,
+                          const std::wstring &logPrefix,
+                          NormalMethod normalMethod = NormalMethod::kAngleWeighted,
+                          float normalCreaseAngle = 60.f,
+                          TangentMethod tangentMethod = TangentMethod::kMikkTSpace,
+                          ThreadPool *pool = nullptr);
+
+    // Replaces normals of all vertices used by triangles (see NormalGenerator::Calculate()). A vertex
+    // whose corners get different normals is duplicated; triangle strips are converted to lists then.
+    bool GenerateNormals(NormalMethod method,
+                         float creaseAngle,
+                         const std::wstring &logPrefix = std::wstring(),
+                         ThreadPool *pool = nullptr);
+
+    // Uses mikktspace tangent space calculator by Morten S. Mikkelsen or its fast approximation.
+    // Requires position, normal, and texture coordinates to be already loaded.
+    // See TangentCalculator::Calculate() for the pool usage.
+    bool CalculateTangentsIfNeeded(const std::wstring &logPrefix = std::wstring(),
+                                   TangentMethod method = TangentMethod::kMikkTSpace,
+                                   ThreadPool *pool = nullptr);
+
+    // Merges duplicate vertices (bitwise identical ones, or ones with positions within epsilon and equal
+    // other attributes if epsilon is positive) and drops the triangles which become degenerate; triangle
+    // strips are converted to lists first. The remaining vertices are stored in the order of their first
+    // use. A triangle primitive smaller than epsilon is left without any vertices, which is not drawn.
+    bool WeldVertices(float epsilon, const std::wstring &logPrefix = std::wstring());
+
+    // Reorders triangles for the post-transform vertex cache (and optionally to reduce overdraw),
+    // then vertices in the order of their first use, dropping unused ones (see mesh_optimizer.hpp).
+    // Only indexed triangle lists are optimized, other geometry is left untouched (with empty stats).
+    // Returns false for invalid indices.
+    bool OptimizeForRendering(bool reduceOverdraw,
+                              MeshOptimizer::VertexCacheStats &statsBefore,
+                              MeshOptimizer::VertexCacheStats &statsAfter);
+
+    size_t GetVerticesPerFace() const;
+    size_t GetFacesCount() const;
+
+    // Vertex indices of all faces, GetVerticesPerFace() per face in the order expected by mikktspace.
+    // Strips are resolved (restarts removed and the winding of odd faces flipped) once and cached.
+    const std::vector<uint32_t>& GetFaceCorners() const;
+
+    size_t GetVertexIndex(const int face, const int vertex) const;
+    const SceneVertex& GetVertex(const int face, const int vertex) const;
+          SceneVertex& GetVertex(const int face, const int vertex);
+    void GetPosition(float outpos[], const int face, const int vertex) const;
+    void GetNormal(float outnormal[], const int face, const int vertex) const;
+    void GetTextCoord(float outuv[], const int face, const int vertex) const;
+    void SetTangent(const float tangent[], const float sign, const int face, const int vertex);
+
+    bool IsTangentPresent() const { return mIsTangentPresent; }
+
+    const std::vector<SceneVertex>& GetVertices()   const { return mVertices; }
+          std::vector<SceneVertex>& GetVertices()         { return mVertices; }
+    const std::vector<uint32_t>&    GetIndices()    const { return mIndices; }
+    PrimitiveTopology               GetTopology()   const { return mTopology; }
+
+    // CPU memory taken by the geometry including cached data
+    size_t GetSize() const;
+
+    void Clear();
+
+private:
+
+    void FillFaceCornersCacheIfNeeded() const;
+
+private:
+
+    std::vector<SceneVertex>    mVertices;
+    std::vector<uint32_t>       mIndices;
+    PrimitiveTopology           mTopology = PrimitiveTopology::kUndefined;
+    bool                        mIsTangentPresent = false;
+
+    // Cached geometry data (strips only, lists use mIndices directly)
+    mutable bool                    mAreFaceCornersCached = false;
+    mutable std::vector<uint32_t>   mFaceCorners;
+};
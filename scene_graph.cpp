@@ -0,0 +1,164 @@
+#include "scene_graph.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SCENE_GRAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace SceneMath;
+
+const uint32_t SceneGraph::kNoParent;
+
+
+// Same as result = a * b including the order of operations, so the results are identical
+static void MultiplyMatrices(Matrix &result, const Matrix &a, const Matrix &b)
+{
+#ifdef SCENE_GRAPH_SSE2
+    const __m128 b0 = _mm_loadu_ps(b.m[0]);
+    const __m128 b1 = _mm_loadu_ps(b.m[1]);
+    const __m128 b2 = _mm_loadu_ps(b.m[2]);
+    const __m128 b3 = _mm_loadu_ps(b.m[3]);
+    for (int row = 0; row < 4; row++)
+    {
+        __m128 r = _mm_mul_ps(_mm_set1_ps(a.m[row][0]), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][1]), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][2]), b2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][3]), b3));
+        _mm_storeu_ps(result.m[row], r);
+    }
+#else
+    result = a * b;
+#endif
+}
+
+
+void SceneGraph::Clear()
+{
+    mParents.clear();
+    mMeshIndices.clear();
+    mTranslations.clear();
+    mRotations.clear();
+    mScales.clear();
+    mLocalMatrices.clear();
+    mWorldMatrices.clear();
+    mWorldVersions.clear();
+    mDirtyFlags.clear();
+    mDirtyNodeCount = 0;
+    mIsRootMtrxValid = false;
+    mVersion++;
+}
+
+
+void SceneGraph::Reserve(size_t nodeCount)
+{
+    mParents.reserve(nodeCount);
+    mMeshIndices.reserve(nodeCount);
+    mTranslations.reserve(nodeCount);
+    mRotations.reserve(nodeCount);
+    mScales.reserve(nodeCount);
+    mLocalMatrices.reserve(nodeCount);
+    mWorldMatrices.reserve(nodeCount);
+    mWorldVersions.reserve(nodeCount);
+    mDirtyFlags.reserve(nodeCount);
+}
+
+
+uint32_t SceneGraph::AddNode(uint32_t parent, int meshIdx)
+{
+    const auto node = (uint32_t)mParents.size();
+    assert((parent == kNoParent) || (parent < node));
+
+    mParents.push_back(parent);
+    mMeshIndices.push_back(meshIdx);
+    mTranslations.push_back(Float3(0.f, 0.f, 0.f));
+    mRotations.push_back(Float4(0.f, 0.f, 0.f, 1.f));
+    mScales.push_back(Float3(1.f, 1.f, 1.f));
+    mLocalMatrices.push_back(MatrixIdentity());
+    mWorldMatrices.push_back(MatrixIdentity());
+    mWorldVersions.push_back(0);
+    mDirtyFlags.push_back(1);
+    mDirtyNodeCount++;
+
+    return node;
+}
+
+
+void SceneGraph::MarkDirty(uint32_t node)
+{
+    if (!mDirtyFlags[node])
+    {
+        mDirtyFlags[node] = 1;
+        mDirtyNodeCount++;
+    }
+}
+
+
+void SceneGraph::SetLocalTRS(uint32_t node,
+                             const Float3 &translation,
+                             const Float4 &rotation,
+                             const Float3 &scale)
+{
+    mTranslations[node] = translation;
+    mRotations[node] = rotation;
+    mScales[node] = scale;
+    mLocalMatrices[node] = MatrixScaling(scale.x, scale.y, scale.z) *
+                           MatrixRotationQuaternion(rotation) *
+                           MatrixTranslation(translation.x, translation.y, translation.z);
+    MarkDirty(node);
+}
+
+
+void SceneGraph::SetLocalMtrx(uint32_t node, const Matrix &mtrx)
+{
+    mTranslations[node] = Float3(0.f, 0.f, 0.f);
+    mRotations[node] = Float4(0.f, 0.f, 0.f, 1.f);
+    mScales[node] = Float3(1.f, 1.f, 1.f);
+    mLocalMatrices[node] = mtrx;
+    MarkDirty(node);
+}
+
+
+size_t SceneGraph::UpdateWorldMatrices(const Matrix &rootMtrx)
+{
+    const bool isRootChanged = !mIsRootMtrxValid || (memcmp(&rootMtrx, &mRootMtrx, sizeof(Matrix)) != 0);
+    if (!isRootChanged && (mDirtyNodeCount == 0))
+        return 0;
+
+    mRootMtrx = rootMtrx;
+    mIsRootMtrxValid = true;
+
+    const size_t nodeCount = mParents.size();
+    const uint32_t *parents = mParents.data();
+    const Matrix *localMatrices = mLocalMatrices.data();
+    Matrix *worldMatrices = mWorldMatrices.data();
+    uint32_t *worldVersions = mWorldVersions.data();
+    uint8_t *dirtyFlags = mDirtyFlags.data();
+
+    // Parents precede their children, so their world matrices and flags are final already
+    const uint32_t version = mVersion + 1;
+    size_t updatedNodeCount = 0;
+    for (size_t node = 0; node < nodeCount; node++)
+    {
+        const auto parent = parents[node];
+        const bool isParentChanged = (parent == kNoParent) ? isRootChanged : (dirtyFlags[parent] != 0);
+        if (!isParentChanged && !dirtyFlags[node])
+            continue;
+
+        MultiplyMatrices(worldMatrices[node],
+                         localMatrices[node],
+                         (parent == kNoParent) ? mRootMtrx : worldMatrices[parent]);
+        worldVersions[node] = version;
+        dirtyFlags[node] = 1;
+        updatedNodeCount++;
+    }
+
+    memset(dirtyFlags, 0, nodeCount);
+    mDirtyNodeCount = 0;
+    if (updatedNodeCount > 0)
+        mVersion = version;
+
+    return updatedNodeCount;
+}
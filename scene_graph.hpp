@@ -0,0 +1,77 @@
+#pragma once
+
+#include "scene_math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Node hierarchy flattened into arrays indexed by node. Nodes are stored in depth-first order, so each
+// parent precedes its children and world matrices of all nodes are computed by a single linear pass.
+// Nodes whose local transformation changes are marked dirty and only they and their subtrees get their
+// world matrices recomputed; each recomputation sets the world version of the node to the new graph
+// version, so consumers of world matrices can skip unchanged nodes, even after the graph is cleared.
+class SceneGraph
+{
+public:
+
+    static const uint32_t kNoParent = ~0u;
+
+    void Clear();
+    void Reserve(size_t nodeCount);
+
+    // Appends a dirty node with identity local transformation. The parent must be added already;
+    // nodes added in depth-first order keep it for rendering.
+    uint32_t AddNode(uint32_t parent, int meshIdx = -1);
+
+    void SetMeshIdx(uint32_t node, int meshIdx) { mMeshIndices[node] = meshIdx; }
+
+    // Local matrix is composed from scale, rotation quaternion and translation in this order (like glTF)
+    void SetLocalTRS(uint32_t node,
+                     const SceneMath::Float3 &translation,
+                     const SceneMath::Float4 &rotation,
+                     const SceneMath::Float3 &scale);
+
+    // Local matrix given directly, the TRS of the node is reset to identity
+    void SetLocalMtrx(uint32_t node, const SceneMath::Matrix &mtrx);
+
+    // World matrix of a node is its local matrix followed by the world matrix of its parent,
+    // or by rootMtrx for root nodes. Only dirty nodes and their subtrees are updated, or all nodes
+    // if rootMtrx differs from the previous one. Returns the number of updated nodes.
+    size_t UpdateWorldMatrices(const SceneMath::Matrix &rootMtrx);
+
+    size_t  GetNodeCount() const { return mParents.size(); }
+
+    // Increased whenever any world matrix changes
+    uint32_t GetVersion() const { return mVersion; }
+
+    uint32_t                    GetParent(uint32_t node)        const { return mParents[node]; }
+    int                         GetMeshIdx(uint32_t node)       const { return mMeshIndices[node]; }
+    const SceneMath::Float3&    GetTranslation(uint32_t node)   const { return mTranslations[node]; }
+    const SceneMath::Float4&    GetRotation(uint32_t node)      const { return mRotations[node]; }
+    const SceneMath::Float3&    GetScale(uint32_t node)         const { return mScales[node]; }
+    const SceneMath::Matrix&    GetLocalMtrx(uint32_t node)     const { return mLocalMatrices[node]; }
+    const SceneMath::Matrix&    GetWorldMtrx(uint32_t node)     const { return mWorldMatrices[node]; }
+    uint32_t                    GetWorldVersion(uint32_t node)  const { return mWorldVersions[node]; }
+
+private:
+
+    void MarkDirty(uint32_t node);
+
+private:
+
+    std::vector<uint32_t>           mParents;
+    std::vector<int>                mMeshIndices;   // Index into the scene's mesh table, -1 for none
+    std::vector<SceneMath::Float3>  mTranslations;
+    std::vector<SceneMath::Float4>  mRotations;
+    std::vector<SceneMath::Float3>  mScales;
+    std::vector<SceneMath::Matrix>  mLocalMatrices;
+    std::vector<SceneMath::Matrix>  mWorldMatrices;
+    std::vector<uint32_t>           mWorldVersions;
+    std::vector<uint8_t>            mDirtyFlags;    // Just during the update also set for dirty subtrees
+
+    size_t              mDirtyNodeCount = 0;
+    bool                mIsRootMtrxValid = false;
+    SceneMath::Matrix   mRootMtrx;                  // Used by the last update
+    uint32_t            mVersion = 0;
+};
@@ -0,0 +1,267 @@
+// Measures the update of world matrices (see SceneGraph::UpdateWorldMatrices()) of randomly generated
+// hierarchies against the recursive traversal of a tree of nodes, each owning its children, which the
+// scene used before: a full update after the root matrix changes, and an incremental one after local
+// transformations of 0.1% of nodes change. World matrices of both are checked to be bit-identical.
+//
+// Usage: scene_graph_benchmark [repeat count] [node counts...]
+//
+// Each time is the best of repeat count runs. Without node counts, hierarchies from 1k to 1M nodes
+// are measured.
+
+#include "scene_graph.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace SceneMath;
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t sDefaultNodeCounts[] = { 1000, 10000, 100000, 1000000 };
+
+
+// Reference node owning its children
+struct TreeNode
+{
+    Matrix                  localMtrx;
+    Matrix                  worldMtrx;
+    std::vector<TreeNode>   children;
+};
+
+
+// Random local transformation of a node, similar to the ones of glTF scenes
+static void GetRandomTRS(std::mt19937 &random, Float3 &translation, Float4 &rotation, Float3 &scale)
+{
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+
+    translation = Float3(distribution(random), distribution(random), distribution(random));
+
+    Float4 axisAngle(distribution(random), distribution(random), distribution(random), distribution(random));
+    const float sinHalf = std::sin(axisAngle.w * kPi / 2.f);
+    const float axisLength = std::sqrt(axisAngle.x * axisAngle.x + axisAngle.y * axisAngle.y + axisAngle.z * axisAngle.z);
+    const float axisScale = (axisLength > 0.f) ? sinHalf / axisLength : 0.f;
+    rotation = Float4(axisAngle.x * axisScale,
+                      axisAngle.y * axisScale,
+                      axisAngle.z * axisScale,
+                      std::cos(axisAngle.w * kPi / 2.f));
+
+    const float uniformScale = 1.f + 0.1f * distribution(random);
+    scale = Float3(uniformScale, uniformScale, uniformScale);
+}
+
+
+// Random parents with at most maxChildCount children per node and a few roots. Each parent precedes its
+// children, but the nodes are not in the depth-first order yet.
+static std::vector<uint32_t> GenerateParents(std::mt19937 &random, size_t nodeCount, size_t maxChildCount)
+{
+    std::vector<uint32_t> parents(nodeCount, SceneGraph::kNoParent);
+    std::vector<uint32_t> childCounts(nodeCount, 0);
+    const size_t rootCount = std::max<size_t>(nodeCount / 1000, 1);
+    uint32_t firstOpenNode = 0;
+    for (size_t node = rootCount; node < nodeCount; node++)
+    {
+        // Fill the nodes roughly level by level with some randomness to vary the fan-out
+        std::uniform_int_distribution<uint32_t> distribution(firstOpenNode, (uint32_t)node - 1);
+        uint32_t parent = distribution(random);
+        while (childCounts[parent] >= maxChildCount)
+            parent++;
+        parents[node] = parent;
+        childCounts[parent]++;
+        while (childCounts[firstOpenNode] >= maxChildCount)
+            firstOpenNode++;
+    }
+    return parents;
+}
+
+
+// Tree nodes are collected in the order of graph nodes
+static void BuildTree(TreeNode &treeNode,
+                      SceneGraph &graph,
+                      std::vector<TreeNode*> &treeNodes,
+                      uint32_t parent,
+                      uint32_t node,
+                      const std::vector<std::vector<uint32_t>> &children,
+                      std::mt19937 &random)
+{
+    Float3 translation, scale;
+    Float4 rotation;
+    GetRandomTRS(random, translation, rotation, scale);
+
+    const auto graphNode = graph.AddNode(parent);
+    graph.SetLocalTRS(graphNode, translation, rotation, scale);
+    treeNode.localMtrx = graph.GetLocalMtrx(graphNode);
+    treeNodes.push_back(&treeNode);
+
+    treeNode.children.resize(children[node].size());
+    for (size_t i = 0; i < children[node].size(); i++)
+        BuildTree(treeNode.children[i], graph, treeNodes, graphNode, children[node][i], children, random);
+}
+
+
+static void UpdateTree(TreeNode &treeNode, const Matrix &parentWorldMtrx)
+{
+    treeNode.worldMtrx = treeNode.localMtrx * parentWorldMtrx;
+    for (auto &child : treeNode.children)
+        UpdateTree(child, treeNode.worldMtrx);
+}
+
+
+// Compares the tree in the depth-first order, which is the order of graph nodes
+static bool IsSameTree(const TreeNode &treeNode, const SceneGraph &graph, uint32_t &node)
+{
+    if (memcmp(&treeNode.worldMtrx, &graph.GetWorldMtrx(node), sizeof(Matrix)) != 0)
+        return false;
+    node++;
+    for (const auto &child : treeNode.children)
+        if (!IsSameTree(child, graph, node))
+            return false;
+    return true;
+}
+
+
+static size_t GetTreeDepth(const TreeNode &treeNode)
+{
+    size_t depth = 0;
+    for (const auto &child : treeNode.children)
+        depth = std::max(depth, GetTreeDepth(child));
+    return depth + 1;
+}
+
+
+static bool IsSameTree(const std::vector<TreeNode> &tree, const SceneGraph &graph)
+{
+    uint32_t node = 0;
+    for (const auto &root : tree)
+        if (!IsSameTree(root, graph, node))
+            return false;
+    return true;
+}
+
+
+static bool RunBenchmark(size_t nodeCount, size_t repeatCount)
+{
+    std::mt19937 random((uint32_t)nodeCount);
+    const auto parents = GenerateParents(random, nodeCount, 8);
+
+    std::vector<std::vector<uint32_t>> children(nodeCount);
+    std::vector<uint32_t> roots;
+    for (uint32_t node = 0; node < nodeCount; node++)
+        if (parents[node] == SceneGraph::kNoParent)
+            roots.push_back(node);
+        else
+            children[parents[node]].push_back(node);
+
+    std::vector<TreeNode> tree(roots.size());
+    std::vector<TreeNode*> treeNodes;
+    treeNodes.reserve(nodeCount);
+    SceneGraph graph;
+    graph.Reserve(nodeCount);
+    size_t depth = 0;
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        BuildTree(tree[i], graph, treeNodes, SceneGraph::kNoParent, roots[i], children, random);
+        depth = std::max(depth, GetTreeDepth(tree[i]));
+    }
+
+    // Full update: the root matrix changes in each run
+    Matrix rootMtrx;
+    double treeTime = 0., graphTime = 0.;
+    for (size_t i = 0; i < repeatCount; i++)
+    {
+        rootMtrx = MatrixScaling(2.f, 2.f, 2.f) * MatrixRotationY(0.5f + 0.01f * i) * MatrixTranslation(0.f, -1.f, 0.f);
+
+        auto start = Clock::now();
+        for (auto &root : tree)
+            UpdateTree(root, rootMtrx);
+        const double treeRunTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        graph.UpdateWorldMatrices(rootMtrx);
+        const double graphRunTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        treeTime = (i == 0) ? treeRunTime : std::min(treeTime, treeRunTime);
+        graphTime = (i == 0) ? graphRunTime : std::min(graphTime, graphRunTime);
+    }
+    bool identical = IsSameTree(tree, graph);
+
+    // Incremental update: a few nodes change their local transformations in each run
+    const size_t changedCount = std::max<size_t>(nodeCount / 1000, 1);
+    std::uniform_int_distribution<uint32_t> nodeDistribution(0, (uint32_t)nodeCount - 1);
+    double incrementalTime = 0.;
+    size_t updatedCount = 0;
+    for (size_t i = 0; i < repeatCount; i++)
+    {
+        for (size_t j = 0; j < changedCount; j++)
+        {
+            Float3 translation, scale;
+            Float4 rotation;
+            GetRandomTRS(random, translation, rotation, scale);
+            const auto node = nodeDistribution(random);
+            graph.SetLocalTRS(node, translation, rotation, scale);
+            treeNodes[node]->localMtrx = graph.GetLocalMtrx(node);
+        }
+
+        const auto start = Clock::now();
+        updatedCount += graph.UpdateWorldMatrices(rootMtrx);
+        const double runTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        incrementalTime = (i == 0) ? runTime : std::min(incrementalTime, runTime);
+    }
+    for (auto &root : tree)
+        UpdateTree(root, rootMtrx);
+    identical = identical && IsSameTree(tree, graph);
+
+    // Nothing changed
+    const bool isCleanSkipped = (graph.UpdateWorldMatrices(rootMtrx) == 0);
+
+    Log::Info(L"%d nodes (%d roots, depth %d): tree %.3f ms (%.1f ns/node), graph %.3f ms (%.1f ns/node), %.2fx%s",
+              (int)nodeCount,
+              (int)roots.size(),
+              (int)depth,
+              treeTime,
+              treeTime * 1e6 / nodeCount,
+              graphTime,
+              graphTime * 1e6 / nodeCount,
+              treeTime / graphTime,
+              identical ? L"" : L" MISMATCH");
+    Log::Info(L"   %d changed node(s): %.1f updated, graph %.3f ms, %.2fx of tree%s",
+              (int)changedCount,
+              (double)updatedCount / repeatCount,
+              incrementalTime,
+              treeTime / incrementalTime,
+              isCleanSkipped ? L"" : L", UPDATED WHEN CLEAN");
+
+    if (!identical)
+        Log::Error(L"   World matrices of the scene graph differ from the tree ones!");
+    if (!isCleanSkipped)
+        Log::Error(L"   Scene graph without changes was updated!");
+
+    return identical && isCleanSkipped;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Log::sLoggingLevel = Log::eInfo;
+
+    const size_t repeatCount = (argc > 1) ? (size_t)std::max(std::atoi(argv[1]), 1) : 10;
+    std::vector<size_t> nodeCounts;
+    for (int i = 2; i < argc; i++)
+        nodeCounts.push_back((size_t)std::max(std::atoi(argv[i]), 1));
+    if (nodeCounts.empty())
+        nodeCounts.assign(std::begin(sDefaultNodeCounts), std::end(sDefaultNodeCounts));
+
+    int failedCount = 0;
+    for (const auto nodeCount : nodeCounts)
+        if (!RunBenchmark(nodeCount, repeatCount))
+            failedCount++;
+
+    return failedCount == 0 ? 0 : -1;
+}
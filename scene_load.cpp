@@ -3,21 +3,97 @@
 #include "scene_utils.hpp"
 #include "log.hpp"
 
+using namespace SceneMath;
+
+
+std::wstring Scene::GetSceneFilePath(const SceneId sceneId)
+{
+    switch (sceneId)
+    {
+    case eGltfSampleTriangleWithoutIndices:
+        return L"../Scenes/glTF-Sample-Models/TriangleWithoutIndices/TriangleWithoutIndices.gltf";
+    case eGltfSampleTriangle:
+        return L"../Scenes/glTF-Sample-Models/Triangle/Triangle.gltf";
+    case eGltfSampleSimpleMeshes:
+        return L"../Scenes/glTF-Sample-Models/SimpleMeshes/SimpleMeshes.gltf";
+    case eGltfSampleBox:
+        return L"../Scenes/glTF-Sample-Models/Box/Box.gltf";
+    case eGltfSampleBoxInterleaved:
+        return L"../Scenes/glTF-Sample-Models/BoxInterleaved/BoxInterleaved.gltf";
+    case eGltfSampleBoxTextured:
+        return L"../Scenes/glTF-Sample-Models/BoxTextured/BoxTextured.gltf";
+    case eGltfSampleMetalRoughSpheres:
+        return L"../Scenes/glTF-Sample-Models/MetalRoughSpheres/MetalRoughSpheres.gltf";
+    case eGltfSampleMetalRoughSpheresNoTextures:
+        return L"../Scenes/glTF-Sample-Models/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures.gltf";
+    case eDebugMetalRoughSpheresNoTextures:
+        //return L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures.gltf";
+        //return L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures yellow.gltf";
+        return L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures brown.gltf";
+        //return L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures white.gltf";
+        //return L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures black.gltf";
+    case eGltfSampleNormalTangentTest:
+        return L"../Scenes/glTF-Sample-Models/NormalTangentTest/glTF/NormalTangentTest.gltf";
+    case eGltfSampleNormalTangentMirrorTest:
+        return L"../Scenes/glTF-Sample-Models/NormalTangentMirrorTest/glTF/NormalTangentMirrorTest.gltf";
+    case eGltfSample2CylinderEngine:
+        return L"../Scenes/glTF-Sample-Models/2CylinderEngine/2CylinderEngine.gltf";
+    case eGltfSampleDuck:
+        return L"../Scenes/glTF-Sample-Models/Duck/Duck.gltf";
+    case eGltfSampleBoomBox:
+        return L"../Scenes/glTF-Sample-Models/BoomBox/BoomBox.gltf";
+    case eGltfSampleBoomBoxWithAxes:
+        return L"../Scenes/glTF-Sample-Models/BoomBoxWithAxes/BoomBoxWithAxes.gltf";
+    case eGltfSampleDamagedHelmet:
+        return L"../Scenes/glTF-Sample-Models/DamagedHelmet/DamagedHelmet.gltf";
+    case eGltfSampleFlightHelmet:
+        return L"../Scenes/glTF-Sample-Models/FlightHelmet/FlightHelmet.gltf";
+    case eLowPolyDrifter:
+        return L"../Scenes/Sketchfab/Ivan Norman - Low-poly truck (car Drifter)/scene.gltf";
+    case eWolfBaseMesh:
+        return L"../Scenes/Sketchfab/TheCharliEZM - Wolf base mesh/scene.gltf";
+    case eNintendoGameBoyClassic:
+        return L"../Scenes/Sketchfab/hunter333d - Nintendo Game Boy Classic/scene.gltf";
+    case eWeltron2001SpaceballRadio:
+        return L"../Scenes/Sketchfab/ArneDC - Prinzsound SM8 - Weltron 2001 Spaceball Radio/scene.gltf";
+    case eSpotMiniRigged:
+        return L"../Scenes/Sketchfab/Greg McKechnie - Spot Mini (Rigged)/scene.gltf";
+    case eMandaloriansHelmet:
+        return L"../Scenes/Sketchfab/arn204 - The Mandalorian's Helmet/scene.gltf";
+    case eTheRocket:
+        return L"../Scenes/Sketchfab/TuppsM - The Rocket/scene.gltf";
+    case eRoboV1:
+        return L"../Scenes/Sketchfab/_Sef_ - Robo_V1/scene.gltf";
+    case eRockJacket:
+        return L"../Scenes/Sketchfab/Teliri - Rock Jacket (mid-poly)/scene.gltf";
+    case eSalazarSkull:
+        return L"../Scenes/Sketchfab/jvitorsouzadesign - Skull Salazar/scene.gltf";
+    case eHardhead:
+        return L"../Scenes/Sketchfab/Felipe Oliveira Gall - Hardhead/scene.gltf";
+    case eDebugGradientBox:
+        return L"../Scenes/Debugging/GradientBox/GradientBox.gltf";
+    default:
+        return L"";
+    }
+}
+
+
 bool Scene::Load(IRenderingContext &ctx)
 {
     switch (mSceneId)
     {
-    //case eGltfSampleTriangleWithoutIndices:
-    //{
-    //    if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/TriangleWithoutIndices/TriangleWithoutIndices.gltf"))
-    //        return false;
-    //    AddScaleToRoots(3.);
-    //    break;
-    //}
+    case eGltfSampleTriangleWithoutIndices:
+    {
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
+            return false;
+        AddScaleToRoots(4.5);
+        AddTranslationToRoots({ 0., -1.5, 0. });
+        break;
+    }
 
     case eGltfSampleTriangle:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/Triangle/Triangle.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(4.5);
         AddTranslationToRoots({ 0., -1.5, 0. });
@@ -26,7 +102,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleSimpleMeshes:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/SimpleMeshes/SimpleMeshes.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(2.5);
         AddTranslationToRoots({ 0., -0.5, 0. });
@@ -35,7 +111,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleBox:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/Box/Box.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(4.);
         AddTranslationToRoots({ 0., 0., 0. });
@@ -44,7 +120,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleBoxInterleaved:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/BoxInterleaved/BoxInterleaved.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(4.);
         AddTranslationToRoots({ 0., 0., 0. });
@@ -53,7 +129,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleBoxTextured:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/BoxTextured/BoxTextured.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(4.);
         AddTranslationToRoots({ 0., 0., 0. });
@@ -67,23 +143,19 @@ bool Scene::Load(IRenderingContext &ctx)
         switch (mSceneId)
         {
         case eGltfSampleMetalRoughSpheres:
-            if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/MetalRoughSpheres/MetalRoughSpheres.gltf"))
+            if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
                 return false;
             AddTranslationToRoots({ 0., 0.0, 1.6 });
             AddScaleToRoots(0.85);
             break;
         case eGltfSampleMetalRoughSpheresNoTextures:
-            if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures.gltf"))
+            if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
                 return false;
             AddScaleToRoots(1000);
             AddTranslationToRoots({ -3.0, -3.0, 1.5 });
             break;
         case eDebugMetalRoughSpheresNoTextures:
-            //if (!LoadExternal(ctx, L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures.gltf"))
-            //if (!LoadExternal(ctx, L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures yellow.gltf"))
-            if (!LoadExternal(ctx, L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures brown.gltf"))
-            //if (!LoadExternal(ctx, L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures white.gltf"))
-            //if (!LoadExternal(ctx, L"../Scenes/Debugging/MetalRoughSpheresNoTextures/MetalRoughSpheresNoTextures black.gltf"))
+            if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
                 return false;
             AddScaleToRoots(1000);
             AddTranslationToRoots({ -3.0, -3.0, 1.5 });
@@ -117,20 +189,20 @@ bool Scene::Load(IRenderingContext &ctx)
         const float ints = 4000.f / pointLightCount;
 #endif
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         SetupPointLights(pointLightCount, ints, 20.f, 0, 0);
 
         // Camera pos
-        mViewData.eye = XMVectorSet(0.0f, 0.0f, 10.f, 1.0f);
-        mViewData.at  = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+        mViewData.eye = Float4(0.0f, 0.0f, 10.f, 1.0f);
+        mViewData.at  = Float4(0.0f, 0.0f, 0.0f, 1.0f);
 
         break;
     }
 
     case eGltfSampleNormalTangentTest:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/NormalTangentTest/glTF/NormalTangentTest.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(3.6f);
@@ -143,7 +215,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleNormalTangentMirrorTest:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/NormalTangentMirrorTest/glTF/NormalTangentMirrorTest.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(3.6f);
@@ -155,7 +227,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSample2CylinderEngine:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/2CylinderEngine/2CylinderEngine.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(0.012f);
         AddTranslationToRoots({ 0., 0.2, 0. });
@@ -167,7 +239,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleDuck:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/Duck/Duck.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(3.8);
         AddTranslationToRoots({ -0.5, -3.3, 0. });
@@ -176,7 +248,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleBoomBox:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/BoomBox/BoomBox.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(330.);
         AddTranslationToRoots({ 0., 0., 0. });
@@ -185,7 +257,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleBoomBoxWithAxes:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/BoomBoxWithAxes/BoomBoxWithAxes.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(230.);
         AddTranslationToRoots({ 0., -2.2, 0. });
@@ -194,7 +266,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleDamagedHelmet:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/DamagedHelmet/DamagedHelmet.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(3.7);
@@ -211,8 +283,8 @@ bool Scene::Load(IRenderingContext &ctx)
         const uint8_t amb = 120;
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
         const float lum = 0.8f;
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         SetupPointLights(5, 5.0f, 6.5f, 0, 0);
 
         break;
@@ -220,7 +292,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eGltfSampleFlightHelmet:
     {
-        if (!LoadExternal(ctx, L"../Scenes/glTF-Sample-Models/FlightHelmet/FlightHelmet.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(11.0);
@@ -230,15 +302,15 @@ bool Scene::Load(IRenderingContext &ctx)
         const uint8_t amb = 120;
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
         const float lum = 2.5f;
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         SetupPointLights(5, 4.0f, 6.5f, 0, 0);
         break;
     }
 
     case eLowPolyDrifter:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/Ivan Norman - Low-poly truck (car Drifter)/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(0.015);
         AddTranslationToRoots({ 0.5, -1.2, 0. });
@@ -247,7 +319,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eWolfBaseMesh:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/TheCharliEZM - Wolf base mesh/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(0.008);
         AddTranslationToRoots({ 0.7, -2.4, 0. });
@@ -256,7 +328,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eNintendoGameBoyClassic:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/hunter333d - Nintendo Game Boy Classic/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(0.50);
         AddTranslationToRoots({ 0., -1.7, 0. });
@@ -265,7 +337,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eWeltron2001SpaceballRadio:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/ArneDC - Prinzsound SM8 - Weltron 2001 Spaceball Radio/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(.016);
         AddTranslationToRoots({ 0., -3.6, 0. });
@@ -275,7 +347,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eSpotMiniRigged:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/Greg McKechnie - Spot Mini (Rigged)/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddScaleToRoots(.00028f);
         AddTranslationToRoots({ 0., 0., 2.8 });
@@ -283,13 +355,13 @@ bool Scene::Load(IRenderingContext &ctx)
         const uint8_t amb = 120;
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
         const float lum = 2.0f;
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         break;
     }
 
     case eMandaloriansHelmet:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/arn204 - The Mandalorian's Helmet/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddTranslationToRoots({ -35., -70., 85. });
@@ -302,18 +374,18 @@ bool Scene::Load(IRenderingContext &ctx)
         const uint8_t amb = 30;
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat(amb, amb, amb);
         const float lum = 1.8f;
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         const float ints = 7.0f;
         for (auto &light : mPointLights)
-            light.intensity = XMFLOAT4(ints, ints, ints, 1.0f);
+            light.intensity = Float4(ints, ints, ints, 1.0f);
 
         break;
     }
 
     case eTheRocket:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/TuppsM - The Rocket/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(.012);
@@ -323,13 +395,13 @@ bool Scene::Load(IRenderingContext &ctx)
         const uint8_t amb = 30;
         mAmbientLight.luminance = SceneUtils::SrgbColorToFloat((uint8_t)(1.0*amb), (uint8_t)(1.2*amb), (uint8_t)(1.5*amb));
         const float lum = 3.0f;
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         break;
     }
 
     case eRoboV1:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/_Sef_ - Robo_V1/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         AddTranslationToRoots({ 0., -100., -240. });
         AddScaleToRoots(.10);
@@ -338,7 +410,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eRockJacket:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/Teliri - Rock Jacket (mid-poly)/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(2.2);
@@ -350,8 +422,8 @@ bool Scene::Load(IRenderingContext &ctx)
 
         //const float lum = 0.5f;
         //mDirectLights.resize(1);
-        //mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        //mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        //mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        //mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
 
         SetupPointLights(5, 4.63f, 14.0f, 0, 0);
 
@@ -360,7 +432,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eSalazarSkull:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/jvitorsouzadesign - Skull Salazar/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(4.1);
@@ -372,8 +444,8 @@ bool Scene::Load(IRenderingContext &ctx)
 
         const float lum = 2.0f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
 
         SetupPointLights(3, 7.0f, 5.0f, 0, 0);
 
@@ -382,7 +454,7 @@ bool Scene::Load(IRenderingContext &ctx)
 
     case eHardhead:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Sketchfab/Felipe Oliveira Gall - Hardhead/scene.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
 
         AddScaleToRoots(0.75);
@@ -391,12 +463,12 @@ bool Scene::Load(IRenderingContext &ctx)
         AddRotationQuaternionToRoots({ 0.000, 0.259, 0.000, 0.966 }); // 30y
 
         const float amb = 0.35f;
-        mAmbientLight.luminance = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance = Float4(amb, amb, amb, 1.0f);
 
         const float lum = 3.0f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
 
         SetupPointLights(0, 4.0f, 5.5f, 0, 0);
 
@@ -420,34 +492,34 @@ bool Scene::Load(IRenderingContext &ctx)
                                             //L"../Textures/vfx_debug_textures by Chris Judkins/debug_uv_02.png",
                                             //L"../Textures/Debugging/VerticalSineWaves8.png",
                                             //nullptr,
-                                            //XMFLOAT4(0.f, 0.f, 0.f, 1.f),
-                                            //XMFLOAT4(0.9f, 0.9f, 0.9f, 1.f),
-                                            //XMFLOAT4(0.9f, 0.45f, 0.135f, 1.f),
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            //Float4(0.f, 0.f, 0.f, 1.f),
+                                            //Float4(0.9f, 0.9f, 0.9f, 1.f),
+                                            //Float4(0.9f, 0.45f, 0.135f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
 
                                             // Specular:
                                             nullptr,
-                                            XMFLOAT4(0.f, 0.f, 0.f, 1.f)
-                                            //XMFLOAT4(0.1f, 0.1f, 0.1f, 1.f)
-                                            //XMFLOAT4(1.f, 1.f, 1.f, 1.f)
+                                            Float4(0.f, 0.f, 0.f, 1.f)
+                                            //Float4(0.1f, 0.1f, 0.1f, 1.f)
+                                            //Float4(1.f, 1.f, 1.f, 1.f)
                                             ))
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(1, SceneNode(true));
-        if (mRootNodes.size() != 1)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
-        auto &node0 = mRootNodes[0];
-        auto primitive = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive = CreateEmptyPrimitive(node0);
         if (!primitive)
             return false;
 
         if (!primitive->CreateSphere(ctx, 50, 100))
             return false;
         primitive->SetMaterialIdx(0);
-        node0.AddScale({ 3.4f, 3.4f, 3.4f });
-        node0.AddRotationQuaternion({ 0.000, 0.707, 0.000, 0.707 }); // 90y
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, 0.f, 0.f),
+                                Float4(0.000f, 0.707f, 0.000f, 0.707f), // 90y
+                                Float3(3.4f, 3.4f, 3.4f));
 
 //#define USE_PURE_AMBIENT_LIGHT
 //#define USE_PURE_DIRECTIONAL_LIGHT
@@ -456,48 +528,48 @@ bool Scene::Load(IRenderingContext &ctx)
         mPointLights.resize(3);
 #ifdef USE_PURE_AMBIENT_LIGHT
         const float amb = 0.9f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
 
         const float lum = 0.f;
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         const float ints = 0.f;
         for (auto &light : mPointLights)
-            light.intensity = XMFLOAT4(ints, ints, ints, 1.0f);
+            light.intensity = Float4(ints, ints, ints, 1.0f);
 #elif defined USE_PURE_DIRECTIONAL_LIGHT
         const float amb = 0.f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
 
         const float lum = 3.141f;
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         const float ints = 0.f;
         for (auto &light : mPointLights)
-            light.intensity = XMFLOAT4(ints, ints, ints, 1.0f);
+            light.intensity = Float4(ints, ints, ints, 1.0f);
 #elif defined USE_PURE_POINT_LIGHT
         const float amb = 0.f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
 
         const float lum = 0.f;
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         const float ints = 3.141f;
         for (auto &light : mPointLights)
-            light.intensity = XMFLOAT4(ints, ints, ints, 1.0f);
+            light.intensity = Float4(ints, ints, ints, 1.0f);
 #else
         mAmbientLight.luminance     = SceneUtils::SrgbColorToFloat(30, 30, 30);
 
         const float lum = 2.6f;
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         // coloured point lights
-        mPointLights[0].intensity   = XMFLOAT4(4.0f, 1.8f, 1.2f, 1.0f); // red
-        mPointLights[1].intensity   = XMFLOAT4(1.0f, 2.5f, 1.1f, 1.0f); // green
-        mPointLights[2].intensity   = XMFLOAT4(1.2f, 1.8f, 4.0f, 1.0f); // blue
+        mPointLights[0].intensity   = Float4(4.0f, 1.8f, 1.2f, 1.0f); // red
+        mPointLights[1].intensity   = Float4(1.0f, 2.5f, 1.1f, 1.0f); // green
+        mPointLights[2].intensity   = Float4(1.2f, 1.8f, 4.0f, 1.0f); // blue
 #endif
 
         break;
@@ -511,7 +583,7 @@ bool Scene::Load(IRenderingContext &ctx)
             return false;
 
         auto &material0 = mMaterials[0];
-        const XMFLOAT4 baseColorFactor(0.8f, 0.8f, 0.8f, 1.f);
+        const Float4 baseColorFactor(0.8f, 0.8f, 0.8f, 1.f);
         const float    metallicFactor  = 1.0f;
         const float    roughnessFactor =
                             //0.000f;
@@ -530,39 +602,39 @@ bool Scene::Load(IRenderingContext &ctx)
                                           roughnessFactor))
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(1, SceneNode(true));
-        if (mRootNodes.size() != 1)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
-        auto &node0 = mRootNodes[0];
-        auto primitive = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive = CreateEmptyPrimitive(node0);
         if (!primitive)
             return false;
 
         if (!primitive->CreateSphere(ctx, 20, 40))//40, 80))
             return false;
         primitive->SetMaterialIdx(0);
-        node0.AddScale(3.9f);
-        node0.AddTranslation({ 0.f, -0.2f, 0.f });
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, -0.2f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(3.9f, 3.9f, 3.9f));
 
         const float amb = 0.6f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
 
         const float lum = 3.f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         // coloured point lights
         const float ints = 3.f;
         mPointLights.resize(3);
-        //mPointLights[0].intensity   = XMFLOAT4(4.0f * ints, 0.0f * ints, 0.0f * ints, 1.0f); // red
-        //mPointLights[1].intensity   = XMFLOAT4(0.0f * ints, 2.5f * ints, 0.0f * ints, 1.0f); // green
-        //mPointLights[2].intensity   = XMFLOAT4(0.0f * ints, 0.0f * ints, 4.0f * ints, 1.0f); // blue
-        mPointLights[0].intensity   = XMFLOAT4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
-        mPointLights[1].intensity   = XMFLOAT4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
-        mPointLights[2].intensity   = XMFLOAT4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
+        //mPointLights[0].intensity   = Float4(4.0f * ints, 0.0f * ints, 0.0f * ints, 1.0f); // red
+        //mPointLights[1].intensity   = Float4(0.0f * ints, 2.5f * ints, 0.0f * ints, 1.0f); // green
+        //mPointLights[2].intensity   = Float4(0.0f * ints, 0.0f * ints, 4.0f * ints, 1.0f); // blue
+        mPointLights[0].intensity   = Float4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
+        mPointLights[1].intensity   = Float4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
+        mPointLights[2].intensity   = Float4(0.5f * ints, 0.5f * ints, 0.5f * ints, 1.0f);
         const float pointScale = 10.f;
         for (int i = 0; i < 3; ++i)
         {
@@ -584,32 +656,33 @@ bool Scene::Load(IRenderingContext &ctx)
         auto &material0 = mMaterials[0];
         if (!material0.CreatePbrSpecularity(ctx,
                                             L"../Textures/www.solarsystemscope.com/2k_earth_daymap.jpg",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
                                             L"../Textures/www.solarsystemscope.com/2k_earth_specular_map.tif",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f)))
+                                            Float4(1.f, 1.f, 1.f, 1.f)))
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(1, SceneNode(true));
-        if (mRootNodes.size() != 1)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
-        auto &node0 = mRootNodes[0];
-        auto primitive = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive = CreateEmptyPrimitive(node0);
         if (!primitive)
             return false;
 
         if (!primitive->CreateSphere(ctx, 40, 80))
             return false;
         primitive->SetMaterialIdx(0);
-        node0.AddScale({ 3.4f, 3.4f, 3.4f });
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, 0.f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(3.4f, 3.4f, 3.4f));
 
-        mAmbientLight.luminance     = XMFLOAT4(0.f, 0.f, 0.f, 1.0f);
+        mAmbientLight.luminance     = Float4(0.f, 0.f, 0.f, 1.0f);
 
         const float lum = 3.5f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
 
         SetupPointLights(3, 3.5f, 5.5f);
 
@@ -623,70 +696,74 @@ bool Scene::Load(IRenderingContext &ctx)
         if (mMaterials.size() != 3)
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(3, SceneNode(true));
-        if (mRootNodes.size() != 3)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
         auto &material0 = mMaterials[0];
         if (!material0.CreatePbrSpecularity(ctx,
                                             L"../Textures/www.solarsystemscope.com/2k_earth_daymap.jpg",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
                                             L"../Textures/www.solarsystemscope.com/2k_earth_specular_map.tif",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f)))
+                                            Float4(1.f, 1.f, 1.f, 1.f)))
             return false;
 
-        auto &node0 = mRootNodes[0];
-        auto primitive0 = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive0 = CreateEmptyPrimitive(node0);
         if (!primitive0)
             return false;
         if (!primitive0->CreateSphere(ctx, 40, 80))
             return false;
         primitive0->SetMaterialIdx(0);
-        node0.AddScale({ 2.2f, 2.2f, 2.2f });
-        node0.AddTranslation({ 0.f, 0.f, -1.5f });
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, 0.f, -1.5f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(2.2f, 2.2f, 2.2f));
 
         auto &material1 = mMaterials[1];
         if (!material1.CreatePbrSpecularity(ctx, L"../Textures/www.solarsystemscope.com/2k_mars.jpg",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
                                             nullptr,
-                                            XMFLOAT4(0.f, 0.f, 0.f, 1.f)))
+                                            Float4(0.f, 0.f, 0.f, 1.f)))
             return false;
 
-        auto &node1 = mRootNodes[1];
-        auto primitive1 = node1.CreateEmptyPrimitive();
+        const auto node1 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive1 = CreateEmptyPrimitive(node1);
         if (!primitive1)
             return false;
         if (!primitive1->CreateSphere(ctx, 20, 40))
             return false;
         primitive1->SetMaterialIdx(1);
-        node1.AddScale({ 1.2f, 1.2f, 1.2f });
-        node1.AddTranslation({ -2.5f, 0.f, 2.0f });
+        mSceneGraph.SetLocalTRS(node1,
+                                Float3(-2.5f, 0.f, 2.0f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(1.2f, 1.2f, 1.2f));
 
         auto &material2 = mMaterials[2];
         if (!material2.CreatePbrSpecularity(ctx, L"../Textures/www.solarsystemscope.com/2k_jupiter.jpg",
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
                                             nullptr,
-                                            XMFLOAT4(0.f, 0.f, 0.f, 1.f)))
+                                            Float4(0.f, 0.f, 0.f, 1.f)))
             return false;
 
-        auto &node2 = mRootNodes[2];
-        auto primitive2 = node2.CreateEmptyPrimitive();
+        const auto node2 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive2 = CreateEmptyPrimitive(node2);
         if (!primitive2)
             return false;
         if (!primitive2->CreateSphere(ctx, 20, 40))
             return false;
         primitive2->SetMaterialIdx(2);
-        node2.AddScale({ 1.2f, 1.2f, 1.2f });
-        node2.AddTranslation({ 2.5f, 0.f, 2.0f });
+        mSceneGraph.SetLocalTRS(node2,
+                                Float3(2.5f, 0.f, 2.0f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(1.2f, 1.2f, 1.2f));
 
         const float amb = 0.f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
         const float lum = 3.0f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir       = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
-        SetupPointLights(3, 4.0f, 5.3f, -XM_PI / 8, XM_PI / 8);
+        mDirectLights[0].dir       = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
+        SetupPointLights(3, 4.0f, 5.3f, -kPi / 8, kPi / 8);
 
         break;
     }
@@ -698,15 +775,13 @@ bool Scene::Load(IRenderingContext &ctx)
         if (mMaterials.size() != 3)
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(3, SceneNode(true));
-        if (mRootNodes.size() != 3)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
         const wchar_t *baseColorTex   = L"../Textures/Debugging/VerticalSineWaves8.png";
         const wchar_t *baseColorNoTex = nullptr;
-        const XMFLOAT4 baseColorFactor   = XMFLOAT4(1.0f, 0.7f, 0.1f, 1.0f);
-        const XMFLOAT4 baseColorNoFactor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+        const Float4 baseColorFactor   = Float4(1.0f, 0.7f, 0.1f, 1.0f);
+        const Float4 baseColorNoFactor = Float4(1.0f, 1.0f, 1.0f, 1.0f);
         const wchar_t *metallicRoughnessTex = nullptr;
         const float metallicFactor = 0.f;
         const float roughnessFactor = 0.4f;
@@ -722,15 +797,17 @@ bool Scene::Load(IRenderingContext &ctx)
                                           roughnessFactor))
             return false;
 
-        auto &node0 = mRootNodes[0];
-        auto primitive0 = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive0 = CreateEmptyPrimitive(node0);
         if (!primitive0)
             return false;
         if (!primitive0->CreateSphere(ctx, 40, 80))
             return false;
         primitive0->SetMaterialIdx(0);
-        node0.AddScale({ 1.7f, 1.7f, 1.7f });
-        node0.AddTranslation({ 0.f, 0.f, 0.f });
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, 0.f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(1.7f, 1.7f, 1.7f));
 
         // Sphere 1
 
@@ -743,15 +820,17 @@ bool Scene::Load(IRenderingContext &ctx)
                                           roughnessFactor))
             return false;
 
-        auto &node1 = mRootNodes[1];
-        auto primitive1 = node1.CreateEmptyPrimitive();
+        const auto node1 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive1 = CreateEmptyPrimitive(node1);
         if (!primitive1)
             return false;
         if (!primitive1->CreateSphere(ctx, 40, 80))
             return false;
         primitive1->SetMaterialIdx(1);
-        node1.AddScale({ 1.7f, 1.7f, 1.7f });
-        node1.AddTranslation({ -3.6f, 0.f, 0.f });
+        mSceneGraph.SetLocalTRS(node1,
+                                Float3(-3.6f, 0.f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(1.7f, 1.7f, 1.7f));
 
         // Sphere 2
 
@@ -764,22 +843,24 @@ bool Scene::Load(IRenderingContext &ctx)
                                           roughnessFactor))
             return false;
 
-        auto &node2 = mRootNodes[2];
-        auto primitive2 = node2.CreateEmptyPrimitive();
+        const auto node2 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive2 = CreateEmptyPrimitive(node2);
         if (!primitive2)
             return false;
         if (!primitive2->CreateSphere(ctx, 40, 80))
             return false;
         primitive2->SetMaterialIdx(2);
-        node2.AddScale({ 1.7f, 1.7f, 1.7f });
-        node2.AddTranslation({ 3.6f, 0.f, 0.f });
+        mSceneGraph.SetLocalTRS(node2,
+                                Float3(3.6f, 0.f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(1.7f, 1.7f, 1.7f));
 
         const float amb = 0.f;
-        mAmbientLight.luminance     = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance     = Float4(amb, amb, amb, 1.0f);
         const float lum = 3.0f;
         mDirectLights.resize(1);
-        mDirectLights[0].dir        = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance  = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir        = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance  = Float4(lum, lum, lum, 1.0f);
         SetupPointLights(3, 4.0f, 6.5f);
 
         break;
@@ -795,45 +876,45 @@ bool Scene::Load(IRenderingContext &ctx)
         auto &material0 = mMaterials[0];
         if (!material0.CreatePbrSpecularity(ctx,
                                             nullptr,
-                                            XMFLOAT4(1.f, 1.f, 1.f, 1.f),
+                                            Float4(1.f, 1.f, 1.f, 1.f),
                                             nullptr,
-                                            XMFLOAT4(0.f, 0.f, 0.f, 1.f)))
+                                            Float4(0.f, 0.f, 0.f, 1.f)))
             return false;
 
-        mRootNodes.clear();
-        mRootNodes.resize(1, SceneNode(true));
-        if (mRootNodes.size() != 1)
-            return false;
+        mSceneGraph.Clear();
+        mMeshes.clear();
 
-        auto &node0 = mRootNodes[0];
-        auto primitive = node0.CreateEmptyPrimitive();
+        const auto node0 = mSceneGraph.AddNode(SceneGraph::kNoParent);
+        auto primitive = CreateEmptyPrimitive(node0);
         if (!primitive)
             return false;
 
         if (!primitive->CreateQuad(ctx))
             return false;
         primitive->SetMaterialIdx(0);
-        node0.AddScale({ 100.f, 100.f, 100.f });
-        node0.AddTranslation({ 0.f, -0.5f, 0.f });
+        mSceneGraph.SetLocalTRS(node0,
+                                Float3(0.f, -0.5f, 0.f),
+                                Float4(0.f, 0.f, 0.f, 1.f),
+                                Float3(100.f, 100.f, 100.f));
 
-        mAmbientLight.luminance = XMFLOAT4(0.f, 0.f, 0.f, 1.0f);
+        mAmbientLight.luminance = Float4(0.f, 0.f, 0.f, 1.0f);
         mDirectLights.resize(0);
-        SetupPointLights({ XMFLOAT4(3.8f, 1.2f, 1.2f, 1.0f),   // R
-                           XMFLOAT4(1.2f, 3.0f, 1.2f, 1.0f),   // G
-                           XMFLOAT4(1.2f, 1.2f, 6.0f, 1.0f),   // B
-                           XMFLOAT4(2.6f, 2.6f, 2.6f, 1.0f) }, // W
+        SetupPointLights({ Float4(3.8f, 1.2f, 1.2f, 1.0f),   // R
+                           Float4(1.2f, 3.0f, 1.2f, 1.0f),   // G
+                           Float4(1.2f, 1.2f, 6.0f, 1.0f),   // B
+                           Float4(2.6f, 2.6f, 2.6f, 1.0f) }, // W
                          4.0f, 0.f, 0.f);
 
-        mViewData.eye = XMVectorSet(0.0f,  6.5f, 10.0f, 1.0f);
-        mViewData.at  = XMVectorSet(0.0f,  0.0f,  2.5f, 1.0f);
-        mViewData.up  = XMVectorSet(0.0f,  1.0f,  0.0f, 1.0f);
+        mViewData.eye = Float4(0.0f,  6.5f, 10.0f, 1.0f);
+        mViewData.at  = Float4(0.0f,  0.0f,  2.5f, 1.0f);
+        mViewData.up  = Float4(0.0f,  1.0f,  0.0f, 1.0f);
 
         break;
     }
 
     case  eDebugGradientBox:
     {
-        if (!LoadExternal(ctx, L"../Scenes/Debugging/GradientBox/GradientBox.gltf"))
+        if (!LoadExternal(ctx, GetSceneFilePath(mSceneId)))
             return false;
         //AddScaleToRoots({ 4., 1., 1. });
         AddScaleToRoots(6.);
@@ -842,15 +923,15 @@ bool Scene::Load(IRenderingContext &ctx)
         AddRotationQuaternionToRoots({ 0.980, 0., 0., 0.198 }); //22.8
 
         const float amb = 0.f;//1.f;//
-        mAmbientLight.luminance = XMFLOAT4(amb, amb, amb, 1.0f);
+        mAmbientLight.luminance = Float4(amb, amb, amb, 1.0f);
         const float lum = 8.f;//0.f;//
         mDirectLights.resize(1);
-        mDirectLights[0].dir = XMFLOAT4(0.f, 1.f, 0.f, 1.0f);
-        mDirectLights[0].luminance = XMFLOAT4(lum, lum, lum, 1.0f);
+        mDirectLights[0].dir = Float4(0.f, 1.f, 0.f, 1.0f);
+        mDirectLights[0].luminance = Float4(lum, lum, lum, 1.0f);
         const float ints = 0.f;//3000.f;//
         mPointLights.resize(3);
         for (auto &light : mPointLights)
-            light.intensity = XMFLOAT4(ints, ints, ints, 1.0f);
+            light.intensity = Float4(ints, ints, ints, 1.0f);
 
         break;
     }
@@ -879,8 +960,11 @@ bool Scene::PostLoadSanityTest()
         return false;
     }
 
-    // Geometry using normal map must have tangent specified (for now)
-    for (auto &node : mRootNodes)
+    // Geometry using normal map must have tangent specified (for now). Primitives still being loaded
+    // by background jobs are tested once all of them finish (see ContinueAsyncLoad()).
+    if (IsLoading())
+        return true;
+    for (uint32_t node = 0; node < mSceneGraph.GetNodeCount(); node++)
         if (!NodeTangentSanityTest(node))
             return false;
 
@@ -888,10 +972,9 @@ bool Scene::PostLoadSanityTest()
 }
 
 
-bool Scene::NodeTangentSanityTest(const SceneNode &node)
+bool Scene::NodeTangentSanityTest(uint32_t node)
 {
-    // Test node
-    for (auto &primitive : node.mPrimitives)
+    for (auto &primitive : GetNodePrimitives(node))
     {
         auto &material = GetMaterial(primitive);
 
@@ -902,10 +985,5 @@ bool Scene::NodeTangentSanityTest(const SceneNode &node)
         }
     }
 
-    // Children
-    for (auto &child : node.mChildren)
-        if (!NodeTangentSanityTest(child))
-            return false;
-
     return true;
 }
@@ -0,0 +1,180 @@
+#include "scene_math.hpp"
+
+namespace SceneMath
+{
+
+Matrix::Matrix(float m00, float m01, float m02, float m03,
+               float m10, float m11, float m12, float m13,
+               float m20, float m21, float m22, float m23,
+               float m30, float m31, float m32, float m33)
+{
+    m[0][0] = m00; m[0][1] = m01; m[0][2] = m02; m[0][3] = m03;
+    m[1][0] = m10; m[1][1] = m11; m[1][2] = m12; m[1][3] = m13;
+    m[2][0] = m20; m[2][1] = m21; m[2][2] = m22; m[2][3] = m23;
+    m[3][0] = m30; m[3][1] = m31; m[3][2] = m32; m[3][3] = m33;
+}
+
+
+Matrix operator *(const Matrix &a, const Matrix &b)
+{
+    Matrix result;
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            result.m[row][col] = a.m[row][0] * b.m[0][col] +
+                                 a.m[row][1] * b.m[1][col] +
+                                 a.m[row][2] * b.m[2][col] +
+                                 a.m[row][3] * b.m[3][col];
+    return result;
+}
+
+
+Matrix MatrixIdentity()
+{
+    return Matrix(1.f, 0.f, 0.f, 0.f,
+                  0.f, 1.f, 0.f, 0.f,
+                  0.f, 0.f, 1.f, 0.f,
+                  0.f, 0.f, 0.f, 1.f);
+}
+
+
+Matrix MatrixTranspose(const Matrix &mtrx)
+{
+    Matrix result;
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            result.m[row][col] = mtrx.m[col][row];
+    return result;
+}
+
+
+Matrix MatrixScaling(float sx, float sy, float sz)
+{
+    return Matrix(sx,  0.f, 0.f, 0.f,
+                  0.f, sy,  0.f, 0.f,
+                  0.f, 0.f, sz,  0.f,
+                  0.f, 0.f, 0.f, 1.f);
+}
+
+
+Matrix MatrixTranslation(float x, float y, float z)
+{
+    return Matrix(1.f, 0.f, 0.f, 0.f,
+                  0.f, 1.f, 0.f, 0.f,
+                  0.f, 0.f, 1.f, 0.f,
+                  x,   y,   z,   1.f);
+}
+
+
+Matrix MatrixTranslationFromVector(const Float4 &vec)
+{
+    return MatrixTranslation(vec.x, vec.y, vec.z);
+}
+
+
+Matrix MatrixRotationX(float angle)
+{
+    const float s = std::sin(angle);
+    const float c = std::cos(angle);
+    return Matrix(1.f, 0.f, 0.f, 0.f,
+                  0.f, c,   s,   0.f,
+                  0.f, -s,  c,   0.f,
+                  0.f, 0.f, 0.f, 1.f);
+}
+
+
+Matrix MatrixRotationY(float angle)
+{
+    const float s = std::sin(angle);
+    const float c = std::cos(angle);
+    return Matrix(c,   0.f, -s,  0.f,
+                  0.f, 1.f, 0.f, 0.f,
+                  s,   0.f, c,   0.f,
+                  0.f, 0.f, 0.f, 1.f);
+}
+
+
+Matrix MatrixRotationZ(float angle)
+{
+    const float s = std::sin(angle);
+    const float c = std::cos(angle);
+    return Matrix(c,   s,   0.f, 0.f,
+                  -s,  c,   0.f, 0.f,
+                  0.f, 0.f, 1.f, 0.f,
+                  0.f, 0.f, 0.f, 1.f);
+}
+
+
+Matrix MatrixRotationQuaternion(const Float4 &q)
+{
+    const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    return Matrix(1.f - 2.f * (yy + zz), 2.f * (xy + wz),       2.f * (xz - wy),       0.f,
+                  2.f * (xy - wz),       1.f - 2.f * (xx + zz), 2.f * (yz + wx),       0.f,
+                  2.f * (xz + wy),       2.f * (yz - wx),       1.f - 2.f * (xx + yy), 0.f,
+                  0.f,                   0.f,                   0.f,                   1.f);
+}
+
+
+static Float3 Normalize3(const Float3 &v)
+{
+    const float len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    if (len > 0.f)
+        return Float3(v.x / len, v.y / len, v.z / len);
+    else
+        return v;
+}
+
+
+static Float3 Cross3(const Float3 &a, const Float3 &b)
+{
+    return Float3(a.y * b.z - a.z * b.y,
+                  a.z * b.x - a.x * b.z,
+                  a.x * b.y - a.y * b.x);
+}
+
+
+static float Dot3(const Float3 &a, const Float4 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+Matrix MatrixLookAtLH(const Float4 &eye, const Float4 &at, const Float4 &up)
+{
+    const Float3 zAxis = Normalize3(Float3(at.x - eye.x, at.y - eye.y, at.z - eye.z));
+    const Float3 xAxis = Normalize3(Cross3(Float3(up.x, up.y, up.z), zAxis));
+    const Float3 yAxis = Cross3(zAxis, xAxis);
+
+    return Matrix(xAxis.x,             yAxis.x,             zAxis.x,             0.f,
+                  xAxis.y,             yAxis.y,             zAxis.y,             0.f,
+                  xAxis.z,             yAxis.z,             zAxis.z,             0.f,
+                  -Dot3(xAxis, eye),   -Dot3(yAxis, eye),   -Dot3(zAxis, eye),   1.f);
+}
+
+
+Matrix MatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+    const float height = std::cos(0.5f * fovAngleY) / std::sin(0.5f * fovAngleY);
+    const float width  = height / aspectRatio;
+    const float range  = farZ / (farZ - nearZ);
+
+    return Matrix(width, 0.f,    0.f,             0.f,
+                  0.f,   height, 0.f,             0.f,
+                  0.f,   0.f,    range,           1.f,
+                  0.f,   0.f,    -range * nearZ,  0.f);
+}
+
+
+Float4 Vector3Transform(const Float4 &v, const Matrix &mtrx)
+{
+    Float4 result;
+    result.x = v.x * mtrx.m[0][0] + v.y * mtrx.m[1][0] + v.z * mtrx.m[2][0] + mtrx.m[3][0];
+    result.y = v.x * mtrx.m[0][1] + v.y * mtrx.m[1][1] + v.z * mtrx.m[2][1] + mtrx.m[3][1];
+    result.z = v.x * mtrx.m[0][2] + v.y * mtrx.m[1][2] + v.z * mtrx.m[2][2] + mtrx.m[3][2];
+    result.w = v.x * mtrx.m[0][3] + v.y * mtrx.m[1][3] + v.z * mtrx.m[2][3] + mtrx.m[3][3];
+    return result;
+}
+
+} // namespace SceneMath
@@ -0,0 +1,71 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Portable math types used by the scene code.
+//
+// Memory layout and conventions follow XNA Math (row-major matrices, row vectors multiplied
+// from the left, left-handed coordinate system), so that the data can be fed to the same
+// shaders and constant buffers as before without any conversion.
+// ------------------------------------------------------------------------------------------------
+
+#include <cmath>
+
+namespace SceneMath
+{
+    const float kPi      = 3.141592654f;
+    const float k2Pi     = 6.283185307f;
+    const float kPiDiv2  = 1.570796327f;
+    const float kPiDiv4  = 0.785398163f;
+
+    struct Float2
+    {
+        float x, y;
+
+        Float2() = default;
+        Float2(float _x, float _y) : x(_x), y(_y) {}
+    };
+
+    struct Float3
+    {
+        float x, y, z;
+
+        Float3() = default;
+        Float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+    };
+
+    struct Float4
+    {
+        float x, y, z, w;
+
+        Float4() = default;
+        Float4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+    };
+
+    struct alignas(16) Matrix
+    {
+        float m[4][4];
+
+        Matrix() = default;
+        Matrix(float m00, float m01, float m02, float m03,
+               float m10, float m11, float m12, float m13,
+               float m20, float m21, float m22, float m23,
+               float m30, float m31, float m32, float m33);
+    };
+
+    Matrix operator *(const Matrix &a, const Matrix &b);
+
+    Matrix MatrixIdentity();
+    Matrix MatrixTranspose(const Matrix &mtrx);
+    Matrix MatrixScaling(float sx, float sy, float sz);
+    Matrix MatrixTranslation(float x, float y, float z);
+    Matrix MatrixTranslationFromVector(const Float4 &vec);
+    Matrix MatrixRotationX(float angle);
+    Matrix MatrixRotationY(float angle);
+    Matrix MatrixRotationZ(float angle);
+    Matrix MatrixRotationQuaternion(const Float4 &quaternion);
+    Matrix MatrixLookAtLH(const Float4 &eye, const Float4 &at, const Float4 &up);
+    Matrix MatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ);
+
+    // Transforms point (x, y, z, 1) by the matrix; no homogeneous division is performed
+    Float4 Vector3Transform(const Float4 &vec, const Matrix &mtrx);
+}
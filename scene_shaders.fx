@@ -45,6 +45,11 @@ cbuffer cbSceneNode : register(b2)
 {
     matrix WorldMtrx;
     float4 MeshColor;
+
+    // Dequantization of the drawn primitive's vertices: value = packed * scale + offset
+    float4 PosDequantScale;
+    float4 PosDequantOffset;
+    float4 TexDequantScaleOffset; // xy scale, zw offset
 };
 
 cbuffer cbScenePrimitive : register(b3)
@@ -71,6 +76,14 @@ struct VS_INPUT
     float2 Tex      : TEXCOORD0;
 };
 
+// Compact and quantized vertices (see vertex_packing.hpp)
+struct VS_INPUT_COMPACT
+{
+    float4 Pos              : POSITION;
+    float4 NormalTangent    : NORMAL; // Octahedral normal xy, tangent angle / pi, bitangent sign
+    float2 Tex              : TEXCOORD0;
+};
+
 struct PS_INPUT
 {
     float4 PosProj  : SV_POSITION;
@@ -81,25 +94,69 @@ struct PS_INPUT
 };
 
 
-PS_INPUT VS(VS_INPUT input)
+PS_INPUT TransformVertex(float4 pos, float3 normal, float4 tangent, float2 tex)
 {
     PS_INPUT output = (PS_INPUT)0;
 
-    output.PosWorld = mul(input.Pos, WorldMtrx);
+    output.PosWorld = mul(pos, WorldMtrx);
 
     output.PosProj = mul(output.PosWorld, ViewMtrx);
     output.PosProj = mul(output.PosProj, ProjectionMtrx);
 
-    output.Normal  = mul(input.Normal, (float3x3)WorldMtrx);
-    output.Tangent = float4(mul(input.Tangent.xyz, (float3x3)WorldMtrx),
-                            input.Tangent.w);
+    output.Normal  = mul(normal, (float3x3)WorldMtrx);
+    output.Tangent = float4(mul(tangent.xyz, (float3x3)WorldMtrx),
+                            tangent.w);
 
-    output.Tex = input.Tex;
+    output.Tex = tex;
 
     return output;
 }
 
 
+PS_INPUT VS(VS_INPUT input)
+{
+    return TransformVertex(input.Pos, input.Normal, input.Tangent, input.Tex);
+}
+
+
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 v = float3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    const float t = saturate(-v.z);
+    v.xy += (v.xy >= 0) ? -t : t;
+    return normalize(v);
+}
+
+
+// Must match VertexPacking::GetTangentPlaneBasis()
+void GetTangentPlaneBasis(float3 n, out float3 b1, out float3 b2)
+{
+    const float s = (n.z >= 0) ? 1 : -1;
+    const float a = -1 / (s + n.z);
+    const float b = n.x * n.y * a;
+    b1 = float3(1 + s * n.x * n.x * a, s * b, -s * n.x);
+    b2 = float3(b, s + n.y * n.y * a, -n.y);
+}
+
+
+PS_INPUT VsCompact(VS_INPUT_COMPACT input)
+{
+    const float4 pos = input.Pos * PosDequantScale + PosDequantOffset;
+
+    const float3 normal = DecodeOctahedral(input.NormalTangent.xy);
+    float3 b1, b2;
+    GetTangentPlaneBasis(normal, b1, b2);
+    float angleSin, angleCos;
+    sincos(input.NormalTangent.z * PI, angleSin, angleCos);
+    const float4 tangent = float4(angleCos * b1 + angleSin * b2,
+                                  (input.NormalTangent.w >= 0) ? 1 : -1);
+
+    const float2 tex = input.Tex * TexDequantScaleOffset.xy + TexDequantScaleOffset.zw;
+
+    return TransformVertex(pos, normal, tangent, tex);
+}
+
+
 float3 ComputeNormal(PS_INPUT input)
 {
     // TODO: Optimize?
@@ -110,8 +167,10 @@ float3 ComputeNormal(PS_INPUT input)
     const float3 frameTangent   = normalize(input.Tangent.xyz);
     const float3 frameBitangent = normalize(cross(frameNormal, frameTangent) * input.Tangent.w);
 
-    const float3 normalTex      = NormalTexture.Sample(LinearSampler, input.Tex).xyz;
-    const float3 localNormal    = normalize((normalTex * 2 - 1) * float3(NormalTexScale, NormalTexScale, 1.0));
+    // Only x and y are used, since block-compressed (BC5) normal maps have no z; it is reconstructed
+    const float2 normalTexXY    = NormalTexture.Sample(LinearSampler, input.Tex).xy * 2 - 1;
+    const float3 normalTex      = float3(normalTexXY, sqrt(saturate(1 - dot(normalTexXY, normalTexXY))));
+    const float3 localNormal    = normalize(normalTex * float3(NormalTexScale, NormalTexScale, 1.0));
 
     return
         localNormal.x * frameTangent +
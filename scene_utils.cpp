@@ -3,65 +3,52 @@
 #include "constants.hpp"
 #include "utils.hpp"
 
+#include <cmath>
+
 bool SceneUtils::CreateTextureSrvFromData(IRenderingContext &ctx,
-                                          ID3D11ShaderResourceView *&srv,
-                                          const UINT width,
-                                          const UINT height,
-                                          const DXGI_FORMAT dataFormat,
+                                          IDeviceTexture *&srv,
+                                          const uint32_t width,
+                                          const uint32_t height,
+                                          const TextureFormat dataFormat,
                                           const void *data,
-                                          const UINT lineMemPitch)
+                                          const uint32_t lineMemPitch)
 {
-    auto device = ctx.GetDevice();
-    if (!device)
-        return false;
-    HRESULT hr = S_OK;
-    ID3D11Texture2D *tex = nullptr;
-
-    // Texture
-    D3D11_TEXTURE2D_DESC descTex;
-    ZeroMemory(&descTex, sizeof(D3D11_TEXTURE2D_DESC));
-    descTex.ArraySize = 1;
-    descTex.Usage = D3D11_USAGE_IMMUTABLE;
-    descTex.Format = dataFormat;
-    descTex.Width = width;
-    descTex.Height = height;
-    descTex.MipLevels = 1;
-    descTex.SampleDesc.Count = 1;
-    descTex.SampleDesc.Quality = 0;
-    descTex.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    D3D11_SUBRESOURCE_DATA initData = { data, lineMemPitch, 0 };
-    hr = device->CreateTexture2D(&descTex, &initData, &tex);
-    if (FAILED(hr))
-        return false;
+    const TextureMipData mip = { data, lineMemPitch };
+    return ctx.CreateTexture(width, height, dataFormat, &mip, 1, srv);
+}
 
-    // Shader resource view
-    D3D11_SHADER_RESOURCE_VIEW_DESC descSRV;
-    descSRV.Format = descTex.Format;
-    descSRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    descSRV.Texture2D.MipLevels = 1;
-    descSRV.Texture2D.MostDetailedMip = 0;
-    hr = device->CreateShaderResourceView(tex, &descSRV, &srv);
-    Utils::ReleaseAndMakeNull(tex);
-    if (FAILED(hr))
+
+bool SceneUtils::CreateTextureSrvFromData(IRenderingContext &ctx,
+                                          IDeviceTexture *&srv,
+                                          const MipChain &mipChain,
+                                          const TextureFormat dataFormat)
+{
+    if (mipChain.GetLevelCount() == 0)
         return false;
 
-    return true;
+    std::vector<TextureMipData> mips(mipChain.GetLevelCount());
+    for (size_t level = 0; level < mips.size(); level++)
+        mips[level] = { mipChain.GetLevel(level).data, mipChain.GetLevelPitch(level) };
+
+    const auto &topLevel = mipChain.GetLevel(0);
+    return ctx.CreateTexture(topLevel.width, topLevel.height, dataFormat,
+                             mips.data(), (uint32_t)mips.size(), srv);
 }
 
 
 bool SceneUtils::CreateConstantTextureSRV(IRenderingContext &ctx,
-                                          ID3D11ShaderResourceView *&srv,
-                                          XMFLOAT4 color)
+                                          IDeviceTexture *&srv,
+                                          SceneMath::Float4 color)
 {
     return CreateTextureSrvFromData(ctx, srv,
-                                    1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT,
-                                    &color, sizeof(XMFLOAT4));
+                                    1, 1, TextureFormat::kR32G32B32A32Float,
+                                    &color, sizeof(SceneMath::Float4));
 }
 
 
 bool SceneUtils::ConvertImageToFloat(std::vector<unsigned char> &floatImage,
                                      const tinygltf::Image &srcImage,
-                                     XMFLOAT4 constFactor)
+                                     SceneMath::Float4 constFactor)
 {
     const size_t floatDataSize = srcImage.width * srcImage.height * 4 * sizeof(float);
     floatImage.resize(floatDataSize);
@@ -90,9 +77,9 @@ bool SceneUtils::ConvertImageToFloat(std::vector<unsigned char> &floatImage,
 }
 
 
-const FLOAT& SceneUtils::GetComponent(const XMFLOAT4 &vec, size_t comp)
+const float& SceneUtils::GetComponent(const SceneMath::Float4 &vec, size_t comp)
 {
-    return *(reinterpret_cast<const FLOAT*>(&vec) + comp);
+    return *(reinterpret_cast<const float*>(&vec) + comp);
 }
 
 
@@ -113,17 +100,17 @@ float SceneUtils::SrgbValueToLinear(uint8_t v)
 }
 
 
-XMFLOAT4 SceneUtils::SrgbColorToFloat(uint8_t r, uint8_t g, uint8_t b, float intensity)
+SceneMath::Float4 SceneUtils::SrgbColorToFloat(uint8_t r, uint8_t g, uint8_t b, float intensity)
 {
 #ifdef CONVERT_SRGB_INPUT_TO_LINEAR
-    return XMFLOAT4(SrgbValueToLinear(r) * intensity,
-                    SrgbValueToLinear(g) * intensity,
-                    SrgbValueToLinear(b) * intensity,
-                    1.0f);
+    return SceneMath::Float4(SrgbValueToLinear(r) * intensity,
+                             SrgbValueToLinear(g) * intensity,
+                             SrgbValueToLinear(b) * intensity,
+                             1.0f);
 #else
-    return XMFLOAT4((r / 255.f) * intensity,
-                    (g / 255.f) * intensity,
-                    (b / 255.f) * intensity,
-                    1.0f);
+    return SceneMath::Float4((r / 255.f) * intensity,
+                             (g / 255.f) * intensity,
+                             (b / 255.f) * intensity,
+                             1.0f);
 #endif
 };
@@ -3,41 +3,39 @@
 #include "Libs/tinygltf-2.5.0/tiny_gltf.h" // just the interfaces (no implementation)
 
 #include "irenderingcontext.hpp"
+#include "mip_chain.hpp"
+#include "scene_math.hpp"
 
-// We are using an older version of DirectX headers which causes 
-// "warning C4005: '...' : macro redefinition"
-#pragma warning(push)
-#pragma warning(disable: 4005)
-#include <d3d11.h>
-#include <d3dx11.h>
-#pragma warning(pop)
-
-#pragma warning(push)
-#pragma warning(disable: 4838)
-#include <xnamath.h>
-#pragma warning(pop)
+#include <cstdint>
+#include <vector>
 
 namespace SceneUtils
 {
     bool CreateTextureSrvFromData(IRenderingContext &ctx,
-                                  ID3D11ShaderResourceView *&srv,
-                                  const UINT width,
-                                  const UINT height,
-                                  const DXGI_FORMAT dataFormat,
+                                  IDeviceTexture *&srv,
+                                  const uint32_t width,
+                                  const uint32_t height,
+                                  const TextureFormat dataFormat,
                                   const void *data,
-                                  const UINT lineMemPitch);
+                                  const uint32_t lineMemPitch);
+
+    // Uploads all levels of a mip chain; the format has to match the chain (RGBA8 or its BC format)
+    bool CreateTextureSrvFromData(IRenderingContext &ctx,
+                                  IDeviceTexture *&srv,
+                                  const MipChain &mipChain,
+                                  const TextureFormat dataFormat);
 
     bool CreateConstantTextureSRV(IRenderingContext &ctx,
-                                  ID3D11ShaderResourceView *&srv,
-                                  XMFLOAT4 color);
+                                  IDeviceTexture *&srv,
+                                  SceneMath::Float4 color);
 
     bool ConvertImageToFloat(std::vector<unsigned char> &floatImage,
                              const tinygltf::Image &srcImage,
-                             XMFLOAT4 constFactor);
+                             SceneMath::Float4 constFactor);
 
-    const FLOAT& GetComponent(const XMFLOAT4 &vec, size_t comp);
+    const float& GetComponent(const SceneMath::Float4 &vec, size_t comp);
 
     float SrgbValueToLinear(uint8_t v);
 
-    XMFLOAT4 SrgbColorToFloat(uint8_t r, uint8_t g, uint8_t b, float intensity = 1.0f);
+    SceneMath::Float4 SrgbColorToFloat(uint8_t r, uint8_t g, uint8_t b, float intensity = 1.0f);
 }
@@ -0,0 +1,279 @@
+// Measures tangent calculation of glTF primitives: the reference mikktspace run through callbacks
+// (TangentCalculator::CalculateReference()), serial, parallel across primitives, and parallel with large
+// primitives split into regions (see TangentCalculator::Calculate()), for thread counts 1, 2, 4, ... up
+// to the given maximum. Speedups are relative to the serial run. Serial results are checked to be
+// bit-identical to the reference ones and parallel results to the serial ones.
+//
+// Usage: tangent_benchmark [max thread count] [repeat count] [glTF files...]
+//
+// Zero max thread count means one per hardware thread. Each measurement is the best of repeat count
+// runs. Without files, the bundled sample scenes are measured (paths are relative to the Bin directory).
+
+#include "scene.hpp"
+#include "scene_geometry.hpp"
+#include "tangent_calculator.hpp"
+#include "thread_pool.hpp"
+#include "gltf_utils.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Scene::SceneId sSampleScenes[] =
+{
+    Scene::eGltfSample2CylinderEngine,
+    Scene::eGltfSampleDuck,
+    Scene::eGltfSampleBoomBox,
+    Scene::eGltfSampleDamagedHelmet,
+    Scene::eGltfSampleFlightHelmet,
+    Scene::eLowPolyDrifter,
+    Scene::eWolfBaseMesh,
+    Scene::eNintendoGameBoyClassic,
+    Scene::eWeltron2001SpaceballRadio,
+    Scene::eSpotMiniRigged,
+    Scene::eMandaloriansHelmet,
+    Scene::eTheRocket,
+    Scene::eRoboV1,
+    Scene::eRockJacket,
+    Scene::eSalazarSkull,
+    Scene::eHardhead,
+};
+
+
+struct BenchmarkScene
+{
+    std::wstring                                    name;
+    std::vector<std::unique_ptr<SceneGeometry>>     geometries;
+    std::vector<std::vector<SceneMath::Float4>>     referenceTangents;
+    std::vector<std::vector<SceneMath::Float4>>     serialTangents;
+    size_t                                          faceCount = 0;
+    size_t                                          largestFaceCount = 0;
+};
+
+
+static bool LoadBenchmarkScene(BenchmarkScene &scene, const std::wstring &filePath)
+{
+    tinygltf::Model model;
+    if (!GltfUtils::LoadModel(model, filePath, true))
+        return false;
+
+    scene.name = filePath;
+    for (const auto &mesh : model.meshes)
+        for (int i = 0; i < (int)mesh.primitives.size(); i++)
+        {
+            std::unique_ptr<SceneGeometry> geometry(new SceneGeometry);
+            if (!geometry->LoadDataFromGLTF(model, mesh, i, L"   "))
+                return false;
+            if (geometry->GetVerticesPerFace() != 3)
+                continue;
+
+            const auto faceCount = geometry->GetFacesCount();
+            scene.faceCount += faceCount;
+            scene.largestFaceCount = std::max(scene.largestFaceCount, faceCount);
+            scene.geometries.push_back(std::move(geometry));
+        }
+
+    return !scene.geometries.empty();
+}
+
+
+static std::vector<SceneMath::Float4> GetTangents(const SceneGeometry &geometry)
+{
+    std::vector<SceneMath::Float4> tangents;
+    tangents.reserve(geometry.GetVertices().size());
+    for (const auto &vertex : geometry.GetVertices())
+        tangents.push_back(vertex.Tangent);
+    return tangents;
+}
+
+
+// Best time of the given number of runs in ms; tangents are reset before each run
+static double MeasureRuns(BenchmarkScene &scene, size_t repeatCount, const std::function<bool()> &run)
+{
+    double bestTime = 0.;
+    for (size_t i = 0; i < repeatCount; i++)
+    {
+        for (auto &geometry : scene.geometries)
+        {
+            const auto faceCount = geometry->GetFacesCount();
+            for (size_t face = 0; face < faceCount; face++)
+                for (int vertex = 0; vertex < 3; vertex++)
+                    geometry->GetVertex((int)face, vertex).Tangent = SceneMath::Float4(0.f, 0.f, 0.f, 0.f);
+        }
+
+        const auto start = Clock::now();
+        if (!run())
+            return -1.;
+        const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bestTime = (i == 0) ? time : std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+
+static bool IsSameResult(const BenchmarkScene &scene,
+                         const std::vector<std::vector<SceneMath::Float4>> &expectedTangents)
+{
+    for (size_t i = 0; i < scene.geometries.size(); i++)
+    {
+        const auto tangents = GetTangents(*scene.geometries[i]);
+        const auto &expected = expectedTangents[i];
+        if ((tangents.size() != expected.size()) ||
+            (memcmp(tangents.data(), expected.data(), tangents.size() * sizeof(SceneMath::Float4)) != 0))
+            return false;
+    }
+    return true;
+}
+
+
+static bool RunBenchmark(BenchmarkScene &scene,
+                         const std::vector<size_t> &threadCounts,
+                         size_t repeatCount)
+{
+    auto &geometries = scene.geometries;
+
+    const double referenceTime = MeasureRuns(scene, repeatCount, [&geometries]()
+    {
+        for (auto &geometry : geometries)
+            if (!TangentCalculator::CalculateReference(*geometry))
+                return false;
+        return true;
+    });
+    if (referenceTime < 0.)
+    {
+        Log::Error(L"   Reference tangents calculation failed!");
+        return false;
+    }
+    scene.referenceTangents.clear();
+    for (const auto &geometry : geometries)
+        scene.referenceTangents.push_back(GetTangents(*geometry));
+
+    const double serialTime = MeasureRuns(scene, repeatCount, [&geometries]()
+    {
+        for (auto &geometry : geometries)
+            if (!TangentCalculator::Calculate(*geometry))
+                return false;
+        return true;
+    });
+    if (serialTime < 0.)
+    {
+        Log::Error(L"   Serial tangents calculation failed!");
+        return false;
+    }
+    scene.serialTangents.clear();
+    for (const auto &geometry : geometries)
+        scene.serialTangents.push_back(GetTangents(*geometry));
+
+    const bool serialIdentical = IsSameResult(scene, scene.referenceTangents);
+    Log::Info(L"   %d primitive(s), %d triangles (largest primitive %d): reference %.1f ms, serial %.1f ms (%.2fx)%s",
+              (int)geometries.size(), (int)scene.faceCount, (int)scene.largestFaceCount,
+              referenceTime, serialTime, referenceTime / serialTime,
+              serialIdentical ? L"" : L" MISMATCH");
+    if (!serialIdentical)
+        Log::Error(L"   Serial tangents differ from the reference ones!");
+
+    bool identical = true;
+    for (const auto threadCount : threadCounts)
+    {
+        ThreadPool pool(threadCount);
+        ThreadPool tangentPool(threadCount);
+
+        std::vector<char> succeeded(geometries.size());
+        std::vector<size_t> regionCounts(geometries.size());
+        auto runParallel = [&](ThreadPool *regionPool)
+        {
+            pool.ParallelFor(geometries.size(), [&](size_t i)
+            {
+                succeeded[i] = TangentCalculator::Calculate(*geometries[i], TangentMethod::kMikkTSpace,
+                                                            regionPool, &regionCounts[i]);
+            });
+            return std::find(succeeded.begin(), succeeded.end(), false) == succeeded.end();
+        };
+
+        const double primitivesTime = MeasureRuns(scene, repeatCount, [&]() { return runParallel(nullptr); });
+        const bool primitivesIdentical = IsSameResult(scene, scene.serialTangents);
+        const double regionsTime = MeasureRuns(scene, repeatCount, [&]() { return runParallel(&tangentPool); });
+        const bool regionsIdentical = IsSameResult(scene, scene.serialTangents);
+        if ((primitivesTime < 0.) || (regionsTime < 0.))
+        {
+            Log::Error(L"   Parallel tangents calculation failed!");
+            return false;
+        }
+
+        size_t regionCount = 0;
+        for (const auto count : regionCounts)
+            regionCount += count;
+
+        Log::Info(L"   %2d thread(s): primitives %.1f ms (%.2fx)%s, "
+                  L"primitives + regions %.1f ms (%.2fx, %d region(s))%s",
+                  (int)threadCount,
+                  primitivesTime,
+                  serialTime / primitivesTime,
+                  primitivesIdentical ? L"" : L" MISMATCH",
+                  regionsTime,
+                  serialTime / regionsTime,
+                  (int)regionCount,
+                  regionsIdentical ? L"" : L" MISMATCH");
+
+        identical = identical && primitivesIdentical && regionsIdentical;
+    }
+
+    if (!identical)
+        Log::Error(L"   Parallel tangents differ from the serial ones!");
+
+    return serialIdentical && identical;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Log::sLoggingLevel = Log::eInfo;
+
+    size_t maxThreadCount = (argc > 1) ? (size_t)std::max(std::atoi(argv[1]), 0) : 0;
+    const size_t repeatCount = (argc > 2) ? (size_t)std::max(std::atoi(argv[2]), 1) : 3;
+    std::vector<std::wstring> filePaths;
+    for (int i = 3; i < argc; i++)
+        filePaths.push_back(Utils::StringToWstring(argv[i]));
+    if (filePaths.empty())
+        for (const auto sceneId : sSampleScenes)
+            filePaths.push_back(Scene::GetSceneFilePath(sceneId));
+
+    if (maxThreadCount == 0)
+        maxThreadCount = ThreadPool::GetHardwareThreadCount();
+    std::vector<size_t> threadCounts;
+    for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    threadCounts.push_back(maxThreadCount);
+
+    int failedCount = 0;
+    for (const auto &filePath : filePaths)
+    {
+        Log::Info(L"Scene \"%s\":", filePath.c_str());
+
+        BenchmarkScene scene;
+        if (!LoadBenchmarkScene(scene, filePath))
+        {
+            Log::Error(L"   Failed to load triangle primitives!");
+            failedCount++;
+            continue;
+        }
+
+        if (!RunBenchmark(scene, threadCounts, repeatCount))
+            failedCount++;
+    }
+
+    return failedCount == 0 ? 0 : -1;
+}
@@ -1,6 +1,376 @@
 #include "tangent_calculator.hpp"
 
-bool TangentCalculator::Calculate(ScenePrimitive &primitive)
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Smaller meshes are not worth the analysis
+static const size_t kMinParallelFaceCount = 16384;
+
+// More regions than workers, so that uneven ones are balanced out
+static const size_t kRegionsPerThread = 4;
+
+static const uint32_t kNoFace = static_cast<uint32_t>(-1);
+
+
+// Angle between two vectors, zero if any of them is degenerate
+static float GetAngle(float ax, float ay, float az, float bx, float by, float bz)
+{
+    const float lengths = std::sqrt((ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz));
+    if (lengths == 0.f)
+        return 0.f;
+    const float cosAngle = (ax * bx + ay * by + az * bz) / lengths;
+    return std::acos(std::max(-1.f, std::min(cosAngle, 1.f)));
+}
+
+
+// Splits triangles into at most maxRegionCount + 1 regions of similar size, leaving the regions empty if
+// the mesh is not worth splitting. Triangles which share a vertex in the mikktspace sense (equal position,
+// normal, and texture coordinates) always end up in the same region, because that is the only way
+// mikktspace lets triangles affect each other. Each region keeps its triangles in the original order, so
+// mikktspace processes them in the same order as if the mesh was not split.
+static void SplitIntoRegions(std::vector<std::vector<uint32_t>> &regions,
+                             const SceneGeometry &geometry,
+                             size_t maxRegionCount)
+{
+    regions.clear();
+
+    if (geometry.GetVerticesPerFace() != 3)
+        return;
+
+    // Also fills the corners cache before any worker thread touches the geometry
+    const auto &corners = geometry.GetFaceCorners();
+    const auto &vertices = geometry.GetVertices();
+    const size_t faceCount = corners.size() / 3;
+    if ((faceCount < kMinParallelFaceCount) || (maxRegionCount < 2))
+        return;
+    for (const auto corner : corners)
+        if (corner >= vertices.size())
+            return;
+
+    // Vertex identity as seen by mikktspace, which compares floats (0 equals -0)
+    const size_t keySize = 8;
+    std::vector<float> keys(vertices.size() * keySize);
+    auto key = keys.data();
+    for (const auto &vertex : vertices)
+    {
+        const float components[keySize] = { vertex.Pos.x,    vertex.Pos.y,    vertex.Pos.z,
+                                            vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+                                            vertex.Tex.x,    vertex.Tex.y };
+        for (const auto component : components)
+            *key++ = (component == 0.f) ? 0.f : component;
+    }
+    std::vector<uint32_t> vertexClasses(vertices.size());
+    const auto classCount = MeshOptimizer::GenerateWeldRemap(vertexClasses.data(),
+                                                             (const void *)keys.data(),
+                                                             vertices.size(),
+                                                             keySize * sizeof(float));
+    std::vector<float>().swap(keys);
+
+    // Connected components of triangles sharing a vertex class, each represented by its first triangle
+    std::vector<uint32_t> parents(faceCount);
+    for (size_t face = 0; face < faceCount; face++)
+        parents[face] = (uint32_t)face;
+    auto findRoot = [&parents](uint32_t face)
+    {
+        while (parents[face] != face)
+        {
+            parents[face] = parents[parents[face]];
+            face = parents[face];
+        }
+        return face;
+    };
+
+    std::vector<uint32_t> classFaces(classCount, kNoFace);
+    for (size_t face = 0; face < faceCount; face++)
+        for (size_t i = 0; i < 3; i++)
+        {
+            auto &classFace = classFaces[vertexClasses[corners[face * 3 + i]]];
+            if (classFace == kNoFace)
+            {
+                classFace = (uint32_t)face;
+                continue;
+            }
+
+            const auto root1 = findRoot(classFace);
+            const auto root2 = findRoot((uint32_t)face);
+            if (root1 != root2)
+                parents[std::max(root1, root2)] = std::min(root1, root2);
+        }
+
+    // Components are packed into regions in the order of their first triangles
+    std::vector<uint32_t> componentSizes(faceCount, 0);
+    for (size_t face = 0; face < faceCount; face++)
+        componentSizes[findRoot((uint32_t)face)]++;
+
+    const size_t targetRegionSize = (faceCount + maxRegionCount - 1) / maxRegionCount;
+    std::vector<uint32_t> &componentRegions = classFaces; // no longer needed
+    componentRegions.assign(faceCount, 0);
+    size_t regionCount = 0;
+    size_t regionSize = 0;
+    for (size_t root = 0; root < faceCount; root++)
+    {
+        if (componentSizes[root] == 0)
+            continue;
+        if (regionSize >= targetRegionSize)
+        {
+            regionCount++;
+            regionSize = 0;
+        }
+        componentRegions[root] = (uint32_t)regionCount;
+        regionSize += componentSizes[root];
+    }
+    regionCount++;
+
+    if (regionCount < 2)
+        return; // A single large component
+
+    regions.resize(regionCount);
+    for (size_t face = 0; face < faceCount; face++)
+        regions[componentRegions[findRoot((uint32_t)face)]].push_back((uint32_t)face);
+}
+
+
+bool TangentCalculator::Calculate(SceneGeometry &geometry,
+                                  TangentMethod method,
+                                  ThreadPool *pool,
+                                  size_t *regionCount)
+{
+    if (method == TangentMethod::kFast)
+    {
+        if (regionCount)
+            *regionCount = 1;
+        return CalculateFast(geometry);
+    }
+
+    std::vector<std::vector<uint32_t>> regionFaces;
+    if (pool && (pool->GetThreadCount() > 1))
+        SplitIntoRegions(regionFaces, geometry, pool->GetThreadCount() * kRegionsPerThread);
+
+    if (regionCount)
+        *regionCount = std::max<size_t>(regionFaces.size(), 1);
+
+    if (regionFaces.empty())
+    {
+        Region region{ &geometry, nullptr, geometry.GetFacesCount(), false };
+        return CalculateRegion(region);
+    }
+
+    std::vector<char> succeeded(regionFaces.size(), false); // std::vector<bool> is not safe for concurrent writes
+    std::vector<char> edgeOrderDependent(regionFaces.size(), false);
+    pool->ParallelFor(regionFaces.size(), [&](size_t i)
+    {
+        Region region{ &geometry, regionFaces[i].data(), regionFaces[i].size(), false };
+        succeeded[i] = CalculateRegion(region);
+        edgeOrderDependent[i] = region.edgeOrderDependent;
+    });
+
+    if (std::find(succeeded.begin(), succeeded.end(), false) != succeeded.end())
+        return false;
+
+    // Rare, but the serial result cannot be reproduced by regions then
+    if (std::find(edgeOrderDependent.begin(), edgeOrderDependent.end(), true) != edgeOrderDependent.end())
+    {
+        if (regionCount)
+            *regionCount = 1;
+        Region region{ &geometry, nullptr, geometry.GetFacesCount(), false };
+        return CalculateRegion(region);
+    }
+
+    return true;
+}
+
+
+bool TangentCalculator::CalculateFast(SceneGeometry &geometry)
+{
+    if (geometry.GetVerticesPerFace() != 3)
+        return true; // mikktspace ignores such faces as well
+
+    const auto &corners = geometry.GetFaceCorners();
+    const auto &vertices = geometry.GetVertices();
+    const size_t vertexCount = vertices.size();
+    const size_t faceCount = corners.size() / 3;
+    for (const auto corner : corners)
+        if (corner >= vertexCount)
+            return false;
+
+    // SoA streams: vertex attributes followed by tangent and bitangent accumulators
+    enum Stream
+    {
+        kPosX, kPosY, kPosZ, kNormalX, kNormalY, kNormalZ, kTexU, kTexV,
+        kTangentX, kTangentY, kTangentZ, kBitangentX, kBitangentY, kBitangentZ,
+        kStreamCount
+    };
+    std::vector<float> streamData(kStreamCount * vertexCount, 0.f);
+    float *streams[kStreamCount];
+    for (size_t i = 0; i < kStreamCount; i++)
+        streams[i] = streamData.data() + i * vertexCount;
+
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const auto &vertex = vertices[i];
+        streams[kPosX][i]       = vertex.Pos.x;
+        streams[kPosY][i]       = vertex.Pos.y;
+        streams[kPosZ][i]       = vertex.Pos.z;
+        streams[kNormalX][i]    = vertex.Normal.x;
+        streams[kNormalY][i]    = vertex.Normal.y;
+        streams[kNormalZ][i]    = vertex.Normal.z;
+        streams[kTexU][i]       = vertex.Tex.x;
+        streams[kTexV][i]       = vertex.Tex.y;
+    }
+
+    const float *posX = streams[kPosX], *posY = streams[kPosY], *posZ = streams[kPosZ];
+    const float *texU = streams[kTexU], *texV = streams[kTexV];
+    float *tanX = streams[kTangentX], *tanY = streams[kTangentY], *tanZ = streams[kTangentZ];
+    float *bitX = streams[kBitangentX], *bitY = streams[kBitangentY], *bitZ = streams[kBitangentZ];
+
+    // Triangles: tangent directions weighted by the corner angles like in mikktspace
+    for (size_t face = 0; face < faceCount; face++)
+    {
+        const uint32_t i0 = corners[face * 3 + 0];
+        const uint32_t i1 = corners[face * 3 + 1];
+        const uint32_t i2 = corners[face * 3 + 2];
+
+        const float e1x = posX[i1] - posX[i0], e1y = posY[i1] - posY[i0], e1z = posZ[i1] - posZ[i0];
+        const float e2x = posX[i2] - posX[i0], e2y = posY[i2] - posY[i0], e2z = posZ[i2] - posZ[i0];
+        const float du1 = texU[i1] - texU[i0], dv1 = texV[i1] - texV[i0];
+        const float du2 = texU[i2] - texU[i0], dv2 = texV[i2] - texV[i0];
+
+        const float det = du1 * dv2 - du2 * dv1;
+        if (det == 0.f)
+            continue; // Degenerate texture mapping
+        const float orientation = (det > 0.f) ? 1.f : -1.f;
+
+        float tx = (e1x * dv2 - e2x * dv1) * orientation;
+        float ty = (e1y * dv2 - e2y * dv1) * orientation;
+        float tz = (e1z * dv2 - e2z * dv1) * orientation;
+        float bx = (e2x * du1 - e1x * du2) * orientation;
+        float by = (e2y * du1 - e1y * du2) * orientation;
+        float bz = (e2z * du1 - e1z * du2) * orientation;
+
+        const float tLength = std::sqrt(tx * tx + ty * ty + tz * tz);
+        const float bLength = std::sqrt(bx * bx + by * by + bz * bz);
+        if ((tLength == 0.f) || (bLength == 0.f))
+            continue;
+        tx /= tLength; ty /= tLength; tz /= tLength;
+        bx /= bLength; by /= bLength; bz /= bLength;
+
+        const float e3x = posX[i2] - posX[i1], e3y = posY[i2] - posY[i1], e3z = posZ[i2] - posZ[i1];
+        const float angles[3] = { GetAngle( e1x,  e1y,  e1z, e2x, e2y, e2z),
+                                  GetAngle(-e1x, -e1y, -e1z, e3x, e3y, e3z),
+                                  GetAngle(-e2x, -e2y, -e2z, -e3x, -e3y, -e3z) };
+        const uint32_t faceCorners[3] = { i0, i1, i2 };
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            const auto i = faceCorners[corner];
+            const auto weight = angles[corner];
+            tanX[i] += tx * weight; tanY[i] += ty * weight; tanZ[i] += tz * weight;
+            bitX[i] += bx * weight; bitY[i] += by * weight; bitZ[i] += bz * weight;
+        }
+    }
+
+    // Vertices: Gram-Schmidt against the normal, handedness from the bitangent.
+    // The results are stored in place of the accumulated tangent and the bitangent X stream.
+    const float *normalX = streams[kNormalX], *normalY = streams[kNormalY], *normalZ = streams[kNormalZ];
+    float *sign = bitX;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        float nx = normalX[i], ny = normalY[i], nz = normalZ[i];
+        const float nLengthSqr = nx * nx + ny * ny + nz * nz;
+        const float nScale = (nLengthSqr > 0.f) ? 1.f / std::sqrt(nLengthSqr) : 0.f;
+        nx *= nScale; ny *= nScale; nz *= nScale;
+
+        const float nDotT = nx * tanX[i] + ny * tanY[i] + nz * tanZ[i];
+        float tx = tanX[i] - nx * nDotT;
+        float ty = tanY[i] - ny * nDotT;
+        float tz = tanZ[i] - nz * nDotT;
+
+        // Any vector perpendicular to the normal if there is no tangent to orthogonalize
+        const float tLengthSqr = tx * tx + ty * ty + tz * tz;
+        const bool isDegenerate = !(tLengthSqr > 1e-20f);
+        const bool useAxisX = std::abs(nx) < 0.9f;
+        const float fallbackX = useAxisX ? 0.f : -nz;
+        const float fallbackY = useAxisX ? nz : 0.f;
+        const float fallbackZ = useAxisX ? -ny : nx;
+        tx = isDegenerate ? fallbackX : tx;
+        ty = isDegenerate ? fallbackY : ty;
+        tz = isDegenerate ? fallbackZ : tz;
+
+        const float lengthSqr = tx * tx + ty * ty + tz * tz;
+        const float tScale = (lengthSqr > 0.f) ? 1.f / std::sqrt(lengthSqr) : 0.f;
+        tx *= tScale; ty *= tScale; tz *= tScale;
+
+        // Bitangent is expected to be sign * cross(normal, tangent)
+        const float cx = ny * tz - nz * ty;
+        const float cy = nz * tx - nx * tz;
+        const float cz = nx * ty - ny * tx;
+        const float handedness = cx * bitX[i] + cy * bitY[i] + cz * bitZ[i];
+
+        tanX[i] = tx;
+        tanY[i] = ty;
+        tanZ[i] = tz;
+        sign[i] = (handedness < 0.f) ? -1.f : 1.f;
+    }
+
+    for (size_t face = 0; face < faceCount; face++)
+        for (int vertex = 0; vertex < 3; vertex++)
+        {
+            const auto i = corners[face * 3 + vertex];
+            const float tangent[3] = { tanX[i], tanY[i], tanZ[i] };
+            geometry.SetTangent(tangent, sign[i], (int)face, vertex);
+        }
+
+    return true;
+}
+
+
+bool TangentCalculator::CalculateReference(SceneGeometry &geometry)
+{
+    Region region{ &geometry, nullptr, geometry.GetFacesCount(), false };
+    return CalculateRegionCallbacks(region);
+}
+
+
+bool TangentCalculator::CalculateRegion(Region &region)
+{
+    auto &geometry = *region.geometry;
+    if (geometry.GetVerticesPerFace() != 3)
+        return CalculateRegionCallbacks(region);
+
+    const auto &corners = geometry.GetFaceCorners();
+    auto &vertices = geometry.GetVertices();
+    if (region.faceCount == 0)
+        return false; // Same as mikktspace
+    for (size_t i = 0; i < region.faceCount; i++)
+    {
+        const size_t face = region.faces ? region.faces[i] : i;
+        for (size_t vertex = 0; vertex < 3; vertex++)
+            if (corners[face * 3 + vertex] >= vertices.size())
+                return false;
+    }
+
+    SMikkTSpaceMesh mesh;
+    mesh.m_pPositions = &vertices[0].Pos.x;
+    mesh.m_pNormals = &vertices[0].Normal.x;
+    mesh.m_pTexCoords = &vertices[0].Tex.x;
+    mesh.m_pTangents = &vertices[0].Tangent.x;
+    mesh.m_iVertexStride = (int)sizeof(SceneVertex);
+    mesh.m_piIndices = corners.data();
+    mesh.m_piFaces = region.faces;
+    mesh.m_iNrFaces = (int)region.faceCount;
+    tbool edgeOrderDependent = 0;
+    mesh.m_pbEdgeOrderDependent = &edgeOrderDependent;
+
+    const bool succeeded = genTangSpaceMeshDefault(&mesh) == 1;
+    region.edgeOrderDependent = (edgeOrderDependent != 0);
+    return succeeded;
+}
+
+
+bool TangentCalculator::CalculateRegionCallbacks(Region &region)
 {
     SMikkTSpaceInterface iface;
     iface.m_getNumFaces = getNumFaces;
@@ -13,21 +383,28 @@ bool TangentCalculator::Calculate(ScenePrimitive &primitive)
 
     SMikkTSpaceContext context;
     context.m_pInterface = &iface;
-    context.m_pUserData = &primitive;
+    context.m_pUserData = &region;
 
     return genTangSpaceDefault(&context) == 1;
 }
 
 
-ScenePrimitive& TangentCalculator::GetPrimitive(const SMikkTSpaceContext *context)
+TangentCalculator::Region& TangentCalculator::GetRegion(const SMikkTSpaceContext *context)
+{
+    return *static_cast<Region*>(context->m_pUserData);
+}
+
+
+int TangentCalculator::GetGeometryFace(const SMikkTSpaceContext *context, const int face)
 {
-    return *static_cast<ScenePrimitive*>(context->m_pUserData);
+    const auto &region = GetRegion(context);
+    return region.faces ? (int)region.faces[face] : face;
 }
 
 
 int TangentCalculator::getNumFaces(const SMikkTSpaceContext *context)
 {
-    return (int)GetPrimitive(context).GetFacesCount();
+    return (int)GetRegion(context).faceCount;
 }
 
 
@@ -36,7 +413,7 @@ int TangentCalculator::getNumVerticesOfFace(const SMikkTSpaceContext *context,
 {
     face; // unused param
 
-    return (int)GetPrimitive(context).GetVerticesPerFace();
+    return (int)GetRegion(context).geometry->GetVerticesPerFace();
 }
 
 
@@ -45,7 +422,7 @@ void TangentCalculator::getPosition(const SMikkTSpaceContext *context,
                                     const int face,
                                     const int vertex)
 {
-    GetPrimitive(context).GetPosition(outpos, face, vertex);
+    GetRegion(context).geometry->GetPosition(outpos, GetGeometryFace(context, face), vertex);
 }
 
 
@@ -54,7 +431,7 @@ void TangentCalculator::getNormal(const SMikkTSpaceContext *context,
                                   const int face,
                                   const int vertex)
 {
-    GetPrimitive(context).GetNormal(outnormal, face, vertex);
+    GetRegion(context).geometry->GetNormal(outnormal, GetGeometryFace(context, face), vertex);
 }
 
 
@@ -63,7 +440,7 @@ void TangentCalculator::getTexCoord(const SMikkTSpaceContext *context,
                                     const int face,
                                     const int vertex)
 {
-    GetPrimitive(context).GetTextCoord(outuv, face, vertex);
+    GetRegion(context).geometry->GetTextCoord(outuv, GetGeometryFace(context, face), vertex);
 }
 
 
@@ -73,5 +450,5 @@ void TangentCalculator::setTSpaceBasic(const SMikkTSpaceContext *context,
                                        const int face,
                                        const int vertex)
 {
-    GetPrimitive(context).SetTangent(tangent, sign, face, vertex);
+    GetRegion(context).geometry->SetTangent(tangent, sign, GetGeometryFace(context, face), vertex);
 }
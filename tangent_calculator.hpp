@@ -1,17 +1,53 @@
 #pragma once
 
-#include "scene.hpp"
+#include "scene_geometry.hpp"
 #include "mikktspace.hpp"
 
+#include <cstdint>
+
+class ThreadPool;
+
 class TangentCalculator
 {
 public:
     TangentCalculator() = delete; // force abstract
 
-    static bool Calculate(ScenePrimitive &primitive);
+    // If a pool is given, large triangle meshes are split into regions which share no vertex (as
+    // identified by mikktspace: position, normal and texture coordinates) and processed on its workers
+    // (must not be called from a worker of the same pool). The result is bit-identical to the serial one;
+    // if mikktspace reports that a region might not match it, the whole mesh is processed serially again.
+    // The fast method always runs serially.
+    static bool Calculate(SceneGeometry &geometry,
+                          TangentMethod method = TangentMethod::kMikkTSpace,
+                          ThreadPool *pool = nullptr,
+                          size_t *regionCount = nullptr);
+
+    // Serial mikktspace run through the original callback interface. Calculate() with the mikktspace
+    // method reads triangle meshes directly instead and must give bit-identical results.
+    static bool CalculateReference(SceneGeometry &geometry);
 
 private:
-    static ScenePrimitive& GetPrimitive(const SMikkTSpaceContext *context);
+
+    // Single linear pass over SoA copies of the vertex streams: tangents and bitangents of triangles
+    // are accumulated in their vertices, then orthogonalized against the vertex normals (Gram-Schmidt)
+    // and the handedness is taken from the accumulated bitangent. Unlike mikktspace, vertices are
+    // identified by their indices and never split.
+    static bool CalculateFast(SceneGeometry &geometry);
+
+    // Subset of geometry faces processed by a single mikktspace run
+    struct Region
+    {
+        SceneGeometry   *geometry;
+        const uint32_t  *faces;     // Ascending geometry face indices; null for all faces
+        size_t          faceCount;
+        bool            edgeOrderDependent; // Output: a run over all faces could differ (see genTangSpaceMesh())
+    };
+
+    static bool CalculateRegion(Region &region);
+    static bool CalculateRegionCallbacks(Region &region);
+
+    static Region& GetRegion(const SMikkTSpaceContext *context);
+    static int GetGeometryFace(const SMikkTSpaceContext *context, const int face);
 
     static int  getNumFaces(const SMikkTSpaceContext *context);
     static int  getNumVerticesOfFace(const SMikkTSpaceContext *context,
@@ -0,0 +1,194 @@
+// Compares the fast tangents (TangentMethod::kFast) with mikktspace ones for each triangle primitive
+// of the given glTF files: maximum and mean angle between the tangents, number of vertices with
+// a different handedness, and the time taken by both methods.
+//
+// Usage: tangent_validator [repeat count] [glTF files...]
+//
+// Each time is the best of repeat count runs. Without files, the bundled NormalTangentTest and
+// NormalTangentMirrorTest scenes are validated (paths are relative to the Bin directory).
+
+#include "scene.hpp"
+#include "scene_geometry.hpp"
+#include "tangent_calculator.hpp"
+#include "gltf_utils.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+#include "Libs/tinygltf-2.5.0/tiny_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Scene::SceneId sTestScenes[] =
+{
+    Scene::eGltfSampleNormalTangentTest,
+    Scene::eGltfSampleNormalTangentMirrorTest,
+};
+
+
+struct TangentDeviation
+{
+    size_t  vertexCount = 0;
+    size_t  flippedCount = 0;   // Vertices with a different handedness
+    double  maxAngle = 0.;      // Degrees
+    double  angleSum = 0.;
+};
+
+
+// Best time of the given number of runs in ms, tangents are left calculated
+static double MeasureMethod(SceneGeometry &geometry, TangentMethod method, size_t repeatCount)
+{
+    double bestTime = 0.;
+    for (size_t i = 0; i < repeatCount; i++)
+    {
+        const auto start = Clock::now();
+        if (!TangentCalculator::Calculate(geometry, method))
+            return -1.;
+        const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bestTime = (i == 0) ? time : std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+
+static std::vector<SceneMath::Float4> GetTangents(const SceneGeometry &geometry)
+{
+    std::vector<SceneMath::Float4> tangents;
+    tangents.reserve(geometry.GetVertices().size());
+    for (const auto &vertex : geometry.GetVertices())
+        tangents.push_back(vertex.Tangent);
+    return tangents;
+}
+
+
+// Only vertices used by the faces are compared, the others are not touched by either method
+static TangentDeviation GetDeviation(const SceneGeometry &geometry,
+                                     const std::vector<SceneMath::Float4> &referenceTangents)
+{
+    const auto &vertices = geometry.GetVertices();
+    std::vector<char> isUsed(vertices.size(), false);
+    for (const auto corner : geometry.GetFaceCorners())
+        isUsed[corner] = true;
+
+    TangentDeviation deviation;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (!isUsed[i])
+            continue;
+
+        const auto &tangent = vertices[i].Tangent;
+        const auto &reference = referenceTangents[i];
+        const double dot = (double)tangent.x * reference.x + (double)tangent.y * reference.y + (double)tangent.z * reference.z;
+        const double lengths = std::sqrt(((double)tangent.x * tangent.x + (double)tangent.y * tangent.y + (double)tangent.z * tangent.z) *
+                                         ((double)reference.x * reference.x + (double)reference.y * reference.y + (double)reference.z * reference.z));
+        const double cosAngle = (lengths > 0.) ? std::max(-1., std::min(dot / lengths, 1.)) : -1.;
+        const double angle = std::acos(cosAngle) * 180. / SceneMath::kPi;
+
+        deviation.vertexCount++;
+        deviation.maxAngle = std::max(deviation.maxAngle, angle);
+        deviation.angleSum += angle;
+        if (tangent.w != reference.w)
+            deviation.flippedCount++;
+    }
+    return deviation;
+}
+
+
+static void LogDeviation(const std::wstring &name,
+                         const TangentDeviation &deviation,
+                         double mikkTSpaceTime,
+                         double fastTime)
+{
+    Log::Info(L"   %s: %d vertices, max %.3f deg, mean %.3f deg, %d flipped; "
+              L"mikktspace %.3f ms, fast %.3f ms (%.1fx)",
+              name.c_str(),
+              (int)deviation.vertexCount,
+              deviation.maxAngle,
+              (deviation.vertexCount > 0) ? deviation.angleSum / deviation.vertexCount : 0.,
+              (int)deviation.flippedCount,
+              mikkTSpaceTime,
+              fastTime,
+              (fastTime > 0.) ? mikkTSpaceTime / fastTime : 0.);
+}
+
+
+static bool ValidateScene(const std::wstring &filePath, size_t repeatCount)
+{
+    tinygltf::Model model;
+    if (!GltfUtils::LoadModel(model, filePath, true))
+        return false;
+
+    TangentDeviation sceneDeviation;
+    double sceneMikkTSpaceTime = 0.;
+    double sceneFastTime = 0.;
+    for (const auto &mesh : model.meshes)
+        for (int i = 0; i < (int)mesh.primitives.size(); i++)
+        {
+            SceneGeometry geometry;
+            if (!geometry.LoadDataFromGLTF(model, mesh, i, L"   "))
+                return false;
+            if (geometry.GetVerticesPerFace() != 3)
+                continue;
+
+            const double mikkTSpaceTime = MeasureMethod(geometry, TangentMethod::kMikkTSpace, repeatCount);
+            const auto referenceTangents = GetTangents(geometry);
+            const double fastTime = MeasureMethod(geometry, TangentMethod::kFast, repeatCount);
+            if ((mikkTSpaceTime < 0.) || (fastTime < 0.))
+            {
+                Log::Error(L"   Tangents calculation of mesh \"%s\" failed!",
+                           Utils::StringToWstring(mesh.name).c_str());
+                return false;
+            }
+
+            const auto deviation = GetDeviation(geometry, referenceTangents);
+            const auto name = L"Mesh \"" + Utils::StringToWstring(mesh.name) + L"\", primitive " + std::to_wstring(i);
+            LogDeviation(name, deviation, mikkTSpaceTime, fastTime);
+
+            sceneDeviation.vertexCount += deviation.vertexCount;
+            sceneDeviation.flippedCount += deviation.flippedCount;
+            sceneDeviation.maxAngle = std::max(sceneDeviation.maxAngle, deviation.maxAngle);
+            sceneDeviation.angleSum += deviation.angleSum;
+            sceneMikkTSpaceTime += mikkTSpaceTime;
+            sceneFastTime += fastTime;
+        }
+
+    LogDeviation(L"Total", sceneDeviation, sceneMikkTSpaceTime, sceneFastTime);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Log::sLoggingLevel = Log::eInfo;
+
+    const size_t repeatCount = (argc > 1) ? (size_t)std::max(std::atoi(argv[1]), 1) : 3;
+    std::vector<std::wstring> filePaths;
+    for (int i = 2; i < argc; i++)
+        filePaths.push_back(Utils::StringToWstring(argv[i]));
+    if (filePaths.empty())
+        for (const auto sceneId : sTestScenes)
+            filePaths.push_back(Scene::GetSceneFilePath(sceneId));
+
+    int failedCount = 0;
+    for (const auto &filePath : filePaths)
+    {
+        Log::Info(L"Scene \"%s\":", filePath.c_str());
+
+        if (!ValidateScene(filePath, repeatCount))
+        {
+            Log::Error(L"   Failed to validate tangents!");
+            failedCount++;
+        }
+    }
+
+    return failedCount == 0 ? 0 : -1;
+}
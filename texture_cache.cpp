@@ -0,0 +1,69 @@
+#include "texture_cache.hpp"
+
+#include "scene_utils.hpp"
+#include "utils.hpp"
+
+
+TextureCache::~TextureCache()
+{
+    Clear();
+}
+
+
+IDeviceTexture* TextureCache::FindImageTexture(const ImageKey &key)
+{
+    const auto it = mImageTextures.find(key);
+    if (it == mImageTextures.end())
+    {
+        mMissCount++;
+        return nullptr;
+    }
+
+    mHitCount++;
+    return it->second;
+}
+
+
+void TextureCache::AddImageTexture(const ImageKey &key, IDeviceTexture *texture)
+{
+    if (!texture)
+        return;
+
+    auto &cachedTexture = mImageTextures[key];
+    Utils::ReleaseAndMakeNull(cachedTexture);
+    cachedTexture = texture;
+    cachedTexture->AddRef();
+}
+
+
+IDeviceTexture* TextureCache::GetConstantTexture(IRenderingContext &ctx, const SceneMath::Float4 &value)
+{
+    const std::array<float, 4> key = { { value.x, value.y, value.z, value.w } };
+
+    const auto it = mConstantTextures.find(key);
+    if (it != mConstantTextures.end())
+    {
+        mHitCount++;
+        return it->second;
+    }
+
+    mMissCount++;
+    IDeviceTexture *texture = nullptr;
+    if (!SceneUtils::CreateConstantTextureSRV(ctx, texture, value))
+        return nullptr;
+    mConstantTextures[key] = texture;
+
+    return texture;
+}
+
+
+void TextureCache::Clear()
+{
+    for (auto &item : mImageTextures)
+        Utils::ReleaseAndMakeNull(item.second);
+    for (auto &item : mConstantTextures)
+        Utils::ReleaseAndMakeNull(item.second);
+
+    mImageTextures.clear();
+    mConstantTextures.clear();
+}
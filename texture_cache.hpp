@@ -0,0 +1,63 @@
+#pragma once
+
+#include "irenderingcontext.hpp"
+#include "scene_math.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+
+// Device textures shared by materials of one or more scenes, so that identical textures are decoded
+// and uploaded just once. Textures created from glTF images are keyed by the scene file, the image
+// and the way its texels are stored; neutral constant textures are keyed by their value.
+// The cache holds its own reference of each texture, users take their own ones.
+// All scenes sharing a cache must use the same rendering context.
+class TextureCache
+{
+public:
+
+    struct ImageKey
+    {
+        std::wstring    sourcePath;
+        int             imageIdx;
+        bool            isSrgb;
+        uint32_t        encodingKey; // See SceneTexture::GetEncodingKey()
+
+        bool operator <(const ImageKey &other) const
+        {
+            return std::tie(sourcePath, imageIdx, isSrgb, encodingKey) <
+                   std::tie(other.sourcePath, other.imageIdx, other.isSrgb, other.encodingKey);
+        }
+    };
+
+    TextureCache() {}
+    ~TextureCache();
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache& operator =(const TextureCache &) = delete;
+
+    // Returned textures are owned by the cache; users must add their own reference to keep them
+
+    IDeviceTexture* FindImageTexture(const ImageKey &key);
+    void            AddImageTexture(const ImageKey &key, IDeviceTexture *texture);
+
+    // Creates the texture upon the first request
+    IDeviceTexture* GetConstantTexture(IRenderingContext &ctx, const SceneMath::Float4 &value);
+
+    // Releases references of all textures
+    void            Clear();
+
+    size_t          GetTextureCount() const { return mImageTextures.size() + mConstantTextures.size(); }
+    uint64_t        GetHitCount()     const { return mHitCount; }
+    uint64_t        GetMissCount()    const { return mMissCount; }
+
+private:
+
+    std::map<ImageKey, IDeviceTexture*>                 mImageTextures;
+    std::map<std::array<float, 4>, IDeviceTexture*>     mConstantTextures;
+
+    uint64_t    mHitCount = 0;
+    uint64_t    mMissCount = 0;
+};
@@ -0,0 +1,104 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = GetHardwareThreadCount();
+
+    mWorkers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+        mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mTaskAvailable.notify_all();
+
+    for (auto &worker : mWorkers)
+        worker.join();
+}
+
+
+size_t ThreadPool::GetHardwareThreadCount()
+{
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+        mUnfinishedTasks++;
+    }
+    mTaskAvailable.notify_one();
+}
+
+
+void ThreadPool::WaitAll()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mAllTasksFinished.wait(lock, [this] { return mUnfinishedTasks == 0; });
+}
+
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+    if (count == 0)
+        return;
+
+    std::atomic<size_t> nextIndex(0);
+    size_t runningChunks = std::min(count, GetThreadCount());
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+
+    const size_t chunkCount = runningChunks;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        Enqueue([&]()
+        {
+            for (size_t i = nextIndex++; i < count; i = nextIndex++)
+                job(i);
+
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--runningChunks == 0)
+                doneCondition.notify_one();
+        });
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [&] { return runningChunks == 0; });
+}
+
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTaskAvailable.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+            if (mStopping && mTasks.empty())
+                return;
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mUnfinishedTasks == 0)
+                mAllTasksFinished.notify_all();
+        }
+    }
+}
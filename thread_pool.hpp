@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads processing queued tasks in FIFO order
+class ThreadPool
+{
+public:
+
+    // Zero thread count means one worker per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator =(const ThreadPool &) = delete;
+
+    size_t GetThreadCount() const { return mWorkers.size(); }
+
+    void Enqueue(std::function<void()> task);
+
+    // Blocks until all enqueued tasks are finished
+    void WaitAll();
+
+    // Calls job(i) for each i in [0, count) on the workers and waits until all calls are finished.
+    // Indices are handed out dynamically, so the job must not depend on the order of execution.
+    // Must not be called from a worker thread of the same pool.
+    void ParallelFor(size_t count, const std::function<void(size_t)> &job);
+
+    static size_t GetHardwareThreadCount();
+
+private:
+
+    void WorkerLoop();
+
+private:
+
+    std::vector<std::thread>            mWorkers;
+    std::deque<std::function<void()>>   mTasks;
+    size_t                              mUnfinishedTasks = 0; // queued or running
+    bool                                mStopping = false;
+
+    std::mutex                          mMutex;
+    std::condition_variable             mTaskAvailable;
+    std::condition_variable             mAllTasksFinished;
+};
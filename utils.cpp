@@ -5,6 +5,15 @@
 #include <codecvt>
 
 #include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 
 
 std::wstring Utils::GetFilePathExt(const std::wstring &path)
@@ -51,3 +60,42 @@ float Utils::ModX(float x, float y)
 
     return result;
 }
+
+
+uint64_t Utils::Hash64(const void *data, size_t size, uint64_t hash)
+{
+    const uint64_t prime = 1099511628211ull;
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (; size >= 8; size -= 8, bytes += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32; // Multiplication only propagates upwards; fold high bits back
+    }
+    for (; size > 0; size--, bytes++)
+        hash = (hash ^ *bytes) * prime;
+
+    return hash;
+}
+
+
+size_t Utils::GetPeakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss; // Bytes
+#else
+    return (size_t)usage.ru_maxrss * 1024; // Kilobytes
+#endif
+#endif
+}
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <windows.h>
 #include <stdio.h>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
 
 namespace Utils
 {
@@ -59,4 +61,11 @@ namespace Utils
     }
 
     float ModX(float x, float y);
+
+    // Fast non-cryptographic hash (FNV-1a consuming 8 bytes at a time). The hash of a previous
+    // block can be passed in to continue hashing.
+    uint64_t Hash64(const void *data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+    // Peak resident memory of the process in bytes (0 if not available)
+    size_t GetPeakMemoryUsage();
 }
@@ -0,0 +1,247 @@
+#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace SceneMath;
+
+
+bool VertexDequantization::operator ==(const VertexDequantization &other) const
+{
+    return memcmp(this, &other, sizeof(VertexDequantization)) == 0;
+}
+
+
+uint32_t VertexPacking::GetVertexSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::kCompact:    return sizeof(CompactSceneVertex);
+    case VertexFormat::kQuantized:  return sizeof(QuantizedSceneVertex);
+    default:                        return sizeof(SceneVertex);
+    }
+}
+
+
+static float Dot(const Float3 &a, const Float3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+static int16_t FloatToSnorm16(float value)
+{
+    value = std::min(std::max(value, -1.f), 1.f);
+    return (int16_t)std::lround(value * 32767.f);
+}
+
+
+static uint16_t FloatToUnorm16(float value)
+{
+    value = std::min(std::max(value, 0.f), 1.f);
+    return (uint16_t)std::lround(value * 65535.f);
+}
+
+
+void VertexPacking::GetTangentPlaneBasis(const Float3 &n, Float3 &b1, Float3 &b2)
+{
+    const float sign = (n.z >= 0.f) ? 1.f : -1.f;
+    const float a = -1.f / (sign + n.z);
+    const float b = n.x * n.y * a;
+    b1 = Float3(1.f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    b2 = Float3(b, sign + n.y * n.y * a, -n.y);
+}
+
+
+void VertexPacking::EncodeOctahedral(int16_t encoded[2], const Float3 &v)
+{
+    const float norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (norm <= 0.f)
+    {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+
+    float x = v.x / norm;
+    float y = v.y / norm;
+    if (v.z < 0.f)
+    {
+        // Fold the lower hemisphere over the diagonals
+        const float foldedX = (1.f - std::abs(y)) * ((x >= 0.f) ? 1.f : -1.f);
+        const float foldedY = (1.f - std::abs(x)) * ((y >= 0.f) ? 1.f : -1.f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = FloatToSnorm16(x);
+    encoded[1] = FloatToSnorm16(y);
+}
+
+
+Float3 VertexPacking::DecodeOctahedral(const int16_t encoded[2])
+{
+    const float x = std::max(encoded[0] / 32767.f, -1.f);
+    const float y = std::max(encoded[1] / 32767.f, -1.f);
+
+    Float3 v(x, y, 1.f - std::abs(x) - std::abs(y));
+    const float t = std::max(-v.z, 0.f);
+    v.x += (v.x >= 0.f) ? -t : t;
+    v.y += (v.y >= 0.f) ? -t : t;
+
+    const float length = std::sqrt(Dot(v, v));
+    return Float3(v.x / length, v.y / length, v.z / length);
+}
+
+
+uint16_t VertexPacking::FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff)
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0); // Inf or NaN
+
+    const int32_t halfExponent = (int32_t)exponent - 127 + 15;
+    if (halfExponent >= 31)
+        return sign | 0x7c00; // Overflow to Inf
+    if (halfExponent <= 0)
+    {
+        // Denormalized half or zero
+        if (halfExponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        const uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            half++;
+        return sign | (uint16_t)half;
+    }
+
+    // Rounding may carry over to the exponent, which is the correct result
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        half++;
+    return sign | (uint16_t)half;
+}
+
+
+// Octahedral normal, tangent angle in the normal's tangent plane and bitangent sign
+static void PackNormalTangent(int16_t packed[4], const SceneVertex &vertex)
+{
+    VertexPacking::EncodeOctahedral(packed, vertex.Normal);
+
+    // The angle is measured relative to the basis of the decoded normal, as in the shader
+    const Float3 normal = VertexPacking::DecodeOctahedral(packed);
+    Float3 b1, b2;
+    VertexPacking::GetTangentPlaneBasis(normal, b1, b2);
+
+    const Float3 tangent(vertex.Tangent.x, vertex.Tangent.y, vertex.Tangent.z);
+    const float angle = std::atan2(Dot(tangent, b2), Dot(tangent, b1));
+
+    packed[2] = FloatToSnorm16(angle / kPi);
+    packed[3] = (vertex.Tangent.w < 0.f) ? -32767 : 32767;
+}
+
+
+void VertexPacking::PackVertices(std::vector<uint8_t> &packed,
+                                 VertexDequantization &dequantization,
+                                 VertexFormat format,
+                                 const SceneVertex *vertices,
+                                 size_t vertexCount)
+{
+    dequantization = VertexDequantization();
+    packed.resize(vertexCount * GetVertexSize(format));
+
+    switch (format)
+    {
+    case VertexFormat::kCompact:
+    {
+        auto compactVertices = reinterpret_cast<CompactSceneVertex*>(packed.data());
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const auto &vertex = vertices[i];
+            auto &compactVertex = compactVertices[i];
+            compactVertex.Pos = vertex.Pos;
+            PackNormalTangent(compactVertex.NormalTangent, vertex);
+            compactVertex.Tex[0] = FloatToHalf(vertex.Tex.x);
+            compactVertex.Tex[1] = FloatToHalf(vertex.Tex.y);
+        }
+        break;
+    }
+
+    case VertexFormat::kQuantized:
+    {
+        if (vertexCount == 0)
+            break;
+
+        // Ranges of positions and texture coordinates
+        float posMin[3], posMax[3], texMin[2], texMax[2];
+        for (size_t k = 0; k < 3; k++)
+            posMin[k] = posMax[k] = (&vertices[0].Pos.x)[k];
+        for (size_t k = 0; k < 2; k++)
+            texMin[k] = texMax[k] = (&vertices[0].Tex.x)[k];
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                posMin[k] = std::min(posMin[k], (&vertices[i].Pos.x)[k]);
+                posMax[k] = std::max(posMax[k], (&vertices[i].Pos.x)[k]);
+            }
+            for (size_t k = 0; k < 2; k++)
+            {
+                texMin[k] = std::min(texMin[k], (&vertices[i].Tex.x)[k]);
+                texMax[k] = std::max(texMax[k], (&vertices[i].Tex.x)[k]);
+            }
+        }
+        float posRange[3], texRange[2];
+        for (size_t k = 0; k < 3; k++)
+            posRange[k] = posMax[k] - posMin[k];
+        for (size_t k = 0; k < 2; k++)
+            texRange[k] = texMax[k] - texMin[k];
+
+        auto quantizedVertices = reinterpret_cast<QuantizedSceneVertex*>(packed.data());
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const auto &vertex = vertices[i];
+            auto &quantizedVertex = quantizedVertices[i];
+            for (size_t k = 0; k < 3; k++)
+                quantizedVertex.Pos[k] = (posRange[k] > 0.f) ?
+                    FloatToUnorm16(((&vertex.Pos.x)[k] - posMin[k]) / posRange[k]) : 0;
+            quantizedVertex.Pos[3] = 0;
+            PackNormalTangent(quantizedVertex.NormalTangent, vertex);
+            for (size_t k = 0; k < 2; k++)
+                quantizedVertex.Tex[k] = (texRange[k] > 0.f) ?
+                    FloatToUnorm16(((&vertex.Tex.x)[k] - texMin[k]) / texRange[k]) : 0;
+        }
+
+        dequantization.PosScale         = Float4(posRange[0], posRange[1], posRange[2], 0.f);
+        dequantization.PosOffset        = Float4(posMin[0], posMin[1], posMin[2], 1.f);
+        dequantization.TexScaleOffset   = Float4(texRange[0], texRange[1], texMin[0], texMin[1]);
+        break;
+    }
+
+    default:
+        if (vertexCount > 0)
+            memcpy(packed.data(), vertices, packed.size());
+        break;
+    }
+}
+
+
+bool VertexPacking::CanUse16BitIndices(uint32_t vertexCount)
+{
+    return vertexCount <= 0xffff;
+}
+
+
+void VertexPacking::PackIndices16(std::vector<uint16_t> &packed, const uint32_t *indices, size_t indexCount)
+{
+    packed.resize(indexCount);
+    for (size_t i = 0; i < indexCount; i++)
+        packed[i] = (indices[i] == 0xffffffff) ? (uint16_t)0xffff : (uint16_t)indices[i];
+}
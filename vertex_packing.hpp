@@ -0,0 +1,79 @@
+#pragma once
+
+// ------------------------------------------------------------------------------------------------
+// Compact device vertex layouts packed from SceneVertex. Normals are octahedral-encoded; tangents
+// are stored as an angle in the tangent plane of the normal (relative to the basis built by
+// GetTangentPlaneBasis(), which the vertex shader rebuilds the same way) together with the sign
+// of the bitangent. The quantized layout also stores positions and texture coordinates as 16-bit
+// normalized values of their per-primitive ranges.
+// ------------------------------------------------------------------------------------------------
+
+#include "scene_geometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class VertexFormat
+{
+    kFull,      // SceneVertex, 60 bytes
+    kCompact,   // CompactSceneVertex, 24 bytes
+    kQuantized, // QuantizedSceneVertex, 20 bytes
+};
+
+
+struct CompactSceneVertex
+{
+    SceneMath::Float3   Pos;
+    int16_t             NormalTangent[4];   // snorm: octahedral normal xy, tangent angle / pi, bitangent sign
+    uint16_t            Tex[2];             // half float
+};
+
+
+struct QuantizedSceneVertex
+{
+    uint16_t            Pos[4];             // unorm within the position range, w is unused
+    int16_t             NormalTangent[4];   // See CompactSceneVertex
+    uint16_t            Tex[2];             // unorm within the texture coordinates range
+};
+
+
+// Restores quantized values in the vertex shader: value = packed * scale + offset
+struct VertexDequantization
+{
+    SceneMath::Float4   PosScale        = SceneMath::Float4(1.f, 1.f, 1.f, 0.f);
+    SceneMath::Float4   PosOffset       = SceneMath::Float4(0.f, 0.f, 0.f, 1.f);
+    SceneMath::Float4   TexScaleOffset  = SceneMath::Float4(1.f, 1.f, 0.f, 0.f); // xy scale, zw offset
+
+    bool operator ==(const VertexDequantization &other) const;
+    bool operator !=(const VertexDequantization &other) const { return !(*this == other); }
+};
+
+
+namespace VertexPacking
+{
+    uint32_t GetVertexSize(VertexFormat format);
+
+    // Fills the device vertex data of the given format; dequantization stays identity unless
+    // the format is quantized
+    void PackVertices(std::vector<uint8_t> &packed,
+                      VertexDequantization &dequantization,
+                      VertexFormat format,
+                      const SceneVertex *vertices,
+                      size_t vertexCount);
+
+    // Indices fit into 16 bits if the largest one is below the 16-bit strip cut value
+    bool CanUse16BitIndices(uint32_t vertexCount);
+
+    // Strip cut values are kept as strip cut values
+    void PackIndices16(std::vector<uint16_t> &packed, const uint32_t *indices, size_t indexCount);
+
+    // Orthonormal basis of the plane perpendicular to a unit normal (Duff et al., "Building an
+    // Orthonormal Basis, Revisited", 2017); matches the vertex shader
+    void GetTangentPlaneBasis(const SceneMath::Float3 &normal, SceneMath::Float3 &b1, SceneMath::Float3 &b2);
+
+    void EncodeOctahedral(int16_t encoded[2], const SceneMath::Float3 &unitVector);
+    SceneMath::Float3 DecodeOctahedral(const int16_t encoded[2]);
+
+    uint16_t FloatToHalf(float value);
+}